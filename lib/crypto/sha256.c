@@ -41,8 +41,8 @@
 #include "includes.h"
 #include "sha256.h"
 
-#define Ch(x,y,z) (((x) & (y)) ^ ((~(x)) & (z)))
-#define Maj(x,y,z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define Ch(x,y,z) ((((y) ^ (z)) & (x)) ^ (z))
+#define Maj(x,y,z) (((x) & (y)) | (((x) | (y)) & (z)))
 
 #define ROTR(x,n)   (((x)>>(n)) | ((x) << (32 - (n))))
 
@@ -94,12 +94,65 @@ SHA256_Init (SHA256_CTX *m)
     H = 0x5be0cd19;
 }
 
+/*
+ * Load a big endian word. Written with shifts so that the compiler can
+ * turn it into a single load and byte swap, independent of alignment.
+ */
+#define LOAD_BE32(p) \
+    (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | \
+     ((uint32_t)(p)[2] << 8) | ((uint32_t)(p)[3]))
+
+/*
+ * One round. Instead of shifting the eight working variables after each
+ * round, the callers rotate the argument list, so that only d and h are
+ * written.
+ */
+#define ROUND(a,b,c,d,e,f,g,h,i,w) do { \
+    uint32_t T1 = (h) + Sigma1(e) + Ch(e,f,g) + constant_256[i] + (w); \
+    (d) += T1; \
+    (h) = T1 + Sigma0(a) + Maj(a,b,c); \
+} while (0)
+
+/*
+ * The message schedule only ever needs the last 16 words, keep them in
+ * a ring buffer.
+ */
+#define W(i) (data[(i) & 15])
+#define SCHEDULE(i) \
+    (W(i) += sigma1(W((i) - 2)) + W((i) - 7) + sigma0(W((i) - 15)))
+
+#define ROUNDS8_LOAD(i) do { \
+    W(i+0) = LOAD_BE32(p + 4*(i+0)); ROUND(AA,BB,CC,DD,EE,FF,GG,HH,i+0,W(i+0)); \
+    W(i+1) = LOAD_BE32(p + 4*(i+1)); ROUND(HH,AA,BB,CC,DD,EE,FF,GG,i+1,W(i+1)); \
+    W(i+2) = LOAD_BE32(p + 4*(i+2)); ROUND(GG,HH,AA,BB,CC,DD,EE,FF,i+2,W(i+2)); \
+    W(i+3) = LOAD_BE32(p + 4*(i+3)); ROUND(FF,GG,HH,AA,BB,CC,DD,EE,i+3,W(i+3)); \
+    W(i+4) = LOAD_BE32(p + 4*(i+4)); ROUND(EE,FF,GG,HH,AA,BB,CC,DD,i+4,W(i+4)); \
+    W(i+5) = LOAD_BE32(p + 4*(i+5)); ROUND(DD,EE,FF,GG,HH,AA,BB,CC,i+5,W(i+5)); \
+    W(i+6) = LOAD_BE32(p + 4*(i+6)); ROUND(CC,DD,EE,FF,GG,HH,AA,BB,i+6,W(i+6)); \
+    W(i+7) = LOAD_BE32(p + 4*(i+7)); ROUND(BB,CC,DD,EE,FF,GG,HH,AA,i+7,W(i+7)); \
+} while (0)
+
+#define ROUNDS8(i) do { \
+    ROUND(AA,BB,CC,DD,EE,FF,GG,HH,i+0,SCHEDULE(i+0)); \
+    ROUND(HH,AA,BB,CC,DD,EE,FF,GG,i+1,SCHEDULE(i+1)); \
+    ROUND(GG,HH,AA,BB,CC,DD,EE,FF,i+2,SCHEDULE(i+2)); \
+    ROUND(FF,GG,HH,AA,BB,CC,DD,EE,i+3,SCHEDULE(i+3)); \
+    ROUND(EE,FF,GG,HH,AA,BB,CC,DD,i+4,SCHEDULE(i+4)); \
+    ROUND(DD,EE,FF,GG,HH,AA,BB,CC,i+5,SCHEDULE(i+5)); \
+    ROUND(CC,DD,EE,FF,GG,HH,AA,BB,i+6,SCHEDULE(i+6)); \
+    ROUND(BB,CC,DD,EE,FF,GG,HH,AA,i+7,SCHEDULE(i+7)); \
+} while (0)
+
+/*
+ * Process one 64 byte block. p does not need to be aligned, full blocks
+ * are hashed directly from the caller's buffer without copying them to
+ * m->save first.
+ */
 static void
-calc (SHA256_CTX *m, uint32_t *in)
+calc (SHA256_CTX *m, const unsigned char *p)
 {
     uint32_t AA, BB, CC, DD, EE, FF, GG, HH;
-    uint32_t data[64];
-    int i;
+    uint32_t data[16];
 
     AA = A;
     BB = B;
@@ -110,27 +163,14 @@ calc (SHA256_CTX *m, uint32_t *in)
     GG = G;
     HH = H;
 
-    for (i = 0; i < 16; ++i)
-	data[i] = in[i];
-    for (i = 16; i < 64; ++i)
-	data[i] = sigma1(data[i-2]) + data[i-7] + 
-	    sigma0(data[i-15]) + data[i - 16];
-
-    for (i = 0; i < 64; i++) {
-	uint32_t T1, T2;
-
-	T1 = HH + Sigma1(EE) + Ch(EE, FF, GG) + constant_256[i] + data[i];
-	T2 = Sigma0(AA) + Maj(AA,BB,CC);
-			     
-	HH = GG;
-	GG = FF;
-	FF = EE;
-	EE = DD + T1;
-	DD = CC;
-	CC = BB;
-	BB = AA;
-	AA = T1 + T2;
-    }
+    ROUNDS8_LOAD(0);
+    ROUNDS8_LOAD(8);
+    ROUNDS8(16);
+    ROUNDS8(24);
+    ROUNDS8(32);
+    ROUNDS8(40);
+    ROUNDS8(48);
+    ROUNDS8(56);
 
     A += AA;
     B += BB;
@@ -142,50 +182,6 @@ calc (SHA256_CTX *m, uint32_t *in)
     H += HH;
 }
 
-/*
- * From `Performance analysis of MD5' by Joseph D. Touch <touch@isi.edu>
- */
-
-#if !defined(WORDS_BIGENDIAN) || defined(_CRAY)
-/* Vector Crays doesn't have a good 32-bit type, or more precisely,
-   int32_t as defined by <bind/bitypes.h> isn't 32 bits, and we don't
-   want to depend in being able to redefine this type.  To cope with
-   this we have to clamp the result in some places to [0,2^32); no
-   need to do this on other machines.  Did I say this was a mess?
-   */
-
-#ifdef _CRAY
-#define CRAYFIX(X) ((X) & 0xffffffff)
-#else
-#define CRAYFIX(X) (X)
-#endif
-
-static inline uint32_t
-cshift (uint32_t x, unsigned int n)
-{
-    x = CRAYFIX(x);
-    return CRAYFIX((x << n) | (x >> (32 - n)));
-}
-
-static inline uint32_t
-swap_uint32_t (uint32_t t)
-{
-    uint32_t temp1, temp2;
-
-    temp1   = cshift(t, 16);
-    temp2   = temp1 >> 8;
-    temp1  &= 0x00ff00ff;
-    temp2  &= 0x00ff00ff;
-    temp1 <<= 8;
-    return temp1 | temp2;
-}
-#endif
-
-struct x32{
-    unsigned int a:32;
-    unsigned int b:32;
-};
-
 void
 SHA256_Update (SHA256_CTX *m, const void *v, size_t len)
 {
@@ -197,28 +193,26 @@ SHA256_Update (SHA256_CTX *m, const void *v, size_t len)
     if (m->sz[0] < old_sz)
 	++m->sz[1];
     offset = (old_sz / 8) % 64;
-    while(len > 0){
+
+    if (offset != 0) {
 	size_t l = MIN(len, 64 - offset);
 	memcpy(m->save + offset, p, l);
 	offset += l;
 	p += l;
 	len -= l;
-	if(offset == 64){
-#if !defined(WORDS_BIGENDIAN) || defined(_CRAY)
-	    int i;
-	    uint32_t current[16];
-	    struct x32 *u = (struct x32*)m->save;
-	    for(i = 0; i < 8; i++){
-		current[2*i+0] = swap_uint32_t(u[i].a);
-		current[2*i+1] = swap_uint32_t(u[i].b);
-	    }
-	    calc(m, current);
-#else
-	    calc(m, (uint32_t*)m->save);
-#endif
-	    offset = 0;
-	}
+	if (offset < 64)
+	    return;
+	calc(m, m->save);
     }
+
+    while (len >= 64) {
+	calc(m, p);
+	p += 64;
+	len -= 64;
+    }
+
+    if (len > 0)
+	memcpy(m->save, p, len);
 }
 
 void
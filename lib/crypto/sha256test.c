@@ -0,0 +1,149 @@
+/* 
+   Unix SMB/CIFS implementation.
+   SHA256 tests
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+   
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "includes.h"
+#include "../lib/crypto/crypto.h"
+
+struct torture_context;
+
+/*
+ This uses the test values from FIPS 180-2
+*/
+bool torture_local_crypto_sha256(struct torture_context *torture) 
+{
+	bool ret = true;
+	uint32_t i;
+	struct {
+		const char *data;
+		const char *sha256;
+	} testarray[] = {
+	{
+		.data	= "",
+		.sha256	= "e3b0c44298fc1c149afbf4c8996fb924"
+			  "27ae41e4649b934ca495991b7852b855"
+	},{
+		.data	= "abc",
+		.sha256	= "ba7816bf8f01cfea414140de5dae2223"
+			  "b00361a396177a9cb410ff61f20015ad"
+	},{
+		.data	= "abcdbcdecdefdefgefghfghighijhijk"
+			  "ijkljklmklmnlmnomnopnopq",
+		.sha256	= "248d6a61d20638b8e5c026930c3e6039"
+			  "a33ce45964ff2167f6ecedd419db06c1"
+	},{
+		.data	= "abcdefghbcdefghicdefghijdefghijk"
+			  "efghijklfghijklmghijklmnhijklmno"
+			  "ijklmnopjklmnopqklmnopqrlmnopqrs"
+			  "mnopqrstnopqrstu",
+		.sha256	= "cf5b16a778af8380036ce59e7b049237"
+			  "0b249b11e8f07a51afac45037afee9d1"
+	}
+	};
+
+	for (i=0; i < ARRAY_SIZE(testarray); i++) {
+		SHA256_CTX ctx;
+		uint8_t sha256[SHA256_DIGEST_LENGTH];
+		uint8_t split[SHA256_DIGEST_LENGTH];
+		size_t ofs;
+		int e;
+
+		DATA_BLOB data;
+		DATA_BLOB sha256blob;
+
+		data = data_blob_string_const(testarray[i].data);
+		sha256blob  = strhex_to_data_blob(NULL, testarray[i].sha256);
+
+		SHA256_Init(&ctx);
+		SHA256_Update(&ctx, data.data, data.length);
+		SHA256_Final(sha256, &ctx);
+
+		/* feed the same data byte by byte, must give the same result */
+		SHA256_Init(&ctx);
+		for (ofs = 0; ofs < data.length; ofs++) {
+			SHA256_Update(&ctx, data.data + ofs, 1);
+		}
+		SHA256_Final(split, &ctx);
+
+		e = memcmp(sha256blob.data,
+			   sha256,
+			   MIN(sha256blob.length, sizeof(sha256)));
+		if (e == 0) {
+			e = memcmp(sha256, split, sizeof(sha256));
+		}
+		if (e != 0) {
+			printf("sha256 test[%u]: failed\n", i);
+			dump_data(0, data.data, data.length);
+			dump_data(0, sha256blob.data, sha256blob.length);
+			dump_data(0, sha256, sizeof(sha256));
+			dump_data(0, split, sizeof(split));
+			ret = false;
+		}
+		talloc_free(sha256blob.data);
+	}
+
+	return ret;
+}
+
+/*
+ Measure the throughput of SHA256 and of HMAC-SHA256 over SMB2 sized
+ buffers, the latter is what SMB2 signing costs per PDU.
+*/
+bool torture_local_crypto_sha256_speed(struct torture_context *torture)
+{
+	static const size_t sizes[] = { 64, 1024, 65536, 1024*1024 };
+	const size_t total = 16*1024*1024;
+	uint8_t key[16];
+	uint8_t *buf;
+	uint32_t i;
+
+	buf = talloc_array(NULL, uint8_t, sizes[ARRAY_SIZE(sizes)-1] + 1);
+	if (buf == NULL) {
+		return false;
+	}
+	for (i=0; i < talloc_array_length(buf); i++) {
+		buf[i] = (uint8_t)(i * 7);
+	}
+	memset(key, 0x0b, sizeof(key));
+
+	for (i=0; i < ARRAY_SIZE(sizes); i++) {
+		struct timeval start;
+		double elapsed;
+		size_t count = total / sizes[i];
+		size_t n;
+
+		start = timeval_current();
+		for (n=0; n < count; n++) {
+			struct HMACSHA256Context ctx;
+			uint8_t res[SHA256_DIGEST_LENGTH];
+
+			/* use an unaligned buffer, as SMB2 payloads are */
+			hmac_sha256_init(key, sizeof(key), &ctx);
+			hmac_sha256_update(buf + 1, sizes[i], &ctx);
+			hmac_sha256_final(res, &ctx);
+		}
+		elapsed = timeval_elapsed(&start);
+
+		printf("hmac-sha256 %7u bytes: %8.1f MB/sec %10.0f ops/sec\n",
+		       (unsigned int)sizes[i],
+		       elapsed > 0 ? total / (1024*1024*elapsed) : 0.0,
+		       elapsed > 0 ? count / elapsed : 0.0);
+	}
+
+	talloc_free(buf);
+	return true;
+}
@@ -38,7 +38,8 @@ static bool tdb_check_header(struct tdb_context *tdb, tdb_off_t *recovery)
 	if (hdr.version != TDB_VERSION)
 		goto corrupt;
 
-	if (hdr.rwlocks != 0)
+	if (hdr.rwlocks != 0 && hdr.rwlocks != TDB_HASH_RWLOCK_MAGIC &&
+	    hdr.rwlocks != TDB_FEATURE_FLAG_MAGIC)
 		goto corrupt;
 
 	if (hdr.hash_size == 0)
@@ -0,0 +1,125 @@
+ /*
+   Unix SMB/CIFS implementation.
+
+   trivial database library
+
+   Copyright (C) Andrew Tridgell              1999-2005
+   Copyright (C) Bob Jenkins                  2006
+
+     ** NOTE! The following LGPL license applies to the tdb
+     ** library. This does NOT imply that all of Samba is released
+     ** under the LGPL
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tdb_private.h"
+
+/* This is based on the hash algorithm from gdbm */
+unsigned int tdb_old_hash(TDB_DATA *key)
+{
+	uint32_t value;	/* Used to compute the hash value.  */
+	uint32_t   i;	/* Used to cycle through random values. */
+
+	/* Set the initial value from the key size. */
+	for (value = 0x238F13AF * key->dsize, i=0; i < key->dsize; i++)
+		value = (value + (key->dptr[i] << (i*5 % 24)));
+
+	return (1103515243 * value + 12345);
+}
+
+/*
+  hashlittle() from lookup3.c by Bob Jenkins, May 2006, Public Domain.
+
+  Only the byte at a time variant is used. It gives the same result on
+  all platforms, which is what we need for a hash that is recorded in
+  the database header.
+*/
+
+#define rot(x,k) (((x)<<(k)) | ((x)>>(32-(k))))
+
+#define mix(a,b,c) \
+{ \
+  a -= c;  a ^= rot(c, 4);  c += b; \
+  b -= a;  b ^= rot(a, 6);  a += c; \
+  c -= b;  c ^= rot(b, 8);  b += a; \
+  a -= c;  a ^= rot(c,16);  c += b; \
+  b -= a;  b ^= rot(a,19);  a += c; \
+  c -= b;  c ^= rot(b, 4);  b += a; \
+}
+
+#define final(a,b,c) \
+{ \
+  c ^= b; c -= rot(b,14); \
+  a ^= c; a -= rot(c,11); \
+  b ^= a; b -= rot(a,25); \
+  c ^= b; c -= rot(b,16); \
+  a ^= c; a -= rot(c,4);  \
+  b ^= a; b -= rot(a,14); \
+  c ^= b; c -= rot(b,24); \
+}
+
+static uint32_t hashlittle(const void *key, size_t length)
+{
+	const uint8_t *k = (const uint8_t *)key;
+	uint32_t a, b, c;
+
+	/* Set up the internal state */
+	a = b = c = 0xdeadbeef + ((uint32_t)length);
+
+	/* all but the last block: affect some 32 bits of (a,b,c) */
+	while (length > 12) {
+		a += k[0];
+		a += ((uint32_t)k[1])<<8;
+		a += ((uint32_t)k[2])<<16;
+		a += ((uint32_t)k[3])<<24;
+		b += k[4];
+		b += ((uint32_t)k[5])<<8;
+		b += ((uint32_t)k[6])<<16;
+		b += ((uint32_t)k[7])<<24;
+		c += k[8];
+		c += ((uint32_t)k[9])<<8;
+		c += ((uint32_t)k[10])<<16;
+		c += ((uint32_t)k[11])<<24;
+		mix(a,b,c);
+		length -= 12;
+		k += 12;
+	}
+
+	/* last block: affect all 32 bits of (c) */
+	switch (length) {	/* all the case statements fall through */
+	case 12: c+=((uint32_t)k[11])<<24;
+	case 11: c+=((uint32_t)k[10])<<16;
+	case 10: c+=((uint32_t)k[9])<<8;
+	case 9 : c+=k[8];
+	case 8 : b+=((uint32_t)k[7])<<24;
+	case 7 : b+=((uint32_t)k[6])<<16;
+	case 6 : b+=((uint32_t)k[5])<<8;
+	case 5 : b+=k[4];
+	case 4 : a+=((uint32_t)k[3])<<24;
+	case 3 : a+=((uint32_t)k[2])<<16;
+	case 2 : a+=((uint32_t)k[1])<<8;
+	case 1 : a+=k[0];
+		break;
+	case 0 : return c;
+	}
+
+	final(a,b,c);
+	return c;
+}
+
+unsigned int tdb_jenkins_hash(TDB_DATA *key)
+{
+	return hashlittle(key->dptr, key->dsize);
+}
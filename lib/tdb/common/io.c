@@ -299,7 +299,7 @@ static int tdb_expand_file(struct tdb_context *tdb, tdb_off_t size, tdb_off_t ad
 int tdb_expand(struct tdb_context *tdb, tdb_off_t size)
 {
 	struct tdb_record rec;
-	tdb_off_t offset, new_size;	
+	tdb_off_t offset, new_size, increment;
 
 	if (tdb_lock(tdb, -1, F_WRLCK) == -1) {
 		TDB_LOG((tdb, TDB_DEBUG_ERROR, "lock failed in tdb_expand\n"));
@@ -310,9 +310,16 @@ int tdb_expand(struct tdb_context *tdb, tdb_off_t size)
 	tdb->methods->tdb_oob(tdb, tdb->map_size + 1, 1);
 
 	/* always make room for at least 100 more records, and at
-           least 25% more space. Round the database up to a multiple
-           of the page size */
-	new_size = MAX(tdb->map_size + size*100, tdb->map_size * 1.25);
+           least 25% more space. Room for 100 more records is too
+           much if the record is big, give those room for two
+           more. Round the database up to a multiple of the page
+           size */
+	if (size > 100 * 1024) {
+		increment = size * 2;
+	} else {
+		increment = size * 100;
+	}
+	new_size = MAX(tdb->map_size + increment, tdb->map_size * 1.25);
 	size = TDB_ALIGN(new_size, tdb->page_size) - tdb->map_size;
 
 	if (!(tdb->flags & TDB_INTERNAL))
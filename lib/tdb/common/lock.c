@@ -34,6 +34,140 @@ void tdb_setalarm_sigptr(struct tdb_context *tdb, volatile sig_atomic_t *ptr)
 	tdb->interrupt_sig_ptr = ptr;
 }
 
+/*
+  Every modification of the hash chains is bracketed by
+  tdb_mutation_start() and tdb_mutation_done(), which atomically
+  increment two counters in the mmap'ed header. TDB_READ_MOSTLY
+  readers walk the chains without locks and use these counters to
+  detect that a writer was active meanwhile, see tdb_fetch_lockless().
+
+  This only works when all processes using the database have it
+  mmap'ed, a writer without a mapping can't bump the counters. A
+  database created with TDB_READ_MOSTLY carries
+  TDB_FEATURE_FLAG_MUTATIONS in its header, which older tdb versions
+  refuse to open and which we refuse to open for writing without a
+  mapping. Readers only go lockless on such databases.
+*/
+#ifdef TDB_HAVE_ATOMICS
+static tdb_off_t *tdb_mutation_counter(struct tdb_context *tdb, int which)
+{
+	if (tdb->map_ptr == NULL || tdb->map_size < sizeof(struct tdb_header)) {
+		return NULL;
+	}
+	return (tdb_off_t *)((char *)tdb->map_ptr + TDB_MUTATIONS_OFS) + which;
+}
+#endif
+
+void tdb_mutation_start(struct tdb_context *tdb)
+{
+#ifdef TDB_HAVE_ATOMICS
+	tdb_off_t *p = tdb_mutation_counter(tdb, 0);
+	if (p != NULL) {
+		__sync_fetch_and_add(p, 1);
+	}
+#endif
+}
+
+void tdb_mutation_done(struct tdb_context *tdb)
+{
+#ifdef TDB_HAVE_ATOMICS
+	tdb_off_t *p = tdb_mutation_counter(tdb, 1);
+	if (p != NULL) {
+		__sync_fetch_and_add(p, 1);
+	}
+#endif
+}
+
+/*
+  A writer that died between tdb_mutation_start() and
+  tdb_mutation_done() leaves the counters apart for good, lockless
+  readers would always fall back to locking. Whoever holds the
+  allrecord write lock knows no other writer is active and can put
+  them back in line.
+*/
+void tdb_mutations_resync(struct tdb_context *tdb)
+{
+#ifdef TDB_HAVE_ATOMICS
+	volatile tdb_off_t *p = tdb_mutation_counter(tdb, 0);
+
+	if (p == NULL || p[0] == p[1]) {
+		return;
+	}
+	TDB_LOG((tdb, TDB_DEBUG_WARNING, "tdb_mutations_resync: "
+		 "mutation counters of %s out of sync, a writer died?\n",
+		 tdb->name));
+	p[1] = p[0];
+	__sync_synchronize();
+#endif
+}
+
+/*
+  Bulk writers (transaction commit and recovery) write back blocks
+  that can contain the header. Make sure they don't overwrite the
+  counters with stale values.
+*/
+void tdb_mutation_fixup(struct tdb_context *tdb, tdb_off_t offset,
+			void *buf, tdb_len_t len)
+{
+#ifdef TDB_HAVE_ATOMICS
+	tdb_off_t start = TDB_MUTATIONS_OFS;
+	tdb_off_t end = TDB_MUTATIONS_OFS + TDB_MUTATIONS_LEN;
+	tdb_off_t *p = tdb_mutation_counter(tdb, 0);
+
+	if (p == NULL || offset >= end || offset + len <= start) {
+		return;
+	}
+	if (offset > start) {
+		memcpy(buf, (char *)p + (offset - start),
+		       MIN(end - offset, len));
+	} else {
+		memcpy((char *)buf + (start - offset), p,
+		       MIN(end, offset + len) - start);
+	}
+#endif
+}
+
+/*
+  Take a snapshot of the counters before a lockless read. Returns
+  false if a writer is active right now.
+*/
+bool tdb_mutations_snapshot(struct tdb_context *tdb, tdb_off_t *started)
+{
+#ifdef TDB_HAVE_ATOMICS
+	volatile tdb_off_t *p = tdb_mutation_counter(tdb, 0);
+	tdb_off_t done;
+
+	if (p == NULL) {
+		return false;
+	}
+	done = p[1];
+	__sync_synchronize();
+	*started = p[0];
+	__sync_synchronize();
+	return (*started == done);
+#else
+	return false;
+#endif
+}
+
+/*
+  Check that no writer started since tdb_mutations_snapshot().
+*/
+bool tdb_mutations_unchanged(struct tdb_context *tdb, tdb_off_t started)
+{
+#ifdef TDB_HAVE_ATOMICS
+	volatile tdb_off_t *p = tdb_mutation_counter(tdb, 0);
+
+	if (p == NULL) {
+		return false;
+	}
+	__sync_synchronize();
+	return (p[0] == started);
+#else
+	return false;
+#endif
+}
+
 /* a byte range locking function - return 0 on success
    this functions locks/unlocks 1 byte at the specified offset.
 
@@ -183,6 +317,10 @@ static int _tdb_lock(struct tdb_context *tdb, int list, int ltype, int op)
 
 	tdb->num_locks++;
 
+	if (list >= 0 && ltype == F_WRLCK) {
+		tdb_mutation_start(tdb);
+	}
+
 	tdb->lockrecs[tdb->num_lockrecs].list = list;
 	tdb->lockrecs[tdb->num_lockrecs].count = 1;
 	tdb->lockrecs[tdb->num_lockrecs].ltype = ltype;
@@ -209,6 +347,61 @@ int tdb_lock_nonblock(struct tdb_context *tdb, int list, int ltype)
 	return _tdb_lock(tdb, list, ltype, F_SETLK);
 }
 
+/*
+  read the hash size from the file. tdb_rehash() in another process
+  can change it, but only while we hold no locks at all.
+*/
+uint32_t tdb_hash_size_ondisk(struct tdb_context *tdb)
+{
+	uint32_t hash_size;
+
+	if (tdb->methods->tdb_read(tdb, offsetof(struct tdb_header, hash_size),
+				   &hash_size, sizeof(hash_size),
+				   DOCONV()) == -1 ||
+	    hash_size == 0) {
+		return tdb->header.hash_size;
+	}
+	return hash_size;
+}
+
+/*
+  lock the hash chain a hash value belongs to. If this is our first
+  lock, check that the hash size did not change under us, otherwise
+  we might have locked the wrong chain.
+*/
+int tdb_lock_hash(struct tdb_context *tdb, uint32_t hash, int ltype, int op)
+{
+	while (true) {
+		int list = BUCKET(hash);
+		uint32_t hash_size;
+
+		if (_tdb_lock(tdb, list, ltype, op) == -1) {
+			if (op == F_SETLKW) {
+				TDB_LOG((tdb, TDB_DEBUG_ERROR, "tdb_lock failed "
+					 "on list %d ltype=%d (%s)\n", list,
+					 ltype, strerror(errno)));
+			}
+			return -1;
+		}
+
+		if (tdb->num_locks > 1 || tdb->global_lock.count != 0 ||
+		    tdb->transaction != NULL) {
+			return 0;
+		}
+
+		hash_size = tdb_hash_size_ondisk(tdb);
+		if (hash_size == tdb->header.hash_size) {
+			return 0;
+		}
+
+		TDB_LOG((tdb, TDB_DEBUG_TRACE, "tdb_lock_hash: hash size "
+			 "changed from %u to %u\n",
+			 tdb->header.hash_size, hash_size));
+		tdb_unlock(tdb, list, ltype);
+		tdb->header.hash_size = hash_size;
+	}
+}
+
 
 /* unlock the database: returns void because it's too late for errors. */
 	/* changed to return int it may be interesting to know there
@@ -266,6 +459,12 @@ int tdb_unlock(struct tdb_context *tdb, int list, int ltype)
 	 * anyway.
 	 */
 
+	/* done before the unlock, whoever gets the allrecord lock next
+	   must find the counters in line */
+	if (list >= 0 && lck->ltype == F_WRLCK) {
+		tdb_mutation_done(tdb);
+	}
+
 	if (mark_lock) {
 		ret = 0;
 	} else {
@@ -374,6 +573,7 @@ static int _tdb_lockall(struct tdb_context *tdb, int ltype, int op)
 		return -1;
 	}
 
+again:
 	if (!mark_lock &&
 	    tdb->methods->tdb_brlock(tdb, FREELIST_TOP, ltype, op,
 				     0, 4*tdb->header.hash_size)) {
@@ -383,9 +583,32 @@ static int _tdb_lockall(struct tdb_context *tdb, int ltype, int op)
 		return -1;
 	}
 
+	/* a tdb_rehash() in another process might have changed the
+	   range we have to lock */
+	if (tdb->transaction == NULL) {
+		uint32_t hash_size = tdb_hash_size_ondisk(tdb);
+
+		if (hash_size != tdb->header.hash_size) {
+			if (!mark_lock) {
+				tdb->methods->tdb_brlock(
+					tdb, FREELIST_TOP, F_UNLCK, F_SETLKW,
+					0, 4*tdb->header.hash_size);
+			}
+			tdb->header.hash_size = hash_size;
+			goto again;
+		}
+	}
+
 	tdb->global_lock.count = 1;
 	tdb->global_lock.ltype = ltype;
 
+	if (ltype == F_WRLCK) {
+		if (!mark_lock) {
+			tdb_mutations_resync(tdb);
+		}
+		tdb_mutation_start(tdb);
+	}
+
 	return 0;
 }
 
@@ -414,6 +637,10 @@ static int _tdb_unlockall(struct tdb_context *tdb, int ltype)
 		return 0;
 	}
 
+	if (ltype == F_WRLCK) {
+		tdb_mutation_done(tdb);
+	}
+
 	if (!mark_lock &&
 	    tdb->methods->tdb_brlock(tdb, FREELIST_TOP, F_UNLCK, F_SETLKW, 
 				     0, 4*tdb->header.hash_size)) {
@@ -489,7 +716,7 @@ int tdb_unlockall_read(struct tdb_context *tdb)
    contention - it cannot guarantee how many records will be locked */
 int tdb_chainlock(struct tdb_context *tdb, TDB_DATA key)
 {
-	int ret = tdb_lock(tdb, BUCKET(tdb->hash_fn(&key)), F_WRLCK);
+	int ret = tdb_lock_hash(tdb, tdb->hash_fn(&key), F_WRLCK, F_SETLKW);
 	tdb_trace_1rec(tdb, "tdb_chainlock", key);
 	return ret;
 }
@@ -499,7 +726,7 @@ int tdb_chainlock(struct tdb_context *tdb, TDB_DATA key)
    locked */
 int tdb_chainlock_nonblock(struct tdb_context *tdb, TDB_DATA key)
 {
-	int ret = tdb_lock_nonblock(tdb, BUCKET(tdb->hash_fn(&key)), F_WRLCK);
+	int ret = tdb_lock_hash(tdb, tdb->hash_fn(&key), F_WRLCK, F_SETLK);
 	tdb_trace_1rec_ret(tdb, "tdb_chainlock_nonblock", key, ret);
 	return ret;
 }
@@ -507,7 +734,8 @@ int tdb_chainlock_nonblock(struct tdb_context *tdb, TDB_DATA key)
 /* mark a chain as locked without actually locking it. Warning! use with great caution! */
 int tdb_chainlock_mark(struct tdb_context *tdb, TDB_DATA key)
 {
-	int ret = tdb_lock(tdb, BUCKET(tdb->hash_fn(&key)), F_WRLCK | TDB_MARK_LOCK);
+	int ret = tdb_lock_hash(tdb, tdb->hash_fn(&key),
+			    F_WRLCK | TDB_MARK_LOCK, F_SETLKW);
 	tdb_trace_1rec(tdb, "tdb_chainlock_mark", key);
 	return ret;
 }
@@ -528,7 +756,7 @@ int tdb_chainunlock(struct tdb_context *tdb, TDB_DATA key)
 int tdb_chainlock_read(struct tdb_context *tdb, TDB_DATA key)
 {
 	int ret;
-	ret = tdb_lock(tdb, BUCKET(tdb->hash_fn(&key)), F_RDLCK);
+	ret = tdb_lock_hash(tdb, tdb->hash_fn(&key), F_RDLCK, F_SETLKW);
 	tdb_trace_1rec(tdb, "tdb_chainlock_read", key);
 	return ret;
 }
@@ -31,19 +31,56 @@
 static struct tdb_context *tdbs = NULL;
 
 
-/* This is based on the hash algorithm from gdbm */
-static unsigned int default_tdb_hash(TDB_DATA *key)
+/*
+  hashes of two well known keys, recorded in the header so that every
+  opener can verify it uses the hash function the database was created
+  with
+*/
+static void tdb_header_hash(struct tdb_context *tdb,
+			    uint32_t *magic1_hash, uint32_t *magic2_hash)
 {
-	uint32_t value;	/* Used to compute the hash value.  */
-	uint32_t   i;	/* Used to cycle through random values. */
+	static const unsigned char magic2[] = { 0x99, 0x19, 0x01, 0x26 };
+	TDB_DATA hash_key;
+
+	hash_key.dptr = (unsigned char *)TDB_MAGIC_FOOD;
+	hash_key.dsize = sizeof(TDB_MAGIC_FOOD);
+	*magic1_hash = tdb->hash_fn(&hash_key);
 
-	/* Set the initial value from the key size. */
-	for (value = 0x238F13AF * key->dsize, i=0; i < key->dsize; i++)
-		value = (value + (key->dptr[i] << (i*5 % 24)));
+	hash_key.dptr = (unsigned char *)magic2;
+	hash_key.dsize = sizeof(magic2);
+	*magic2_hash = tdb->hash_fn(&hash_key);
 
-	return (1103515243 * value + 12345);  
+	/* make sure at least one of them is non-zero */
+	if (*magic1_hash == 0 && *magic2_hash == 0) {
+		*magic1_hash = 1;
+	}
 }
 
+/*
+  check the hash function against the header. If the caller did not
+  ask for a specific one, try the other builtin hash as well.
+*/
+static bool tdb_check_header_hash(struct tdb_context *tdb, bool default_hash)
+{
+	uint32_t magic1_hash, magic2_hash;
+
+	tdb_header_hash(tdb, &magic1_hash, &magic2_hash);
+	if (tdb->header.magic1_hash == magic1_hash &&
+	    tdb->header.magic2_hash == magic2_hash) {
+		return true;
+	}
+
+	if (!default_hash) {
+		return false;
+	}
+
+	if (tdb->hash_fn == tdb_old_hash) {
+		tdb->hash_fn = tdb_jenkins_hash;
+	} else {
+		tdb->hash_fn = tdb_old_hash;
+	}
+	return tdb_check_header_hash(tdb, false);
+}
 
 /* initialise a new database with a specified hash size */
 static int tdb_new_database(struct tdb_context *tdb, int hash_size)
@@ -63,6 +100,22 @@ static int tdb_new_database(struct tdb_context *tdb, int hash_size)
 	/* Fill in the header */
 	newdb->version = TDB_VERSION;
 	newdb->hash_size = hash_size;
+	tdb_header_hash(tdb, &newdb->magic1_hash, &newdb->magic2_hash);
+
+	/* make older tdb versions refuse to open a database they
+	   would hash differently */
+	if (tdb->hash_fn != tdb_old_hash) {
+		newdb->rwlocks = TDB_HASH_RWLOCK_MAGIC;
+	}
+
+	/* lockless readers need every writer to bump the mutation
+	   counters in the mmap'ed header. Older tdb versions don't, make
+	   them refuse to open the database. */
+	if ((tdb->flags & TDB_READ_MOSTLY) &&
+	    !(tdb->flags & (TDB_INTERNAL|TDB_NOMMAP))) {
+		newdb->rwlocks = TDB_FEATURE_FLAG_MAGIC;
+		newdb->feature_flags = TDB_FEATURE_FLAG_MUTATIONS;
+	}
 	if (tdb->flags & TDB_INTERNAL) {
 		tdb->map_size = size;
 		tdb->map_ptr = (char *)newdb;
@@ -176,7 +229,14 @@ struct tdb_context *tdb_open_ex(const char *name, int hash_size, int tdb_flags,
 		tdb->log.log_fn = null_log_fn;
 		tdb->log.log_private = NULL;
 	}
-	tdb->hash_fn = hash_fn ? hash_fn : default_tdb_hash;
+	if (hash_fn) {
+		tdb->hash_fn = hash_fn;
+	} else if (tdb_flags & TDB_INCOMPATIBLE_HASH) {
+		/* only used when creating, otherwise the header decides */
+		tdb->hash_fn = tdb_jenkins_hash;
+	} else {
+		tdb->hash_fn = tdb_old_hash;
+	}
 
 	/* cache the page size */
 	tdb->page_size = getpagesize();
@@ -289,9 +349,33 @@ struct tdb_context *tdb_open_ex(const char *name, int hash_size, int tdb_flags,
 	if (fstat(tdb->fd, &st) == -1)
 		goto fail;
 
-	if (tdb->header.rwlocks != 0) {
+	if (tdb->header.rwlocks == TDB_FEATURE_FLAG_MAGIC) {
+		if (tdb->header.feature_flags & ~TDB_SUPPORTED_FEATURE_FLAGS) {
+			TDB_LOG((tdb, TDB_DEBUG_ERROR, "tdb_open_ex: "
+				 "%s has unsupported feature flags 0x%x\n",
+				 name, (unsigned)tdb->header.feature_flags));
+			errno = EINVAL;
+			goto fail;
+		}
+	} else if (tdb->header.rwlocks != 0 &&
+		   tdb->header.rwlocks != TDB_HASH_RWLOCK_MAGIC) {
 		TDB_LOG((tdb, TDB_DEBUG_ERROR, "tdb_open_ex: spinlocks no longer supported\n"));
 		goto fail;
+	} else {
+		tdb->header.feature_flags = 0;
+	}
+
+	if (tdb->header.magic1_hash == 0 && tdb->header.magic2_hash == 0) {
+		/* created before the hash was recorded */
+		if (hash_fn == NULL) {
+			tdb->hash_fn = tdb_old_hash;
+		}
+	} else if (!tdb_check_header_hash(tdb, hash_fn == NULL)) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, "tdb_open_ex: "
+			 "%s was created with a different hash function\n",
+			 name));
+		errno = EINVAL;
+		goto fail;
 	}
 
 	/* Is it already in the open list?  If so, fail. */
@@ -312,6 +396,16 @@ struct tdb_context *tdb_open_ex(const char *name, int hash_size, int tdb_flags,
 	tdb->device = st.st_dev;
 	tdb->inode = st.st_ino;
 	tdb_mmap(tdb);
+
+	if ((tdb->header.feature_flags & TDB_FEATURE_FLAG_MUTATIONS) &&
+	    !tdb->read_only && (tdb->map_ptr == NULL)) {
+		/* we could not tell lockless readers about our writes */
+		TDB_LOG((tdb, TDB_DEBUG_ERROR, "tdb_open_ex: "
+			 "%s needs mmap for writing\n", name));
+		errno = EINVAL;
+		goto fail;
+	}
+
 	if (locked) {
 		if (tdb->methods->tdb_brlock(tdb, ACTIVE_LOCK, F_UNLCK, F_SETLK, 0, 1) == -1) {
 			TDB_LOG((tdb, TDB_DEBUG_ERROR, "tdb_open_ex: "
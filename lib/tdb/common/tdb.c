@@ -114,7 +114,7 @@ tdb_off_t tdb_find_lock_hash(struct tdb_context *tdb, TDB_DATA key, uint32_t has
 {
 	uint32_t rec_ptr;
 
-	if (tdb_lock(tdb, BUCKET(hash), locktype) == -1)
+	if (tdb_lock_hash(tdb, hash, locktype, F_SETLKW) == -1)
 		return 0;
 	if (!(rec_ptr = tdb_find(tdb, key, hash, rec)))
 		tdb_unlock(tdb, BUCKET(hash), locktype);
@@ -123,6 +123,136 @@ tdb_off_t tdb_find_lock_hash(struct tdb_context *tdb, TDB_DATA key, uint32_t has
 
 static TDB_DATA _tdb_fetch(struct tdb_context *tdb, TDB_DATA key);
 
+/*
+  Lookup without chain locks for TDB_READ_MOSTLY databases.
+
+  We walk the hash chain directly in the mmap area, bracketed by
+  tdb_mutations_snapshot() and tdb_mutations_unchanged(). A writer
+  active in the meantime makes us retry, anything that looks
+  inconsistent is treated the same way. Nothing found in the map is
+  trusted before the final check, so all offsets are bounds checked
+  and no errors are logged.
+
+  Only databases created with TDB_READ_MOSTLY are read this way, their
+  header tells all tdb versions that can open them to maintain the
+  counters, see tdb_mutation_start().
+
+  Returns 1 if found (with a malloc'ed copy of the data in *data if
+  data is not NULL), 0 if the key does not exist and -1 if the caller
+  has to fall back to the locked lookup.
+*/
+static int tdb_find_lockless(struct tdb_context *tdb, TDB_DATA key,
+			     uint32_t hash, TDB_DATA *data)
+{
+	const unsigned char *map = (const unsigned char *)tdb->map_ptr;
+	tdb_len_t map_size = tdb->map_size;
+	int tries, busy = 0;
+
+	if (!(tdb->flags & TDB_READ_MOSTLY) ||
+	    !(tdb->header.feature_flags & TDB_FEATURE_FLAG_MUTATIONS) ||
+	    (tdb->flags & (TDB_NOLOCK|TDB_CONVERT)) ||
+	    map == NULL || tdb->transaction != NULL ||
+	    tdb->num_locks != 0 || tdb->global_lock.count != 0) {
+		return -1;
+	}
+
+	if (TDB_HASH_TOP(hash) + sizeof(tdb_off_t) > map_size) {
+		return -1;
+	}
+
+	/* the locked path copes with a tdb_rehash() in another process */
+	if (((const struct tdb_header *)map)->hash_size !=
+	    tdb->header.hash_size) {
+		return -1;
+	}
+
+	for (tries = 0; tries < 3; tries++) {
+		tdb_off_t started, rec_ptr;
+		struct tdb_record rec;
+		unsigned char *buf = NULL;
+		tdb_len_t loops = 0;
+		bool found = false;
+		bool retry = false;
+
+		if (!tdb_mutations_snapshot(tdb, &started)) {
+			busy += 1;
+			continue;
+		}
+
+		memcpy(&rec_ptr, map + TDB_HASH_TOP(hash), sizeof(rec_ptr));
+
+		while (rec_ptr != 0) {
+			tdb_len_t avail;
+
+			if (rec_ptr > map_size ||
+			    map_size - rec_ptr < sizeof(rec) ||
+			    ++loops > map_size / sizeof(rec)) {
+				retry = true;
+				break;
+			}
+			memcpy(&rec, map + rec_ptr, sizeof(rec));
+			if (TDB_BAD_MAGIC(&rec)) {
+				retry = true;
+				break;
+			}
+
+			avail = map_size - rec_ptr - sizeof(rec);
+			if (!TDB_DEAD(&rec) && rec.full_hash == hash
+			    && rec.key_len == key.dsize) {
+				if (rec.key_len > avail ||
+				    rec.data_len > avail - rec.key_len) {
+					retry = true;
+					break;
+				}
+				if (memcmp(map + rec_ptr + sizeof(rec),
+					   key.dptr, key.dsize) == 0) {
+					found = true;
+					break;
+				}
+			}
+			rec_ptr = rec.next;
+		}
+
+		if (retry) {
+			continue;
+		}
+
+		if (found && data != NULL) {
+			buf = (unsigned char *)malloc(
+				rec.data_len ? rec.data_len : 1);
+			if (buf == NULL) {
+				return -1;
+			}
+			memcpy(buf, map + rec_ptr + sizeof(rec) + rec.key_len,
+			       rec.data_len);
+		}
+
+		if (!tdb_mutations_unchanged(tdb, started)) {
+			SAFE_FREE(buf);
+			continue;
+		}
+
+		if (data != NULL) {
+			data->dptr = buf;
+			data->dsize = found ? rec.data_len : 0;
+		}
+		return found ? 1 : 0;
+	}
+
+	if (busy == tries) {
+		/*
+		 * Either writers keep us busy or one died in the
+		 * middle, see tdb_mutations_resync(). If we can get the
+		 * allrecord lock right away, nobody is writing.
+		 */
+		if (tdb_lockall_nonblock(tdb) == 0) {
+			tdb_unlockall(tdb);
+		}
+	}
+
+	return -1;
+}
+
 /* update an entry in place - this only works if the new data size
    is <= the old data size and the key exists.
    on failure return -1.
@@ -189,6 +319,15 @@ static TDB_DATA _tdb_fetch(struct tdb_context *tdb, TDB_DATA key)
 
 	/* find which hash bucket it is in */
 	hash = tdb->hash_fn(&key);
+
+	switch (tdb_find_lockless(tdb, key, hash, &ret)) {
+	case 1:
+		return ret;
+	case 0:
+		tdb->ecode = TDB_ERR_NOEXIST;
+		return tdb_null;
+	}
+
 	if (!(rec_ptr = tdb_find_lock_hash(tdb,key,hash,F_RDLCK,&rec)))
 		return tdb_null;
 
@@ -217,7 +356,8 @@ TDB_DATA tdb_fetch(struct tdb_context *tdb, TDB_DATA key)
  * For mmapped tdb's that do not have a transaction open it points the parsing
  * function directly at the mmap area, it avoids the malloc/memcpy in this
  * case. If a transaction is open or no mmap is available, it has to do
- * malloc/read/parse/free.
+ * malloc/read/parse/free. With TDB_READ_MOSTLY the parser is handed a
+ * private copy of the data that was read without taking the chain lock.
  *
  * This is interesting for all readers of potentially large data structures in
  * the tdb records, ldb indexes being one example.
@@ -230,12 +370,25 @@ int tdb_parse_record(struct tdb_context *tdb, TDB_DATA key,
 {
 	tdb_off_t rec_ptr;
 	struct tdb_record rec;
+	TDB_DATA data;
 	int ret;
 	uint32_t hash;
 
 	/* find which hash bucket it is in */
 	hash = tdb->hash_fn(&key);
 
+	switch (tdb_find_lockless(tdb, key, hash, &data)) {
+	case 1:
+		tdb_trace_1rec_ret(tdb, "tdb_parse_record", key, 0);
+		ret = parser(key, data, private_data);
+		free(data.dptr);
+		return ret;
+	case 0:
+		tdb_trace_1rec_ret(tdb, "tdb_parse_record", key, -1);
+		tdb->ecode = TDB_ERR_NOEXIST;
+		return 0;
+	}
+
 	if (!(rec_ptr = tdb_find_lock_hash(tdb,key,hash,F_RDLCK,&rec))) {
 		tdb_trace_1rec_ret(tdb, "tdb_parse_record", key, -1);
 		tdb->ecode = TDB_ERR_NOEXIST;
@@ -260,7 +413,16 @@ int tdb_parse_record(struct tdb_context *tdb, TDB_DATA key,
 static int tdb_exists_hash(struct tdb_context *tdb, TDB_DATA key, uint32_t hash)
 {
 	struct tdb_record rec;
-	
+	int ret;
+
+	ret = tdb_find_lockless(tdb, key, hash, NULL);
+	if (ret == 0) {
+		tdb->ecode = TDB_ERR_NOEXIST;
+	}
+	if (ret != -1) {
+		return ret;
+	}
+
 	if (tdb_find_lock_hash(tdb, key, hash, F_RDLCK, &rec) == 0)
 		return 0;
 	tdb_unlock(tdb, BUCKET(rec.full_hash), F_RDLCK);
@@ -387,7 +549,7 @@ static int tdb_delete_hash(struct tdb_context *tdb, TDB_DATA key, uint32_t hash)
 		 * tdb's with a very high create/delete rate like locking.tdb.
 		 */
 
-		if (tdb_lock(tdb, BUCKET(hash), F_WRLCK) == -1)
+		if (tdb_lock_hash(tdb, hash, F_WRLCK, F_SETLKW) == -1)
 			return -1;
 
 		if (tdb_count_dead(tdb, hash) >= tdb->max_dead_records) {
@@ -609,7 +771,7 @@ int tdb_store(struct tdb_context *tdb, TDB_DATA key, TDB_DATA dbuf, int flag)
 
 	/* find which hash bucket it is in */
 	hash = tdb->hash_fn(&key);
-	if (tdb_lock(tdb, BUCKET(hash), F_WRLCK) == -1)
+	if (tdb_lock_hash(tdb, hash, F_WRLCK, F_SETLKW) == -1)
 		return -1;
 
 	ret = _tdb_store(tdb, key, dbuf, flag, hash);
@@ -627,7 +789,7 @@ int tdb_append(struct tdb_context *tdb, TDB_DATA key, TDB_DATA new_dbuf)
 
 	/* find which hash bucket it is in */
 	hash = tdb->hash_fn(&key);
-	if (tdb_lock(tdb, BUCKET(hash), F_WRLCK) == -1)
+	if (tdb_lock_hash(tdb, hash, F_WRLCK, F_SETLKW) == -1)
 		return -1;
 
 	dbuf = _tdb_fetch(tdb, key);
@@ -986,6 +1148,110 @@ int tdb_repack(struct tdb_context *tdb)
 	return 0;
 }
 
+/*
+  change the number of hash chains of a tdb, for example to shorten
+  the chains of a database that has grown far beyond what it was
+  created for.
+
+  This is done within a transaction, so other processes can keep the
+  database open. They pick up the new hash size when they take their
+  next lock, see tdb_lock_hash().
+ */
+int tdb_rehash(struct tdb_context *tdb, int hash_size)
+{
+	struct tdb_context *tmp_db;
+	struct traverse_state state;
+	tdb_off_t zero = 0;
+	tdb_off_t data_start;
+
+	tdb_trace(tdb, "tdb_rehash");
+
+	if (hash_size <= 0) {
+		tdb->ecode = TDB_ERR_EINVAL;
+		return -1;
+	}
+
+	if (tdb->transaction != NULL) {
+		TDB_LOG((tdb, TDB_DEBUG_ERROR, "tdb_rehash: "
+			 "not possible within a transaction\n"));
+		tdb->ecode = TDB_ERR_NESTING;
+		return -1;
+	}
+
+	if (tdb_transaction_start(tdb) != 0) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, __location__ " Failed to start transaction\n"));
+		return -1;
+	}
+
+	if ((uint32_t)hash_size == tdb->header.hash_size) {
+		tdb_transaction_cancel(tdb);
+		return 0;
+	}
+
+	tmp_db = tdb_open("tmpdb", hash_size, TDB_INTERNAL, O_RDWR|O_CREAT, 0);
+	if (tmp_db == NULL) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, __location__ " Failed to create tmp_db\n"));
+		tdb_transaction_cancel(tdb);
+		return -1;
+	}
+
+	state.error = false;
+	state.dest_db = tmp_db;
+
+	if (tdb_traverse_read(tdb, repack_traverse, &state) == -1 ||
+	    state.error) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, __location__ " Failed to traverse copying out\n"));
+		goto fail;
+	}
+
+	/* a grown hash table might cover the recovery area, the
+	   commit will allocate a new one at the end of the file */
+	if (tdb_ofs_write(tdb, TDB_RECOVERY_HEAD, &zero) == -1) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, __location__ " Failed to drop recovery area\n"));
+		goto fail;
+	}
+
+	data_start = FREELIST_TOP + (hash_size+1)*sizeof(tdb_off_t);
+	if (tdb->map_size < data_start &&
+	    tdb_expand(tdb, data_start - tdb->map_size) != 0) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, __location__ " Failed to expand database\n"));
+		goto fail;
+	}
+
+	if (tdb_transaction_set_hash_size(tdb, hash_size) != 0) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, __location__ " Failed to set hash size\n"));
+		goto fail;
+	}
+
+	if (tdb_wipe_all(tdb) != 0) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, __location__ " Failed to wipe database\n"));
+		goto fail;
+	}
+
+	state.error = false;
+	state.dest_db = tdb;
+
+	if (tdb_traverse_read(tmp_db, repack_traverse, &state) == -1 ||
+	    state.error) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, __location__ " Failed to traverse copying back\n"));
+		goto fail;
+	}
+
+	tdb_close(tmp_db);
+
+	if (tdb_transaction_commit(tdb) != 0) {
+		TDB_LOG((tdb, TDB_DEBUG_FATAL, __location__ " Failed to commit\n"));
+		return -1;
+	}
+
+	return 0;
+
+fail:
+	tdb_transaction_cancel(tdb);
+	tdb_close(tmp_db);
+	return -1;
+}
+
 #ifdef TDB_TRACE
 static void tdb_trace_write(struct tdb_context *tdb, const char *str)
 {
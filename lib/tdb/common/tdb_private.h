@@ -49,6 +49,10 @@ typedef uint32_t tdb_off_t;
 #define TDB_FREE_MAGIC (~TDB_MAGIC)
 #define TDB_DEAD_MAGIC (0xFEE1DEAD)
 #define TDB_RECOVERY_MAGIC (0xf53bc0e7U)
+#define TDB_HASH_RWLOCK_MAGIC (0xbad1a51U)
+#define TDB_FEATURE_FLAG_MAGIC (0xbad1a52U)
+#define TDB_FEATURE_FLAG_MUTATIONS 0x00000001
+#define TDB_SUPPORTED_FEATURE_FLAGS TDB_FEATURE_FLAG_MUTATIONS
 #define TDB_ALIGNMENT 4
 #define DEFAULT_HASH_SIZE 131
 #define FREELIST_TOP (sizeof(struct tdb_header))
@@ -61,6 +65,8 @@ typedef uint32_t tdb_off_t;
 #define TDB_DATA_START(hash_size) (TDB_HASH_TOP(hash_size-1) + sizeof(tdb_off_t))
 #define TDB_RECOVERY_HEAD offsetof(struct tdb_header, recovery_start)
 #define TDB_SEQNUM_OFS    offsetof(struct tdb_header, sequence_number)
+#define TDB_MUTATIONS_OFS offsetof(struct tdb_header, mutations_started)
+#define TDB_MUTATIONS_LEN (2*sizeof(tdb_off_t))
 #define TDB_PAD_BYTE 0x42
 #define TDB_PAD_U32  0x42424242
 
@@ -100,6 +106,12 @@ void tdb_trace_2rec_retrec(struct tdb_context *tdb, const char *op,
 #define tdb_trace_2rec_retrec(tdb, op, rec1, rec2, ret)
 #endif /* !TDB_TRACE */
 
+/* the mutation counters for TDB_READ_MOSTLY need atomic operations */
+#if defined(__GNUC__) && \
+	((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+#define TDB_HAVE_ATOMICS 1
+#endif
+
 /* lock offsets */
 #define GLOBAL_LOCK      0
 #define ACTIVE_LOCK      4
@@ -146,7 +158,12 @@ struct tdb_header {
 	tdb_off_t rwlocks; /* obsolete - kept to detect old formats */
 	tdb_off_t recovery_start; /* offset of transaction recovery region */
 	tdb_off_t sequence_number; /* used when TDB_SEQNUM is set */
-	tdb_off_t reserved[29];
+	tdb_off_t mutations_started; /* see tdb_mutation_start() */
+	tdb_off_t mutations_done;
+	uint32_t magic1_hash; /* hash of TDB_MAGIC_FOOD, see tdb_header_hash() */
+	uint32_t magic2_hash; /* hash of TDB_MAGIC */
+	uint32_t feature_flags; /* valid if rwlocks == TDB_FEATURE_FLAG_MAGIC */
+	tdb_off_t reserved[24];
 };
 
 struct tdb_lock_type {
@@ -214,7 +231,17 @@ void tdb_mmap(struct tdb_context *tdb);
 int tdb_lock(struct tdb_context *tdb, int list, int ltype);
 int tdb_lock_nonblock(struct tdb_context *tdb, int list, int ltype);
 int tdb_unlock(struct tdb_context *tdb, int list, int ltype);
+int tdb_lock_hash(struct tdb_context *tdb, uint32_t hash, int ltype, int op);
+uint32_t tdb_hash_size_ondisk(struct tdb_context *tdb);
+int tdb_transaction_set_hash_size(struct tdb_context *tdb, uint32_t hash_size);
 int tdb_brlock(struct tdb_context *tdb, tdb_off_t offset, int rw_type, int lck_type, int probe, size_t len);
+void tdb_mutation_start(struct tdb_context *tdb);
+void tdb_mutation_done(struct tdb_context *tdb);
+void tdb_mutations_resync(struct tdb_context *tdb);
+void tdb_mutation_fixup(struct tdb_context *tdb, tdb_off_t offset,
+			void *buf, tdb_len_t len);
+bool tdb_mutations_snapshot(struct tdb_context *tdb, tdb_off_t *started);
+bool tdb_mutations_unchanged(struct tdb_context *tdb, tdb_off_t started);
 int tdb_transaction_lock(struct tdb_context *tdb, int ltype);
 int tdb_transaction_unlock(struct tdb_context *tdb);
 int tdb_brlock_upgrade(struct tdb_context *tdb, tdb_off_t offset, size_t len);
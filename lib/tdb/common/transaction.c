@@ -138,6 +138,9 @@ struct tdb_transaction {
 	/* set when the GLOBAL_LOCK has been taken */
 	bool global_lock_taken;
 
+	/* hash size to restore on cancel after tdb_rehash() */
+	uint32_t old_hash_size;
+
 	/* old file size before transaction */
 	tdb_len_t old_map_size;
 
@@ -500,6 +503,9 @@ int tdb_transaction_start(struct tdb_context *tdb)
 		goto fail;
 	}
 
+	/* nobody can rehash while we hold the transaction lock */
+	tdb->header.hash_size = tdb_hash_size_ondisk(tdb);
+
 	/* setup a copy of the hash table heads so the hash scan in
 	   traverse can be fast */
 	tdb->transaction->hash_heads = (uint32_t *)
@@ -586,6 +592,10 @@ int _tdb_transaction_cancel(struct tdb_context *tdb)
 
 	tdb->map_size = tdb->transaction->old_map_size;
 
+	if (tdb->transaction->old_hash_size != 0) {
+		tdb->header.hash_size = tdb->transaction->old_hash_size;
+	}
+
 	/* free all the transaction blocks */
 	for (i=0;i<tdb->transaction->num_blocks;i++) {
 		if (tdb->transaction->blocks[i] != NULL) {
@@ -639,6 +649,41 @@ int _tdb_transaction_cancel(struct tdb_context *tdb)
 	return ret;
 }
 
+/*
+  change the hash size within the current transaction, used by
+  tdb_rehash(). The caller has to rebuild all hash chains.
+*/
+int tdb_transaction_set_hash_size(struct tdb_context *tdb, uint32_t hash_size)
+{
+	uint32_t *hash_heads;
+	tdb_off_t ofs_hash_size = hash_size;
+
+	if (tdb->transaction == NULL || tdb->transaction->prepared) {
+		tdb->ecode = TDB_ERR_EINVAL;
+		return -1;
+	}
+
+	hash_heads = (uint32_t *)realloc(tdb->transaction->hash_heads,
+					 (hash_size+1)*sizeof(uint32_t));
+	if (hash_heads == NULL) {
+		tdb->ecode = TDB_ERR_OOM;
+		return -1;
+	}
+	memset(hash_heads, 0, (hash_size+1)*sizeof(uint32_t));
+	tdb->transaction->hash_heads = hash_heads;
+
+	if (tdb_ofs_write(tdb, offsetof(struct tdb_header, hash_size),
+			  &ofs_hash_size) == -1) {
+		return -1;
+	}
+
+	if (tdb->transaction->old_hash_size == 0) {
+		tdb->transaction->old_hash_size = tdb->header.hash_size;
+	}
+	tdb->header.hash_size = hash_size;
+	return 0;
+}
+
 /*
   cancel the current transaction
 */
@@ -1039,6 +1084,12 @@ int tdb_transaction_commit(struct tdb_context *tdb)
 
 	methods = tdb->transaction->io_methods;
 
+	/* lockless readers must not trust the chains while we write. We
+	   hold all hash chains, so we can also repair the counters after
+	   a crashed writer. */
+	tdb_mutations_resync(tdb);
+	tdb_mutation_start(tdb);
+
 	/* perform all the writes */
 	for (i=0;i<tdb->transaction->num_blocks;i++) {
 		tdb_off_t offset;
@@ -1054,6 +1105,8 @@ int tdb_transaction_commit(struct tdb_context *tdb)
 			length = tdb->transaction->last_block_size;
 		}
 
+		tdb_mutation_fixup(tdb, offset, tdb->transaction->blocks[i], length);
+
 		if (methods->tdb_write(tdb, offset, tdb->transaction->blocks[i], length) == -1) {
 			TDB_LOG((tdb, TDB_DEBUG_FATAL, "tdb_transaction_commit: write failed during commit\n"));
 			
@@ -1062,6 +1115,7 @@ int tdb_transaction_commit(struct tdb_context *tdb)
 			   run the crash recovery code */
 			tdb->methods = methods;
 			tdb_transaction_recover(tdb); 
+			tdb_mutation_done(tdb);
 
 			_tdb_transaction_cancel(tdb);
 
@@ -1073,6 +1127,9 @@ int tdb_transaction_commit(struct tdb_context *tdb)
 
 	SAFE_FREE(tdb->transaction->blocks);
 	tdb->transaction->num_blocks = 0;
+	tdb->transaction->old_hash_size = 0;
+
+	tdb_mutation_done(tdb);
 
 	/* ensure the new data is on disk */
 	if (transaction_sync(tdb, 0, tdb->map_size) == -1) {
@@ -1169,6 +1226,7 @@ int tdb_transaction_recover(struct tdb_context *tdb)
 	}
 
 	/* recover the file data */
+	tdb_mutation_start(tdb);
 	p = data;
 	while (p+8 < data + rec.data_len) {
 		uint32_t ofs, len;
@@ -1178,7 +1236,10 @@ int tdb_transaction_recover(struct tdb_context *tdb)
 		memcpy(&ofs, p, 4);
 		memcpy(&len, p+4, 4);
 
+		tdb_mutation_fixup(tdb, ofs, p+8, len);
+
 		if (tdb->methods->tdb_write(tdb, ofs, p+8, len) == -1) {
+			tdb_mutation_done(tdb);
 			free(data);
 			TDB_LOG((tdb, TDB_DEBUG_FATAL, "tdb_transaction_recover: failed to recover %d bytes at offset %d\n", len, ofs));
 			tdb->ecode = TDB_ERR_IO;
@@ -1186,6 +1247,7 @@ int tdb_transaction_recover(struct tdb_context *tdb)
 		}
 		p += 8 + len;
 	}
+	tdb_mutation_done(tdb);
 
 	free(data);
 
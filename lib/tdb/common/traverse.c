@@ -224,6 +224,11 @@ int tdb_traverse_read(struct tdb_context *tdb,
 		return -1;
 	}
 
+	/* tdb_rehash() holds the transaction lock, pick up its result */
+	if (tdb->transaction == NULL) {
+		tdb->header.hash_size = tdb_hash_size_ondisk(tdb);
+	}
+
 	tdb->traverse_read++;
 	tdb_trace(tdb, "tdb_traverse_read_start");
 	ret = tdb_traverse_internal(tdb, fn, private_data, &tl);
@@ -255,6 +260,10 @@ int tdb_traverse(struct tdb_context *tdb,
 		return -1;
 	}
 
+	if (tdb->transaction == NULL) {
+		tdb->header.hash_size = tdb_hash_size_ondisk(tdb);
+	}
+
 	tdb->traverse_write++;
 	tdb_trace(tdb, "tdb_traverse_start");
 	ret = tdb_traverse_internal(tdb, fn, private_data, &tl);
@@ -50,6 +50,8 @@ extern "C" {
 #define TDB_VOLATILE   256 /* Activate the per-hashchain freelist, default 5 */
 #define TDB_ALLOW_NESTING 512 /* Allow transactions to nest */
 #define TDB_DISALLOW_NESTING 1024 /* Disallow transactions to nest */
+#define TDB_READ_MOSTLY 2048 /* fetch without chain locks, needs mmap */
+#define TDB_INCOMPATIBLE_HASH 4096 /* new databases use tdb_jenkins_hash */
 
 /* error codes */
 enum TDB_ERROR {TDB_SUCCESS=0, TDB_ERR_CORRUPT, TDB_ERR_IO, TDB_ERR_LOCK, 
@@ -160,6 +162,11 @@ void tdb_setalarm_sigptr(struct tdb_context *tdb, volatile sig_atomic_t *sigptr)
 /* wipe and repack */
 int tdb_wipe_all(struct tdb_context *tdb);
 int tdb_repack(struct tdb_context *tdb);
+int tdb_rehash(struct tdb_context *tdb, int hash_size);
+
+/* hash functions that can be recorded in the database header */
+unsigned int tdb_old_hash(TDB_DATA *key);
+unsigned int tdb_jenkins_hash(TDB_DATA *key);
 
 /* Debug functions. Not used in production. */
 void tdb_dump_all(struct tdb_context *tdb);
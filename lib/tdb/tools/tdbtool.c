@@ -61,6 +61,7 @@ enum commands {
 	CMD_NEXT,
 	CMD_SYSTEM,
 	CMD_CHECK,
+	CMD_REHASH,
 	CMD_QUIT,
 	CMD_HELP
 };
@@ -95,6 +96,7 @@ COMMAND_TABLE cmd_table[] = {
 	{"next",	CMD_NEXT},
 	{"n",		CMD_NEXT},
 	{"check",	CMD_CHECK},
+	{"rehash",	CMD_REHASH},
 	{"quit",	CMD_QUIT},
 	{"q",		CMD_QUIT},
 	{"!",		CMD_SYSTEM},
@@ -203,6 +205,7 @@ static void help(void)
 "  list                 : print the database hash table and freelist\n"
 "  free                 : print the database freelist\n"
 "  check                : check the integrity of an opened database\n"
+"  rehash    size       : change the number of hash chains\n"
 "  speed                : perform speed tests on the database\n"
 "  ! command            : execute system command\n"
 "  1 | first            : print the first record\n"
@@ -556,6 +559,22 @@ static void check_db(TDB_CONTEXT *the_tdb)
 		       tdbcount);
 }
 
+static void rehash_db(TDB_CONTEXT *the_tdb, const char *size)
+{
+	int hash_size = size ? atoi(size) : 0;
+
+	if (!the_tdb) {
+		printf("Error: No database opened!\n");
+	} else if (hash_size <= 0) {
+		terror("need a hash size");
+	} else if (tdb_rehash(the_tdb, hash_size) == -1) {
+		terror("rehash failed");
+	} else {
+		printf("Database now has %d hash chains.\n",
+		       tdb_hash_size(the_tdb));
+	}
+}
+
 static int do_command(void)
 {
 	COMMAND_TABLE *ctp = cmd_table;
@@ -673,6 +692,10 @@ static int do_command(void)
 		case CMD_CHECK:
 			check_db(tdb);
 			return 0;
+		case CMD_REHASH:
+			bIterate = 0;
+			rehash_db(tdb, arg1);
+			return 0;
 		case CMD_HELP:
 			help();
 			return 0;
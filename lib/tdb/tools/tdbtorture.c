@@ -23,6 +23,7 @@
 #define TRAVERSE_PROB 20
 #define TRAVERSE_READ_PROB 20
 #define CULL_PROB 100
+#define REHASH_PROB 500
 #define KEYLEN 3
 #define DATALEN 100
 
@@ -30,6 +31,7 @@ static struct tdb_context *db;
 static int in_transaction;
 static int error_count;
 static int always_transaction = 0;
+static int tdb_flags = TDB_DEFAULT;
 
 #ifdef PRINTF_ATTRIBUTE
 static void tdb_log(struct tdb_context *tdb, enum tdb_debug_level level, const char *format, ...) PRINTF_ATTRIBUTE(3,4);
@@ -112,6 +114,15 @@ static void addrec_db(void)
 	}
 #endif
 
+#if REHASH_PROB
+	if (in_transaction == 0 && random() % REHASH_PROB == 0) {
+		if (tdb_rehash(db, 1 + (random() % 64)) != 0) {
+			fatal("tdb_rehash failed");
+		}
+		goto next;
+	}
+#endif
+
 #if TRANSACTION_PROB
 	if (in_transaction == 0 &&
 	    (always_transaction || random() % TRANSACTION_PROB == 0)) {
@@ -211,10 +222,135 @@ static int traverse_fn(struct tdb_context *tdb, TDB_DATA key, TDB_DATA dbuf,
 
 static void usage(void)
 {
-	printf("Usage: tdbtorture [-t] [-n NUM_PROCS] [-l NUM_LOOPS] [-s SEED] [-H HASH_SIZE]\n");
+	printf("Usage: tdbtorture [-t] [-r] [-b] [-n NUM_PROCS] [-l NUM_LOOPS] [-s SEED] [-H HASH_SIZE]\n");
+	printf("  -r  open the database with TDB_READ_MOSTLY\n");
+	printf("  -b  benchmark lookups/sec of NUM_PROCS readers against one writer\n");
 	exit(0);
 }
 
+#define BENCH_KEYS 1000
+
+static TDB_DATA bench_key(char *buf, size_t buflen, int k)
+{
+	TDB_DATA key;
+	key.dptr = (unsigned char *)buf;
+	key.dsize = snprintf(buf, buflen, "key%d", k);
+	return key;
+}
+
+static int bench_store(struct tdb_context *tdb, int k, int generation)
+{
+	char kbuf[32], dbuf[DATALEN];
+	TDB_DATA key, data;
+
+	key = bench_key(kbuf, sizeof(kbuf), k);
+	data.dptr = (unsigned char *)dbuf;
+	data.dsize = snprintf(dbuf, sizeof(dbuf), "key%d:%d", k, generation);
+	return tdb_store(tdb, key, data, TDB_REPLACE);
+}
+
+/*
+  Measure tdb_fetch() throughput: num_procs readers look up random
+  keys while a single writer keeps rewriting them. Every value starts
+  with its key, so readers can verify they never see a torn or
+  misplaced record.
+*/
+static int bench_lookups(int num_procs, int num_loops, int hash_size,
+			 struct tdb_logging_context *log_ctx)
+{
+	struct timeval start, end;
+	pid_t writer;
+	int i, k;
+	double secs;
+
+	unlink("torture.tdb");
+
+	db = tdb_open_ex("torture.tdb", hash_size, tdb_flags,
+			 O_RDWR | O_CREAT, 0600, log_ctx, NULL);
+	if (!db) {
+		fatal("db open failed");
+		return 1;
+	}
+	for (k=0;k<BENCH_KEYS;k++) {
+		if (bench_store(db, k, 0) != 0) {
+			fatal("tdb_store failed");
+			return 1;
+		}
+	}
+	tdb_close(db);
+
+	printf("benchmarking %d readers, %d lookups each, %d hash_size%s\n",
+	       num_procs, num_loops, hash_size,
+	       (tdb_flags & TDB_READ_MOSTLY) ? " (read mostly)" : "");
+
+	writer = fork();
+	if (writer == 0) {
+		int generation = 0;
+		db = tdb_open_ex("torture.tdb", hash_size, tdb_flags,
+				 O_RDWR, 0600, log_ctx, NULL);
+		if (!db) {
+			exit(1);
+		}
+		srandom(getpid());
+		while (true) {
+			bench_store(db, random() % BENCH_KEYS, ++generation);
+		}
+	}
+
+	gettimeofday(&start, NULL);
+
+	for (i=0;i<num_procs;i++) {
+		if (fork() != 0) {
+			continue;
+		}
+		db = tdb_open_ex("torture.tdb", hash_size, tdb_flags,
+				 O_RDWR, 0600, log_ctx, NULL);
+		if (!db) {
+			exit(1);
+		}
+		srandom(getpid());
+		for (k=0;k<num_loops;k++) {
+			char kbuf[32];
+			int n = random() % BENCH_KEYS;
+			TDB_DATA key = bench_key(kbuf, sizeof(kbuf), n);
+			TDB_DATA data = tdb_fetch(db, key);
+
+			if (data.dptr == NULL ||
+			    data.dsize <= key.dsize ||
+			    memcmp(data.dptr, key.dptr, key.dsize) != 0 ||
+			    data.dptr[key.dsize] != ':') {
+				printf("bad record for %s\n", kbuf);
+				exit(1);
+			}
+			free(data.dptr);
+		}
+		tdb_close(db);
+		exit(error_count);
+	}
+
+	for (i=0;i<num_procs;i++) {
+		int status;
+		if (waitpid(-1, &status, 0) == -1) {
+			perror("failed to wait for child\n");
+			exit(1);
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			error_count++;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+
+	kill(writer, SIGTERM);
+	waitpid(writer, NULL, 0);
+
+	secs = (end.tv_sec - start.tv_sec) +
+		(end.tv_usec - start.tv_usec) / 1000000.0;
+	printf("%.0f lookups/sec\n", num_procs * (double)num_loops / secs);
+
+	return error_count;
+}
+
  int main(int argc, char * const *argv)
 {
 	int i, seed = -1;
@@ -222,13 +358,14 @@ static void usage(void)
 	int num_loops = 5000;
 	int hash_size = 2;
 	int c;
+	bool benchmark = false;
 	extern char *optarg;
 	pid_t *pids;
 
 	struct tdb_logging_context log_ctx;
 	log_ctx.log_fn = tdb_log;
 
-	while ((c = getopt(argc, argv, "n:l:s:H:th")) != -1) {
+	while ((c = getopt(argc, argv, "n:l:s:H:trbh")) != -1) {
 		switch (c) {
 		case 'n':
 			num_procs = strtol(optarg, NULL, 0);
@@ -245,11 +382,26 @@ static void usage(void)
 		case 't':
 			always_transaction = 1;
 			break;
+		case 'r':
+			tdb_flags |= TDB_READ_MOSTLY;
+			break;
+		case 'b':
+			benchmark = true;
+			break;
 		default:
 			usage();
 		}
 	}
 
+	if (benchmark) {
+		error_count = bench_lookups(num_procs, num_loops, hash_size,
+					    &log_ctx);
+		if (error_count == 0) {
+			printf("OK\n");
+		}
+		return error_count;
+	}
+
 	unlink("torture.tdb");
 
 	pids = (pid_t *)calloc(sizeof(pid_t), num_procs);
@@ -259,7 +411,7 @@ static void usage(void)
 		if ((pids[i+1]=fork()) == 0) break;
 	}
 
-	db = tdb_open_ex("torture.tdb", hash_size, TDB_CLEAR_IF_FIRST, 
+	db = tdb_open_ex("torture.tdb", hash_size, TDB_CLEAR_IF_FIRST | tdb_flags,
 			 O_RDWR | O_CREAT, 0600, &log_ctx, NULL);
 	if (!db) {
 		fatal("db open failed");
@@ -283,6 +435,8 @@ static void usage(void)
 
 	if (error_count == 0) {
 		tdb_traverse_read(db, NULL, NULL);
+		if (tdb_check(db, NULL, NULL) != 0)
+			fatal("tdb_check failed");
 		if (always_transaction) {
 			while (in_transaction) {
 				tdb_transaction_cancel(db);
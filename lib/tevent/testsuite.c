@@ -144,6 +144,113 @@ static bool test_event_context(struct torture_context *test,
 	return true;
 }
 
+#define TIMER_BENCH_NUM 100000
+
+struct timer_bench_state {
+	struct timeval last;
+	int fired;
+	bool out_of_order;
+};
+
+struct timer_bench_entry {
+	struct timer_bench_state *state;
+	struct timeval tv;
+};
+
+static void timer_bench_handler(struct tevent_context *ev_ctx,
+				struct tevent_timer *te,
+				struct timeval tval, void *private_data)
+{
+	struct timer_bench_entry *entry =
+		(struct timer_bench_entry *)private_data;
+	struct timer_bench_state *state = entry->state;
+
+	if (tevent_timeval_compare(&entry->tv, &state->last) < 0) {
+		state->out_of_order = true;
+	}
+	state->last = entry->tv;
+	state->fired++;
+}
+
+/*
+  add TIMER_BENCH_NUM timers in random order, remove every other one
+  and fire the rest, they have to come in time order
+*/
+static bool test_timer_bench(struct torture_context *test,
+			     const void *test_data)
+{
+	struct tevent_context *ev_ctx;
+	struct timer_bench_state state;
+	struct timer_bench_entry *entries;
+	struct tevent_timer **timers;
+	struct timeval t, now;
+	int i, num_left;
+
+	ev_ctx = tevent_context_init(test);
+	torture_assert(test, ev_ctx != NULL, "tevent_context_init failed");
+
+	entries = talloc_array(ev_ctx, struct timer_bench_entry,
+			       TIMER_BENCH_NUM);
+	timers = talloc_array(ev_ctx, struct tevent_timer *,
+			      TIMER_BENCH_NUM);
+	torture_assert(test, entries != NULL && timers != NULL,
+		       "talloc_array failed");
+
+	ZERO_STRUCT(state);
+
+	/* all in the last hour, so they are due once we loop */
+	now = tevent_timeval_current();
+
+	for (i=0; i<TIMER_BENCH_NUM; i++) {
+		entries[i].state = &state;
+		entries[i].tv = tevent_timeval_set(
+			now.tv_sec - 3600 + random() % 3600,
+			random() % 1000000);
+	}
+
+	t = timeval_current();
+	for (i=0; i<TIMER_BENCH_NUM; i++) {
+		timers[i] = tevent_add_timer(ev_ctx, ev_ctx, entries[i].tv,
+					     timer_bench_handler, &entries[i]);
+		if (timers[i] == NULL) {
+			talloc_free(ev_ctx);
+			torture_fail(test, "tevent_add_timer failed");
+		}
+	}
+	torture_comment(test, "Added %d timers: %.0f timers/sec\n",
+			TIMER_BENCH_NUM,
+			TIMER_BENCH_NUM/timeval_elapsed(&t));
+
+	t = timeval_current();
+	num_left = 0;
+	for (i=0; i<TIMER_BENCH_NUM; i++) {
+		if (i % 2 == 0) {
+			TALLOC_FREE(timers[i]);
+		} else {
+			num_left++;
+		}
+	}
+	torture_comment(test, "Removed %d timers: %.0f timers/sec\n",
+			TIMER_BENCH_NUM - num_left,
+			(TIMER_BENCH_NUM - num_left)/timeval_elapsed(&t));
+
+	t = timeval_current();
+	while (state.fired < num_left) {
+		if (tevent_loop_once(ev_ctx) == -1) {
+			talloc_free(ev_ctx);
+			torture_fail(test, "Failed event loop");
+		}
+	}
+	torture_comment(test, "Fired %d timers: %.0f timers/sec\n",
+			state.fired, state.fired/timeval_elapsed(&t));
+
+	talloc_free(ev_ctx);
+
+	torture_assert(test, !state.out_of_order, "timers fired out of order");
+
+	return true;
+}
+
 struct torture_suite *torture_local_event(TALLOC_CTX *mem_ctx)
 {
 	struct torture_suite *suite = torture_suite_create(mem_ctx, "EVENT");
@@ -156,5 +263,8 @@ struct torture_suite *torture_local_event(TALLOC_CTX *mem_ctx)
 					       (const void *)list[i]);
 	}
 
+	torture_suite_add_simple_tcase_const(suite, "timer_bench",
+					     test_timer_bench, NULL);
+
 	return suite;
 }
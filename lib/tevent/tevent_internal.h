@@ -167,8 +167,11 @@ struct tevent_fd {
 };
 
 struct tevent_timer {
-	struct tevent_timer *prev, *next;
 	struct tevent_context *event_ctx;
+	/* position in event_ctx->timer_heap */
+	size_t heap_idx;
+	/* orders timers with the same next_event by age */
+	uint64_t seq;
 	struct timeval next_event;
 	tevent_timer_handler_t handler;
 	/* this is private for the specific handler */
@@ -226,8 +229,15 @@ struct tevent_context {
 	/* list of fd events - used by common code */
 	struct tevent_fd *fd_events;
 
-	/* list of timed events - used by common code */
-	struct tevent_timer *timer_events;
+	/*
+	 * timed events - used by common code. A binary min heap
+	 * ordered by next_event, so adding and removing a timer is
+	 * O(log n) and the next one to fire is timer_heap[0].
+	 */
+	struct tevent_timer **timer_heap;
+	size_t num_timers;
+	size_t max_timers;
+	uint64_t timer_seq;
 
 	/* list of immediate events - used by common code */
 	struct tevent_immediate *immediate_events;
@@ -280,6 +290,8 @@ struct tevent_timer *tevent_common_add_timer(struct tevent_context *ev,
 					     void *private_data,
 					     const char *handler_name,
 					     const char *location);
+struct tevent_timer *tevent_common_next_timer(struct tevent_context *ev);
+void tevent_common_remove_timer(struct tevent_timer *te);
 struct timeval tevent_common_loop_timer_delay(struct tevent_context *);
 
 void tevent_common_schedule_immediate(struct tevent_immediate *im,
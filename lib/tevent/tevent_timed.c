@@ -128,6 +128,141 @@ struct timeval tevent_timeval_current_ofs(uint32_t secs, uint32_t usecs)
 	return tevent_timeval_add(&tv, secs, usecs);
 }
 
+/*
+  ev->timer_heap is a binary min heap: the children of timer_heap[i]
+  are timer_heap[2*i+1] and timer_heap[2*i+2], neither fires before
+  it. Every timer knows its own index, so it can be removed without
+  searching for it.
+*/
+
+#define TEVENT_TIMER_NOT_QUEUED ((size_t)-1)
+
+/*
+  return true if te1 has to fire before te2. Timers for the same
+  time fire in the order they were added.
+*/
+static bool tevent_timer_before(const struct tevent_timer *te1,
+				const struct tevent_timer *te2)
+{
+	int cmp = tevent_timeval_compare(&te1->next_event, &te2->next_event);
+
+	if (cmp != 0) {
+		return (cmp < 0);
+	}
+	return (te1->seq < te2->seq);
+}
+
+static void tevent_timer_heap_set(struct tevent_context *ev, size_t idx,
+				  struct tevent_timer *te)
+{
+	ev->timer_heap[idx] = te;
+	te->heap_idx = idx;
+}
+
+static void tevent_timer_heap_up(struct tevent_context *ev, size_t idx)
+{
+	struct tevent_timer *te = ev->timer_heap[idx];
+
+	while (idx > 0) {
+		size_t parent = (idx - 1) / 2;
+
+		if (!tevent_timer_before(te, ev->timer_heap[parent])) {
+			break;
+		}
+		tevent_timer_heap_set(ev, idx, ev->timer_heap[parent]);
+		idx = parent;
+	}
+	tevent_timer_heap_set(ev, idx, te);
+}
+
+static void tevent_timer_heap_down(struct tevent_context *ev, size_t idx)
+{
+	struct tevent_timer *te = ev->timer_heap[idx];
+
+	while (true) {
+		size_t child = 2 * idx + 1;
+
+		if (child >= ev->num_timers) {
+			break;
+		}
+		if ((child + 1 < ev->num_timers) &&
+		    tevent_timer_before(ev->timer_heap[child + 1],
+					ev->timer_heap[child])) {
+			child += 1;
+		}
+		if (!tevent_timer_before(ev->timer_heap[child], te)) {
+			break;
+		}
+		tevent_timer_heap_set(ev, idx, ev->timer_heap[child]);
+		idx = child;
+	}
+	tevent_timer_heap_set(ev, idx, te);
+}
+
+/*
+  give back memory after a burst of timers is gone
+*/
+static void tevent_timer_heap_shrink(struct tevent_context *ev)
+{
+	struct tevent_timer **heap;
+	size_t max_timers = ev->max_timers / 2;
+
+	if ((ev->max_timers <= 64) || (ev->num_timers >= ev->max_timers / 4)) {
+		return;
+	}
+
+	heap = talloc_realloc(ev, ev->timer_heap, struct tevent_timer *,
+			      max_timers);
+	if (heap == NULL) {
+		return;
+	}
+	ev->timer_heap = heap;
+	ev->max_timers = max_timers;
+}
+
+/*
+  return the timer that fires next or NULL
+*/
+struct tevent_timer *tevent_common_next_timer(struct tevent_context *ev)
+{
+	if (ev->num_timers == 0) {
+		return NULL;
+	}
+	return ev->timer_heap[0];
+}
+
+/*
+  take a timer out of the heap, it's fine to call this twice
+*/
+void tevent_common_remove_timer(struct tevent_timer *te)
+{
+	struct tevent_context *ev = te->event_ctx;
+	struct tevent_timer *last;
+	size_t idx = te->heap_idx;
+
+	if ((ev == NULL) || (idx == TEVENT_TIMER_NOT_QUEUED)) {
+		return;
+	}
+
+	te->heap_idx = TEVENT_TIMER_NOT_QUEUED;
+	ev->num_timers -= 1;
+
+	if (idx < ev->num_timers) {
+		/* fill the hole with the last timer */
+		last = ev->timer_heap[ev->num_timers];
+		tevent_timer_heap_set(ev, idx, last);
+
+		if ((idx > 0) &&
+		    tevent_timer_before(last, ev->timer_heap[(idx - 1) / 2])) {
+			tevent_timer_heap_up(ev, idx);
+		} else {
+			tevent_timer_heap_down(ev, idx);
+		}
+	}
+
+	tevent_timer_heap_shrink(ev);
+}
+
 /*
   destroy a timed event
 */
@@ -137,9 +272,7 @@ static int tevent_common_timed_destructor(struct tevent_timer *te)
 		     "Destroying timer event %p \"%s\"\n",
 		     te, te->handler_name);
 
-	if (te->event_ctx) {
-		DLIST_REMOVE(te->event_ctx->timer_events, te);
-	}
+	tevent_common_remove_timer(te);
 
 	return 0;
 }
@@ -160,12 +293,25 @@ struct tevent_timer *tevent_common_add_timer(struct tevent_context *ev, TALLOC_C
 					     const char *handler_name,
 					     const char *location)
 {
-	struct tevent_timer *te, *last_te, *cur_te;
+	struct tevent_timer *te;
+
+	if (ev->num_timers == ev->max_timers) {
+		struct tevent_timer **heap;
+		size_t max_timers = MAX(ev->max_timers * 2, 16);
+
+		heap = talloc_realloc(ev, ev->timer_heap,
+				      struct tevent_timer *, max_timers);
+		if (heap == NULL) return NULL;
+
+		ev->timer_heap = heap;
+		ev->max_timers = max_timers;
+	}
 
 	te = talloc(mem_ctx?mem_ctx:ev, struct tevent_timer);
 	if (te == NULL) return NULL;
 
 	te->event_ctx		= ev;
+	te->seq			= ev->timer_seq++;
 	te->next_event		= next_event;
 	te->handler		= handler;
 	te->private_data	= private_data;
@@ -173,18 +319,9 @@ struct tevent_timer *tevent_common_add_timer(struct tevent_context *ev, TALLOC_C
 	te->location		= location;
 	te->additional_data	= NULL;
 
-	/* keep the list ordered */
-	last_te = NULL;
-	for (cur_te = ev->timer_events; cur_te; cur_te = cur_te->next) {
-		/* if the new event comes before the current one break */
-		if (tevent_timeval_compare(&te->next_event, &cur_te->next_event) < 0) {
-			break;
-		}
-
-		last_te = cur_te;
-	}
-
-	DLIST_ADD_AFTER(ev->timer_events, te, last_te);
+	ev->timer_heap[ev->num_timers] = te;
+	ev->num_timers += 1;
+	tevent_timer_heap_up(ev, ev->num_timers - 1);
 
 	talloc_set_destructor(te, tevent_common_timed_destructor);
 
@@ -203,7 +340,7 @@ struct tevent_timer *tevent_common_add_timer(struct tevent_context *ev, TALLOC_C
 struct timeval tevent_common_loop_timer_delay(struct tevent_context *ev)
 {
 	struct timeval current_time = tevent_timeval_zero();
-	struct tevent_timer *te = ev->timer_events;
+	struct tevent_timer *te = tevent_common_next_timer(ev);
 
 	if (!te) {
 		/* have a default tick time of 30 seconds. This guarantees
@@ -239,10 +376,10 @@ struct timeval tevent_common_loop_timer_delay(struct tevent_context *ev)
 	/* deny the handler to free the event */
 	talloc_set_destructor(te, tevent_common_timed_deny_destructor);
 
-	/* We need to remove the timer from the list before calling the
+	/* We need to remove the timer from the heap before calling the
 	 * handler because in a semi-async inner event loop called from the
 	 * handler we don't want to come across this event again -- vl */
-	DLIST_REMOVE(ev->timer_events, te);
+	tevent_common_remove_timer(te);
 
 	/*
 	 * If the timed event was registered for a zero current_time,
@@ -254,7 +391,7 @@ struct timeval tevent_common_loop_timer_delay(struct tevent_context *ev)
 	te->handler(ev, te, current_time, te->private_data);
 
 	/* The destructor isn't necessary anymore, we've already removed the
-	 * event from the list. */
+	 * event from the heap. */
 	talloc_set_destructor(te, NULL);
 
 	tevent_debug(te->event_ctx, TEVENT_DEBUG_TRACE,
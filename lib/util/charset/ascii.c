@@ -0,0 +1,165 @@
+/*
+   Unix SMB/CIFS implementation.
+   Fast paths for ASCII strings in character set conversion
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "includes.h"
+#include "ascii.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Without SSE2 we look at 8 bytes at a time. The masks are loaded from
+ * byte arrays, so they are right for either byte order.
+ */
+
+static const uint8_t ascii_ones[8] = {
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01 };
+static const uint8_t ascii_highbits[8] = {
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 };
+static const uint8_t ucs2_nonascii[8] = {
+	0x80, 0xff, 0x80, 0xff, 0x80, 0xff, 0x80, 0xff };
+static const uint8_t ucs2_hibytes[8] = {
+	0x00, 0x01, 0x00, 0x01, 0x00, 0x01, 0x00, 0x01 };
+
+static inline uint64_t ascii_load8(const uint8_t *p)
+{
+	uint64_t x;
+	memcpy(&x, p, sizeof(x));
+	return x;
+}
+
+/* Does x contain a zero byte or a byte with the high bit set? */
+static inline bool ascii_stop8(uint64_t x)
+{
+	uint64_t ones = ascii_load8(ascii_ones);
+	uint64_t highbits = ascii_load8(ascii_highbits);
+
+	return ((((x - ones) & ~x) | x) & highbits) != 0;
+}
+
+size_t ascii_copy(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	size_t i = 0;
+
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i stop = _mm_or_si128(v, _mm_cmpeq_epi8(v, zero));
+
+		if (_mm_movemask_epi8(stop) != 0) {
+			return i;
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), v);
+	}
+#endif
+
+	for (; i + 8 <= n; i += 8) {
+		uint64_t x = ascii_load8(src + i);
+
+		if (ascii_stop8(x)) {
+			break;
+		}
+		memcpy(dst + i, &x, sizeof(x));
+	}
+	return i;
+}
+
+size_t ascii_widen(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	size_t i = 0;
+
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i stop = _mm_or_si128(v, _mm_cmpeq_epi8(v, zero));
+
+		if (_mm_movemask_epi8(stop) != 0) {
+			return i;
+		}
+		_mm_storeu_si128((__m128i *)(dst + 2*i),
+				 _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128((__m128i *)(dst + 2*i + 16),
+				 _mm_unpackhi_epi8(v, zero));
+	}
+#endif
+
+	for (; i + 8 <= n; i += 8) {
+		size_t j;
+
+		if (ascii_stop8(ascii_load8(src + i))) {
+			break;
+		}
+		for (j = 0; j < 8; j++) {
+			dst[2*(i+j)] = src[i+j];
+			dst[2*(i+j)+1] = 0;
+		}
+	}
+	return i;
+}
+
+size_t ascii_narrow(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	size_t i = 0;
+	uint64_t nonascii, hibytes;
+
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(src + 2*i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + 2*i + 16));
+		/*
+		 * packus saturates 0x0080-0x7fff to 0xff and everything
+		 * from 0x8000 on to 0x00, so a character is ASCII and not
+		 * NUL exactly if it packs to a byte in 0x01-0x7f.
+		 */
+		__m128i v = _mm_packus_epi16(a, b);
+		__m128i stop = _mm_or_si128(v, _mm_cmpeq_epi8(v, zero));
+
+		if (_mm_movemask_epi8(stop) != 0) {
+			return i;
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), v);
+	}
+#endif
+
+	nonascii = ascii_load8(ucs2_nonascii);
+	hibytes = ascii_load8(ucs2_hibytes);
+
+	for (; i + 4 <= n; i += 4) {
+		uint64_t x = ascii_load8(src + 2*i);
+
+		/*
+		 * With the high bytes zero, filling them with 0x01 leaves
+		 * only NUL characters as zero bytes.
+		 */
+		if (((x & nonascii) != 0) || ascii_stop8(x | hibytes)) {
+			break;
+		}
+		dst[i] = src[2*i];
+		dst[i+1] = src[2*i+2];
+		dst[i+2] = src[2*i+4];
+		dst[i+3] = src[2*i+6];
+	}
+	return i;
+}
@@ -0,0 +1,39 @@
+/*
+   Unix SMB/CIFS implementation.
+   Fast paths for ASCII strings in character set conversion
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SAMBA_CHARSET_ASCII_H_
+#define _SAMBA_CHARSET_ASCII_H_
+
+/*
+ * These work on blocks of several characters. They convert a prefix of
+ * src that contains nothing but ASCII characters other than NUL and
+ * return how many characters they converted. The caller takes care of
+ * the rest of the string, starting with the block that contained the
+ * first NUL or non-ASCII character.
+ */
+
+/* Copy up to n bytes from src to dst */
+size_t ascii_copy(uint8_t *dst, const uint8_t *src, size_t n);
+
+/* Widen up to n bytes from src to UTF-16LE, dst has room for 2*n bytes */
+size_t ascii_widen(uint8_t *dst, const uint8_t *src, size_t n);
+
+/* Narrow up to n UTF-16LE characters (2*n bytes) from src to dst */
+size_t ascii_narrow(uint8_t *dst, const uint8_t *src, size_t n);
+
+#endif /* _SAMBA_CHARSET_ASCII_H_ */
@@ -1,7 +1,8 @@
 [SUBSYSTEM::LIBWINBIND-CLIENT]
 PRIVATE_DEPENDENCIES = SOCKET_WRAPPER
 
-LIBWINBIND-CLIENT_OBJ_FILES = $(nsswitchsrcdir)/wb_common.o
+LIBWINBIND-CLIENT_OBJ_FILES = $(nsswitchsrcdir)/wb_common.o \
+	$(nsswitchsrcdir)/wb_nsscache.o
 $(LIBWINBIND-CLIENT_OBJ_FILES): CFLAGS+=-DWINBINDD_SOCKET_DIR=\"$(winbindd_socket_dir)\"
 
 #################################
@@ -122,6 +122,47 @@ static bool test_wbc_sidtostring(struct torture_context *tctx)
 	return true;
 }
 
+static bool test_wbc_sids_to_unix_ids(struct torture_context *tctx)
+{
+	const char *sid_strings[] = { "S-1-5-32-544", "S-1-5-32-545" };
+	struct wbcDomainSid sids[2], sids2[2];
+	struct wbcUnixId ids[2];
+	int i;
+
+	for (i=0; i<2; i++) {
+		torture_assert_wbc_ok(tctx, wbcStringToSid(sid_strings[i], &sids[i]),
+			"wbcStringToSid failed");
+	}
+
+	torture_assert_wbc_ok(tctx, wbcSidsToUnixIds(sids, 2, ids),
+		"wbcSidsToUnixIds failed");
+
+	for (i=0; i<2; i++) {
+		gid_t gid;
+		char *sid_string;
+
+		if (ids[i].type == WBC_ID_TYPE_NOT_SPECIFIED) {
+			continue;
+		}
+		torture_assert_int_equal(tctx, ids[i].type, WBC_ID_TYPE_GID,
+			"wbcSidsToUnixIds expected a gid");
+		torture_assert_wbc_ok(tctx, wbcSidToGid(&sids[i], &gid),
+			"wbcSidToGid failed");
+		torture_assert_int_equal(tctx, ids[i].id.gid, gid,
+			"wbcSidsToUnixIds and wbcSidToGid differ");
+
+		torture_assert_wbc_ok(tctx, wbcUnixIdsToSids(&ids[i], 1, &sids2[i]),
+			"wbcUnixIdsToSids failed");
+		torture_assert_wbc_ok(tctx, wbcSidToString(&sids2[i], &sid_string),
+			"wbcSidToString failed");
+		torture_assert_str_equal(tctx, sid_string, sid_strings[i],
+			"wbcUnixIdsToSids did not map back");
+		wbcFreeMemory(sid_string);
+	}
+
+	return true;
+}
+
 static bool test_wbc_guidtostring(struct torture_context *tctx)
 {
 	struct wbcGuid guid;
@@ -359,6 +400,7 @@ struct torture_suite *torture_wbclient(void)
 	torture_suite_add_simple_test(suite, "wbcSidTypeString", test_wbc_sidtypestring);
 	torture_suite_add_simple_test(suite, "wbcSidToString", test_wbc_sidtostring);
 	torture_suite_add_simple_test(suite, "wbcGuidToString", test_wbc_guidtostring);
+	torture_suite_add_simple_test(suite, "wbcSidsToUnixIds", test_wbc_sids_to_unix_ids);
 	torture_suite_add_simple_test(suite, "wbcDomainInfo", test_wbc_domain_info);
 	torture_suite_add_simple_test(suite, "wbcListUsers", test_wbc_users);
 	torture_suite_add_simple_test(suite, "wbcListGroups", test_wbc_groups);
@@ -24,6 +24,7 @@
 
 #include "replace.h"
 #include "libwbclient.h"
+#include "../winbind_client.h"
 
 /* Convert a Windows SID to a Unix uid, allocating an uid if needed */
 wbcErr wbcSidToUid(const struct wbcDomainSid *sid, uid_t *puid)
@@ -206,6 +207,240 @@ wbcErr wbcQueryGidToSid(gid_t gid,
 	return WBC_ERR_NOT_IMPLEMENTED;
 }
 
+/* Map one request worth of sids, one line per sid */
+static wbcErr wbc_sids_to_xids(char *sidlist, size_t len,
+			       struct wbcUnixId *ids, uint32_t num_ids)
+{
+	struct winbindd_request request;
+	struct winbindd_response response;
+	wbcErr wbc_status = WBC_ERR_UNKNOWN_FAILURE;
+	uint32_t i;
+	char *p;
+
+	/* Initialize request */
+
+	ZERO_STRUCT(request);
+	ZERO_STRUCT(response);
+
+	request.extra_data.data = sidlist;
+	request.extra_len = len;
+
+	/* Make request */
+
+	wbc_status = wbcRequestResponse(WINBINDD_SIDS_TO_XIDS,
+					&request,
+					&response);
+	BAIL_ON_WBC_ERROR(wbc_status);
+
+	p = (char *)response.extra_data.data;
+	if (p == NULL) {
+		wbc_status = WBC_ERR_INVALID_RESPONSE;
+		BAIL_ON_WBC_ERROR(wbc_status);
+	}
+
+	for (i=0; i<num_ids; i++) {
+		struct wbcUnixId *id = &ids[i];
+		char *q;
+
+		switch (p[0]) {
+		case 'U':
+			id->type = WBC_ID_TYPE_UID;
+			id->id.uid = strtoul(p+1, &q, 10);
+			break;
+		case 'G':
+			id->type = WBC_ID_TYPE_GID;
+			id->id.gid = strtoul(p+1, &q, 10);
+			break;
+		case '-':
+			id->type = WBC_ID_TYPE_NOT_SPECIFIED;
+			q = p+1;
+			break;
+		default:
+			wbc_status = WBC_ERR_INVALID_RESPONSE;
+			BAIL_ON_WBC_ERROR(wbc_status);
+		}
+		if (q[0] != '\n') {
+			wbc_status = WBC_ERR_INVALID_RESPONSE;
+			BAIL_ON_WBC_ERROR(wbc_status);
+		}
+		p = q+1;
+	}
+
+	wbc_status = WBC_ERR_SUCCESS;
+
+ done:
+	winbindd_free_response(&response);
+	return wbc_status;
+}
+
+/* Convert a list of Windows SIDs to Unix ids */
+wbcErr wbcSidsToUnixIds(const struct wbcDomainSid *sids, uint32_t num_sids,
+			struct wbcUnixId *ids)
+{
+	wbcErr wbc_status = WBC_ERR_UNKNOWN_FAILURE;
+	char *sidlist = NULL;
+	uint32_t i, first;
+	size_t len;
+
+	if ((num_sids != 0) && (!sids || !ids)) {
+		wbc_status = WBC_ERR_INVALID_PARAM;
+		BAIL_ON_WBC_ERROR(wbc_status);
+	}
+
+	sidlist = talloc_array(NULL, char, WINBINDD_MAX_EXTRA_DATA);
+	BAIL_ON_PTR_ERROR(sidlist, wbc_status);
+
+	/* Split into requests winbindd accepts */
+
+	i = 0;
+
+	while (i < num_sids) {
+		first = i;
+		len = 0;
+
+		for (; i<num_sids; i++) {
+			char *sid_string = NULL;
+			size_t sidlen;
+
+			wbc_status = wbcSidToString(&sids[i], &sid_string);
+			BAIL_ON_WBC_ERROR(wbc_status);
+
+			sidlen = strlen(sid_string);
+			if (len + sidlen + 2 > WINBINDD_MAX_EXTRA_DATA) {
+				wbcFreeMemory(sid_string);
+				break;
+			}
+			memcpy(sidlist + len, sid_string, sidlen);
+			sidlist[len + sidlen] = '\n';
+			len += sidlen + 1;
+			wbcFreeMemory(sid_string);
+		}
+		sidlist[len] = '\0';
+
+		wbc_status = wbc_sids_to_xids(sidlist, len + 1, &ids[first],
+					      i - first);
+		BAIL_ON_WBC_ERROR(wbc_status);
+	}
+
+	wbc_status = WBC_ERR_SUCCESS;
+
+ done:
+	talloc_free(sidlist);
+	return wbc_status;
+}
+
+/* Map one request worth of ids, one line per id */
+static wbcErr wbc_xids_to_sids(char *xidlist, size_t len,
+			       struct wbcDomainSid *sids, uint32_t num_sids)
+{
+	struct winbindd_request request;
+	struct winbindd_response response;
+	wbcErr wbc_status = WBC_ERR_UNKNOWN_FAILURE;
+	uint32_t i;
+	char *p;
+
+	/* Initialize request */
+
+	ZERO_STRUCT(request);
+	ZERO_STRUCT(response);
+
+	request.extra_data.data = xidlist;
+	request.extra_len = len;
+
+	/* Make request */
+
+	wbc_status = wbcRequestResponse(WINBINDD_XIDS_TO_SIDS,
+					&request,
+					&response);
+	BAIL_ON_WBC_ERROR(wbc_status);
+
+	p = (char *)response.extra_data.data;
+	if (p == NULL) {
+		wbc_status = WBC_ERR_INVALID_RESPONSE;
+		BAIL_ON_WBC_ERROR(wbc_status);
+	}
+
+	for (i=0; i<num_sids; i++) {
+		char *q;
+
+		q = strchr(p, '\n');
+		if (q == NULL) {
+			wbc_status = WBC_ERR_INVALID_RESPONSE;
+			BAIL_ON_WBC_ERROR(wbc_status);
+		}
+		*q = '\0';
+
+		if (strcmp(p, "-") == 0) {
+			ZERO_STRUCT(sids[i]);
+		} else {
+			wbc_status = wbcStringToSid(p, &sids[i]);
+			BAIL_ON_WBC_ERROR(wbc_status);
+		}
+		p = q+1;
+	}
+
+	wbc_status = WBC_ERR_SUCCESS;
+
+ done:
+	winbindd_free_response(&response);
+	return wbc_status;
+}
+
+/* Convert a list of Unix ids to Windows SIDs */
+wbcErr wbcUnixIdsToSids(const struct wbcUnixId *ids, uint32_t num_ids,
+			struct wbcDomainSid *sids)
+{
+	wbcErr wbc_status = WBC_ERR_UNKNOWN_FAILURE;
+	char *xidlist = NULL;
+	uint32_t i, first;
+	size_t len;
+
+	if ((num_ids != 0) && (!ids || !sids)) {
+		wbc_status = WBC_ERR_INVALID_PARAM;
+		BAIL_ON_WBC_ERROR(wbc_status);
+	}
+
+	xidlist = talloc_array(NULL, char, WINBINDD_MAX_EXTRA_DATA);
+	BAIL_ON_PTR_ERROR(xidlist, wbc_status);
+
+	/* Split into requests winbindd accepts, "G4294967295\n" is 12 */
+
+	i = 0;
+
+	while (i < num_ids) {
+		first = i;
+		len = 0;
+
+		for (; (i<num_ids) && (len + 13 <= WINBINDD_MAX_EXTRA_DATA);
+		     i++) {
+			switch (ids[i].type) {
+			case WBC_ID_TYPE_UID:
+				len += snprintf(xidlist + len, 13, "U%u\n",
+						(unsigned)ids[i].id.uid);
+				break;
+			case WBC_ID_TYPE_GID:
+				len += snprintf(xidlist + len, 13, "G%u\n",
+						(unsigned)ids[i].id.gid);
+				break;
+			default:
+				wbc_status = WBC_ERR_INVALID_PARAM;
+				BAIL_ON_WBC_ERROR(wbc_status);
+			}
+		}
+		xidlist[len] = '\0';
+
+		wbc_status = wbc_xids_to_sids(xidlist, len + 1, &sids[first],
+					      i - first);
+		BAIL_ON_WBC_ERROR(wbc_status);
+	}
+
+	wbc_status = WBC_ERR_SUCCESS;
+
+ done:
+	talloc_free(xidlist);
+	return wbc_status;
+}
+
 /* Obtain a new uid from Winbind */
 wbcErr wbcAllocateUid(uid_t *puid)
 {
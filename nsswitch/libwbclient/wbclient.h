@@ -65,9 +65,11 @@ const char *wbcErrorString(wbcErr error);
  *	 Added wbcGetSidAliases()
  *  0.4: Added wbcSidTypeString()
  *  0.5: Added wbcChangeTrustCredentials()
+ *  0.6: Added wbcSidsToUnixIds()
+ *       Added wbcUnixIdsToSids()
  **/
 #define WBCLIENT_MAJOR_VERSION 0
-#define WBCLIENT_MINOR_VERSION 5
+#define WBCLIENT_MINOR_VERSION 6
 #define WBCLIENT_VENDOR_VERSION "Samba libwbclient"
 struct wbcLibraryDetails {
 	uint16_t major_version;
@@ -144,6 +146,34 @@ struct wbcSidWithAttr {
 #define WBC_SID_ATTR_GROUP_RESOURCE 		0x20000000
 #define WBC_SID_ATTR_GROUP_LOGON_ID 		0xC0000000
 
+/**
+ * @brief Type of a Unix id
+ **/
+
+enum wbcIdType {
+	WBC_ID_TYPE_NOT_SPECIFIED,
+	WBC_ID_TYPE_UID,
+	WBC_ID_TYPE_GID
+};
+
+/**
+ * @brief A uid or a gid
+ **/
+
+union wbcUnixIdContainer {
+	uid_t uid;
+	gid_t gid;
+};
+
+/**
+ * @brief A Unix id with its type
+ **/
+
+struct wbcUnixId {
+	enum wbcIdType type;
+	union wbcUnixIdContainer id;
+};
+
 /**
  *  @brief Windows GUID
  *
@@ -768,6 +798,34 @@ wbcErr wbcGidToSid(gid_t gid,
 wbcErr wbcQueryGidToSid(gid_t gid,
 			struct wbcDomainSid *sid);
 
+/**
+ * @brief Convert a list of Windows SIDs to Unix ids in one request
+ *
+ * @param *sids       Pointer to the array of SIDs to be resolved
+ * @param num_sids    Number of SIDs
+ * @param *ids        Pointer to num_sids ids to fill in. A SID that
+ *                    does not map gets type WBC_ID_TYPE_NOT_SPECIFIED.
+ *
+ * @return #wbcErr
+ *
+ **/
+wbcErr wbcSidsToUnixIds(const struct wbcDomainSid *sids, uint32_t num_sids,
+			struct wbcUnixId *ids);
+
+/**
+ * @brief Convert a list of Unix ids to Windows SIDs in one request
+ *
+ * @param *ids        Pointer to the array of ids to be resolved
+ * @param num_ids     Number of ids
+ * @param *sids       Pointer to num_ids SIDs to fill in. An id that
+ *                    does not map gets a zeroed SID.
+ *
+ * @return #wbcErr
+ *
+ **/
+wbcErr wbcUnixIdsToSids(const struct wbcUnixId *ids, uint32_t num_ids,
+			struct wbcDomainSid *sids);
+
 /**
  * @brief Obtain a new uid from Winbind
  *
@@ -148,6 +148,20 @@ fi
 
 testfail "wbinfo -Y against $TARGET using invalid SID" $wbinfo -Y "S-1-22-1-30000" && failed=`expr $failed + 1`
 
+testit "wbinfo --sids-to-unix-ids against $TARGET" $wbinfo --sids-to-unix-ids="S-1-22-1-30000,S-1-22-2-30000" || failed=`expr $failed + 1`
+
+echo "test: wbinfo --sids-to-unix-ids check for sane mapping"
+xids_for_sids=`$wbinfo --sids-to-unix-ids="S-1-22-1-30000,S-1-22-2-30000" | tr '\n' ' '`
+if test "x$xids_for_sids" != "xS-1-22-1-30000 -> uid 30000 S-1-22-2-30000 -> gid 30000 "; then
+	echo "S-1-22-1-30000,S-1-22-2-30000 mapped to $xids_for_sids"
+	echo "failure: wbinfo --sids-to-unix-ids check for sane mapping"
+	failed=`expr $failed + 1`
+else
+	echo "success: wbinfo --sids-to-unix-ids check for sane mapping"
+fi
+
+testit "wbinfo --unix-ids-to-sids against $TARGET" $wbinfo --unix-ids-to-sids="u30000,g30000" || failed=`expr $failed + 1`
+
 testit "wbinfo -t against $TARGET" $wbinfo -t || failed=`expr $failed + 1`
 
 #didn't really work anyway
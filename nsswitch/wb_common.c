@@ -23,6 +23,7 @@
 */
 
 #include "winbind_client.h"
+#include "winbind_nsscache.h"
 
 /* Global variables.  These are effectively the client state information */
 
@@ -639,6 +640,14 @@ NSS_STATUS winbindd_request_response(int req_type,
 	NSS_STATUS status = NSS_STATUS_UNAVAIL;
 	int count = 0;
 
+	/* Try the answers winbindd published before asking it */
+
+	if ((response != NULL) && !winbind_env_set() &&
+	    winbind_nsscache_fetch(winbindd_socket_dir(), req_type,
+				   request, response)) {
+		return NSS_STATUS_SUCCESS;
+	}
+
 	while ((status == NSS_STATUS_UNAVAIL) && (count < 10)) {
 		status = winbindd_send_request(req_type, 0, request);
 		if (status != NSS_STATUS_SUCCESS)
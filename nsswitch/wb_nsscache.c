@@ -0,0 +1,310 @@
+/*
+   Unix SMB/CIFS implementation.
+
+   winbind client side of the shared nss cache
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "winbind_client.h"
+#include "winbind_nsscache.h"
+#include "system/shmem.h"
+#include "system/time.h"
+
+/* Don't follow a corrupt chain forever */
+#define NSSCACHE_MAX_CHAIN 1024
+
+/* Retry a missing or unusable file at most once per second */
+#define NSSCACHE_RETRY 1
+
+/* The mapped nss cache of this process */
+
+static const uint8_t *nsscache_map;
+static size_t nsscache_size;
+static time_t nsscache_next_try;
+
+/*
+ * Build the key of a cacheable request. Returns the key length and the
+ * number of bytes of response->data to cache, 0 if the request is not
+ * cacheable.
+ */
+
+size_t winbind_nsscache_key(int cmd, const struct winbindd_request *request,
+			    uint8_t *key, size_t *data_len)
+{
+	const char *name = NULL;
+	size_t name_size = 0;
+	size_t len;
+
+	if (request == NULL) {
+		return 0;
+	}
+
+	switch (cmd) {
+	case WINBINDD_GETPWNAM:
+		name = request->data.username;
+		name_size = sizeof(request->data.username);
+		*data_len = sizeof(struct winbindd_pw);
+		break;
+	case WINBINDD_GETGRNAM:
+		name = request->data.groupname;
+		name_size = sizeof(request->data.groupname);
+		*data_len = sizeof(struct winbindd_gr);
+		break;
+	case WINBINDD_SID_TO_UID:
+		name = request->data.sid;
+		name_size = sizeof(request->data.sid);
+		*data_len = sizeof(uid_t);
+		break;
+	case WINBINDD_SID_TO_GID:
+		name = request->data.sid;
+		name_size = sizeof(request->data.sid);
+		*data_len = sizeof(gid_t);
+		break;
+	case WINBINDD_GETPWUID:
+		memcpy(key, &request->data.uid, sizeof(uid_t));
+		*data_len = sizeof(struct winbindd_pw);
+		return sizeof(uid_t);
+	case WINBINDD_UID_TO_SID:
+		memcpy(key, &request->data.uid, sizeof(uid_t));
+		*data_len = sizeof(struct winbindd_sid);
+		return sizeof(uid_t);
+	case WINBINDD_GETGRGID:
+		memcpy(key, &request->data.gid, sizeof(gid_t));
+		*data_len = sizeof(struct winbindd_gr);
+		return sizeof(gid_t);
+	case WINBINDD_GID_TO_SID:
+		memcpy(key, &request->data.gid, sizeof(gid_t));
+		*data_len = sizeof(struct winbindd_sid);
+		return sizeof(gid_t);
+	default:
+		return 0;
+	}
+
+	for (len = 0; len < name_size && name[len] != '\0'; len++) {
+		;
+	}
+	if ((len == 0) || (len == name_size) ||
+	    (len > WINBIND_NSSCACHE_MAX_KEY)) {
+		return 0;
+	}
+
+	memcpy(key, name, len);
+	return len;
+}
+
+/* FNV-1a over the command and the key */
+
+uint32_t winbind_nsscache_hash(int cmd, const uint8_t *key, size_t key_len)
+{
+	uint32_t hash = 0x811c9dc5;
+	size_t i;
+
+	hash = (hash ^ (uint32_t)cmd) * 0x01000193;
+
+	for (i = 0; i < key_len; i++) {
+		hash = (hash ^ key[i]) * 0x01000193;
+	}
+
+	return hash;
+}
+
+#ifdef HAVE_MMAP
+
+static void nsscache_unmap(void)
+{
+	if (nsscache_map != NULL) {
+		munmap((void *)nsscache_map, nsscache_size);
+		nsscache_map = NULL;
+		nsscache_size = 0;
+	}
+}
+
+/* Map dir/nsscache if winbindd published it */
+
+static bool nsscache_map_file(const char *dir)
+{
+	const struct winbind_nsscache_header *hdr;
+	char *path = NULL;
+	struct stat st;
+	void *map;
+	time_t now;
+	int fd;
+
+	now = time(NULL);
+	if (now < nsscache_next_try) {
+		return false;
+	}
+	nsscache_next_try = now + NSSCACHE_RETRY;
+
+	if (asprintf(&path, "%s/%s", dir, WINBIND_NSSCACHE_NAME) < 0) {
+		return false;
+	}
+
+	fd = open(path, O_RDONLY, 0);
+	SAFE_FREE(path);
+	if (fd == -1) {
+		return false;
+	}
+
+	/* Only trust a file winbindd wrote, like the socket */
+
+	if ((fstat(fd, &st) == -1) || !S_ISREG(st.st_mode) ||
+	    (st.st_uid != 0 && st.st_uid != geteuid()) ||
+	    ((st.st_mode & (S_IWGRP|S_IWOTH)) != 0) ||
+	    (st.st_size < (off_t)sizeof(struct winbind_nsscache_header))) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_FILE|MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+
+	hdr = (const struct winbind_nsscache_header *)map;
+
+	if ((hdr->magic != WINBIND_NSSCACHE_MAGIC) ||
+	    (hdr->version != WINBIND_NSSCACHE_VERSION) ||
+	    (hdr->size != (uint32_t)st.st_size) || (hdr->num_buckets == 0) ||
+	    (hdr->data_ofs > hdr->size) ||
+	    (hdr->data_ofs < sizeof(*hdr) + hdr->num_buckets * 4)) {
+		munmap(map, st.st_size);
+		return false;
+	}
+
+	nsscache_map = (const uint8_t *)map;
+	nsscache_size = st.st_size;
+	return true;
+}
+
+/*
+ * Look up a request in the nss cache. On a hit fill in the response
+ * like winbindd would have and return true.
+ */
+
+bool winbind_nsscache_fetch(const char *dir, int cmd,
+			    const struct winbindd_request *request,
+			    struct winbindd_response *response)
+{
+	const volatile struct winbind_nsscache_header *hdr;
+	const uint32_t *buckets;
+	uint8_t key[WINBIND_NSSCACHE_MAX_KEY];
+	size_t key_len, data_len;
+	uint32_t seqnum, hash, ofs, extra_len;
+	void *extra = NULL;
+	time_t now;
+	int steps;
+
+	key_len = winbind_nsscache_key(cmd, request, key, &data_len);
+	if (key_len == 0) {
+		return false;
+	}
+
+	if (nsscache_map != NULL) {
+		hdr = (const volatile struct winbind_nsscache_header *)
+			nsscache_map;
+		if (hdr->dead) {
+			nsscache_unmap();
+			nsscache_next_try = 0;
+		}
+	}
+
+	if ((nsscache_map == NULL) && !nsscache_map_file(dir)) {
+		return false;
+	}
+
+	hdr = (const volatile struct winbind_nsscache_header *)nsscache_map;
+	buckets = (const uint32_t *)(nsscache_map + sizeof(*hdr));
+
+	seqnum = hdr->seqnum;
+	if ((seqnum & 1) != 0) {
+		return false;
+	}
+	WINBIND_NSSCACHE_BARRIER();
+
+	hash = winbind_nsscache_hash(cmd, key, key_len);
+	ofs = buckets[hash % hdr->num_buckets];
+	now = time(NULL);
+
+	for (steps = 0; (ofs != 0) && (steps < NSSCACHE_MAX_CHAIN); steps++) {
+		const struct winbind_nsscache_entry *e;
+		const uint8_t *p;
+
+		if ((ofs % 8 != 0) || (ofs < hdr->data_ofs) ||
+		    (ofs > nsscache_size - sizeof(*e))) {
+			return false;
+		}
+
+		e = (const struct winbind_nsscache_entry *)(nsscache_map + ofs);
+		p = (const uint8_t *)(e + 1);
+
+		if ((e->hash != hash) || (e->cmd != cmd) ||
+		    (e->key_len != key_len) ||
+		    (e->key_len > nsscache_size - ofs - sizeof(*e)) ||
+		    (memcmp(p, key, key_len) != 0)) {
+			ofs = e->next;
+			continue;
+		}
+
+		/* The newest entry for the key decides */
+
+		extra_len = e->extra_len;
+
+		if ((e->data_len != data_len) ||
+		    (extra_len > nsscache_size) ||
+		    (data_len + extra_len >
+		     nsscache_size - ofs - sizeof(*e) - key_len) ||
+		    (e->stored > now) || (now - e->stored >= hdr->ttl)) {
+			return false;
+		}
+
+		if (extra_len != 0) {
+			extra = malloc(extra_len);
+			if (extra == NULL) {
+				return false;
+			}
+			memcpy(extra, p + key_len + data_len, extra_len);
+		}
+
+		memset(&response->data, 0, sizeof(response->data));
+		memcpy(&response->data, p + key_len, data_len);
+
+		WINBIND_NSSCACHE_BARRIER();
+		if (hdr->seqnum != seqnum) {
+			SAFE_FREE(extra);
+			return false;
+		}
+
+		response->result = WINBINDD_OK;
+		response->length = sizeof(struct winbindd_response)
+			+ extra_len;
+		response->extra_data.data = extra;
+		return true;
+	}
+
+	return false;
+}
+
+#else
+
+bool winbind_nsscache_fetch(const char *dir, int cmd,
+			    const struct winbindd_request *request,
+			    struct winbindd_response *response)
+{
+	return false;
+}
+
+#endif
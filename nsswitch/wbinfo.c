@@ -914,6 +914,180 @@ static bool wbinfo_sid_to_gid(const char *sid_str)
 	return true;
 }
 
+static bool wbinfo_sids_to_unix_ids(const char *arg)
+{
+	wbcErr wbc_status = WBC_ERR_UNKNOWN_FAILURE;
+	struct wbcDomainSid *sids = NULL;
+	struct wbcUnixId *unix_ids = NULL;
+	uint32_t i, num_sids;
+	const char *p;
+	char *sidstr;
+	TALLOC_CTX *mem_ctx;
+	bool ret = false;
+
+	mem_ctx = talloc_new(NULL);
+	if (mem_ctx == NULL) {
+		d_printf("talloc_new failed\n");
+		return false;
+	}
+
+	num_sids = 0;
+	p = arg;
+
+	while (next_token_talloc(mem_ctx, &p, &sidstr, " ,\n")) {
+		sids = talloc_realloc(mem_ctx, sids, struct wbcDomainSid,
+				      num_sids + 1);
+		if (sids == NULL) {
+			d_printf("talloc_realloc failed\n");
+			goto done;
+		}
+		wbc_status = wbcStringToSid(sidstr, &sids[num_sids]);
+		if (!WBC_ERROR_IS_OK(wbc_status)) {
+			d_printf("wbcStringToSid(%s) failed: %s\n", sidstr,
+				 wbcErrorString(wbc_status));
+			goto done;
+		}
+		num_sids += 1;
+	}
+
+	unix_ids = talloc_array(mem_ctx, struct wbcUnixId, num_sids);
+	if ((num_sids != 0) && (unix_ids == NULL)) {
+		d_printf("talloc_array failed\n");
+		goto done;
+	}
+
+	wbc_status = wbcSidsToUnixIds(sids, num_sids, unix_ids);
+	if (!WBC_ERROR_IS_OK(wbc_status)) {
+		d_printf("wbcSidsToUnixIds failed: %s\n",
+			 wbcErrorString(wbc_status));
+		goto done;
+	}
+
+	for (i=0; i<num_sids; i++) {
+		char *str = NULL;
+
+		wbc_status = wbcSidToString(&sids[i], &str);
+		if (!WBC_ERROR_IS_OK(wbc_status)) {
+			goto done;
+		}
+
+		switch (unix_ids[i].type) {
+		case WBC_ID_TYPE_UID:
+			d_printf("%s -> uid %d\n", str,
+				 (int)unix_ids[i].id.uid);
+			break;
+		case WBC_ID_TYPE_GID:
+			d_printf("%s -> gid %d\n", str,
+				 (int)unix_ids[i].id.gid);
+			break;
+		default:
+			d_printf("%s -> unmapped\n", str);
+			break;
+		}
+		wbcFreeMemory(str);
+	}
+
+	ret = true;
+ done:
+	TALLOC_FREE(mem_ctx);
+	return ret;
+}
+
+static bool wbinfo_unix_ids_to_sids(const char *arg)
+{
+	wbcErr wbc_status = WBC_ERR_UNKNOWN_FAILURE;
+	struct wbcUnixId *unix_ids = NULL;
+	struct wbcDomainSid *sids = NULL;
+	uint32_t i, num_ids;
+	const char *p;
+	char *idstr;
+	TALLOC_CTX *mem_ctx;
+	bool ret = false;
+
+	mem_ctx = talloc_new(NULL);
+	if (mem_ctx == NULL) {
+		d_printf("talloc_new failed\n");
+		return false;
+	}
+
+	num_ids = 0;
+	p = arg;
+
+	while (next_token_talloc(mem_ctx, &p, &idstr, " ,\n")) {
+		struct wbcUnixId *id;
+
+		unix_ids = talloc_realloc(mem_ctx, unix_ids,
+					  struct wbcUnixId, num_ids + 1);
+		if (unix_ids == NULL) {
+			d_printf("talloc_realloc failed\n");
+			goto done;
+		}
+		id = &unix_ids[num_ids];
+
+		switch (idstr[0]) {
+		case 'u':
+		case 'U':
+			id->type = WBC_ID_TYPE_UID;
+			id->id.uid = strtoul(idstr+1, NULL, 10);
+			break;
+		case 'g':
+		case 'G':
+			id->type = WBC_ID_TYPE_GID;
+			id->id.gid = strtoul(idstr+1, NULL, 10);
+			break;
+		default:
+			d_printf("Invalid unix id %s, expected u<uid> or "
+				 "g<gid>\n", idstr);
+			goto done;
+		}
+		num_ids += 1;
+	}
+
+	sids = talloc_array(mem_ctx, struct wbcDomainSid, num_ids);
+	if ((num_ids != 0) && (sids == NULL)) {
+		d_printf("talloc_array failed\n");
+		goto done;
+	}
+
+	wbc_status = wbcUnixIdsToSids(unix_ids, num_ids, sids);
+	if (!WBC_ERROR_IS_OK(wbc_status)) {
+		d_printf("wbcUnixIdsToSids failed: %s\n",
+			 wbcErrorString(wbc_status));
+		goto done;
+	}
+
+	for (i=0; i<num_ids; i++) {
+		char *str = NULL;
+		const char *type;
+		int id;
+
+		if (unix_ids[i].type == WBC_ID_TYPE_UID) {
+			type = "uid";
+			id = unix_ids[i].id.uid;
+		} else {
+			type = "gid";
+			id = unix_ids[i].id.gid;
+		}
+
+		if (sids[i].num_auths == 0) {
+			d_printf("%s %d -> unmapped\n", type, id);
+			continue;
+		}
+
+		wbc_status = wbcSidToString(&sids[i], &str);
+		if (!WBC_ERROR_IS_OK(wbc_status)) {
+			goto done;
+		}
+		d_printf("%s %d -> %s\n", type, id, str);
+		wbcFreeMemory(str);
+	}
+
+	ret = true;
+ done:
+	TALLOC_FREE(mem_ctx);
+	return ret;
+}
+
 static bool wbinfo_allocate_uid(void)
 {
 	wbcErr wbc_status = WBC_ERR_UNKNOWN_FAILURE;
@@ -1775,6 +1949,8 @@ enum {
 	OPT_PING_DC,
 	OPT_CCACHE_SAVE,
 	OPT_SID_TO_FULLNAME,
+	OPT_SIDS_TO_UNIX_IDS,
+	OPT_UNIX_IDS_TO_SIDS,
 	OPT_NTLMV2,
 	OPT_LANMAN
 };
@@ -1813,6 +1989,11 @@ int main(int argc, char **argv, char **envp)
 		{ "gid-to-sid", 'G', POPT_ARG_INT, &int_arg, 'G', "Converts gid to sid", "GID" },
 		{ "sid-to-uid", 'S', POPT_ARG_STRING, &string_arg, 'S', "Converts sid to uid", "SID" },
 		{ "sid-to-gid", 'Y', POPT_ARG_STRING, &string_arg, 'Y', "Converts sid to gid", "SID" },
+		{ "sids-to-unix-ids", 0, POPT_ARG_STRING, &string_arg,
+		  OPT_SIDS_TO_UNIX_IDS, "Converts sids to unix ids", "Sid-List" },
+		{ "unix-ids-to-sids", 0, POPT_ARG_STRING, &string_arg,
+		  OPT_UNIX_IDS_TO_SIDS, "Converts unix ids to sids",
+		  "ID-List (u<num> g<num>)" },
 		{ "allocate-uid", 0, POPT_ARG_NONE, 0, OPT_ALLOCATE_UID,
 		  "Get a new UID out of idmap" },
 		{ "allocate-gid", 0, POPT_ARG_NONE, 0, OPT_ALLOCATE_GID,
@@ -1998,6 +2179,20 @@ int main(int argc, char **argv, char **envp)
 				goto done;
 			}
 			break;
+		case OPT_SIDS_TO_UNIX_IDS:
+			if (!wbinfo_sids_to_unix_ids(string_arg)) {
+				d_fprintf(stderr, "Could not convert sids to "
+					  "unix ids\n");
+				goto done;
+			}
+			break;
+		case OPT_UNIX_IDS_TO_SIDS:
+			if (!wbinfo_unix_ids_to_sids(string_arg)) {
+				d_fprintf(stderr, "Could not convert unix ids "
+					  "to sids\n");
+				goto done;
+			}
+			break;
 		case OPT_ALLOCATE_UID:
 			if (!wbinfo_allocate_uid()) {
 				d_fprintf(stderr, "Could not allocate a uid\n");
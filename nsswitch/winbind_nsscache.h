@@ -0,0 +1,88 @@
+/*
+   Unix SMB/CIFS implementation.
+
+   Layout of the nss cache file winbindd shares with its clients
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 3 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _WINBIND_NSSCACHE_H
+#define _WINBIND_NSSCACHE_H
+
+/*
+ * The winbindd parent publishes the answers to getpw*, getgr* and the
+ * sid/id mapping requests in WINBINDD_SOCKET_DIR/nsscache. Clients
+ * mmap it read-only and look there before talking to winbindd.
+ *
+ * The file starts with the header, followed by num_buckets offsets of
+ * the first entry in each hash chain and the entries themselves. An
+ * entry holds the request key, the bytes of response->data and the
+ * response extra data, so a hit is a plain memcpy. New entries are
+ * added to the front of their chain, they hide older ones for the same
+ * key. When the file is full it is cleared.
+ *
+ * winbindd is the only writer. It makes seqnum odd while it changes
+ * the file. A reader that saw an odd seqnum, or a different one after
+ * copying the entry, asks winbindd instead. A file that winbindd no
+ * longer maintains is marked dead, clients then map the new one.
+ */
+
+#define WINBIND_NSSCACHE_NAME "nsscache"
+#define WINBIND_NSSCACHE_MAGIC 0x57424e43 /* "WBNC" */
+#define WINBIND_NSSCACHE_VERSION 1
+
+/* largest key: a user or group name */
+#define WINBIND_NSSCACHE_MAX_KEY sizeof(fstring)
+
+struct winbind_nsscache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seqnum;
+	uint32_t dead;
+	uint32_t ttl;		/* seconds an entry is valid */
+	uint32_t num_buckets;
+	uint32_t data_ofs;	/* first entry */
+	uint32_t used;		/* end of the last entry */
+	uint32_t size;		/* size of the file */
+	uint32_t pad;
+};
+
+struct winbind_nsscache_entry {
+	uint32_t next;
+	uint32_t cmd;
+	uint32_t hash;
+	uint32_t key_len;
+	uint32_t data_len;
+	uint32_t extra_len;
+	int64_t stored;
+	/* key, data and extra data follow */
+};
+
+#define WINBIND_NSSCACHE_ALIGN(x) (((x) + 7) & ~7)
+
+#if defined(__GNUC__) && \
+	((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+#define WINBIND_NSSCACHE_BARRIER() __sync_synchronize()
+#else
+#define WINBIND_NSSCACHE_BARRIER()
+#endif
+
+size_t winbind_nsscache_key(int cmd, const struct winbindd_request *request,
+			    uint8_t *key, size_t *data_len);
+uint32_t winbind_nsscache_hash(int cmd, const uint8_t *key, size_t key_len);
+bool winbind_nsscache_fetch(const char *dir, int cmd,
+			    const struct winbindd_request *request,
+			    struct winbindd_response *response);
+
+#endif
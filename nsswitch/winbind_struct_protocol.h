@@ -50,8 +50,10 @@ typedef char fstring[FSTRING_LEN];
  * 22: added WINBINDD_PING_DC
  * 23: added session_key to ccache_ntlm_auth response
  *     added WINBINDD_CCACHE_SAVE
+ * 24: implemented WINBINDD_SIDS_TO_XIDS
+ *     added WINBINDD_XIDS_TO_SIDS
  */
-#define WINBIND_INTERFACE_VERSION 23
+#define WINBIND_INTERFACE_VERSION 24
 
 /* Have to deal with time_t being 4 or 8 bytes due to structure alignment.
    On a 64bit Linux box, we have to support a constant structure size
@@ -111,6 +113,7 @@ enum winbindd_cmd {
 	WINBINDD_SIDS_TO_XIDS,
 	WINBINDD_UID_TO_SID,
 	WINBINDD_GID_TO_SID,
+	WINBINDD_XIDS_TO_SIDS,
 
 	WINBINDD_ALLOCATE_UID,
 	WINBINDD_ALLOCATE_GID,
@@ -146,6 +146,7 @@ sub setup_member($$$)
 	my $member_options = "
 	security = domain
 	server signing = on
+	winbind max domain connections = 4
 ";
 	my $ret = $self->provision($prefix,
 				   "LOCALMEMBER3",
@@ -35,6 +35,7 @@ struct memcache;
 
 enum memcache_number {
 	STAT_CACHE,
+	STAT_CACHE_NEGATIVE,
 	UID_SID_CACHE,
 	SID_UID_CACHE,
 	GID_SID_CACHE,
@@ -44,16 +45,50 @@ enum memcache_number {
 	MANGLE_HASH2_CACHE,
 	PDB_GETPWSID_CACHE,	/* talloc */
 	SINGLETON_CACHE_TALLOC,	/* talloc */
-	SINGLETON_CACHE
+	SINGLETON_CACHE,
+	MEMCACHE_NUM_CACHES	/* Keep this last */
+};
+
+/*
+ * Statistics of a cache subset, see memcache_get_stats()
+ */
+
+struct memcache_stats {
+	size_t size;		/* Bytes used by this subset */
+	size_t max_size;	/* Budget of this subset, 0 if none */
+	size_t num_elements;
+	uint64_t lookups;
+	uint64_t hits;
+	uint64_t adds;
+	uint64_t evictions;	/* Elements dropped to stay in budget */
 };
 
 /*
  * Create a memcache structure. max_size is in bytes, if you set it 0 it will
  * not forget anything.
+ *
+ * If the cache as a whole grows beyond max_size, elements are dropped from
+ * the least recently used end of the largest cache subset. This way a burst
+ * of additions to one subset does not push out the entries of others.
  */
 
 struct memcache *memcache_init(TALLOC_CTX *mem_ctx, size_t max_size);
 
+/*
+ * Give a cache subset its own budget in bytes, 0 removes it. The subset
+ * then never grows beyond max_size, independent of the overall size.
+ */
+
+void memcache_set_max_size(struct memcache *cache, enum memcache_number n,
+			   size_t max_size);
+
+/*
+ * Retrieve size and hit statistics of a cache subset.
+ */
+
+void memcache_get_stats(struct memcache *cache, enum memcache_number n,
+			struct memcache_stats *stats);
+
 /*
  * If you set this global memcache, use it as the default cache when NULL is
  * passed to the memcache functions below. This is a workaround for many
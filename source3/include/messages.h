@@ -109,6 +109,15 @@ struct messaging_backend {
 NTSTATUS messaging_tdb_init(struct messaging_context *msg_ctx,
 			    TALLOC_CTX *mem_ctx,
 			    struct messaging_backend **presult);
+void messaging_tdb_set_predispatch(struct messaging_backend *backend,
+				   void (*collect_fn)(void *private_data),
+				   bool (*fn)(void *private_data),
+				   void *private_data);
+
+NTSTATUS messaging_dgram_init(struct messaging_context *msg_ctx,
+			      TALLOC_CTX *mem_ctx,
+			      struct messaging_backend *fallback,
+			      struct messaging_backend **presult);
 
 NTSTATUS messaging_ctdbd_init(struct messaging_context *msg_ctx,
 			      TALLOC_CTX *mem_ctx,
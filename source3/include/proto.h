@@ -586,6 +586,15 @@ void init_modules(void);
 
 int ms_fnmatch(const char *pattern, const char *string, bool translate_pattern,
 	       bool is_case_sensitive);
+struct ms_fnmatch_compiled *ms_fnmatch_compile(TALLOC_CTX *mem_ctx,
+					       const char *pattern,
+					       bool translate_pattern,
+					       bool is_case_sensitive);
+bool ms_fnmatch_compiled_for(const struct ms_fnmatch_compiled *m,
+			     const char *pattern, bool translate_pattern,
+			     bool is_case_sensitive);
+int ms_fnmatch_compiled(const struct ms_fnmatch_compiled *m,
+			const char *string);
 int gen_fnmatch(const char *pattern, const char *string);
 
 /* The following definitions come from lib/pam_errors.c  */
@@ -656,10 +665,12 @@ int cmd_history(void);
 
 /* The following definitions come from lib/recvfile.c  */
 
+void sys_recvfile_try_splice(void);
 ssize_t sys_recvfile(int fromfd,
 			int tofd,
 			SMB_OFF_T offset,
 			size_t count);
+void sys_recvfile_try_splice(void);
 ssize_t sys_recvfile(int fromfd,
 			int tofd,
 			SMB_OFF_T offset,
@@ -3998,6 +4009,7 @@ bool lp_winbind_nested_groups(void);
 int lp_winbind_expand_groups(void);
 bool lp_winbind_refresh_tickets(void);
 bool lp_winbind_offline_logon(void);
+bool lp_winbind_nss_cache(void);
 bool lp_winbind_normalize_names(void);
 bool lp_winbind_rpc_only(void);
 bool lp_create_krb5_conf(void);
@@ -4072,6 +4084,7 @@ bool lp_nt_pipe_support(void);
 bool lp_nt_status_support(void);
 bool lp_stat_cache(void);
 int lp_max_stat_cache_size(void);
+int lp_dir_name_index_size(void);
 bool lp_allow_trusted_domains(void);
 bool lp_map_untrusted_to_domain(void);
 int lp_restrict_anonymous(void);
@@ -4116,6 +4129,8 @@ bool lp_paranoid_server_security(void);
 int lp_maxdisksize(void);
 int lp_lpqcachetime(void);
 int lp_max_smbd_processes(void);
+int lp_aio_max_threads(void);
+int lp_aio_signing_size(void);
 bool _lp_disable_spoolss(void);
 int lp_syslog(void);
 int lp_lm_announce(void);
@@ -4259,6 +4274,9 @@ int lp_aio_read_size(int );
 int lp_aio_write_size(int );
 int lp_map_readonly(int );
 int lp_directory_name_cache_size(int );
+int lp_negative_stat_cache_size(int );
+int lp_directory_stat_prefetch(int );
+int lp_directory_listing_cache_size(int );
 int lp_smb_encrypt(int );
 char lp_magicchar(const struct share_params *p );
 int lp_winbind_cache_time(void);
@@ -4390,6 +4408,7 @@ void lp_set_posix_pathnames(void);
 enum brl_flavour lp_posix_cifsu_locktype(files_struct *fsp);
 void lp_set_posix_default_cifsx_readwrite_locktype(enum brl_flavour val);
 int lp_min_receive_file_size(void);
+int lp_winbind_max_domain_connections(void);
 char* lp_perfcount_module(void);
 void lp_set_passdb_backend(const char *backend);
 
@@ -6074,6 +6093,24 @@ bool schedule_aio_write_and_X(connection_struct *conn,
 int wait_for_aio_completion(files_struct *fsp);
 void cancel_aio_by_fsp(files_struct *fsp);
 void smbd_aio_complete_mid(unsigned int mid);
+struct fncall_context *smbd_aio_fncall_context(void);
+bool smbd_aio_pthread_read_possible(files_struct *fsp, size_t n);
+bool smbd_aio_pthread_write_possible(files_struct *fsp, size_t n);
+struct tevent_req *smbd_aio_pread_send(TALLOC_CTX *mem_ctx,
+				       struct tevent_context *ev,
+				       files_struct *fsp,
+				       uint8_t *buf, size_t n,
+				       SMB_OFF_T offset);
+ssize_t smbd_aio_pread_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
+			    int *perr);
+struct tevent_req *smbd_aio_pwrite_send(TALLOC_CTX *mem_ctx,
+					struct tevent_context *ev,
+					files_struct *fsp,
+					const void *data_owner,
+					const uint8_t *data, size_t n,
+					SMB_OFF_T offset);
+ssize_t smbd_aio_pwrite_recv(struct tevent_req *req, int *perr);
+void smbd_aio_wait_for_threads(files_struct *fsp);
 
 /* The following definitions come from smbd/blocking.c  */
 
@@ -6202,6 +6239,9 @@ int dptr_CloseDir(struct dptr_struct *dptr);
 void dptr_SeekDir(struct dptr_struct *dptr, long offset);
 long dptr_TellDir(struct dptr_struct *dptr);
 bool dptr_has_wild(struct dptr_struct *dptr);
+bool dptr_mask_match(struct dptr_struct *dptr, const char *string,
+		     const char *mask, bool translate_pattern,
+		     bool is_case_sensitive);
 int dptr_dnum(struct dptr_struct *dptr);
 char *dptr_ReadDirName(TALLOC_CTX *ctx,
 			struct dptr_struct *dptr,
@@ -6228,6 +6268,11 @@ bool get_dir_entry(TALLOC_CTX *ctx,
 		bool check_descend,
 		bool ask_sharemode);
 bool is_visible_file(connection_struct *conn, const char *dir_path, const char *name, SMB_STRUCT_STAT *pst, bool use_veto);
+void dir_listing_cache_init(void);
+void dir_listing_cache_delete(connection_struct *conn,
+			      const struct file_id *id);
+void dir_listing_cache_delete_parent(connection_struct *conn,
+				     const char *path);
 struct smb_Dir *OpenDir(TALLOC_CTX *mem_ctx, connection_struct *conn,
 			const char *name, const char *mask, uint32 attr);
 const char *ReadDirName(struct smb_Dir *dirp, long *poffset,
@@ -6331,6 +6376,7 @@ void update_write_time_handler(struct event_context *ctx,
                                       void *private_data);
 void trigger_write_time_update(struct files_struct *fsp);
 void trigger_write_time_update_immediate(struct files_struct *fsp);
+bool prepare_async_write(files_struct *fsp);
 ssize_t write_file(struct smb_request *req,
 			files_struct *fsp,
 			const char *data,
@@ -6429,6 +6475,12 @@ void api_reply(connection_struct *conn, uint16 vuid,
 	       int tdscnt, int tpscnt,
 	       int mdrcnt, int mprcnt);
 
+/* The following definitions come from smbd/latency.c  */
+
+NTSTATUS perfcount_latency_init(void);
+void smbd_latency_smb2(uint16_t opcode, uint64_t start);
+void smbd_latency_init(void);
+
 /* The following definitions come from smbd/mangle.c  */
 
 void mangle_reset_cache(void);
@@ -6885,6 +6937,12 @@ NTSTATUS unlink_internals(connection_struct *conn, struct smb_request *req,
 			  uint32 dirtype, struct smb_filename *smb_fname,
 			  bool has_wild);
 void reply_unlink(struct smb_request *req);
+ssize_t fake_sendfile(files_struct *fsp, SMB_OFF_T startpos,
+		      size_t nread);
+void sendfile_short_send(files_struct *fsp,
+			 ssize_t nread,
+			 size_t headersize,
+			 size_t smb_maxcnt);
 void reply_readbraw(struct smb_request *req);
 void reply_lockread(struct smb_request *req);
 void reply_read(struct smb_request *req);
@@ -7048,6 +7106,16 @@ bool stat_cache_lookup(connection_struct *conn,
 			char **pp_dirpath,
 			char **pp_start,
 			SMB_STRUCT_STAT *pst);
+bool stat_cache_lookup_negative(connection_struct *conn,
+				const char *dirpath,
+				const char *name,
+				const SMB_STRUCT_STAT *dir_st);
+void stat_cache_add_negative(connection_struct *conn,
+			     const char *dirpath,
+			     const char *name,
+			     const SMB_STRUCT_STAT *dir_st,
+			     const struct timespec *scan_start);
+void stat_cache_delete_negative(connection_struct *conn, const char *path);
 void send_stat_cache_delete_message(const char *name);
 void stat_cache_delete(const char *name);
 unsigned int fast_string_hash(TDB_DATA *key);
@@ -7178,8 +7246,12 @@ NTSTATUS idmap_allocate_uid(struct unixid *id);
 NTSTATUS idmap_allocate_gid(struct unixid *id);
 NTSTATUS idmap_set_uid_hwm(struct unixid *id);
 NTSTATUS idmap_set_gid_hwm(struct unixid *id);
+NTSTATUS idmap_backends_unixids_to_sids(const char *domname,
+					struct id_map **ids);
 NTSTATUS idmap_backends_unixid_to_sid(const char *domname,
 				      struct id_map *id);
+NTSTATUS idmap_backends_sids_to_unixids(const char *domain,
+					struct id_map **ids);
 NTSTATUS idmap_backends_sid_to_unixid(const char *domname,
 				      struct id_map *id);
 NTSTATUS idmap_new_mapping(const struct dom_sid *psid, enum id_type type,
@@ -7219,6 +7291,8 @@ NTSTATUS idmap_uid_to_sid(const char *domname, DOM_SID *sid, uid_t uid);
 NTSTATUS idmap_gid_to_sid(const char *domname, DOM_SID *sid, gid_t gid);
 NTSTATUS idmap_sid_to_uid(const char *dom_name, DOM_SID *sid, uid_t *uid);
 NTSTATUS idmap_sid_to_gid(const char *domname, DOM_SID *sid, gid_t *gid);
+NTSTATUS idmap_sids_to_unixids(const char *dom_name, struct id_map **ids);
+NTSTATUS idmap_unixids_to_sids(const char *dom_name, struct id_map **ids);
 
 /* The following definitions come from winbindd/nss_info.c  */
 
@@ -7246,6 +7320,7 @@ struct tevent_req *fncall_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
 			       void (*fn)(void *private_data),
 			       void *private_data);
 int fncall_recv(struct tevent_req *req, int *perr);
+int fncall_wait_job(struct fncall_context *ctx, void *job_private);
 
 /* The following definitions come from rpc_server/srv_samr_nt.c */
 NTSTATUS access_check_object( SEC_DESC *psd, NT_USER_TOKEN *token,
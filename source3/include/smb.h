@@ -442,6 +442,8 @@ typedef struct files_struct {
 	struct share_mode_entry *pending_break_messages;
 	int num_pending_break_messages;
 
+	int num_aio_requests; /* Reads/writes running in helper threads. */
+
 	bool can_lock;
 	bool can_read;
 	bool can_write;
@@ -615,6 +617,7 @@ typedef struct connection_struct {
 	struct dfree_cached_info *dfree_info;
 	struct trans_state *pending_trans;
 	struct notify_context *notify_ctx;
+	struct memcache *negative_stat_cache; /* Names a directory scan did not find. */
 } connection_struct;
 
 struct current_user {
@@ -800,6 +803,9 @@ struct share_mode_lock {
 	struct timespec changed_write_time;
 	bool fresh;
 	bool modified;
+	bool names_modified; /* Delete token or names changed. */
+	TDB_DATA buf; /* Aligned copy of the record, share_modes points
+			 into it. NULL for fresh records. */
 	struct db_record *record;
 };
 
@@ -808,6 +814,8 @@ struct share_mode_lock {
  * Used by locking.c and libsmbsharemodes.c
  */
 
+#define LOCKING_DATA_VERSION 2
+
 struct locking_data {
 	union {
 		struct {
@@ -818,17 +826,27 @@ struct locking_data {
 			uint32 delete_token_size; /* Only valid if either of
 						     the two previous fields
 						     are True. */
+			uint32 version; /* LOCKING_DATA_VERSION */
+			uint32 entries_offset; /* Start of modes[] */
 		} s;
 		struct share_mode_entry dummy; /* Needed for alignment. */
 	} u;
-	/* The following four entries are implicit
-	   struct share_mode_entry modes[num_share_mode_entries];
+	/* The following entries are implicit
 	   char unix_token[delete_token_size] (divisible by 4).
 	   char share_name[];
 	   char file_name[];
+	   char stream_name[];
+	   padding up to entries_offset (multiple of 8)
+	   struct share_mode_entry modes[num_share_mode_entries];
+
+	   The entries come last and have a fixed size, so they can be
+	   added, changed and removed without moving anything else.
         */
 };
 
+#define LOCKING_DATA_ENTRIES_OFFSET(token_size, names_size) \
+	((sizeof(struct locking_data) + (token_size) + (names_size) + 7) & ~7)
+
 /* Used to store pipe open records for NetFileEnum() */
 
 struct pipe_open_rec {
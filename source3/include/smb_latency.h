@@ -0,0 +1,62 @@
+/*
+   Unix SMB/CIFS implementation.
+   Latency histograms for smbd hot paths
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SMB_LATENCY_H_
+#define _SMB_LATENCY_H_
+
+/*
+ * Latencies are kept in microseconds in log-linear buckets: values
+ * below 8 get a bucket each, above that every power of two is split
+ * into 8 linear sub-buckets. That keeps the relative error of every
+ * percentile below 12.5% from 1us up to several days with a fixed
+ * size histogram that can be merged by adding up the buckets.
+ */
+
+#define LATENCY_SUB_BITS	3
+#define LATENCY_SUB_BUCKETS	(1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BIT		39
+#define LATENCY_HIST_BUCKETS \
+	(LATENCY_SUB_BUCKETS * (LATENCY_MAX_BIT - LATENCY_SUB_BITS + 2))
+
+struct latency_hist {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t buckets[LATENCY_HIST_BUCKETS];
+};
+
+/* A named histogram of one process, see latency_record() */
+struct latency_counter;
+
+int latency_bucket(uint64_t usec);
+uint64_t latency_bucket_max(int bucket);
+void latency_hist_add(struct latency_hist *hist, uint64_t usec);
+void latency_hist_merge(struct latency_hist *dst,
+			const struct latency_hist *src);
+uint64_t latency_hist_percentile(const struct latency_hist *hist,
+				 double percent);
+
+bool latency_init(struct event_context *ev);
+bool latency_enabled(void);
+uint64_t latency_now(void);
+void latency_record(struct latency_counter **pcounter,
+		    const char *class_name, const char *name,
+		    uint64_t start);
+void latency_flush(void);
+
+#endif /* _SMB_LATENCY_H_ */
@@ -26,7 +26,7 @@
 
 #define PROF_SHMEM_KEY ((key_t)0x07021999)
 #define PROF_SHM_MAGIC 0x6349985
-#define PROF_SHM_VERSION 11
+#define PROF_SHM_VERSION 12
 
 /* time values in the following structure are in microseconds */
 
@@ -783,6 +783,9 @@ struct profile_stats {
 	unsigned statcache_lookups;
 	unsigned statcache_misses;
 	unsigned statcache_hits;
+	unsigned statcache_negative_hits;
+	unsigned statcache_negative_misses;
+	unsigned statcache_negative_stale;
 
 /* write cache counters */
 	unsigned writecache_read_hits;
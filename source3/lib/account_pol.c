@@ -212,13 +212,13 @@ bool init_account_policy(void)
 		return True;
 	}
 
-	db = db_open(NULL, state_path("account_policy.tdb"), 0, TDB_DEFAULT,
-		     O_RDWR, 0600);
+	db = db_open(NULL, state_path("account_policy.tdb"), 0,
+		     TDB_READ_MOSTLY, O_RDWR, 0600);
 
 	if (db == NULL) { /* the account policies files does not exist or open
 			   * failed, try to create a new one */
 		db = db_open(NULL, state_path("account_policy.tdb"), 0,
-			     TDB_DEFAULT, O_RDWR|O_CREAT, 0600);
+			     TDB_READ_MOSTLY, O_RDWR|O_CREAT, 0600);
 		if (db == NULL) {
 			DEBUG(0,("Failed to open account policy database\n"));
 			return False;
@@ -21,6 +21,7 @@
 
 */
 #include "includes.h"
+#include "../lib/util/charset/ascii.h"
 
 /* We can parameterize this if someone complains.... JRA. */
 
@@ -413,6 +414,25 @@ size_t convert_string(charset_t from, charset_t to,
 		size_t dlen = destlen;
 		unsigned char lastp = '\0';
 		size_t retval = 0;
+		size_t n;
+
+		/*
+		 * Whole blocks of ascii first. For nul terminated strings
+		 * strnlen is cheaper than going byte by byte.
+		 */
+		if (slen != (size_t)-1) {
+			n = ascii_copy(q, p, MIN(slen, dlen));
+			slen -= n;
+		} else {
+			n = ascii_copy(q, p, strnlen((const char *)p, dlen));
+		}
+		if (n) {
+			lastp = p[n-1];
+		}
+		p += n;
+		q += n;
+		dlen -= n;
+		retval += n;
 
 		/* If all characters are ascii, fast path here. */
 		while (slen && dlen) {
@@ -452,6 +472,17 @@ size_t convert_string(charset_t from, charset_t to,
 		size_t slen = srclen;
 		size_t dlen = destlen;
 		unsigned char lastp = '\0';
+		size_t n;
+
+		/* Whole blocks of ascii first. */
+		if (slen != (size_t)-1) {
+			n = ascii_narrow(q, p, MIN(slen / 2, dlen));
+			p += 2 * n;
+			q += n;
+			slen -= 2 * n;
+			dlen -= n;
+			retval += n;
+		}
 
 		/* If all characters are ascii, fast path here. */
 		while (((slen == (size_t)-1) || (slen >= 2)) && dlen) {
@@ -492,6 +523,23 @@ size_t convert_string(charset_t from, charset_t to,
 		size_t slen = srclen;
 		size_t dlen = destlen;
 		unsigned char lastp = '\0';
+		size_t n;
+
+		/* Whole blocks of ascii first, see above. */
+		if (slen != (size_t)-1) {
+			n = ascii_widen(q, p, MIN(slen, dlen / 2));
+			slen -= n;
+		} else {
+			n = ascii_widen(q, p,
+					strnlen((const char *)p, dlen / 2));
+		}
+		if (n) {
+			lastp = p[n-1];
+		}
+		p += n;
+		q += 2 * n;
+		dlen -= 2 * n;
+		retval += 2 * n;
 
 		/* If all characters are ascii, fast path here. */
 		while (slen && (dlen >= 2)) {
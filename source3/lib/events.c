@@ -51,6 +51,7 @@ bool event_add_to_select_args(struct tevent_context *ev,
 			      struct timeval *timeout, int *maxfd)
 {
 	struct tevent_fd *fde;
+	struct tevent_timer *te;
 	struct timeval diff;
 	bool ret = false;
 
@@ -75,11 +76,12 @@ bool event_add_to_select_args(struct tevent_context *ev,
 		return true;
 	}
 
-	if (ev->timer_events == NULL) {
+	te = tevent_common_next_timer(ev);
+	if (te == NULL) {
 		return ret;
 	}
 
-	diff = timeval_until(now, &ev->timer_events->next_event);
+	diff = timeval_until(now, &te->next_event);
 	*timeout = timeval_min(timeout, &diff);
 
 	return true;
@@ -89,6 +91,7 @@ bool run_events(struct tevent_context *ev,
 		int selrtn, fd_set *read_fds, fd_set *write_fds)
 {
 	struct tevent_fd *fde;
+	struct tevent_timer *te;
 	struct timeval now;
 
 	if (ev->signal_events &&
@@ -103,8 +106,10 @@ bool run_events(struct tevent_context *ev,
 
 	GetTimeOfDay(&now);
 
-	if ((ev->timer_events != NULL)
-	    && (timeval_compare(&now, &ev->timer_events->next_event) >= 0)) {
+	te = tevent_common_next_timer(ev);
+
+	if ((te != NULL)
+	    && (timeval_compare(&now, &te->next_event) >= 0)) {
 		/* this older events system did not auto-free timed
 		   events on running them, and had a race condition
 		   where the event could be called twice if the
@@ -113,16 +118,15 @@ bool run_events(struct tevent_context *ev,
 		   this while still allowing old code which frees the
 		   te, we need to create a temporary context which
 		   will be used to ensure the te is freed. We also
-		   remove the te from the timed event list before we
+		   remove the te from the timed event heap before we
 		   call the handler, to ensure we can't loop */
 
-		struct tevent_timer *te = ev->timer_events;
 		TALLOC_CTX *tmp_ctx = talloc_new(ev);
 
 		DEBUG(10, ("Running timed event \"%s\" %p\n",
-			   ev->timer_events->handler_name, ev->timer_events));
+			   te->handler_name, te));
 
-		DLIST_REMOVE(ev->timer_events, te);
+		tevent_common_remove_timer(te);
 		talloc_steal(tmp_ctx, te);
 
 		te->handler(ev, te, now, te->private_data);
@@ -157,9 +161,12 @@ bool run_events(struct tevent_context *ev,
 struct timeval *get_timed_events_timeout(struct tevent_context *ev,
 					 struct timeval *to_ret)
 {
+	struct tevent_timer *te;
 	struct timeval now;
 
-	if ((ev->timer_events == NULL) && (ev->immediate_events == NULL)) {
+	te = tevent_common_next_timer(ev);
+
+	if ((te == NULL) && (ev->immediate_events == NULL)) {
 		return NULL;
 	}
 	if (ev->immediate_events != NULL) {
@@ -168,7 +175,7 @@ struct timeval *get_timed_events_timeout(struct tevent_context *ev,
 	}
 
 	now = timeval_current();
-	*to_ret = timeval_until(&now, &ev->timer_events->next_event);
+	*to_ret = timeval_until(&now, &te->next_event);
 
 	DEBUG(10, ("timed_events_timeout: %d/%d\n", (int)to_ret->tv_sec,
 		(int)to_ret->tv_usec));
@@ -228,6 +235,7 @@ void dump_event_list(struct tevent_context *ev)
 	struct tevent_timer *te;
 	struct tevent_fd *fe;
 	struct timeval evt, now;
+	size_t i;
 
 	if (!ev) {
 		return;
@@ -237,8 +245,11 @@ void dump_event_list(struct tevent_context *ev)
 
 	DEBUG(10,("dump_event_list:\n"));
 
-	for (te = ev->timer_events; te; te = te->next) {
+	/* heap order, not sorted by time */
+
+	for (i=0; i<ev->num_timers; i++) {
 
+		te = ev->timer_heap[i];
 		evt = timeval_until(&now, &te->next_event);
 
 		DEBUGADD(10,("Timed Event \"%s\" %p handled in %d seconds (at %s)\n",
@@ -41,11 +41,23 @@ struct fncall_context {
 	struct fncall_state **orphaned;
 	int num_orphaned;
 
+	/*
+	 * Jobs that finished while fncall_wait_job() waited for another
+	 * one. Their completion is run from an immediate event.
+	 */
+	int *finished;
+	struct tevent_immediate *finished_im;
+
+	struct tevent_context *ev;
 	struct fd_event *fde;
 };
 
 static void fncall_handler(struct tevent_context *ev, struct tevent_fd *fde,
 			   uint16_t flags, void *private_data);
+static void fncall_job_finished(struct fncall_context *ctx, int job_id);
+static void fncall_finished_handler(struct tevent_context *ev,
+				    struct tevent_immediate *im,
+				    void *private_data);
 
 static int fncall_context_destructor(struct fncall_context *ctx)
 {
@@ -54,6 +66,9 @@ static int fncall_context_destructor(struct fncall_context *ctx)
 		talloc_free(ctx->pending[0]);
 	}
 
+	/* Orphaned jobs might be in here */
+	fncall_finished_handler(NULL, NULL, ctx);
+
 	while (ctx->num_orphaned != 0) {
 		/*
 		 * We've got jobs in the queue for which the tevent_req has
@@ -148,16 +163,17 @@ static bool fncall_set_pending(struct tevent_req *req,
 	 * Make sure that the orphaned array of fncall_state structs has
 	 * enough space. A job can change from pending to orphaned in
 	 * fncall_destructor, and to fail in a talloc destructor should be
-	 * avoided if possible.
+	 * avoided if possible. Jobs orphaned earlier might still be
+	 * running, so all of them and all pending ones must fit.
 	 */
 
 	orphaned_array_length = talloc_array_length(ctx->orphaned);
-	if (num_pending > orphaned_array_length) {
+	if (num_pending + ctx->num_orphaned > orphaned_array_length) {
 		struct fncall_state **orphaned;
 
 		orphaned = talloc_realloc(ctx, ctx->orphaned,
 					  struct fncall_state *,
-					  orphaned_array_length + 1);
+					  num_pending + ctx->num_orphaned);
 		if (orphaned == NULL) {
 			fncall_unset_pending(req);
 			return false;
@@ -169,6 +185,7 @@ static bool fncall_set_pending(struct tevent_req *req,
 		return true;
 	}
 
+	ctx->ev = ev;
 	ctx->fde = tevent_add_fd(ev, ctx->pending, ctx->sig_fd, TEVENT_FD_READ,
 				 fncall_handler, ctx);
 	if (ctx->fde == NULL) {
@@ -276,13 +293,18 @@ static void fncall_handler(struct tevent_context *ev, struct tevent_fd *fde,
 {
 	struct fncall_context *ctx = talloc_get_type_abort(
 		private_data, struct fncall_context);
-	int i, num_pending;
 	int job_id;
 
 	job_id = pthreadpool_finished_job(ctx->pool);
 	if (job_id <= 0) {
 		return;
 	}
+	fncall_job_finished(ctx, job_id);
+}
+
+static void fncall_job_finished(struct fncall_context *ctx, int job_id)
+{
+	int i, num_pending;
 
 	num_pending = talloc_array_length(ctx->pending);
 
@@ -316,6 +338,122 @@ static void fncall_handler(struct tevent_context *ev, struct tevent_fd *fde,
 	ctx->num_orphaned -= 1;
 }
 
+static void fncall_finished_handler(struct tevent_context *ev,
+				    struct tevent_immediate *im,
+				    void *private_data)
+{
+	struct fncall_context *ctx = talloc_get_type_abort(
+		private_data, struct fncall_context);
+
+	/*
+	 * A completion can call fncall_wait_job() and add to the list
+	 * again, so take one at a time.
+	 */
+	while (talloc_array_length(ctx->finished) != 0) {
+		int num_finished = talloc_array_length(ctx->finished);
+		int job_id = ctx->finished[0];
+
+		ctx->finished[0] = ctx->finished[num_finished-1];
+		ctx->finished = talloc_realloc(ctx, ctx->finished, int,
+					       num_finished-1);
+		fncall_job_finished(ctx, job_id);
+	}
+}
+
+/*
+ * Remember a job that finished while we waited for another one
+ */
+
+static void fncall_defer_finished(struct fncall_context *ctx, int job_id)
+{
+	int num_finished = talloc_array_length(ctx->finished);
+	int *finished;
+
+	if (ctx->finished_im == NULL) {
+		ctx->finished_im = tevent_create_immediate(ctx);
+	}
+	finished = talloc_realloc(ctx, ctx->finished, int, num_finished+1);
+
+	if ((ctx->ev == NULL) || (ctx->finished_im == NULL) ||
+	    (finished == NULL)) {
+		/* Better late than never */
+		fncall_job_finished(ctx, job_id);
+		return;
+	}
+
+	finished[num_finished] = job_id;
+	ctx->finished = finished;
+
+	tevent_schedule_immediate(ctx->finished_im, ctx->ev,
+				  fncall_finished_handler, ctx);
+}
+
+static int fncall_find_job(struct fncall_context *ctx, void *job_private)
+{
+	int i, num_pending;
+
+	num_pending = talloc_array_length(ctx->pending);
+
+	for (i=0; i<num_pending; i++) {
+		struct fncall_state *state = tevent_req_data(
+			ctx->pending[i], struct fncall_state);
+
+		if (!state->done && (state->job_private == job_private)) {
+			return state->job_id;
+		}
+	}
+	for (i=0; i<ctx->num_orphaned; i++) {
+		if (ctx->orphaned[i]->job_private == job_private) {
+			return ctx->orphaned[i]->job_id;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Block until the job with job_private has finished in a helper thread and
+ * run its completion. Completions of other jobs that finish in the meantime
+ * are not run from in here, they are deferred to the event loop.
+ */
+
+int fncall_wait_job(struct fncall_context *ctx, void *job_private)
+{
+	int num_finished, i;
+	int wanted;
+
+	wanted = fncall_find_job(ctx, job_private);
+	if (wanted == 0) {
+		return 0;
+	}
+
+	num_finished = talloc_array_length(ctx->finished);
+
+	for (i=0; i<num_finished; i++) {
+		if (ctx->finished[i] == wanted) {
+			ctx->finished[i] = ctx->finished[num_finished-1];
+			ctx->finished = talloc_realloc(
+				ctx, ctx->finished, int, num_finished-1);
+			fncall_job_finished(ctx, wanted);
+			return 0;
+		}
+	}
+
+	while (true) {
+		int job_id = pthreadpool_finished_job(ctx->pool);
+
+		if (job_id == -1) {
+			return -1;
+		}
+		if (job_id == wanted) {
+			fncall_job_finished(ctx, job_id);
+			return 0;
+		}
+		if (job_id > 0) {
+			fncall_defer_finished(ctx, job_id);
+		}
+	}
+}
+
 int fncall_recv(struct tevent_req *req, int *perr)
 {
 	if (tevent_req_is_unix_error(req, perr)) {
@@ -362,4 +500,9 @@ int fncall_recv(struct tevent_req *req, int *perr)
 	return 0;
 }
 
+int fncall_wait_job(struct fncall_context *ctx, void *job_private)
+{
+	return 0;
+}
+
 #endif
@@ -0,0 +1,314 @@
+/*
+   Unix SMB/CIFS implementation.
+   Latency histograms for smbd hot paths
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Every process records into its own histograms without any locking.
+ * The histograms are merged into latency.tdb every "latency:flush
+ * interval" seconds and when the process exits, so smbstatus can dump
+ * the sum over all processes. latency.tdb is opened CLEAR_IF_FIRST by
+ * the parent smbd, the numbers start from zero with every restart.
+ */
+
+#include "includes.h"
+
+struct latency_counter {
+	struct latency_counter *prev, *next;
+	char *key;
+	struct latency_hist hist;
+};
+
+static bool latency_on;
+static int latency_flush_interval;
+static struct event_context *latency_ev;
+static struct timed_event *latency_flush_event;
+static struct latency_counter *latency_counters;
+static struct db_context *latency_db;
+
+/****************************************************************************
+ Map a latency to its bucket.
+****************************************************************************/
+
+int latency_bucket(uint64_t usec)
+{
+	int msb, shift;
+
+	if (usec < LATENCY_SUB_BUCKETS) {
+		return usec;
+	}
+
+	for (msb = LATENCY_SUB_BITS; msb < 63; msb++) {
+		if ((usec >> (msb + 1)) == 0) {
+			break;
+		}
+	}
+
+	if (msb > LATENCY_MAX_BIT) {
+		return LATENCY_HIST_BUCKETS - 1;
+	}
+
+	shift = msb - LATENCY_SUB_BITS;
+	return LATENCY_SUB_BUCKETS + shift * LATENCY_SUB_BUCKETS
+		+ ((usec >> shift) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/****************************************************************************
+ The largest latency that ends up in a bucket.
+****************************************************************************/
+
+uint64_t latency_bucket_max(int bucket)
+{
+	int shift, sub;
+
+	if (bucket < LATENCY_SUB_BUCKETS) {
+		return bucket;
+	}
+
+	shift = (bucket - LATENCY_SUB_BUCKETS) / LATENCY_SUB_BUCKETS;
+	sub = (bucket - LATENCY_SUB_BUCKETS) % LATENCY_SUB_BUCKETS;
+
+	return (((uint64_t)(LATENCY_SUB_BUCKETS + sub + 1)) << shift) - 1;
+}
+
+void latency_hist_add(struct latency_hist *hist, uint64_t usec)
+{
+	hist->count += 1;
+	hist->sum += usec;
+	if (usec > hist->max) {
+		hist->max = usec;
+	}
+	hist->buckets[latency_bucket(usec)] += 1;
+}
+
+void latency_hist_merge(struct latency_hist *dst,
+			const struct latency_hist *src)
+{
+	int i;
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->max > dst->max) {
+		dst->max = src->max;
+	}
+	for (i=0; i<LATENCY_HIST_BUCKETS; i++) {
+		dst->buckets[i] += src->buckets[i];
+	}
+}
+
+/****************************************************************************
+ Return the latency below which "percent" of all samples are. This is the
+ upper end of the bucket the sample falls into, but never more than the
+ largest latency seen.
+****************************************************************************/
+
+uint64_t latency_hist_percentile(const struct latency_hist *hist,
+				 double percent)
+{
+	uint64_t wanted, seen;
+	int i;
+
+	if (hist->count == 0) {
+		return 0;
+	}
+
+	wanted = (uint64_t)(hist->count * percent / 100.0 + 0.5);
+	if (wanted == 0) {
+		wanted = 1;
+	}
+
+	seen = 0;
+	for (i=0; i<LATENCY_HIST_BUCKETS; i++) {
+		seen += hist->buckets[i];
+		if (seen >= wanted) {
+			return MIN(latency_bucket_max(i), hist->max);
+		}
+	}
+
+	return hist->max;
+}
+
+/****************************************************************************
+ Open latency.tdb and start recording. The parent smbd calls this so that
+ the CLEAR_IF_FIRST database stays open, the children inherit it.
+****************************************************************************/
+
+bool latency_init(struct event_context *ev)
+{
+	if (latency_db != NULL) {
+		return true;
+	}
+
+	latency_db = db_open(NULL, lock_path("latency.tdb"), 0,
+			     TDB_CLEAR_IF_FIRST|TDB_INCOMPATIBLE_HASH,
+			     O_RDWR|O_CREAT, 0644);
+	if (latency_db == NULL) {
+		DEBUG(1, ("latency_init: Could not open latency.tdb: %s\n",
+			  strerror(errno)));
+		return false;
+	}
+
+	latency_ev = ev;
+	latency_flush_interval = lp_parm_int(-1, "latency", "flush interval",
+					     10);
+	latency_on = true;
+	return true;
+}
+
+bool latency_enabled(void)
+{
+	return latency_on;
+}
+
+/****************************************************************************
+ The start time for latency_record(), 0 if we are not recording.
+****************************************************************************/
+
+uint64_t latency_now(void)
+{
+	uint64_t now;
+
+	if (!latency_on) {
+		return 0;
+	}
+
+#if defined(HAVE_CLOCK_GETTIME) && defined(HAVE_CLOCK_MONOTONIC)
+	{
+		struct timespec ts;
+
+		if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+			now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+			return now ? now : 1;
+		}
+	}
+#endif
+	{
+		struct timeval tv;
+
+		GetTimeOfDay(&tv);
+		now = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+	}
+
+	return now ? now : 1;
+}
+
+static void latency_flush_handler(struct event_context *ev,
+				  struct timed_event *te,
+				  struct timeval now,
+				  void *private_data)
+{
+	latency_flush_event = NULL;
+	latency_flush();
+}
+
+/****************************************************************************
+ Record the time since "start" in the histogram *pcounter, which is
+ created as "class_name/name" on first use. The caller keeps *pcounter in
+ a static, so the hot path is a lookup-free array increment.
+****************************************************************************/
+
+void latency_record(struct latency_counter **pcounter,
+		    const char *class_name, const char *name,
+		    uint64_t start)
+{
+	struct latency_counter *counter = *pcounter;
+	uint64_t now;
+	int saved_errno;
+
+	if (start == 0) {
+		return;
+	}
+
+	now = latency_now();
+	saved_errno = errno;
+
+	if (counter == NULL) {
+		counter = TALLOC_ZERO_P(NULL, struct latency_counter);
+		if (counter == NULL) {
+			goto done;
+		}
+		counter->key = talloc_asprintf(counter, "%s/%s",
+					       class_name, name);
+		if (counter->key == NULL) {
+			TALLOC_FREE(counter);
+			goto done;
+		}
+		DLIST_ADD(latency_counters, counter);
+		*pcounter = counter;
+	}
+
+	latency_hist_add(&counter->hist, now > start ? now - start : 0);
+
+	if ((latency_flush_event == NULL) && (latency_ev != NULL)) {
+		latency_flush_event = event_add_timed(
+			latency_ev, NULL,
+			timeval_current_ofs(latency_flush_interval, 0),
+			latency_flush_handler, NULL);
+	}
+
+ done:
+	errno = saved_errno;
+}
+
+/****************************************************************************
+ Add what we recorded since the last flush to latency.tdb.
+****************************************************************************/
+
+void latency_flush(void)
+{
+	struct latency_counter *counter;
+
+	if (latency_db == NULL) {
+		return;
+	}
+
+	for (counter = latency_counters; counter; counter = counter->next) {
+		struct db_record *rec;
+		struct latency_hist hist;
+		NTSTATUS status;
+
+		if (counter->hist.count == 0) {
+			continue;
+		}
+
+		rec = latency_db->fetch_locked(
+			latency_db, talloc_tos(),
+			string_term_tdb_data(counter->key));
+		if (rec == NULL) {
+			DEBUG(5, ("latency_flush: could not lock %s\n",
+				  counter->key));
+			continue;
+		}
+
+		if (rec->value.dsize == sizeof(hist)) {
+			memcpy(&hist, rec->value.dptr, sizeof(hist));
+		} else {
+			ZERO_STRUCT(hist);
+		}
+		latency_hist_merge(&hist, &counter->hist);
+
+		status = rec->store(rec, make_tdb_data((uint8_t *)&hist,
+						       sizeof(hist)), 0);
+		TALLOC_FREE(rec);
+		if (!NT_STATUS_IS_OK(status)) {
+			DEBUG(5, ("latency_flush: could not store %s: %s\n",
+				  counter->key, nt_errstr(status)));
+			continue;
+		}
+
+		ZERO_STRUCT(counter->hist);
+	}
+}
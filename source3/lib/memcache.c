@@ -18,21 +18,35 @@
 */
 
 #include "memcache.h"
-#include "../lib/util/rbtree.h"
 
 static struct memcache *global_cache;
 
 struct memcache_element {
-	struct rb_node rb_node;
+	struct memcache_element *hash_next;
 	struct memcache_element *prev, *next;
-	size_t keylength, valuelength;
+	uint32_t hash;
 	uint8 n;		/* This is really an enum, but save memory */
+	size_t keylength, valuelength;
 	char data[1];		/* placeholder for offsetof */
 };
 
-struct memcache {
+/*
+ * Every memcache_number has its own hash table and LRU list, so that
+ * lookups only walk elements of one subset and so that we can keep
+ * per-subset budgets and statistics.
+ */
+
+struct memcache_subcache {
+	struct memcache_element **buckets;
+	uint32_t num_buckets;	/* Power of two, 0 if not allocated yet */
 	struct memcache_element *mru, *lru;
-	struct rb_root tree;
+	size_t size;
+	size_t max_size;
+	struct memcache_stats stats;
+};
+
+struct memcache {
+	struct memcache_subcache subs[MEMCACHE_NUM_CACHES];
 	size_t size;
 	size_t max_size;
 };
@@ -60,10 +74,13 @@ static bool memcache_is_talloc(enum memcache_number n)
 
 static int memcache_destructor(struct memcache *cache) {
 	struct memcache_element *e, *next;
+	int i;
 
-	for (e = cache->mru; e != NULL; e = next) {
-		next = e->next;
-		SAFE_FREE(e);
+	for (i = 0; i < MEMCACHE_NUM_CACHES; i++) {
+		for (e = cache->subs[i].mru; e != NULL; e = next) {
+			next = e->next;
+			SAFE_FREE(e);
+		}
 	}
 	return 0;
 }
@@ -87,12 +104,6 @@ void memcache_set_global(struct memcache *cache)
 	global_cache = cache;
 }
 
-static struct memcache_element *memcache_node2elem(struct rb_node *node)
-{
-	return (struct memcache_element *)
-		((char *)node - offsetof(struct memcache_element, rb_node));
-}
-
 static void memcache_element_parse(struct memcache_element *e,
 				   DATA_BLOB *key, DATA_BLOB *value)
 {
@@ -107,37 +118,40 @@ static size_t memcache_element_size(size_t key_length, size_t value_length)
 	return sizeof(struct memcache_element) - 1 + key_length + value_length;
 }
 
-static int memcache_compare(struct memcache_element *e, enum memcache_number n,
-			    DATA_BLOB key)
+static uint32_t memcache_hash(DATA_BLOB key)
 {
-	DATA_BLOB this_key, this_value;
+	uint32_t h = 2166136261U;	/* FNV-1a */
+	size_t i;
 
-	if ((int)e->n < (int)n) return 1;
-	if ((int)e->n > (int)n) return -1;
-
-	if (e->keylength < key.length) return 1;
-	if (e->keylength > key.length) return -1;
-
-	memcache_element_parse(e, &this_key, &this_value);
-	return memcmp(this_key.data, key.data, key.length);
+	for (i = 0; i < key.length; i++) {
+		h ^= key.data[i];
+		h *= 16777619U;
+	}
+	return h;
 }
 
 static struct memcache_element *memcache_find(
-	struct memcache *cache, enum memcache_number n, DATA_BLOB key)
+	struct memcache *cache, enum memcache_number n, DATA_BLOB key,
+	uint32_t hash)
 {
-	struct rb_node *node;
+	struct memcache_subcache *sub = &cache->subs[n];
+	struct memcache_element *e;
 
-	node = cache->tree.rb_node;
+	if (sub->num_buckets == 0) {
+		return NULL;
+	}
 
-	while (node != NULL) {
-		struct memcache_element *elem = memcache_node2elem(node);
-		int cmp;
+	for (e = sub->buckets[hash & (sub->num_buckets - 1)]; e != NULL;
+	     e = e->hash_next) {
+		DATA_BLOB this_key, this_value;
 
-		cmp = memcache_compare(elem, n, key);
-		if (cmp == 0) {
-			return elem;
+		if ((e->hash != hash) || (e->keylength != key.length)) {
+			continue;
+		}
+		memcache_element_parse(e, &this_key, &this_value);
+		if (memcmp(this_key.data, key.data, key.length) == 0) {
+			return e;
 		}
-		node = (cmp < 0) ? node->rb_left : node->rb_right;
 	}
 
 	return NULL;
@@ -146,6 +160,7 @@ static struct memcache_element *memcache_find(
 bool memcache_lookup(struct memcache *cache, enum memcache_number n,
 		     DATA_BLOB key, DATA_BLOB *value)
 {
+	struct memcache_subcache *sub;
 	struct memcache_element *e;
 
 	if (cache == NULL) {
@@ -155,22 +170,22 @@ bool memcache_lookup(struct memcache *cache, enum memcache_number n,
 		return false;
 	}
 
-	e = memcache_find(cache, n, key);
+	sub = &cache->subs[n];
+	sub->stats.lookups += 1;
+
+	e = memcache_find(cache, n, key, memcache_hash(key));
 	if (e == NULL) {
 		return false;
 	}
 
-	if (cache->size != 0) {
-		/*
-		 * Do LRU promotion only when we will ever shrink
-		 */
-		if (e == cache->lru) {
-			cache->lru = e->prev;
-		}
-		DLIST_PROMOTE(cache->mru, e);
-		if (cache->mru == NULL) {
-			cache->mru = e;
-		}
+	sub->stats.hits += 1;
+
+	if (e == sub->lru) {
+		sub->lru = e->prev;
+	}
+	DLIST_PROMOTE(sub->mru, e);
+	if (sub->lru == NULL) {
+		sub->lru = e;
 	}
 
 	memcache_element_parse(e, &key, value);
@@ -199,14 +214,22 @@ void *memcache_lookup_talloc(struct memcache *cache, enum memcache_number n,
 static void memcache_delete_element(struct memcache *cache,
 				    struct memcache_element *e)
 {
-	rb_erase(&e->rb_node, &cache->tree);
+	struct memcache_subcache *sub = &cache->subs[e->n];
+	struct memcache_element **pe;
+	size_t element_size;
+
+	for (pe = &sub->buckets[e->hash & (sub->num_buckets - 1)];
+	     *pe != e; pe = &(*pe)->hash_next) {
+		;
+	}
+	*pe = e->hash_next;
 
-	if (e == cache->lru) {
-		cache->lru = e->prev;
+	if (e == sub->lru) {
+		sub->lru = e->prev;
 	}
-	DLIST_REMOVE(cache->mru, e);
+	DLIST_REMOVE(sub->mru, e);
 
-	if (memcache_is_talloc(e->n)) {
+	if (memcache_is_talloc((enum memcache_number)e->n)) {
 		DATA_BLOB cache_key, cache_value;
 		void *ptr;
 
@@ -216,19 +239,55 @@ static void memcache_delete_element(struct memcache *cache,
 		TALLOC_FREE(ptr);
 	}
 
-	cache->size -= memcache_element_size(e->keylength, e->valuelength);
+	element_size = memcache_element_size(e->keylength, e->valuelength);
+	sub->size -= element_size;
+	sub->stats.num_elements -= 1;
+	cache->size -= element_size;
 
 	SAFE_FREE(e);
 }
 
-static void memcache_trim(struct memcache *cache)
+static void memcache_evict(struct memcache *cache,
+			   struct memcache_subcache *sub)
+{
+	sub->stats.evictions += 1;
+	memcache_delete_element(cache, sub->lru);
+}
+
+static void memcache_trim(struct memcache *cache, enum memcache_number n)
 {
+	struct memcache_subcache *sub = &cache->subs[n];
+
+	if (sub->max_size != 0) {
+		while ((sub->size > sub->max_size) && (sub->lru != NULL)) {
+			memcache_evict(cache, sub);
+		}
+	}
+
 	if (cache->max_size == 0) {
 		return;
 	}
 
-	while ((cache->size > cache->max_size) && (cache->lru != NULL)) {
-		memcache_delete_element(cache, cache->lru);
+	while (cache->size > cache->max_size) {
+		struct memcache_subcache *largest = NULL;
+		int i;
+
+		/*
+		 * Take from the largest subset, a burst in one cache
+		 * type should not flush the others.
+		 */
+		for (i = 0; i < MEMCACHE_NUM_CACHES; i++) {
+			struct memcache_subcache *s = &cache->subs[i];
+
+			if ((s->lru != NULL) &&
+			    ((largest == NULL) || (s->size > largest->size))) {
+				largest = s;
+			}
+		}
+		if (largest == NULL) {
+			break;
+		}
+		memcache_evict(cache, largest);
 	}
 }
 
@@ -244,7 +303,7 @@ void memcache_delete(struct memcache *cache, enum memcache_number n,
 		return;
 	}
 
-	e = memcache_find(cache, n, key);
+	e = memcache_find(cache, n, key, memcache_hash(key));
 	if (e == NULL) {
 		return;
 	}
@@ -252,14 +311,51 @@ void memcache_delete(struct memcache *cache, enum memcache_number n,
 	memcache_delete_element(cache, e);
 }
 
+/*
+ * Make sure the hash table of sub can take one more element without
+ * the chains getting long.
+ */
+
+static bool memcache_grow(struct memcache *cache,
+			  struct memcache_subcache *sub)
+{
+	struct memcache_element **buckets;
+	struct memcache_element *e;
+	uint32_t num_buckets;
+
+	if (sub->stats.num_elements < sub->num_buckets) {
+		return true;
+	}
+
+	num_buckets = (sub->num_buckets == 0) ? 16 : sub->num_buckets * 2;
+
+	buckets = TALLOC_ZERO_ARRAY(cache, struct memcache_element *,
+				    num_buckets);
+	if (buckets == NULL) {
+		/* We can live with long chains */
+		return (sub->num_buckets != 0);
+	}
+
+	for (e = sub->mru; e != NULL; e = e->next) {
+		uint32_t b = e->hash & (num_buckets - 1);
+		e->hash_next = buckets[b];
+		buckets[b] = e;
+	}
+
+	TALLOC_FREE(sub->buckets);
+	sub->buckets = buckets;
+	sub->num_buckets = num_buckets;
+	return true;
+}
+
 void memcache_add(struct memcache *cache, enum memcache_number n,
 		  DATA_BLOB key, DATA_BLOB value)
 {
+	struct memcache_subcache *sub;
 	struct memcache_element *e;
-	struct rb_node **p;
-	struct rb_node *parent;
 	DATA_BLOB cache_key, cache_value;
 	size_t element_size;
+	uint32_t hash, b;
 
 	if (cache == NULL) {
 		cache = global_cache;
@@ -272,13 +368,16 @@ void memcache_add(struct memcache *cache, enum memcache_number n,
 		return;
 	}
 
-	e = memcache_find(cache, n, key);
+	sub = &cache->subs[n];
+	hash = memcache_hash(key);
+
+	e = memcache_find(cache, n, key, hash);
 
 	if (e != NULL) {
 		memcache_element_parse(e, &cache_key, &cache_value);
 
 		if (value.length <= cache_value.length) {
-			if (memcache_is_talloc(e->n)) {
+			if (memcache_is_talloc((enum memcache_number)e->n)) {
 				void *ptr;
 				SMB_ASSERT(cache_value.length == sizeof(ptr));
 				memcpy(&ptr, cache_value.data, sizeof(ptr));
@@ -295,6 +394,11 @@ void memcache_add(struct memcache *cache, enum memcache_number n,
 		memcache_delete_element(cache, e);
 	}
 
+	if (!memcache_grow(cache, sub)) {
+		DEBUG(0, ("talloc failed\n"));
+		return;
+	}
+
 	element_size = memcache_element_size(key.length, value.length);
 
 
@@ -306,6 +410,7 @@ void memcache_add(struct memcache *cache, enum memcache_number n,
 	}
 
 	e->n = n;
+	e->hash = hash;
 	e->keylength = key.length;
 	e->valuelength = value.length;
 
@@ -313,30 +418,20 @@ void memcache_add(struct memcache *cache, enum memcache_number n,
 	memcpy(cache_key.data, key.data, key.length);
 	memcpy(cache_value.data, value.data, value.length);
 
-	parent = NULL;
-	p = &cache->tree.rb_node;
-
-	while (*p) {
-		struct memcache_element *elem = memcache_node2elem(*p);
-		int cmp;
+	b = hash & (sub->num_buckets - 1);
+	e->hash_next = sub->buckets[b];
+	sub->buckets[b] = e;
 
-		parent = (*p);
-
-		cmp = memcache_compare(elem, n, key);
-
-		p = (cmp < 0) ? &(*p)->rb_left : &(*p)->rb_right;
-	}
-
-	rb_link_node(&e->rb_node, parent, p);
-	rb_insert_color(&e->rb_node, &cache->tree);
-
-	DLIST_ADD(cache->mru, e);
-	if (cache->lru == NULL) {
-		cache->lru = e;
+	DLIST_ADD(sub->mru, e);
+	if (sub->lru == NULL) {
+		sub->lru = e;
 	}
 
+	sub->size += element_size;
+	sub->stats.num_elements += 1;
+	sub->stats.adds += 1;
 	cache->size += element_size;
-	memcache_trim(cache);
+	memcache_trim(cache, n);
 }
 
 void memcache_add_talloc(struct memcache *cache, enum memcache_number n,
@@ -358,7 +453,7 @@ void memcache_add_talloc(struct memcache *cache, enum memcache_number n,
 
 void memcache_flush(struct memcache *cache, enum memcache_number n)
 {
-	struct rb_node *node;
+	struct memcache_subcache *sub;
 
 	if (cache == NULL) {
 		cache = global_cache;
@@ -367,70 +462,40 @@ void memcache_flush(struct memcache *cache, enum memcache_number n)
 		return;
 	}
 
-	/*
-	 * Find the smallest element of number n
-	 */
+	sub = &cache->subs[n];
 
-	node = cache->tree.rb_node;
-	if (node == NULL) {
-		return;
+	while (sub->mru != NULL) {
+		memcache_delete_element(cache, sub->mru);
 	}
+}
 
-	/*
-	 * First, find *any* element of number n
-	 */
-
-	while (true) {
-		struct memcache_element *elem = memcache_node2elem(node);
-		struct rb_node *next;
-
-		if ((int)elem->n == (int)n) {
-			break;
-		}
-
-		if ((int)elem->n < (int)n) {
-			next = node->rb_right;
-		}
-		else {
-			next = node->rb_left;
-		}
-		if (next == NULL) {
-			break;
-		}
-		node = next;
+void memcache_set_max_size(struct memcache *cache, enum memcache_number n,
+			   size_t max_size)
+{
+	if (cache == NULL) {
+		cache = global_cache;
 	}
-
-	if (node == NULL) {
+	if (cache == NULL) {
 		return;
 	}
 
-	/*
-	 * Then, find the leftmost element with number n
-	 */
+	cache->subs[n].max_size = max_size;
+	memcache_trim(cache, n);
+}
 
-	while (true) {
-		struct rb_node *prev = rb_prev(node);
-		struct memcache_element *elem;
+void memcache_get_stats(struct memcache *cache, enum memcache_number n,
+			struct memcache_stats *stats)
+{
+	ZERO_STRUCTP(stats);
 
-		if (prev == NULL) {
-			break;
-		}
-		elem = memcache_node2elem(prev);
-		if ((int)elem->n != (int)n) {
-			break;
-		}
-		node = prev;
+	if (cache == NULL) {
+		cache = global_cache;
 	}
-
-	while (node != NULL) {
-		struct memcache_element *e = memcache_node2elem(node);
-		struct rb_node *next = rb_next(node);
-
-		if (e->n != n) {
-			break;
-		}
-
-		memcache_delete_element(cache, e);
-		node = next;
+	if (cache == NULL) {
+		return;
 	}
+
+	*stats = cache->subs[n].stats;
+	stats->size = cache->subs[n].size;
+	stats->max_size = cache->subs[n].max_size;
 }
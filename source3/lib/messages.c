@@ -183,6 +183,38 @@ struct event_context *messaging_event_context(struct messaging_context *msg_ctx)
 	return msg_ctx->event_ctx;
 }
 
+/*
+ * Set up the local backend: datagram sockets, with messages.tdb for
+ * everything that can't be sent that way. Without a socket we still work
+ * with the tdb alone.
+ */
+static NTSTATUS messaging_local_init(struct messaging_context *msg_ctx)
+{
+	struct messaging_backend *tdb_backend;
+	struct messaging_backend *dgram_backend;
+	NTSTATUS status;
+
+	status = messaging_tdb_init(msg_ctx, msg_ctx, &tdb_backend);
+
+	if (!NT_STATUS_IS_OK(status)) {
+		DEBUG(0, ("messaging_tdb_init failed: %s\n",
+			  nt_errstr(status)));
+		return status;
+	}
+
+	status = messaging_dgram_init(msg_ctx, msg_ctx, tdb_backend,
+				      &dgram_backend);
+	if (!NT_STATUS_IS_OK(status)) {
+		DEBUG(2, ("messaging_dgram_init failed: %s, using "
+			  "messages.tdb only\n", nt_errstr(status)));
+		msg_ctx->local = tdb_backend;
+		return NT_STATUS_OK;
+	}
+
+	msg_ctx->local = dgram_backend;
+	return NT_STATUS_OK;
+}
+
 struct messaging_context *messaging_init(TALLOC_CTX *mem_ctx, 
 					 struct server_id server_id, 
 					 struct event_context *ev)
@@ -197,11 +229,9 @@ struct messaging_context *messaging_init(TALLOC_CTX *mem_ctx,
 	ctx->id = server_id;
 	ctx->event_ctx = ev;
 
-	status = messaging_tdb_init(ctx, ctx, &ctx->local);
+	status = messaging_local_init(ctx);
 
 	if (!NT_STATUS_IS_OK(status)) {
-		DEBUG(0, ("messaging_tdb_init failed: %s\n",
-			  nt_errstr(status)));
 		TALLOC_FREE(ctx);
 		return NULL;
 	}
@@ -239,10 +269,8 @@ NTSTATUS messaging_reinit(struct messaging_context *msg_ctx)
 
 	TALLOC_FREE(msg_ctx->local);
 
-	status = messaging_tdb_init(msg_ctx, msg_ctx, &msg_ctx->local);
+	status = messaging_local_init(msg_ctx);
 	if (!NT_STATUS_IS_OK(status)) {
-		DEBUG(0, ("messaging_tdb_init failed: %s\n",
-			  nt_errstr(status)));
 		return status;
 	}
 
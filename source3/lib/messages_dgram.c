@@ -0,0 +1,573 @@
+/*
+   Unix SMB/CIFS implementation.
+   Samba internal messaging over unix datagram sockets
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   Every process binds a datagram socket named after its pid in the
+   "msg" directory below the lock directory. A message is a single
+   NDR-encoded messaging_rec, sent straight to the destination's socket.
+   Nothing is shared between senders, so unlike messages.tdb there is no
+   lock to contend on and no signal to deliver.
+
+   The sockets are only writable for root. Messages that can't go out
+   this way -- we are running as a user, the destination has no socket
+   (it is an older or non-smbd process), its queue is full or the message
+   is too big for a datagram -- are handed to the tdb backend, which we
+   keep running underneath for exactly that reason.
+
+   messages.tdb delivers the messages for a destination in the order
+   they were sent, and callers rely on that. We keep that order across
+   both paths: Once a message to a destination went to the tdb, all
+   further messages from us to it go there as well. A receiver picks up
+   everything in its socket while it holds the lock on its messages.tdb
+   record, and dispatches that before the messages it found in the tdb.
+   So datagrams sent before a message went to the tdb are dispatched
+   first, and no datagram from the same sender can come after it.
+
+   We never remove the socket of another process, its pid might have
+   been reused by now.
+
+   On Linux the receive queue of a datagram socket holds at most
+   net.unix.max_dgram_qlen messages. With the kernel default of 10, a
+   busy receiver pushes many of its senders onto the slower tdb path.
+*/
+
+#include "includes.h"
+#include "librpc/gen_ndr/messaging.h"
+#include "librpc/gen_ndr/ndr_messaging.h"
+
+/*
+ * Largest datagram we send. Bigger messages go through messages.tdb.
+ */
+#define MESSAGING_DGRAM_MAX 65536
+
+/*
+ * Messages received per event loop iteration
+ */
+#define MESSAGING_DGRAM_BATCH 64
+
+struct messaging_dgram_context {
+	struct messaging_context *msg_ctx;
+	struct messaging_backend *fallback;
+	pid_t pid;
+	int sock;
+	char *dir;
+	char *path;
+	struct tevent_fd *fde;
+	uint8_t *buf;
+	bool *destroyed;
+
+	/* Destinations we send to via messages.tdb only, sorted */
+	pid_t *tdb_pids;
+	size_t num_tdb_pids;
+
+	/* Picked up from the socket, not dispatched yet */
+	DATA_BLOB *queue;
+	size_t num_queued;
+};
+
+static NTSTATUS messaging_dgram_send(struct messaging_context *msg_ctx,
+				     struct server_id pid, int msg_type,
+				     const DATA_BLOB *data,
+				     struct messaging_backend *backend);
+static void messaging_dgram_handler(struct tevent_context *ev,
+				    struct tevent_fd *fde,
+				    uint16_t flags,
+				    void *private_data);
+static void messaging_dgram_collect(void *private_data);
+static bool messaging_dgram_predispatch(void *private_data);
+
+static int messaging_dgram_context_destructor(struct messaging_dgram_context *ctx)
+{
+	if (ctx->destroyed != NULL) {
+		*ctx->destroyed = true;
+	}
+	TALLOC_FREE(ctx->fde);
+	if (ctx->sock != -1) {
+		close(ctx->sock);
+		ctx->sock = -1;
+	}
+	/*
+	 * After a fork the socket belongs to our parent, don't remove it
+	 * under its feet.
+	 */
+	if ((ctx->path != NULL) && (ctx->pid == sys_getpid())) {
+		unlink(ctx->path);
+	}
+	return 0;
+}
+
+static bool messaging_dgram_sockaddr(const char *dir, pid_t pid,
+				     struct sockaddr_un *addr)
+{
+	int len;
+
+	ZERO_STRUCTP(addr);
+	addr->sun_family = AF_UNIX;
+	len = snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/%u",
+		       dir, (unsigned)pid);
+	return ((len > 0) && (len < sizeof(addr->sun_path)));
+}
+
+/****************************************************************************
+ Initialise the datagram messaging backend. Messages we can't send as a
+ datagram are passed on to "fallback", which becomes our talloc child.
+****************************************************************************/
+
+NTSTATUS messaging_dgram_init(struct messaging_context *msg_ctx,
+			      TALLOC_CTX *mem_ctx,
+			      struct messaging_backend *fallback,
+			      struct messaging_backend **presult)
+{
+	struct messaging_backend *result;
+	struct messaging_dgram_context *ctx;
+	struct sockaddr_un addr;
+	mode_t old_umask;
+	int ret;
+	NTSTATUS status;
+
+	if (!(result = TALLOC_P(mem_ctx, struct messaging_backend))) {
+		DEBUG(0, ("talloc failed\n"));
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	ctx = TALLOC_ZERO_P(result, struct messaging_dgram_context);
+	if (!ctx) {
+		DEBUG(0, ("talloc failed\n"));
+		TALLOC_FREE(result);
+		return NT_STATUS_NO_MEMORY;
+	}
+	result->private_data = ctx;
+	result->send_fn = messaging_dgram_send;
+
+	ctx->msg_ctx = msg_ctx;
+	ctx->fallback = fallback;
+	ctx->pid = sys_getpid();
+	ctx->sock = -1;
+	talloc_set_destructor(ctx, messaging_dgram_context_destructor);
+
+	ctx->buf = TALLOC_ARRAY(ctx, uint8_t, MESSAGING_DGRAM_MAX);
+	ctx->dir = talloc_strdup(ctx, lock_path("msg"));
+	if ((ctx->buf == NULL) || (ctx->dir == NULL)) {
+		DEBUG(0, ("talloc failed\n"));
+		TALLOC_FREE(result);
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	if (!directory_create_or_exist(ctx->dir, sec_initial_uid(), 0755)) {
+		DEBUG(2, ("Could not create messaging directory %s\n",
+			  ctx->dir));
+		TALLOC_FREE(result);
+		return NT_STATUS_ACCESS_DENIED;
+	}
+
+	if (!messaging_dgram_sockaddr(ctx->dir, ctx->pid, &addr)) {
+		DEBUG(2, ("Messaging socket name in %s is too long\n",
+			  ctx->dir));
+		TALLOC_FREE(result);
+		return NT_STATUS_NAME_TOO_LONG;
+	}
+
+	ctx->sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (ctx->sock == -1) {
+		status = map_nt_error_from_unix(errno);
+		DEBUG(2, ("socket failed: %s\n", strerror(errno)));
+		TALLOC_FREE(result);
+		return status;
+	}
+	/*
+	 * Never wait for a full receiver queue, two processes sending to
+	 * each other could block each other. messages.tdb takes the
+	 * overflow.
+	 */
+	set_blocking(ctx->sock, false);
+	fcntl(ctx->sock, F_SETFD, FD_CLOEXEC);
+
+	/* a dead process with our pid might have left its socket */
+	unlink(addr.sun_path);
+
+	/*
+	 * Only root may send to us. Create the socket with that mode
+	 * right away, a chmod afterwards leaves a window.
+	 */
+	old_umask = umask(0077);
+	ret = bind(ctx->sock, (struct sockaddr *)&addr, sizeof(addr));
+	umask(old_umask);
+
+	if (ret == -1) {
+		status = map_nt_error_from_unix(errno);
+		DEBUG(2, ("bind to %s failed: %s\n", addr.sun_path,
+			  strerror(errno)));
+		TALLOC_FREE(result);
+		return status;
+	}
+
+	ctx->path = talloc_strdup(ctx, addr.sun_path);
+	if (ctx->path == NULL) {
+		unlink(addr.sun_path);
+		TALLOC_FREE(result);
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	ctx->fde = tevent_add_fd(msg_ctx->event_ctx, ctx, ctx->sock,
+				 TEVENT_FD_READ, messaging_dgram_handler, ctx);
+	if (ctx->fde == NULL) {
+		TALLOC_FREE(result);
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	messaging_tdb_set_predispatch(fallback, messaging_dgram_collect,
+				      messaging_dgram_predispatch, ctx);
+	talloc_steal(result, fallback);
+
+	*presult = result;
+	return NT_STATUS_OK;
+}
+
+/****************************************************************************
+ Do we send to pid via messages.tdb only? Returns the index where pid is
+ or would have to be inserted in *pidx.
+****************************************************************************/
+
+static bool messaging_dgram_uses_tdb(struct messaging_dgram_context *ctx,
+				     pid_t pid, size_t *pidx)
+{
+	size_t lo = 0, hi = ctx->num_tdb_pids;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (ctx->tdb_pids[mid] == pid) {
+			*pidx = mid;
+			return true;
+		}
+		if (ctx->tdb_pids[mid] < pid) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	*pidx = lo;
+	return false;
+}
+
+static void messaging_dgram_use_tdb(struct messaging_dgram_context *ctx,
+				    pid_t pid)
+{
+	size_t idx;
+
+	if (messaging_dgram_uses_tdb(ctx, pid, &idx)) {
+		return;
+	}
+
+	if (ctx->num_tdb_pids == talloc_array_length(ctx->tdb_pids)) {
+		pid_t *tmp;
+
+		tmp = TALLOC_REALLOC_ARRAY(
+			ctx, ctx->tdb_pids, pid_t,
+			MAX(ctx->num_tdb_pids * 2, 16));
+		if (tmp == NULL) {
+			/* Ordering is gone, nothing else we can do */
+			smb_panic("messaging_dgram_use_tdb: no memory");
+		}
+		ctx->tdb_pids = tmp;
+	}
+
+	memmove(&ctx->tdb_pids[idx+1], &ctx->tdb_pids[idx],
+		(ctx->num_tdb_pids - idx) * sizeof(pid_t));
+	ctx->tdb_pids[idx] = pid;
+	ctx->num_tdb_pids += 1;
+}
+
+/****************************************************************************
+ Send a message to a particular pid.
+****************************************************************************/
+
+static NTSTATUS messaging_dgram_send(struct messaging_context *msg_ctx,
+				     struct server_id pid, int msg_type,
+				     const DATA_BLOB *data,
+				     struct messaging_backend *backend)
+{
+	struct messaging_dgram_context *ctx = talloc_get_type_abort(
+		backend->private_data, struct messaging_dgram_context);
+	struct messaging_rec rec;
+	struct sockaddr_un addr;
+	enum ndr_err_code ndr_err;
+	DATA_BLOB blob;
+	ssize_t sent;
+	size_t idx;
+	TALLOC_CTX *frame;
+
+	/* NULL pointer means implicit length zero. */
+	if (!data->data) {
+		SMB_ASSERT(data->length == 0);
+	}
+
+	SMB_ASSERT(procid_to_pid(&pid) > 0);
+
+	if (messaging_dgram_uses_tdb(ctx, procid_to_pid(&pid), &idx)
+	    || (data->length >= MESSAGING_DGRAM_MAX)
+	    || !messaging_dgram_sockaddr(ctx->dir, procid_to_pid(&pid),
+					 &addr)) {
+		goto fallback;
+	}
+
+	frame = talloc_stackframe();
+
+	rec.msg_version = MESSAGE_VERSION;
+	rec.msg_type = msg_type & MSG_TYPE_MASK;
+	rec.dest = pid;
+	rec.src = procid_self();
+	rec.buf = *data;
+
+	ndr_err = ndr_push_struct_blob(
+		&blob, frame, NULL, &rec,
+		(ndr_push_flags_fn_t)ndr_push_messaging_rec);
+	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
+		TALLOC_FREE(frame);
+		return ndr_map_error2ntstatus(ndr_err);
+	}
+
+	if (blob.length > MESSAGING_DGRAM_MAX) {
+		TALLOC_FREE(frame);
+		goto fallback;
+	}
+
+	sent = sendto(ctx->sock, blob.data, blob.length, 0,
+		      (struct sockaddr *)&addr, sizeof(addr));
+
+	if (sent == blob.length) {
+		TALLOC_FREE(frame);
+		return NT_STATUS_OK;
+	}
+
+	DEBUG(10, ("messaging_dgram_send: sendto to %s failed (%s), "
+		   "using messages.tdb\n", addr.sun_path, strerror(errno)));
+	TALLOC_FREE(frame);
+
+ fallback:
+	/*
+	 * A datagram sent after this message could overtake it, stick
+	 * with messages.tdb for this destination.
+	 */
+	messaging_dgram_use_tdb(ctx, procid_to_pid(&pid));
+
+	return ctx->fallback->send_fn(msg_ctx, pid, msg_type, data,
+				      ctx->fallback);
+}
+
+/****************************************************************************
+ Dispatch one message we received.
+****************************************************************************/
+
+static void messaging_dgram_dispatch(struct messaging_dgram_context *ctx,
+				     DATA_BLOB blob)
+{
+	struct messaging_rec rec;
+	enum ndr_err_code ndr_err;
+	TALLOC_CTX *frame = talloc_stackframe();
+
+	ndr_err = ndr_pull_struct_blob(
+		&blob, frame, NULL, &rec,
+		(ndr_pull_flags_fn_t)ndr_pull_messaging_rec);
+	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
+		DEBUG(1, ("messaging_dgram_dispatch: could not parse "
+			  "%d byte message\n", (int)blob.length));
+		TALLOC_FREE(frame);
+		return;
+	}
+
+	if (rec.msg_version != MESSAGE_VERSION) {
+		DEBUG(1, ("messaging_dgram_dispatch: message version %u, "
+			  "expected %u\n", (unsigned)rec.msg_version,
+			  MESSAGE_VERSION));
+		TALLOC_FREE(frame);
+		return;
+	}
+
+	if (DEBUGLEVEL >= 10) {
+		DEBUG(10, ("messaging_dgram_dispatch:\n"));
+		NDR_PRINT_DEBUG(messaging_rec, &rec);
+	}
+
+	messaging_dispatch_rec(ctx->msg_ctx, &rec);
+
+	TALLOC_FREE(frame);
+}
+
+/****************************************************************************
+ Receive one message into ctx->buf. Returns -1 if there was none.
+****************************************************************************/
+
+static ssize_t messaging_dgram_recv(struct messaging_dgram_context *ctx)
+{
+	ssize_t received;
+
+	received = recv(ctx->sock, ctx->buf, MESSAGING_DGRAM_MAX, 0);
+	if (received == -1) {
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK)
+		    && (errno != EINTR)) {
+			DEBUG(1, ("messaging_dgram_recv: recv failed: %s\n",
+				  strerror(errno)));
+		}
+	}
+	return received;
+}
+
+/****************************************************************************
+ Dispatch what messaging_dgram_collect() picked up. Returns false if a
+ handler freed the messaging context.
+****************************************************************************/
+
+static bool messaging_dgram_dispatch_queue(struct messaging_dgram_context *ctx)
+{
+	bool destroyed = false;
+	bool *outer_destroyed;
+
+	/*
+	 * We might be called from a nested event loop inside one of
+	 * our own message handlers.
+	 */
+	outer_destroyed = ctx->destroyed;
+	ctx->destroyed = &destroyed;
+
+	while (ctx->num_queued > 0) {
+		DATA_BLOB blob = ctx->queue[0];
+
+		ctx->num_queued -= 1;
+		memmove(&ctx->queue[0], &ctx->queue[1],
+			ctx->num_queued * sizeof(DATA_BLOB));
+
+		messaging_dgram_dispatch(ctx, blob);
+		if (destroyed) {
+			/* blob went away with ctx */
+			if (outer_destroyed != NULL) {
+				*outer_destroyed = true;
+			}
+			return false;
+		}
+		data_blob_free(&blob);
+	}
+
+	ctx->destroyed = outer_destroyed;
+	return true;
+}
+
+static void messaging_dgram_handler(struct tevent_context *ev,
+				    struct tevent_fd *fde,
+				    uint16_t flags,
+				    void *private_data)
+{
+	struct messaging_dgram_context *ctx = talloc_get_type_abort(
+		private_data, struct messaging_dgram_context);
+	bool destroyed = false;
+	ssize_t received;
+	int i;
+
+	if (ctx->pid != sys_getpid()) {
+		/*
+		 * We are a child that did not call messaging_reinit(), the
+		 * messages in this socket are for our parent.
+		 */
+		TALLOC_FREE(ctx->fde);
+		return;
+	}
+
+	/* Older than what is still in the socket */
+	if (!messaging_dgram_dispatch_queue(ctx)) {
+		return;
+	}
+
+	/*
+	 * Empty the queue quickly so that senders don't have to wait, but
+	 * stop if a message handler freed the messaging context.
+	 */
+	ctx->destroyed = &destroyed;
+
+	for (i=0; i<MESSAGING_DGRAM_BATCH; i++) {
+		received = messaging_dgram_recv(ctx);
+		if (received == -1) {
+			break;
+		}
+		messaging_dgram_dispatch(
+			ctx, data_blob_const(ctx->buf, received));
+		if (destroyed) {
+			return;
+		}
+	}
+
+	ctx->destroyed = NULL;
+}
+
+/****************************************************************************
+ Called by the tdb backend while it holds the lock on our messages.tdb
+ record. Everything in our socket was sent before anything that is
+ queued for us in messages.tdb now, pick it up so that it gets
+ dispatched first.
+****************************************************************************/
+
+static void messaging_dgram_collect(void *private_data)
+{
+	struct messaging_dgram_context *ctx = talloc_get_type_abort(
+		private_data, struct messaging_dgram_context);
+	ssize_t received;
+
+	if ((ctx->fde == NULL) || (ctx->pid != sys_getpid())) {
+		return;
+	}
+
+	while ((received = messaging_dgram_recv(ctx)) != -1) {
+		DATA_BLOB blob;
+
+		if (ctx->num_queued == talloc_array_length(ctx->queue)) {
+			DATA_BLOB *tmp;
+
+			tmp = TALLOC_REALLOC_ARRAY(
+				ctx, ctx->queue, DATA_BLOB,
+				MAX(ctx->num_queued * 2, 16));
+			if (tmp == NULL) {
+				DEBUG(0, ("messaging_dgram_collect: talloc "
+					  "failed, dropping message\n"));
+				continue;
+			}
+			ctx->queue = tmp;
+		}
+
+		blob = data_blob_talloc(ctx, ctx->buf, received);
+		if (blob.data == NULL) {
+			DEBUG(0, ("messaging_dgram_collect: talloc failed, "
+				  "dropping message\n"));
+			continue;
+		}
+		ctx->queue[ctx->num_queued] = blob;
+		ctx->num_queued += 1;
+	}
+}
+
+/****************************************************************************
+ Called by the tdb backend before it dispatches the messages it found for
+ us in messages.tdb. Returns false if a handler freed the messaging
+ context.
+****************************************************************************/
+
+static bool messaging_dgram_predispatch(void *private_data)
+{
+	struct messaging_dgram_context *ctx = talloc_get_type_abort(
+		private_data, struct messaging_dgram_context);
+
+	return messaging_dgram_dispatch_queue(ctx);
+}
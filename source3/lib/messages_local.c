@@ -51,13 +51,21 @@ struct messaging_tdb_context {
 	struct tdb_wrap *tdb;
 	struct tevent_signal *se;
 	int received_messages;
+
+	/*
+	 * Called around retrieving our messages from messages.tdb, see
+	 * messaging_tdb_set_predispatch()
+	 */
+	void (*collect_fn)(void *private_data);
+	bool (*predispatch_fn)(void *private_data);
+	void *predispatch_private;
 };
 
 static NTSTATUS messaging_tdb_send(struct messaging_context *msg_ctx,
 				   struct server_id pid, int msg_type,
 				   const DATA_BLOB *data,
 				   struct messaging_backend *backend);
-static void message_dispatch(struct messaging_context *msg_ctx);
+static void message_dispatch(struct messaging_tdb_context *ctx);
 
 static void messaging_tdb_signal_handler(struct tevent_context *ev_ctx,
 					 struct tevent_signal *se,
@@ -72,7 +80,7 @@ static void messaging_tdb_signal_handler(struct tevent_context *ev_ctx,
 	DEBUG(10, ("messaging_tdb_signal_handler: sig[%d] count[%d] msgs[%d]\n",
 		   signum, count, ctx->received_messages));
 
-	message_dispatch(ctx->msg_ctx);
+	message_dispatch(ctx);
 }
 
 /****************************************************************************
@@ -133,6 +141,28 @@ NTSTATUS messaging_tdb_init(struct messaging_context *msg_ctx,
 	return NT_STATUS_OK;
 }
 
+/****************************************************************************
+ Let a backend stacked on top of us dispatch what it received before the
+ messages a sender had to queue here later. collect_fn is called while we
+ hold the lock on our messages.tdb record, so nothing can be queued there
+ while it picks up its own messages. fn is called after we have let go of
+ the lock, before we dispatch what we found in messages.tdb. It returns
+ false if it freed the messaging context.
+****************************************************************************/
+
+void messaging_tdb_set_predispatch(struct messaging_backend *backend,
+				   void (*collect_fn)(void *private_data),
+				   bool (*fn)(void *private_data),
+				   void *private_data)
+{
+	struct messaging_tdb_context *ctx = talloc_get_type_abort(
+		backend->private_data, struct messaging_tdb_context);
+
+	ctx->collect_fn = collect_fn;
+	ctx->predispatch_fn = fn;
+	ctx->predispatch_private = private_data;
+}
+
 /*******************************************************************
  Form a static tdb key from a pid.
 ******************************************************************/
@@ -390,10 +420,11 @@ static NTSTATUS messaging_tdb_send(struct messaging_context *msg_ctx,
  Retrieve all messages for the current process.
 ****************************************************************************/
 
-static NTSTATUS retrieve_all_messages(TDB_CONTEXT *msg_tdb,
+static NTSTATUS retrieve_all_messages(struct messaging_tdb_context *ctx,
 				      TALLOC_CTX *mem_ctx,
 				      struct messaging_array **presult)
 {
+	TDB_CONTEXT *msg_tdb = ctx->tdb->tdb;
 	struct messaging_array *result;
 	TDB_DATA key = message_key_pid(mem_ctx, procid_self());
 	NTSTATUS status;
@@ -403,6 +434,10 @@ static NTSTATUS retrieve_all_messages(TDB_CONTEXT *msg_tdb,
 		return NT_STATUS_LOCK_NOT_GRANTED;
 	}
 
+	if (ctx->collect_fn != NULL) {
+		ctx->collect_fn(ctx->predispatch_private);
+	}
+
 	status = messaging_tdb_fetch(msg_tdb, key, mem_ctx, &result);
 
 	/*
@@ -427,12 +462,10 @@ static NTSTATUS retrieve_all_messages(TDB_CONTEXT *msg_tdb,
  messages on an *odd* byte boundary.
 ****************************************************************************/
 
-static void message_dispatch(struct messaging_context *msg_ctx)
+static void message_dispatch(struct messaging_tdb_context *ctx)
 {
-	struct messaging_tdb_context *ctx = talloc_get_type(msg_ctx->local->private_data,
-					    struct messaging_tdb_context);
+	struct messaging_context *msg_ctx = ctx->msg_ctx;
 	struct messaging_array *msg_array = NULL;
-	struct tdb_wrap *tdb = ctx->tdb;
 	NTSTATUS status;
 	uint32 i;
 
@@ -443,7 +476,7 @@ static void message_dispatch(struct messaging_context *msg_ctx)
 	DEBUG(10, ("message_dispatch: received_messages = %d\n",
 		   ctx->received_messages));
 
-	status = retrieve_all_messages(tdb->tdb, NULL, &msg_array);
+	status = retrieve_all_messages(ctx, NULL, &msg_array);
 	if (!NT_STATUS_IS_OK(status)) {
 		DEBUG(0, ("message_dispatch: failed to retrieve messages: %s\n",
 			   nt_errstr(status)));
@@ -452,6 +485,12 @@ static void message_dispatch(struct messaging_context *msg_ctx)
 
 	ctx->received_messages = 0;
 
+	if ((ctx->predispatch_fn != NULL)
+	    && !ctx->predispatch_fn(ctx->predispatch_private)) {
+		TALLOC_FREE(msg_array);
+		return;
+	}
+
 	for (i=0; i<msg_array->num_messages; i++) {
 		messaging_dispatch_rec(msg_ctx, &msg_array->messages[i]);
 	}
@@ -145,17 +145,89 @@ static int ms_fnmatch_core(const smb_ucs2_t *p, const smb_ucs2_t *n,
 	return -1;
 }
 
-int ms_fnmatch(const char *pattern, const char *string, bool translate_pattern,
-	       bool is_case_sensitive)
+/*
+  for older negotiated protocols it is possible to translate the
+  pattern to produce a "new style" pattern that exactly matches w2k
+  behaviour
+*/
+static void ms_fnmatch_translate(smb_ucs2_t *p)
+{
+	int i;
+
+	for (i=0;p[i];i++) {
+		if (p[i] == UCS2_CHAR('?')) {
+			p[i] = UCS2_CHAR('>');
+		} else if (p[i] == UCS2_CHAR('.') &&
+			   (p[i+1] == UCS2_CHAR('?') ||
+			    p[i+1] == UCS2_CHAR('*') ||
+			    p[i+1] == 0)) {
+			p[i] = UCS2_CHAR('"');
+		} else if (p[i] == UCS2_CHAR('*') && p[i+1] == UCS2_CHAR('.')) {
+			p[i] = UCS2_CHAR('<');
+		}
+	}
+}
+
+static int ms_fnmatch_count_stars(const smb_ucs2_t *p)
+{
+	int count, i;
+
+	for (count=i=0;p[i];i++) {
+		if (p[i] == UCS2_CHAR('*') || p[i] == UCS2_CHAR('<')) count++;
+	}
+	return count;
+}
+
+/*
+  match a unix charset string against an already converted and
+  translated pattern with count '*' and '<' characters in it
+*/
+static int ms_fnmatch_ucs2(const smb_ucs2_t *p, int count, const char *string,
+			   bool is_case_sensitive)
 {
-	smb_ucs2_t *p = NULL;
 	smb_ucs2_t *s = NULL;
-	int ret, count, i;
+	int ret;
 	struct max_n *max_n = NULL;
 	struct max_n *max_n_free = NULL;
 	struct max_n one_max_n;
 	size_t converted_size;
 
+	if (!push_ucs2_talloc(talloc_tos(), &s, string, &converted_size)) {
+		return -1;
+	}
+
+	if (count != 0) {
+		if (count == 1) {
+			/*
+			 * We're doing this a LOT, so save the effort to allocate
+			 */
+			ZERO_STRUCT(one_max_n);
+			max_n = &one_max_n;
+		}
+		else {
+			max_n = SMB_CALLOC_ARRAY(struct max_n, count);
+			if (!max_n) {
+				TALLOC_FREE(s);
+				return -1;
+			}
+			max_n_free = max_n;
+		}
+	}
+
+	ret = ms_fnmatch_core(p, s, max_n, strrchr_w(s, UCS2_CHAR('.')), is_case_sensitive);
+
+	SAFE_FREE(max_n_free);
+	TALLOC_FREE(s);
+	return ret;
+}
+
+int ms_fnmatch(const char *pattern, const char *string, bool translate_pattern,
+	       bool is_case_sensitive)
+{
+	smb_ucs2_t *p = NULL;
+	int ret;
+	size_t converted_size;
+
 	if (ISDOTDOT(string)) {
 		string = ".";
 	}
@@ -174,62 +246,243 @@ int ms_fnmatch(const char *pattern, const char *string, bool translate_pattern,
 		return -1;
 	}
 
-	if (!push_ucs2_talloc(talloc_tos(), &s, string, &converted_size)) {
-		TALLOC_FREE(p);
-		return -1;
+	if (translate_pattern) {
+		ms_fnmatch_translate(p);
 	}
 
-	if (translate_pattern) {
-		/*
-		  for older negotiated protocols it is possible to
-		  translate the pattern to produce a "new style"
-		  pattern that exactly matches w2k behaviour
-		*/
-		for (i=0;p[i];i++) {
-			if (p[i] == UCS2_CHAR('?')) {
-				p[i] = UCS2_CHAR('>');
-			} else if (p[i] == UCS2_CHAR('.') &&
-				   (p[i+1] == UCS2_CHAR('?') ||
-				    p[i+1] == UCS2_CHAR('*') ||
-				    p[i+1] == 0)) {
-				p[i] = UCS2_CHAR('"');
-			} else if (p[i] == UCS2_CHAR('*') && p[i+1] == UCS2_CHAR('.')) {
-				p[i] = UCS2_CHAR('<');
-			}
+	ret = ms_fnmatch_ucs2(p, ms_fnmatch_count_stars(p), string,
+			      is_case_sensitive);
+
+	TALLOC_FREE(p);
+	return ret;
+}
+
+/*
+  A pattern prepared once for matching against many names, typically
+  all entries of a directory. The common shapes are matched without
+  converting the name to UCS2: a pattern without wildcards, a pattern
+  of only '*', and an ASCII literal preceded ("*.tmp") or followed
+  ("abc*") by a single '*'. Everything else, and names that are not
+  ASCII where the literal is compared, goes through ms_fnmatch_core()
+  with the converted pattern.
+*/
+
+enum ms_fnmatch_type {
+	MS_FNMATCH_EXACT,
+	MS_FNMATCH_ALL,
+	MS_FNMATCH_PREFIX,
+	MS_FNMATCH_SUFFIX,
+	MS_FNMATCH_GENERAL
+};
+
+struct ms_fnmatch_compiled {
+	enum ms_fnmatch_type type;
+	char *pattern;
+	bool translate_pattern;
+	bool is_case_sensitive;
+	smb_ucs2_t *p;
+	int count;
+	char *literal;
+	size_t literal_len;
+};
+
+static bool ms_fnmatch_is_wild(smb_ucs2_t c)
+{
+	return (c == UCS2_CHAR('*') || c == UCS2_CHAR('<') ||
+		c == UCS2_CHAR('>') || c == UCS2_CHAR('?') ||
+		c == UCS2_CHAR('"'));
+}
+
+/*
+  Copy the ASCII literal p[0..len-1] into m->literal. Returns false if
+  it contains a wildcard or a non-ASCII character.
+*/
+static bool ms_fnmatch_set_literal(struct ms_fnmatch_compiled *m,
+				   const smb_ucs2_t *p, size_t len)
+{
+	size_t i;
+
+	if (len == 0) {
+		return false;
+	}
+	for (i=0; i<len; i++) {
+		if (p[i] >= 0x80 || ms_fnmatch_is_wild(p[i])) {
+			return false;
 		}
 	}
 
-	for (count=i=0;p[i];i++) {
-		if (p[i] == UCS2_CHAR('*') || p[i] == UCS2_CHAR('<')) count++;
+	m->literal = talloc_array(m, char, len + 1);
+	if (m->literal == NULL) {
+		return false;
 	}
+	for (i=0; i<len; i++) {
+		m->literal[i] = (char)p[i];
+	}
+	m->literal[len] = '\0';
+	m->literal_len = len;
+	return true;
+}
 
-	if (count != 0) {
-		if (count == 1) {
-			/*
-			 * We're doing this a LOT, so save the effort to allocate
-			 */
-			ZERO_STRUCT(one_max_n);
-			max_n = &one_max_n;
+struct ms_fnmatch_compiled *ms_fnmatch_compile(TALLOC_CTX *mem_ctx,
+					       const char *pattern,
+					       bool translate_pattern,
+					       bool is_case_sensitive)
+{
+	struct ms_fnmatch_compiled *m;
+	size_t converted_size, len, i;
+
+	m = TALLOC_ZERO_P(mem_ctx, struct ms_fnmatch_compiled);
+	if (m == NULL) {
+		return NULL;
+	}
+	m->translate_pattern = translate_pattern;
+	m->is_case_sensitive = is_case_sensitive;
+	m->pattern = talloc_strdup(m, pattern);
+	if (m->pattern == NULL) {
+		TALLOC_FREE(m);
+		return NULL;
+	}
+
+	if (strpbrk(pattern, "<>*?\"") == NULL) {
+		m->type = MS_FNMATCH_EXACT;
+		return m;
+	}
+
+	if (!push_ucs2_talloc(m, &m->p, pattern, &converted_size)) {
+		TALLOC_FREE(m);
+		return NULL;
+	}
+	if (translate_pattern) {
+		ms_fnmatch_translate(m->p);
+	}
+	m->count = ms_fnmatch_count_stars(m->p);
+	m->type = MS_FNMATCH_GENERAL;
+
+	len = strlen_w(m->p);
+
+	for (i=0; i<len && m->p[i] == UCS2_CHAR('*'); i++) {
+		;
+	}
+	if (i == len) {
+		m->type = MS_FNMATCH_ALL;
+		return m;
+	}
+
+	/*
+	 * '<' stops at the last dot in the name, so it only behaves like
+	 * '*' in front of a literal containing a dot.
+	 */
+	if ((m->p[0] == UCS2_CHAR('*') ||
+	     (m->p[0] == UCS2_CHAR('<') &&
+	      strchr_w(m->p, UCS2_CHAR('.')) != NULL)) &&
+	    ms_fnmatch_set_literal(m, m->p + 1, len - 1)) {
+		m->type = MS_FNMATCH_SUFFIX;
+	} else if (m->p[len-1] == UCS2_CHAR('*') &&
+		   ms_fnmatch_set_literal(m, m->p, len - 1)) {
+		m->type = MS_FNMATCH_PREFIX;
+	}
+
+	return m;
+}
+
+/*
+  Is m the result of compiling pattern with these flags?
+*/
+bool ms_fnmatch_compiled_for(const struct ms_fnmatch_compiled *m,
+			     const char *pattern, bool translate_pattern,
+			     bool is_case_sensitive)
+{
+	return (m->translate_pattern == translate_pattern &&
+		m->is_case_sensitive == is_case_sensitive &&
+		strcmp(m->pattern, pattern) == 0);
+}
+
+/*
+  Compare the start of string with the literal. Returns -1 for a
+  mismatch and 1 if the caller has to do a full match because the
+  string is not ASCII there.
+*/
+static int ms_fnmatch_literal(const struct ms_fnmatch_compiled *m,
+			      const char *string)
+{
+	size_t i;
+
+	for (i=0; i<m->literal_len; i++) {
+		unsigned char c = (unsigned char)string[i];
+		unsigned char l = (unsigned char)m->literal[i];
+
+		if (c >= 0x80) {
+			return 1;
 		}
-		else {
-			max_n = SMB_CALLOC_ARRAY(struct max_n, count);
-			if (!max_n) {
-				TALLOC_FREE(p);
-				TALLOC_FREE(s);
-				return -1;
-			}
-			max_n_free = max_n;
+		if (c == l) {
+			continue;
+		}
+		if (m->is_case_sensitive ||
+		    toupper_ascii(c) != toupper_ascii(l)) {
+			return -1;
 		}
 	}
+	return 0;
+}
 
-	ret = ms_fnmatch_core(p, s, max_n, strrchr_w(s, UCS2_CHAR('.')), is_case_sensitive);
+int ms_fnmatch_compiled(const struct ms_fnmatch_compiled *m,
+			const char *string)
+{
+	const char *tail;
+	size_t len;
+	int ret;
 
-	SAFE_FREE(max_n_free);
-	TALLOC_FREE(p);
-	TALLOC_FREE(s);
-	return ret;
-}
+	if (ISDOTDOT(string)) {
+		string = ".";
+	}
+
+	switch (m->type) {
+	case MS_FNMATCH_EXACT:
+		if (m->is_case_sensitive) {
+			return strcmp(m->pattern, string);
+		}
+		return StrCaseCmp(m->pattern, string);
+
+	case MS_FNMATCH_ALL:
+		return 0;
+
+	case MS_FNMATCH_PREFIX:
+		len = strnlen(string, m->literal_len);
+		if (len < m->literal_len) {
+			/* fewer bytes than the literal has characters */
+			return -1;
+		}
+		ret = ms_fnmatch_literal(m, string);
+		if (ret <= 0) {
+			return ret;
+		}
+		break;
+
+	case MS_FNMATCH_SUFFIX:
+		len = strlen(string);
+		if (len < m->literal_len) {
+			return -1;
+		}
+		tail = string + len - m->literal_len;
+		/*
+		 * A non-ASCII byte in front of the literal might be the
+		 * start of a multibyte character reaching into it.
+		 */
+		if ((tail > string) && ((unsigned char)tail[-1] >= 0x80)) {
+			break;
+		}
+		ret = ms_fnmatch_literal(m, tail);
+		if (ret <= 0) {
+			return ret;
+		}
+		break;
 
+	case MS_FNMATCH_GENERAL:
+		break;
+	}
+
+	return ms_fnmatch_ucs2(m->p, m->count, string, m->is_case_sensitive);
+}
 
 /* a generic fnmatch function - uses for non-CIFS pattern matching */
 int gen_fnmatch(const char *pattern, const char *string)
@@ -131,6 +131,81 @@ static ssize_t default_sys_recvfile(int fromfd,
 
 #if defined(HAVE_LINUX_SPLICE)
 
+/*
+ * Only SMB2 asks for splice, see sys_recvfile_try_splice(). Older Linux
+ * kernels have splice for sendfile, but it fails for recvfile. We
+ * switch it off for good the first time it fails.
+ */
+static bool try_splice_call = false;
+
+void sys_recvfile_try_splice(void)
+{
+	static bool done;
+
+	if (!done) {
+		try_splice_call = true;
+		done = true;
+	}
+}
+
+/*
+ * Throw away a pipe that might still hold data, the next call to
+ * sys_recvfile() creates a new one.
+ */
+
+static void recvfile_close_pipe(int pipefd[2])
+{
+	close(pipefd[0]);
+	close(pipefd[1]);
+	pipefd[0] = -1;
+	pipefd[1] = -1;
+}
+
+/*
+ * Empty len bytes out of the splice pipe into the file at offset.
+ * Returns the number of bytes written, the pipe is emptied even if
+ * the file write fails. If reading the pipe fails, the caller must
+ * not use it again.
+ */
+
+static ssize_t recvfile_pipe_to_file(int pipefd, int tofd,
+				     SMB_OFF_T offset, size_t len)
+{
+	char buf[4096];
+	size_t total = 0;
+	int saved_errno = 0;
+	ssize_t ret;
+
+	while (len > 0) {
+		size_t done = 0;
+
+		ret = sys_read(pipefd, buf, MIN(len, sizeof(buf)));
+		if (ret <= 0) {
+			return -1;
+		}
+		len -= ret;
+
+		while ((tofd != -1) && (done < ret)) {
+			ssize_t written = sys_pwrite(tofd, buf + done,
+						     ret - done,
+						     offset + total);
+			if (written <= 0) {
+				/* stop writing, but empty the pipe */
+				saved_errno = errno;
+				tofd = -1;
+				break;
+			}
+			done += written;
+			total += written;
+		}
+	}
+
+	if (saved_errno != 0) {
+		errno = saved_errno;
+	}
+	return total;
+}
+
 /*
  * Try and use the Linux system call to do this.
  * Remember we only return -1 if the socket read
@@ -146,7 +221,6 @@ ssize_t sys_recvfile(int fromfd,
 			size_t count)
 {
 	static int pipefd[2] = { -1, -1 };
-	static bool try_splice_call = false;
 	size_t total_written = 0;
 	loff_t splice_offset = offset;
 
@@ -159,13 +233,6 @@ ssize_t sys_recvfile(int fromfd,
 		return 0;
 	}
 
-	/*
-	 * Older Linux kernels have splice for sendfile,
-	 * but it fails for recvfile. Ensure we only try
-	 * this once and always fall back to the userspace
-	 * implementation if recvfile splice fails. JRA.
-	 */
-
 	if (!try_splice_call) {
 		return default_sys_recvfile(fromfd,
 				tofd,
@@ -195,6 +262,10 @@ ssize_t sys_recvfile(int fromfd,
 			}
 			break;
 		}
+		if (nread == 0) {
+			/* EOF on the socket, drain_socket will fail */
+			break;
+		}
 
 		to_write = nread;
 		while (to_write > 0) {
@@ -203,7 +274,44 @@ ssize_t sys_recvfile(int fromfd,
 					  &splice_offset, to_write,
 					  SPLICE_F_MOVE);
 			if (thistime == -1) {
-				goto done;
+				/*
+				 * The file system might not do splice
+				 * writes (EINVAL). The data is off the
+				 * socket already, so pwrite what is in the
+				 * pipe and use the userspace copy from now
+				 * on.
+				 */
+				ssize_t ret;
+
+				try_splice_call = false;
+
+				ret = recvfile_pipe_to_file(pipefd[0], tofd,
+							    splice_offset,
+							    to_write);
+				total_written += nread - to_write;
+				count -= nread;
+				if (ret != to_write) {
+					/*
+					 * Don't let what might be left
+					 * in the pipe end up in the next
+					 * file.
+					 */
+					recvfile_close_pipe(pipefd);
+					if (ret > 0) {
+						total_written += ret;
+					}
+					goto done;
+				}
+				total_written += to_write;
+				splice_offset += to_write;
+
+				ret = default_sys_recvfile(fromfd, tofd,
+							   splice_offset,
+							   count);
+				if (ret == -1) {
+					return -1;
+				}
+				return total_written + ret;
 			}
 			to_write -= thistime;
 		}
@@ -213,10 +321,10 @@ ssize_t sys_recvfile(int fromfd,
 	}
 
  done:
-	if (total_written < count) {
+	if (count > 0) {
+		/* count is what is still in the socket */
 		int saved_errno = errno;
-		if (drain_socket(fromfd, count-total_written) !=
-				count-total_written) {
+		if (drain_socket(fromfd, count) != count) {
 			/* socket is dead. */
 			return -1;
 		}
@@ -231,6 +339,10 @@ ssize_t sys_recvfile(int fromfd,
  No recvfile system call - use the default 128 chunk implementation.
 *****************************************************************/
 
+void sys_recvfile_try_splice(void)
+{
+}
+
 ssize_t sys_recvfile(int fromfd,
 			int tofd,
 			SMB_OFF_T offset,
@@ -46,8 +46,9 @@ bool share_info_db_init(void)
 		return True;
 	}
 
+	/* looked up on every tree connect, rarely written */
 	share_db = db_open(NULL, state_path("share_info.tdb"), 0,
-				 TDB_DEFAULT, O_RDWR|O_CREAT, 0600);
+				 TDB_READ_MOSTLY, O_RDWR|O_CREAT, 0600);
 	if (share_db == NULL) {
 		DEBUG(0,("Failed to open share info database %s (%s)\n",
 			state_path("share_info.tdb"), strerror(errno) ));
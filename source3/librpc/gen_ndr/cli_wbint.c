@@ -3453,3 +3453,297 @@ NTSTATUS rpccli_wbint_SetHWM(struct rpc_pipe_client *cli,
 	return r.out.result;
 }
 
+struct rpccli_wbint_Sids2UnixIDs_state {
+	struct wbint_Sids2UnixIDs orig;
+	struct wbint_Sids2UnixIDs tmp;
+	TALLOC_CTX *out_mem_ctx;
+	NTSTATUS (*dispatch_recv)(struct tevent_req *req, TALLOC_CTX *mem_ctx);
+};
+
+static void rpccli_wbint_Sids2UnixIDs_done(struct tevent_req *subreq);
+
+struct tevent_req *rpccli_wbint_Sids2UnixIDs_send(TALLOC_CTX *mem_ctx,
+						  struct tevent_context *ev,
+						  struct rpc_pipe_client *cli,
+						  struct wbint_IdmapDomains *_domains /* [in] [ref] */,
+						  struct wbint_TransIDArray *_ids /* [in,out] [ref] */)
+{
+	struct tevent_req *req;
+	struct rpccli_wbint_Sids2UnixIDs_state *state;
+	struct tevent_req *subreq;
+
+	req = tevent_req_create(mem_ctx, &state,
+				struct rpccli_wbint_Sids2UnixIDs_state);
+	if (req == NULL) {
+		return NULL;
+	}
+	state->out_mem_ctx = NULL;
+	state->dispatch_recv = cli->dispatch_recv;
+
+	/* In parameters */
+	state->orig.in.domains = _domains;
+	state->orig.in.ids = _ids;
+
+	/* Out parameters */
+	state->orig.out.ids = _ids;
+
+	/* Result */
+	ZERO_STRUCT(state->orig.out.result);
+
+	state->out_mem_ctx = talloc_named_const(state, 0,
+			     "rpccli_wbint_Sids2UnixIDs_out_memory");
+	if (tevent_req_nomem(state->out_mem_ctx, req)) {
+		return tevent_req_post(req, ev);
+	}
+
+	/* make a temporary copy, that we pass to the dispatch function */
+	state->tmp = state->orig;
+
+	subreq = cli->dispatch_send(state, ev, cli,
+				    &ndr_table_wbint,
+				    NDR_WBINT_SIDS2UNIXIDS,
+				    &state->tmp);
+	if (tevent_req_nomem(subreq, req)) {
+		return tevent_req_post(req, ev);
+	}
+	tevent_req_set_callback(subreq, rpccli_wbint_Sids2UnixIDs_done, req);
+	return req;
+}
+
+static void rpccli_wbint_Sids2UnixIDs_done(struct tevent_req *subreq)
+{
+	struct tevent_req *req = tevent_req_callback_data(
+		subreq, struct tevent_req);
+	struct rpccli_wbint_Sids2UnixIDs_state *state = tevent_req_data(
+		req, struct rpccli_wbint_Sids2UnixIDs_state);
+	NTSTATUS status;
+	TALLOC_CTX *mem_ctx;
+
+	if (state->out_mem_ctx) {
+		mem_ctx = state->out_mem_ctx;
+	} else {
+		mem_ctx = state;
+	}
+
+	status = state->dispatch_recv(subreq, mem_ctx);
+	TALLOC_FREE(subreq);
+	if (!NT_STATUS_IS_OK(status)) {
+		tevent_req_nterror(req, status);
+		return;
+	}
+
+	/* Copy out parameters */
+	*state->orig.out.ids = *state->tmp.out.ids;
+
+	/* Copy result */
+	state->orig.out.result = state->tmp.out.result;
+
+	/* Reset temporary structure */
+	ZERO_STRUCT(state->tmp);
+
+	tevent_req_done(req);
+}
+
+NTSTATUS rpccli_wbint_Sids2UnixIDs_recv(struct tevent_req *req,
+					TALLOC_CTX *mem_ctx,
+					NTSTATUS *result)
+{
+	struct rpccli_wbint_Sids2UnixIDs_state *state = tevent_req_data(
+		req, struct rpccli_wbint_Sids2UnixIDs_state);
+	NTSTATUS status;
+
+	if (tevent_req_is_nterror(req, &status)) {
+		tevent_req_received(req);
+		return status;
+	}
+
+	/* Steal possbile out parameters to the callers context */
+	talloc_steal(mem_ctx, state->out_mem_ctx);
+
+	/* Return result */
+	*result = state->orig.out.result;
+
+	tevent_req_received(req);
+	return NT_STATUS_OK;
+}
+
+NTSTATUS rpccli_wbint_Sids2UnixIDs(struct rpc_pipe_client *cli,
+				   TALLOC_CTX *mem_ctx,
+				   struct wbint_IdmapDomains *domains /* [in] [ref] */,
+				   struct wbint_TransIDArray *ids /* [in,out] [ref] */)
+{
+	struct wbint_Sids2UnixIDs r;
+	NTSTATUS status;
+
+	/* In parameters */
+	r.in.domains = domains;
+	r.in.ids = ids;
+
+	status = cli->dispatch(cli,
+				mem_ctx,
+				&ndr_table_wbint,
+				NDR_WBINT_SIDS2UNIXIDS,
+				&r);
+
+	if (!NT_STATUS_IS_OK(status)) {
+		return status;
+	}
+
+	if (NT_STATUS_IS_ERR(status)) {
+		return status;
+	}
+
+	/* Return variables */
+	*ids = *r.out.ids;
+
+	/* Return result */
+	return r.out.result;
+}
+
+struct rpccli_wbint_UnixIDs2Sids_state {
+	struct wbint_UnixIDs2Sids orig;
+	struct wbint_UnixIDs2Sids tmp;
+	TALLOC_CTX *out_mem_ctx;
+	NTSTATUS (*dispatch_recv)(struct tevent_req *req, TALLOC_CTX *mem_ctx);
+};
+
+static void rpccli_wbint_UnixIDs2Sids_done(struct tevent_req *subreq);
+
+struct tevent_req *rpccli_wbint_UnixIDs2Sids_send(TALLOC_CTX *mem_ctx,
+						  struct tevent_context *ev,
+						  struct rpc_pipe_client *cli,
+						  struct wbint_IdmapDomains *_domains /* [in] [ref] */,
+						  struct wbint_TransIDArray *_ids /* [in,out] [ref] */)
+{
+	struct tevent_req *req;
+	struct rpccli_wbint_UnixIDs2Sids_state *state;
+	struct tevent_req *subreq;
+
+	req = tevent_req_create(mem_ctx, &state,
+				struct rpccli_wbint_UnixIDs2Sids_state);
+	if (req == NULL) {
+		return NULL;
+	}
+	state->out_mem_ctx = NULL;
+	state->dispatch_recv = cli->dispatch_recv;
+
+	/* In parameters */
+	state->orig.in.domains = _domains;
+	state->orig.in.ids = _ids;
+
+	/* Out parameters */
+	state->orig.out.ids = _ids;
+
+	/* Result */
+	ZERO_STRUCT(state->orig.out.result);
+
+	state->out_mem_ctx = talloc_named_const(state, 0,
+			     "rpccli_wbint_UnixIDs2Sids_out_memory");
+	if (tevent_req_nomem(state->out_mem_ctx, req)) {
+		return tevent_req_post(req, ev);
+	}
+
+	/* make a temporary copy, that we pass to the dispatch function */
+	state->tmp = state->orig;
+
+	subreq = cli->dispatch_send(state, ev, cli,
+				    &ndr_table_wbint,
+				    NDR_WBINT_UNIXIDS2SIDS,
+				    &state->tmp);
+	if (tevent_req_nomem(subreq, req)) {
+		return tevent_req_post(req, ev);
+	}
+	tevent_req_set_callback(subreq, rpccli_wbint_UnixIDs2Sids_done, req);
+	return req;
+}
+
+static void rpccli_wbint_UnixIDs2Sids_done(struct tevent_req *subreq)
+{
+	struct tevent_req *req = tevent_req_callback_data(
+		subreq, struct tevent_req);
+	struct rpccli_wbint_UnixIDs2Sids_state *state = tevent_req_data(
+		req, struct rpccli_wbint_UnixIDs2Sids_state);
+	NTSTATUS status;
+	TALLOC_CTX *mem_ctx;
+
+	if (state->out_mem_ctx) {
+		mem_ctx = state->out_mem_ctx;
+	} else {
+		mem_ctx = state;
+	}
+
+	status = state->dispatch_recv(subreq, mem_ctx);
+	TALLOC_FREE(subreq);
+	if (!NT_STATUS_IS_OK(status)) {
+		tevent_req_nterror(req, status);
+		return;
+	}
+
+	/* Copy out parameters */
+	*state->orig.out.ids = *state->tmp.out.ids;
+
+	/* Copy result */
+	state->orig.out.result = state->tmp.out.result;
+
+	/* Reset temporary structure */
+	ZERO_STRUCT(state->tmp);
+
+	tevent_req_done(req);
+}
+
+NTSTATUS rpccli_wbint_UnixIDs2Sids_recv(struct tevent_req *req,
+					TALLOC_CTX *mem_ctx,
+					NTSTATUS *result)
+{
+	struct rpccli_wbint_UnixIDs2Sids_state *state = tevent_req_data(
+		req, struct rpccli_wbint_UnixIDs2Sids_state);
+	NTSTATUS status;
+
+	if (tevent_req_is_nterror(req, &status)) {
+		tevent_req_received(req);
+		return status;
+	}
+
+	/* Steal possbile out parameters to the callers context */
+	talloc_steal(mem_ctx, state->out_mem_ctx);
+
+	/* Return result */
+	*result = state->orig.out.result;
+
+	tevent_req_received(req);
+	return NT_STATUS_OK;
+}
+
+NTSTATUS rpccli_wbint_UnixIDs2Sids(struct rpc_pipe_client *cli,
+				   TALLOC_CTX *mem_ctx,
+				   struct wbint_IdmapDomains *domains /* [in] [ref] */,
+				   struct wbint_TransIDArray *ids /* [in,out] [ref] */)
+{
+	struct wbint_UnixIDs2Sids r;
+	NTSTATUS status;
+
+	/* In parameters */
+	r.in.domains = domains;
+	r.in.ids = ids;
+
+	status = cli->dispatch(cli,
+				mem_ctx,
+				&ndr_table_wbint,
+				NDR_WBINT_UNIXIDS2SIDS,
+				&r);
+
+	if (!NT_STATUS_IS_OK(status)) {
+		return status;
+	}
+
+	if (NT_STATUS_IS_ERR(status)) {
+		return status;
+	}
+
+	/* Return variables */
+	*ids = *r.out.ids;
+
+	/* Return result */
+	return r.out.result;
+}
+
@@ -296,4 +296,28 @@ NTSTATUS rpccli_wbint_SetHWM(struct rpc_pipe_client *cli,
 			     TALLOC_CTX *mem_ctx,
 			     enum wbint_IdType type /* [in]  */,
 			     uint64_t id /* [in]  */);
+struct tevent_req *rpccli_wbint_Sids2UnixIDs_send(TALLOC_CTX *mem_ctx,
+						  struct tevent_context *ev,
+						  struct rpc_pipe_client *cli,
+						  struct wbint_IdmapDomains *_domains /* [in] [ref] */,
+						  struct wbint_TransIDArray *_ids /* [in,out] [ref] */);
+NTSTATUS rpccli_wbint_Sids2UnixIDs_recv(struct tevent_req *req,
+					TALLOC_CTX *mem_ctx,
+					NTSTATUS *result);
+NTSTATUS rpccli_wbint_Sids2UnixIDs(struct rpc_pipe_client *cli,
+				   TALLOC_CTX *mem_ctx,
+				   struct wbint_IdmapDomains *domains /* [in] [ref] */,
+				   struct wbint_TransIDArray *ids /* [in,out] [ref] */);
+struct tevent_req *rpccli_wbint_UnixIDs2Sids_send(TALLOC_CTX *mem_ctx,
+						  struct tevent_context *ev,
+						  struct rpc_pipe_client *cli,
+						  struct wbint_IdmapDomains *_domains /* [in] [ref] */,
+						  struct wbint_TransIDArray *_ids /* [in,out] [ref] */);
+NTSTATUS rpccli_wbint_UnixIDs2Sids_recv(struct tevent_req *req,
+					TALLOC_CTX *mem_ctx,
+					NTSTATUS *result);
+NTSTATUS rpccli_wbint_UnixIDs2Sids(struct rpc_pipe_client *cli,
+				   TALLOC_CTX *mem_ctx,
+				   struct wbint_IdmapDomains *domains /* [in] [ref] */,
+				   struct wbint_TransIDArray *ids /* [in,out] [ref] */);
 #endif /* __CLI_WBINT__ */
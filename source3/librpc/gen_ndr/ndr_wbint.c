@@ -531,6 +531,240 @@ _PUBLIC_ void ndr_print_wbint_IdType(struct ndr_print *ndr, const char *name, en
 	ndr_print_enum(ndr, name, "ENUM", val, r);
 }
 
+_PUBLIC_ enum ndr_err_code ndr_push_wbint_TransID(struct ndr_push *ndr, int ndr_flags, const struct wbint_TransID *r)
+{
+	if (ndr_flags & NDR_SCALARS) {
+		NDR_CHECK(ndr_push_align(ndr, 8));
+		NDR_CHECK(ndr_push_wbint_IdType(ndr, NDR_SCALARS, r->type));
+		NDR_CHECK(ndr_push_uint32(ndr, NDR_SCALARS, r->domain_index));
+		NDR_CHECK(ndr_push_dom_sid(ndr, NDR_SCALARS, &r->sid));
+		NDR_CHECK(ndr_push_hyper(ndr, NDR_SCALARS, r->xid));
+		NDR_CHECK(ndr_push_trailer_align(ndr, 8));
+	}
+	if (ndr_flags & NDR_BUFFERS) {
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ enum ndr_err_code ndr_pull_wbint_TransID(struct ndr_pull *ndr, int ndr_flags, struct wbint_TransID *r)
+{
+	if (ndr_flags & NDR_SCALARS) {
+		NDR_CHECK(ndr_pull_align(ndr, 8));
+		NDR_CHECK(ndr_pull_wbint_IdType(ndr, NDR_SCALARS, &r->type));
+		NDR_CHECK(ndr_pull_uint32(ndr, NDR_SCALARS, &r->domain_index));
+		NDR_CHECK(ndr_pull_dom_sid(ndr, NDR_SCALARS, &r->sid));
+		NDR_CHECK(ndr_pull_hyper(ndr, NDR_SCALARS, &r->xid));
+		NDR_CHECK(ndr_pull_trailer_align(ndr, 8));
+	}
+	if (ndr_flags & NDR_BUFFERS) {
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ void ndr_print_wbint_TransID(struct ndr_print *ndr, const char *name, const struct wbint_TransID *r)
+{
+	ndr_print_struct(ndr, name, "wbint_TransID");
+	ndr->depth++;
+	ndr_print_wbint_IdType(ndr, "type", r->type);
+	ndr_print_uint32(ndr, "domain_index", r->domain_index);
+	ndr_print_dom_sid(ndr, "sid", &r->sid);
+	ndr_print_hyper(ndr, "xid", r->xid);
+	ndr->depth--;
+}
+
+_PUBLIC_ enum ndr_err_code ndr_push_wbint_TransIDArray(struct ndr_push *ndr, int ndr_flags, const struct wbint_TransIDArray *r)
+{
+	uint32_t cntr_ids_0;
+	if (ndr_flags & NDR_SCALARS) {
+		NDR_CHECK(ndr_push_uint3264(ndr, NDR_SCALARS, r->num_ids));
+		NDR_CHECK(ndr_push_align(ndr, 8));
+		NDR_CHECK(ndr_push_uint32(ndr, NDR_SCALARS, r->num_ids));
+		for (cntr_ids_0 = 0; cntr_ids_0 < r->num_ids; cntr_ids_0++) {
+			NDR_CHECK(ndr_push_wbint_TransID(ndr, NDR_SCALARS, &r->ids[cntr_ids_0]));
+		}
+		NDR_CHECK(ndr_push_trailer_align(ndr, 8));
+	}
+	if (ndr_flags & NDR_BUFFERS) {
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ enum ndr_err_code ndr_pull_wbint_TransIDArray(struct ndr_pull *ndr, int ndr_flags, struct wbint_TransIDArray *r)
+{
+	uint32_t cntr_ids_0;
+	TALLOC_CTX *_mem_save_ids_0;
+	if (ndr_flags & NDR_SCALARS) {
+		NDR_CHECK(ndr_pull_array_size(ndr, &r->ids));
+		NDR_CHECK(ndr_pull_align(ndr, 8));
+		NDR_CHECK(ndr_pull_uint32(ndr, NDR_SCALARS, &r->num_ids));
+		NDR_PULL_ALLOC_N(ndr, r->ids, ndr_get_array_size(ndr, &r->ids));
+		_mem_save_ids_0 = NDR_PULL_GET_MEM_CTX(ndr);
+		NDR_PULL_SET_MEM_CTX(ndr, r->ids, 0);
+		for (cntr_ids_0 = 0; cntr_ids_0 < r->num_ids; cntr_ids_0++) {
+			NDR_CHECK(ndr_pull_wbint_TransID(ndr, NDR_SCALARS, &r->ids[cntr_ids_0]));
+		}
+		NDR_PULL_SET_MEM_CTX(ndr, _mem_save_ids_0, 0);
+		if (r->ids) {
+			NDR_CHECK(ndr_check_array_size(ndr, (void*)&r->ids, r->num_ids));
+		}
+		NDR_CHECK(ndr_pull_trailer_align(ndr, 8));
+	}
+	if (ndr_flags & NDR_BUFFERS) {
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ void ndr_print_wbint_TransIDArray(struct ndr_print *ndr, const char *name, const struct wbint_TransIDArray *r)
+{
+	uint32_t cntr_ids_0;
+	ndr_print_struct(ndr, name, "wbint_TransIDArray");
+	ndr->depth++;
+	ndr_print_uint32(ndr, "num_ids", r->num_ids);
+	ndr->print(ndr, "%s: ARRAY(%d)", "ids", (int)r->num_ids);
+	ndr->depth++;
+	for (cntr_ids_0=0;cntr_ids_0<r->num_ids;cntr_ids_0++) {
+		char *idx_0=NULL;
+		if (asprintf(&idx_0, "[%d]", cntr_ids_0) != -1) {
+			ndr_print_wbint_TransID(ndr, "ids", &r->ids[cntr_ids_0]);
+			free(idx_0);
+		}
+	}
+	ndr->depth--;
+	ndr->depth--;
+}
+
+_PUBLIC_ enum ndr_err_code ndr_push_wbint_IdmapDomain(struct ndr_push *ndr, int ndr_flags, const struct wbint_IdmapDomain *r)
+{
+	if (ndr_flags & NDR_SCALARS) {
+		NDR_CHECK(ndr_push_align(ndr, 5));
+		NDR_CHECK(ndr_push_unique_ptr(ndr, r->name));
+		NDR_CHECK(ndr_push_trailer_align(ndr, 5));
+	}
+	if (ndr_flags & NDR_BUFFERS) {
+		if (r->name) {
+			NDR_CHECK(ndr_push_uint3264(ndr, NDR_SCALARS, ndr_charset_length(r->name, CH_UTF8)));
+			NDR_CHECK(ndr_push_uint3264(ndr, NDR_SCALARS, 0));
+			NDR_CHECK(ndr_push_uint3264(ndr, NDR_SCALARS, ndr_charset_length(r->name, CH_UTF8)));
+			NDR_CHECK(ndr_push_charset(ndr, NDR_SCALARS, r->name, ndr_charset_length(r->name, CH_UTF8), sizeof(uint8_t), CH_UTF8));
+		}
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ enum ndr_err_code ndr_pull_wbint_IdmapDomain(struct ndr_pull *ndr, int ndr_flags, struct wbint_IdmapDomain *r)
+{
+	uint32_t _ptr_name;
+	TALLOC_CTX *_mem_save_name_0;
+	if (ndr_flags & NDR_SCALARS) {
+		NDR_CHECK(ndr_pull_align(ndr, 5));
+		NDR_CHECK(ndr_pull_generic_ptr(ndr, &_ptr_name));
+		if (_ptr_name) {
+			NDR_PULL_ALLOC(ndr, r->name);
+		} else {
+			r->name = NULL;
+		}
+		NDR_CHECK(ndr_pull_trailer_align(ndr, 5));
+	}
+	if (ndr_flags & NDR_BUFFERS) {
+		if (r->name) {
+			_mem_save_name_0 = NDR_PULL_GET_MEM_CTX(ndr);
+			NDR_PULL_SET_MEM_CTX(ndr, r->name, 0);
+			NDR_CHECK(ndr_pull_array_size(ndr, &r->name));
+			NDR_CHECK(ndr_pull_array_length(ndr, &r->name));
+			if (ndr_get_array_length(ndr, &r->name) > ndr_get_array_size(ndr, &r->name)) {
+				return ndr_pull_error(ndr, NDR_ERR_ARRAY_SIZE, "Bad array size %u should exceed array length %u", ndr_get_array_size(ndr, &r->name), ndr_get_array_length(ndr, &r->name));
+			}
+			NDR_CHECK(ndr_check_string_terminator(ndr, ndr_get_array_length(ndr, &r->name), sizeof(uint8_t)));
+			NDR_CHECK(ndr_pull_charset(ndr, NDR_SCALARS, &r->name, ndr_get_array_length(ndr, &r->name), sizeof(uint8_t), CH_UTF8));
+			NDR_PULL_SET_MEM_CTX(ndr, _mem_save_name_0, 0);
+		}
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ void ndr_print_wbint_IdmapDomain(struct ndr_print *ndr, const char *name, const struct wbint_IdmapDomain *r)
+{
+	ndr_print_struct(ndr, name, "wbint_IdmapDomain");
+	ndr->depth++;
+	ndr_print_ptr(ndr, "name", r->name);
+	ndr->depth++;
+	if (r->name) {
+		ndr_print_string(ndr, "name", r->name);
+	}
+	ndr->depth--;
+	ndr->depth--;
+}
+
+_PUBLIC_ enum ndr_err_code ndr_push_wbint_IdmapDomains(struct ndr_push *ndr, int ndr_flags, const struct wbint_IdmapDomains *r)
+{
+	uint32_t cntr_domains_0;
+	if (ndr_flags & NDR_SCALARS) {
+		NDR_CHECK(ndr_push_uint3264(ndr, NDR_SCALARS, r->num_domains));
+		NDR_CHECK(ndr_push_align(ndr, 5));
+		NDR_CHECK(ndr_push_uint32(ndr, NDR_SCALARS, r->num_domains));
+		for (cntr_domains_0 = 0; cntr_domains_0 < r->num_domains; cntr_domains_0++) {
+			NDR_CHECK(ndr_push_wbint_IdmapDomain(ndr, NDR_SCALARS, &r->domains[cntr_domains_0]));
+		}
+		NDR_CHECK(ndr_push_trailer_align(ndr, 5));
+	}
+	if (ndr_flags & NDR_BUFFERS) {
+		for (cntr_domains_0 = 0; cntr_domains_0 < r->num_domains; cntr_domains_0++) {
+			NDR_CHECK(ndr_push_wbint_IdmapDomain(ndr, NDR_BUFFERS, &r->domains[cntr_domains_0]));
+		}
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ enum ndr_err_code ndr_pull_wbint_IdmapDomains(struct ndr_pull *ndr, int ndr_flags, struct wbint_IdmapDomains *r)
+{
+	uint32_t cntr_domains_0;
+	TALLOC_CTX *_mem_save_domains_0;
+	if (ndr_flags & NDR_SCALARS) {
+		NDR_CHECK(ndr_pull_array_size(ndr, &r->domains));
+		NDR_CHECK(ndr_pull_align(ndr, 5));
+		NDR_CHECK(ndr_pull_uint32(ndr, NDR_SCALARS, &r->num_domains));
+		NDR_PULL_ALLOC_N(ndr, r->domains, ndr_get_array_size(ndr, &r->domains));
+		_mem_save_domains_0 = NDR_PULL_GET_MEM_CTX(ndr);
+		NDR_PULL_SET_MEM_CTX(ndr, r->domains, 0);
+		for (cntr_domains_0 = 0; cntr_domains_0 < r->num_domains; cntr_domains_0++) {
+			NDR_CHECK(ndr_pull_wbint_IdmapDomain(ndr, NDR_SCALARS, &r->domains[cntr_domains_0]));
+		}
+		NDR_PULL_SET_MEM_CTX(ndr, _mem_save_domains_0, 0);
+		if (r->domains) {
+			NDR_CHECK(ndr_check_array_size(ndr, (void*)&r->domains, r->num_domains));
+		}
+		NDR_CHECK(ndr_pull_trailer_align(ndr, 5));
+	}
+	if (ndr_flags & NDR_BUFFERS) {
+		_mem_save_domains_0 = NDR_PULL_GET_MEM_CTX(ndr);
+		NDR_PULL_SET_MEM_CTX(ndr, r->domains, 0);
+		for (cntr_domains_0 = 0; cntr_domains_0 < r->num_domains; cntr_domains_0++) {
+			NDR_CHECK(ndr_pull_wbint_IdmapDomain(ndr, NDR_BUFFERS, &r->domains[cntr_domains_0]));
+		}
+		NDR_PULL_SET_MEM_CTX(ndr, _mem_save_domains_0, 0);
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ void ndr_print_wbint_IdmapDomains(struct ndr_print *ndr, const char *name, const struct wbint_IdmapDomains *r)
+{
+	uint32_t cntr_domains_0;
+	ndr_print_struct(ndr, name, "wbint_IdmapDomains");
+	ndr->depth++;
+	ndr_print_uint32(ndr, "num_domains", r->num_domains);
+	ndr->print(ndr, "%s: ARRAY(%d)", "domains", (int)r->num_domains);
+	ndr->depth++;
+	for (cntr_domains_0=0;cntr_domains_0<r->num_domains;cntr_domains_0++) {
+		char *idx_0=NULL;
+		if (asprintf(&idx_0, "[%d]", cntr_domains_0) != -1) {
+			ndr_print_wbint_IdmapDomain(ndr, "domains", &r->domains[cntr_domains_0]);
+			free(idx_0);
+		}
+	}
+	ndr->depth--;
+	ndr->depth--;
+}
+
 static enum ndr_err_code ndr_push_wbint_Ping(struct ndr_push *ndr, int flags, const struct wbint_Ping *r)
 {
 	if (flags & NDR_IN) {
@@ -2446,6 +2680,190 @@ _PUBLIC_ void ndr_print_wbint_SetHWM(struct ndr_print *ndr, const char *name, in
 	ndr->depth--;
 }
 
+static enum ndr_err_code ndr_push_wbint_Sids2UnixIDs(struct ndr_push *ndr, int flags, const struct wbint_Sids2UnixIDs *r)
+{
+	if (flags & NDR_IN) {
+		if (r->in.domains == NULL) {
+			return ndr_push_error(ndr, NDR_ERR_INVALID_POINTER, "NULL [ref] pointer");
+		}
+		NDR_CHECK(ndr_push_wbint_IdmapDomains(ndr, NDR_SCALARS|NDR_BUFFERS, r->in.domains));
+		if (r->in.ids == NULL) {
+			return ndr_push_error(ndr, NDR_ERR_INVALID_POINTER, "NULL [ref] pointer");
+		}
+		NDR_CHECK(ndr_push_wbint_TransIDArray(ndr, NDR_SCALARS, r->in.ids));
+	}
+	if (flags & NDR_OUT) {
+		if (r->out.ids == NULL) {
+			return ndr_push_error(ndr, NDR_ERR_INVALID_POINTER, "NULL [ref] pointer");
+		}
+		NDR_CHECK(ndr_push_wbint_TransIDArray(ndr, NDR_SCALARS, r->out.ids));
+		NDR_CHECK(ndr_push_NTSTATUS(ndr, NDR_SCALARS, r->out.result));
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+static enum ndr_err_code ndr_pull_wbint_Sids2UnixIDs(struct ndr_pull *ndr, int flags, struct wbint_Sids2UnixIDs *r)
+{
+	TALLOC_CTX *_mem_save_domains_0;
+	TALLOC_CTX *_mem_save_ids_0;
+	if (flags & NDR_IN) {
+		ZERO_STRUCT(r->out);
+
+		if (ndr->flags & LIBNDR_FLAG_REF_ALLOC) {
+			NDR_PULL_ALLOC(ndr, r->in.domains);
+		}
+		_mem_save_domains_0 = NDR_PULL_GET_MEM_CTX(ndr);
+		NDR_PULL_SET_MEM_CTX(ndr, r->in.domains, LIBNDR_FLAG_REF_ALLOC);
+		NDR_CHECK(ndr_pull_wbint_IdmapDomains(ndr, NDR_SCALARS|NDR_BUFFERS, r->in.domains));
+		NDR_PULL_SET_MEM_CTX(ndr, _mem_save_domains_0, LIBNDR_FLAG_REF_ALLOC);
+		if (ndr->flags & LIBNDR_FLAG_REF_ALLOC) {
+			NDR_PULL_ALLOC(ndr, r->in.ids);
+		}
+		_mem_save_ids_0 = NDR_PULL_GET_MEM_CTX(ndr);
+		NDR_PULL_SET_MEM_CTX(ndr, r->in.ids, LIBNDR_FLAG_REF_ALLOC);
+		NDR_CHECK(ndr_pull_wbint_TransIDArray(ndr, NDR_SCALARS, r->in.ids));
+		NDR_PULL_SET_MEM_CTX(ndr, _mem_save_ids_0, LIBNDR_FLAG_REF_ALLOC);
+		NDR_PULL_ALLOC(ndr, r->out.ids);
+		*r->out.ids = *r->in.ids;
+	}
+	if (flags & NDR_OUT) {
+		if (ndr->flags & LIBNDR_FLAG_REF_ALLOC) {
+			NDR_PULL_ALLOC(ndr, r->out.ids);
+		}
+		_mem_save_ids_0 = NDR_PULL_GET_MEM_CTX(ndr);
+		NDR_PULL_SET_MEM_CTX(ndr, r->out.ids, LIBNDR_FLAG_REF_ALLOC);
+		NDR_CHECK(ndr_pull_wbint_TransIDArray(ndr, NDR_SCALARS, r->out.ids));
+		NDR_PULL_SET_MEM_CTX(ndr, _mem_save_ids_0, LIBNDR_FLAG_REF_ALLOC);
+		NDR_CHECK(ndr_pull_NTSTATUS(ndr, NDR_SCALARS, &r->out.result));
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ void ndr_print_wbint_Sids2UnixIDs(struct ndr_print *ndr, const char *name, int flags, const struct wbint_Sids2UnixIDs *r)
+{
+	ndr_print_struct(ndr, name, "wbint_Sids2UnixIDs");
+	ndr->depth++;
+	if (flags & NDR_SET_VALUES) {
+		ndr->flags |= LIBNDR_PRINT_SET_VALUES;
+	}
+	if (flags & NDR_IN) {
+		ndr_print_struct(ndr, "in", "wbint_Sids2UnixIDs");
+		ndr->depth++;
+		ndr_print_ptr(ndr, "domains", r->in.domains);
+		ndr->depth++;
+		ndr_print_wbint_IdmapDomains(ndr, "domains", r->in.domains);
+		ndr->depth--;
+		ndr_print_ptr(ndr, "ids", r->in.ids);
+		ndr->depth++;
+		ndr_print_wbint_TransIDArray(ndr, "ids", r->in.ids);
+		ndr->depth--;
+		ndr->depth--;
+	}
+	if (flags & NDR_OUT) {
+		ndr_print_struct(ndr, "out", "wbint_Sids2UnixIDs");
+		ndr->depth++;
+		ndr_print_ptr(ndr, "ids", r->out.ids);
+		ndr->depth++;
+		ndr_print_wbint_TransIDArray(ndr, "ids", r->out.ids);
+		ndr->depth--;
+		ndr_print_NTSTATUS(ndr, "result", r->out.result);
+		ndr->depth--;
+	}
+	ndr->depth--;
+}
+
+static enum ndr_err_code ndr_push_wbint_UnixIDs2Sids(struct ndr_push *ndr, int flags, const struct wbint_UnixIDs2Sids *r)
+{
+	if (flags & NDR_IN) {
+		if (r->in.domains == NULL) {
+			return ndr_push_error(ndr, NDR_ERR_INVALID_POINTER, "NULL [ref] pointer");
+		}
+		NDR_CHECK(ndr_push_wbint_IdmapDomains(ndr, NDR_SCALARS|NDR_BUFFERS, r->in.domains));
+		if (r->in.ids == NULL) {
+			return ndr_push_error(ndr, NDR_ERR_INVALID_POINTER, "NULL [ref] pointer");
+		}
+		NDR_CHECK(ndr_push_wbint_TransIDArray(ndr, NDR_SCALARS, r->in.ids));
+	}
+	if (flags & NDR_OUT) {
+		if (r->out.ids == NULL) {
+			return ndr_push_error(ndr, NDR_ERR_INVALID_POINTER, "NULL [ref] pointer");
+		}
+		NDR_CHECK(ndr_push_wbint_TransIDArray(ndr, NDR_SCALARS, r->out.ids));
+		NDR_CHECK(ndr_push_NTSTATUS(ndr, NDR_SCALARS, r->out.result));
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+static enum ndr_err_code ndr_pull_wbint_UnixIDs2Sids(struct ndr_pull *ndr, int flags, struct wbint_UnixIDs2Sids *r)
+{
+	TALLOC_CTX *_mem_save_domains_0;
+	TALLOC_CTX *_mem_save_ids_0;
+	if (flags & NDR_IN) {
+		ZERO_STRUCT(r->out);
+
+		if (ndr->flags & LIBNDR_FLAG_REF_ALLOC) {
+			NDR_PULL_ALLOC(ndr, r->in.domains);
+		}
+		_mem_save_domains_0 = NDR_PULL_GET_MEM_CTX(ndr);
+		NDR_PULL_SET_MEM_CTX(ndr, r->in.domains, LIBNDR_FLAG_REF_ALLOC);
+		NDR_CHECK(ndr_pull_wbint_IdmapDomains(ndr, NDR_SCALARS|NDR_BUFFERS, r->in.domains));
+		NDR_PULL_SET_MEM_CTX(ndr, _mem_save_domains_0, LIBNDR_FLAG_REF_ALLOC);
+		if (ndr->flags & LIBNDR_FLAG_REF_ALLOC) {
+			NDR_PULL_ALLOC(ndr, r->in.ids);
+		}
+		_mem_save_ids_0 = NDR_PULL_GET_MEM_CTX(ndr);
+		NDR_PULL_SET_MEM_CTX(ndr, r->in.ids, LIBNDR_FLAG_REF_ALLOC);
+		NDR_CHECK(ndr_pull_wbint_TransIDArray(ndr, NDR_SCALARS, r->in.ids));
+		NDR_PULL_SET_MEM_CTX(ndr, _mem_save_ids_0, LIBNDR_FLAG_REF_ALLOC);
+		NDR_PULL_ALLOC(ndr, r->out.ids);
+		*r->out.ids = *r->in.ids;
+	}
+	if (flags & NDR_OUT) {
+		if (ndr->flags & LIBNDR_FLAG_REF_ALLOC) {
+			NDR_PULL_ALLOC(ndr, r->out.ids);
+		}
+		_mem_save_ids_0 = NDR_PULL_GET_MEM_CTX(ndr);
+		NDR_PULL_SET_MEM_CTX(ndr, r->out.ids, LIBNDR_FLAG_REF_ALLOC);
+		NDR_CHECK(ndr_pull_wbint_TransIDArray(ndr, NDR_SCALARS, r->out.ids));
+		NDR_PULL_SET_MEM_CTX(ndr, _mem_save_ids_0, LIBNDR_FLAG_REF_ALLOC);
+		NDR_CHECK(ndr_pull_NTSTATUS(ndr, NDR_SCALARS, &r->out.result));
+	}
+	return NDR_ERR_SUCCESS;
+}
+
+_PUBLIC_ void ndr_print_wbint_UnixIDs2Sids(struct ndr_print *ndr, const char *name, int flags, const struct wbint_UnixIDs2Sids *r)
+{
+	ndr_print_struct(ndr, name, "wbint_UnixIDs2Sids");
+	ndr->depth++;
+	if (flags & NDR_SET_VALUES) {
+		ndr->flags |= LIBNDR_PRINT_SET_VALUES;
+	}
+	if (flags & NDR_IN) {
+		ndr_print_struct(ndr, "in", "wbint_UnixIDs2Sids");
+		ndr->depth++;
+		ndr_print_ptr(ndr, "domains", r->in.domains);
+		ndr->depth++;
+		ndr_print_wbint_IdmapDomains(ndr, "domains", r->in.domains);
+		ndr->depth--;
+		ndr_print_ptr(ndr, "ids", r->in.ids);
+		ndr->depth++;
+		ndr_print_wbint_TransIDArray(ndr, "ids", r->in.ids);
+		ndr->depth--;
+		ndr->depth--;
+	}
+	if (flags & NDR_OUT) {
+		ndr_print_struct(ndr, "out", "wbint_UnixIDs2Sids");
+		ndr->depth++;
+		ndr_print_ptr(ndr, "ids", r->out.ids);
+		ndr->depth++;
+		ndr_print_wbint_TransIDArray(ndr, "ids", r->out.ids);
+		ndr->depth--;
+		ndr_print_NTSTATUS(ndr, "result", r->out.result);
+		ndr->depth--;
+	}
+	ndr->depth--;
+}
+
 static const struct ndr_interface_call wbint_calls[] = {
 	{
 		"wbint_Ping",
@@ -2639,6 +3057,22 @@ static const struct ndr_interface_call wbint_calls[] = {
 		(ndr_print_function_t) ndr_print_wbint_SetHWM,
 		false,
 	},
+	{
+		"wbint_Sids2UnixIDs",
+		sizeof(struct wbint_Sids2UnixIDs),
+		(ndr_push_flags_fn_t) ndr_push_wbint_Sids2UnixIDs,
+		(ndr_pull_flags_fn_t) ndr_pull_wbint_Sids2UnixIDs,
+		(ndr_print_function_t) ndr_print_wbint_Sids2UnixIDs,
+		false,
+	},
+	{
+		"wbint_UnixIDs2Sids",
+		sizeof(struct wbint_UnixIDs2Sids),
+		(ndr_push_flags_fn_t) ndr_push_wbint_UnixIDs2Sids,
+		(ndr_pull_flags_fn_t) ndr_pull_wbint_UnixIDs2Sids,
+		(ndr_print_function_t) ndr_print_wbint_UnixIDs2Sids,
+		false,
+	},
 	{ NULL, 0, NULL, NULL, NULL, false }
 };
 
@@ -2668,7 +3102,7 @@ const struct ndr_interface_table ndr_table_wbint = {
 		NDR_WBINT_VERSION
 	},
 	.helpstring	= NDR_WBINT_HELPSTRING,
-	.num_calls	= 24,
+	.num_calls	= 26,
 	.calls		= wbint_calls,
 	.endpoints	= &wbint_endpoints,
 	.authservices	= &wbint_authservices
@@ -59,7 +59,11 @@ extern const struct ndr_interface_table ndr_table_wbint;
 
 #define NDR_WBINT_SETHWM (0x17)
 
-#define NDR_WBINT_CALL_COUNT (24)
+#define NDR_WBINT_SIDS2UNIXIDS (0x18)
+
+#define NDR_WBINT_UNIXIDS2SIDS (0x19)
+
+#define NDR_WBINT_CALL_COUNT (26)
 enum ndr_err_code ndr_push_wbint_userinfo(struct ndr_push *ndr, int ndr_flags, const struct wbint_userinfo *r);
 enum ndr_err_code ndr_pull_wbint_userinfo(struct ndr_pull *ndr, int ndr_flags, struct wbint_userinfo *r);
 void ndr_print_wbint_userinfo(struct ndr_print *ndr, const char *name, const struct wbint_userinfo *r);
@@ -81,6 +85,18 @@ void ndr_print_wbint_userinfos(struct ndr_print *ndr, const char *name, const st
 enum ndr_err_code ndr_push_wbint_IdType(struct ndr_push *ndr, int ndr_flags, enum wbint_IdType r);
 enum ndr_err_code ndr_pull_wbint_IdType(struct ndr_pull *ndr, int ndr_flags, enum wbint_IdType *r);
 void ndr_print_wbint_IdType(struct ndr_print *ndr, const char *name, enum wbint_IdType r);
+enum ndr_err_code ndr_push_wbint_TransID(struct ndr_push *ndr, int ndr_flags, const struct wbint_TransID *r);
+enum ndr_err_code ndr_pull_wbint_TransID(struct ndr_pull *ndr, int ndr_flags, struct wbint_TransID *r);
+void ndr_print_wbint_TransID(struct ndr_print *ndr, const char *name, const struct wbint_TransID *r);
+enum ndr_err_code ndr_push_wbint_TransIDArray(struct ndr_push *ndr, int ndr_flags, const struct wbint_TransIDArray *r);
+enum ndr_err_code ndr_pull_wbint_TransIDArray(struct ndr_pull *ndr, int ndr_flags, struct wbint_TransIDArray *r);
+void ndr_print_wbint_TransIDArray(struct ndr_print *ndr, const char *name, const struct wbint_TransIDArray *r);
+enum ndr_err_code ndr_push_wbint_IdmapDomain(struct ndr_push *ndr, int ndr_flags, const struct wbint_IdmapDomain *r);
+enum ndr_err_code ndr_pull_wbint_IdmapDomain(struct ndr_pull *ndr, int ndr_flags, struct wbint_IdmapDomain *r);
+void ndr_print_wbint_IdmapDomain(struct ndr_print *ndr, const char *name, const struct wbint_IdmapDomain *r);
+enum ndr_err_code ndr_push_wbint_IdmapDomains(struct ndr_push *ndr, int ndr_flags, const struct wbint_IdmapDomains *r);
+enum ndr_err_code ndr_pull_wbint_IdmapDomains(struct ndr_pull *ndr, int ndr_flags, struct wbint_IdmapDomains *r);
+void ndr_print_wbint_IdmapDomains(struct ndr_print *ndr, const char *name, const struct wbint_IdmapDomains *r);
 void ndr_print_wbint_Ping(struct ndr_print *ndr, const char *name, int flags, const struct wbint_Ping *r);
 void ndr_print_wbint_LookupSid(struct ndr_print *ndr, const char *name, int flags, const struct wbint_LookupSid *r);
 void ndr_print_wbint_LookupName(struct ndr_print *ndr, const char *name, int flags, const struct wbint_LookupName *r);
@@ -105,4 +121,6 @@ void ndr_print_wbint_PingDc(struct ndr_print *ndr, const char *name, int flags,
 void ndr_print_wbint_SetMapping(struct ndr_print *ndr, const char *name, int flags, const struct wbint_SetMapping *r);
 void ndr_print_wbint_RemoveMapping(struct ndr_print *ndr, const char *name, int flags, const struct wbint_RemoveMapping *r);
 void ndr_print_wbint_SetHWM(struct ndr_print *ndr, const char *name, int flags, const struct wbint_SetHWM *r);
+void ndr_print_wbint_Sids2UnixIDs(struct ndr_print *ndr, const char *name, int flags, const struct wbint_Sids2UnixIDs *r);
+void ndr_print_wbint_UnixIDs2Sids(struct ndr_print *ndr, const char *name, int flags, const struct wbint_UnixIDs2Sids *r);
 #endif /* _HEADER_NDR_wbint */
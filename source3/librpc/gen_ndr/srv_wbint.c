@@ -1902,6 +1902,156 @@ static bool api_wbint_SetHWM(pipes_struct *p)
 	return true;
 }
 
+static bool api_wbint_Sids2UnixIDs(pipes_struct *p)
+{
+	const struct ndr_interface_call *call;
+	struct ndr_pull *pull;
+	struct ndr_push *push;
+	enum ndr_err_code ndr_err;
+	DATA_BLOB blob;
+	struct wbint_Sids2UnixIDs *r;
+
+	call = &ndr_table_wbint.calls[NDR_WBINT_SIDS2UNIXIDS];
+
+	r = talloc(talloc_tos(), struct wbint_Sids2UnixIDs);
+	if (r == NULL) {
+		return false;
+	}
+
+	if (!prs_data_blob(&p->in_data.data, &blob, r)) {
+		talloc_free(r);
+		return false;
+	}
+
+	pull = ndr_pull_init_blob(&blob, r, NULL);
+	if (pull == NULL) {
+		talloc_free(r);
+		return false;
+	}
+
+	pull->flags |= LIBNDR_FLAG_REF_ALLOC;
+	ndr_err = call->ndr_pull(pull, NDR_IN, r);
+	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
+		talloc_free(r);
+		return false;
+	}
+
+	if (DEBUGLEVEL >= 10) {
+		NDR_PRINT_IN_DEBUG(wbint_Sids2UnixIDs, r);
+	}
+
+	ZERO_STRUCT(r->out);
+	r->out.ids = r->in.ids;
+	r->out.result = _wbint_Sids2UnixIDs(p, r);
+
+	if (p->rng_fault_state) {
+		talloc_free(r);
+		/* Return true here, srv_pipe_hnd.c will take care */
+		return true;
+	}
+
+	if (DEBUGLEVEL >= 10) {
+		NDR_PRINT_OUT_DEBUG(wbint_Sids2UnixIDs, r);
+	}
+
+	push = ndr_push_init_ctx(r, NULL);
+	if (push == NULL) {
+		talloc_free(r);
+		return false;
+	}
+
+	ndr_err = call->ndr_push(push, NDR_OUT, r);
+	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
+		talloc_free(r);
+		return false;
+	}
+
+	blob = ndr_push_blob(push);
+	if (!prs_copy_data_in(&p->out_data.rdata, (const char *)blob.data, (uint32_t)blob.length)) {
+		talloc_free(r);
+		return false;
+	}
+
+	talloc_free(r);
+
+	return true;
+}
+
+static bool api_wbint_UnixIDs2Sids(pipes_struct *p)
+{
+	const struct ndr_interface_call *call;
+	struct ndr_pull *pull;
+	struct ndr_push *push;
+	enum ndr_err_code ndr_err;
+	DATA_BLOB blob;
+	struct wbint_UnixIDs2Sids *r;
+
+	call = &ndr_table_wbint.calls[NDR_WBINT_UNIXIDS2SIDS];
+
+	r = talloc(talloc_tos(), struct wbint_UnixIDs2Sids);
+	if (r == NULL) {
+		return false;
+	}
+
+	if (!prs_data_blob(&p->in_data.data, &blob, r)) {
+		talloc_free(r);
+		return false;
+	}
+
+	pull = ndr_pull_init_blob(&blob, r, NULL);
+	if (pull == NULL) {
+		talloc_free(r);
+		return false;
+	}
+
+	pull->flags |= LIBNDR_FLAG_REF_ALLOC;
+	ndr_err = call->ndr_pull(pull, NDR_IN, r);
+	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
+		talloc_free(r);
+		return false;
+	}
+
+	if (DEBUGLEVEL >= 10) {
+		NDR_PRINT_IN_DEBUG(wbint_UnixIDs2Sids, r);
+	}
+
+	ZERO_STRUCT(r->out);
+	r->out.ids = r->in.ids;
+	r->out.result = _wbint_UnixIDs2Sids(p, r);
+
+	if (p->rng_fault_state) {
+		talloc_free(r);
+		/* Return true here, srv_pipe_hnd.c will take care */
+		return true;
+	}
+
+	if (DEBUGLEVEL >= 10) {
+		NDR_PRINT_OUT_DEBUG(wbint_UnixIDs2Sids, r);
+	}
+
+	push = ndr_push_init_ctx(r, NULL);
+	if (push == NULL) {
+		talloc_free(r);
+		return false;
+	}
+
+	ndr_err = call->ndr_push(push, NDR_OUT, r);
+	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
+		talloc_free(r);
+		return false;
+	}
+
+	blob = ndr_push_blob(push);
+	if (!prs_copy_data_in(&p->out_data.rdata, (const char *)blob.data, (uint32_t)blob.length)) {
+		talloc_free(r);
+		return false;
+	}
+
+	talloc_free(r);
+
+	return true;
+}
+
 
 /* Tables */
 static struct api_struct api_wbint_cmds[] = 
@@ -1930,6 +2080,8 @@ static struct api_struct api_wbint_cmds[] =
 	{"WBINT_SETMAPPING", NDR_WBINT_SETMAPPING, api_wbint_SetMapping},
 	{"WBINT_REMOVEMAPPING", NDR_WBINT_REMOVEMAPPING, api_wbint_RemoveMapping},
 	{"WBINT_SETHWM", NDR_WBINT_SETHWM, api_wbint_SetHWM},
+	{"WBINT_SIDS2UNIXIDS", NDR_WBINT_SIDS2UNIXIDS, api_wbint_Sids2UnixIDs},
+	{"WBINT_UNIXIDS2SIDS", NDR_WBINT_UNIXIDS2SIDS, api_wbint_UnixIDs2Sids},
 };
 
 void wbint_get_pipe_fns(struct api_struct **fns, int *n_fns)
@@ -2213,6 +2365,22 @@ NTSTATUS rpc_wbint_dispatch(struct rpc_pipe_client *cli, TALLOC_CTX *mem_ctx, co
 			return NT_STATUS_OK;
 		}
 
+		case NDR_WBINT_SIDS2UNIXIDS: {
+			struct wbint_Sids2UnixIDs *r = (struct wbint_Sids2UnixIDs *)_r;
+			ZERO_STRUCT(r->out);
+			r->out.ids = r->in.ids;
+			r->out.result = _wbint_Sids2UnixIDs(cli->pipes_struct, r);
+			return NT_STATUS_OK;
+		}
+
+		case NDR_WBINT_UNIXIDS2SIDS: {
+			struct wbint_UnixIDs2Sids *r = (struct wbint_UnixIDs2Sids *)_r;
+			ZERO_STRUCT(r->out);
+			r->out.ids = r->in.ids;
+			r->out.result = _wbint_UnixIDs2Sids(cli->pipes_struct, r);
+			return NT_STATUS_OK;
+		}
+
 		default:
 			return NT_STATUS_NOT_IMPLEMENTED;
 	}
@@ -25,6 +25,8 @@ NTSTATUS _wbint_PingDc(pipes_struct *p, struct wbint_PingDc *r);
 NTSTATUS _wbint_SetMapping(pipes_struct *p, struct wbint_SetMapping *r);
 NTSTATUS _wbint_RemoveMapping(pipes_struct *p, struct wbint_RemoveMapping *r);
 NTSTATUS _wbint_SetHWM(pipes_struct *p, struct wbint_SetHWM *r);
+NTSTATUS _wbint_Sids2UnixIDs(pipes_struct *p, struct wbint_Sids2UnixIDs *r);
+NTSTATUS _wbint_UnixIDs2Sids(pipes_struct *p, struct wbint_UnixIDs2Sids *r);
 void wbint_get_pipe_fns(struct api_struct **fns, int *n_fns);
 NTSTATUS rpc_wbint_dispatch(struct rpc_pipe_client *cli, TALLOC_CTX *mem_ctx, const struct ndr_interface_table *table, uint32_t opnum, void *r);
 void _wbint_Ping(pipes_struct *p, struct wbint_Ping *r);
@@ -51,5 +53,7 @@ NTSTATUS _wbint_PingDc(pipes_struct *p, struct wbint_PingDc *r);
 NTSTATUS _wbint_SetMapping(pipes_struct *p, struct wbint_SetMapping *r);
 NTSTATUS _wbint_RemoveMapping(pipes_struct *p, struct wbint_RemoveMapping *r);
 NTSTATUS _wbint_SetHWM(pipes_struct *p, struct wbint_SetHWM *r);
+NTSTATUS _wbint_Sids2UnixIDs(pipes_struct *p, struct wbint_Sids2UnixIDs *r);
+NTSTATUS _wbint_UnixIDs2Sids(pipes_struct *p, struct wbint_UnixIDs2Sids *r);
 NTSTATUS rpc_wbint_init(void);
 #endif /* __SRV_WBINT__ */
@@ -60,6 +60,27 @@ enum wbint_IdType
 #endif
 ;
 
+struct wbint_TransID {
+	enum wbint_IdType type;
+	uint32_t domain_index;
+	struct dom_sid sid;
+	uint64_t xid;
+}/* [public] */;
+
+struct wbint_TransIDArray {
+	uint32_t num_ids;
+	struct wbint_TransID *ids;/* [size_is(num_ids)] */
+}/* [public] */;
+
+struct wbint_IdmapDomain {
+	const char *name;/* [unique,charset(UTF8)] */
+}/* [public] */;
+
+struct wbint_IdmapDomains {
+	uint32_t num_domains;
+	struct wbint_IdmapDomain *domains;/* [size_is(num_domains)] */
+}/* [public] */;
+
 
 struct wbint_Ping {
 	struct {
@@ -351,4 +372,32 @@ struct wbint_SetHWM {
 
 };
 
+
+struct wbint_Sids2UnixIDs {
+	struct {
+		struct wbint_IdmapDomains *domains;/* [ref] */
+		struct wbint_TransIDArray *ids;/* [ref] */
+	} in;
+
+	struct {
+		struct wbint_TransIDArray *ids;/* [ref] */
+		NTSTATUS result;
+	} out;
+
+};
+
+
+struct wbint_UnixIDs2Sids {
+	struct {
+		struct wbint_IdmapDomains *domains;/* [ref] */
+		struct wbint_TransIDArray *ids;/* [ref] */
+	} in;
+
+	struct {
+		struct wbint_TransIDArray *ids;/* [ref] */
+		NTSTATUS result;
+	} out;
+
+};
+
 #endif /* _HEADER_wbint */
@@ -172,6 +172,26 @@ static void create_share_mode_entry(struct share_mode_entry *out,
 	out->flags = 0;
 }
 
+/*
+ * Find the share mode entries in a record, NULL if we don't understand
+ * the record.
+ */
+
+static struct share_mode_entry *get_share_mode_entries(TDB_DATA db_data)
+{
+	struct locking_data *ld = (struct locking_data *)db_data.dptr;
+
+	if ((db_data.dsize < sizeof(struct locking_data)) ||
+	    (ld->u.s.version != LOCKING_DATA_VERSION) ||
+	    (ld->u.s.num_share_mode_entries < 0) ||
+	    (db_data.dsize < ld->u.s.entries_offset +
+	     ld->u.s.num_share_mode_entries * sizeof(struct share_mode_entry))) {
+		return NULL;
+	}
+	return (struct share_mode_entry *)(db_data.dptr +
+					   ld->u.s.entries_offset);
+}
+
 /*
  * Return the current share mode list for an open file.
  * This uses similar (but simplified) logic to locking/locking.c
@@ -202,6 +222,12 @@ int smb_get_share_mode_entries(struct smbdb_ctx *db_ctx,
 		return 0;
 	}
 
+	shares = get_share_mode_entries(db_data);
+	if (shares == NULL) {
+		free(db_data.dptr);
+		return -1;
+	}
+
 	ld = (struct locking_data *)db_data.dptr;
 	num_share_modes = ld->u.s.num_share_mode_entries;
 
@@ -218,8 +244,6 @@ int smb_get_share_mode_entries(struct smbdb_ctx *db_ctx,
 
 	memset(list, '\0', num_share_modes * sizeof(struct smb_share_mode_entry));
 
-	shares = (struct share_mode_entry *)(db_data.dptr + sizeof(struct locking_data));
-
 	list_num = 0;
 	for (i = 0; i < num_share_modes; i++) {
 		struct share_mode_entry *share = &shares[i];
@@ -285,33 +309,36 @@ int smb_create_share_mode_entry_ex(struct smbdb_ctx *db_ctx,
 	db_data = tdb_fetch(db_ctx->smb_tdb, locking_key);
 	if (!db_data.dptr) {
 		/* We must create the entry. */
-		db_data.dptr = (uint8 *)malloc(
-			sizeof(struct locking_data) +
-			sizeof(struct share_mode_entry) +
-			strlen(sharepath) + 1 +
-			strlen(filename) + 1);
+		size_t sp_len = strlen(sharepath);
+		size_t fn_len = strlen(filename);
+		size_t entries_offset = LOCKING_DATA_ENTRIES_OFFSET(
+			0, sp_len + 1 + fn_len + 1 + 1);
+
+		db_data.dsize = entries_offset + sizeof(struct share_mode_entry);
+		db_data.dptr = (uint8 *)malloc(db_data.dsize);
 		if (!db_data.dptr) {
 			return -1;
 		}
+		memset(db_data.dptr, '\0', db_data.dsize);
+
 		ld = (struct locking_data *)db_data.dptr;
-		memset(ld, '\0', sizeof(struct locking_data));
 		ld->u.s.num_share_mode_entries = 1;
 		ld->u.s.delete_on_close = 0;
 		ld->u.s.delete_token_size = 0;
-		shares = (struct share_mode_entry *)(db_data.dptr + sizeof(struct locking_data));
-		create_share_mode_entry(shares, new_entry);
+		ld->u.s.version = LOCKING_DATA_VERSION;
+		ld->u.s.entries_offset = entries_offset;
 
-		memcpy(db_data.dptr + sizeof(struct locking_data) + sizeof(struct share_mode_entry),
+		/* Share path, file name and an empty stream name. */
+		memcpy(db_data.dptr + sizeof(struct locking_data),
 			sharepath,
-			strlen(sharepath) + 1);
-		memcpy(db_data.dptr + sizeof(struct locking_data) + sizeof(struct share_mode_entry) +
-			strlen(sharepath) + 1,
+			sp_len + 1);
+		memcpy(db_data.dptr + sizeof(struct locking_data) + sp_len + 1,
 			filename,
-			strlen(filename) + 1);
+			fn_len + 1);
+
+		shares = (struct share_mode_entry *)(db_data.dptr + entries_offset);
+		create_share_mode_entry(shares, new_entry);
 
-		db_data.dsize = sizeof(struct locking_data) + sizeof(struct share_mode_entry) +
-					strlen(sharepath) + 1 +
-					strlen(filename) + 1;
 		if (tdb_store(db_ctx->smb_tdb, locking_key, db_data, TDB_INSERT) == -1) {
 			free(db_data.dptr);
 			return -1;
@@ -320,38 +347,28 @@ int smb_create_share_mode_entry_ex(struct smbdb_ctx *db_ctx,
 		return 0;
 	}
 
-	/* Entry exists, we must add a new entry. */
-	new_data_p = (uint8 *)malloc(
-		db_data.dsize + sizeof(struct share_mode_entry));
-	if (!new_data_p) {
+	if (get_share_mode_entries(db_data) == NULL) {
 		free(db_data.dptr);
 		return -1;
 	}
 
+	/* Entry exists, the new share mode goes at the end. */
 	ld = (struct locking_data *)db_data.dptr;
 	orig_num_share_modes = ld->u.s.num_share_mode_entries;
+	new_data_size = ld->u.s.entries_offset +
+		(orig_num_share_modes + 1) * sizeof(struct share_mode_entry);
 
-	/* Copy the original data. */
-	memcpy(new_data_p, db_data.dptr, sizeof(struct locking_data) + (orig_num_share_modes * sizeof(struct share_mode_entry)));
-
-	/* Add in the new share mode */
-	shares = (struct share_mode_entry *)(new_data_p + sizeof(struct locking_data) +
-			(orig_num_share_modes * sizeof(struct share_mode_entry)));
-
-	create_share_mode_entry(shares, new_entry);
+	new_data_p = (uint8 *)realloc(db_data.dptr, new_data_size);
+	if (!new_data_p) {
+		free(db_data.dptr);
+		return -1;
+	}
 
 	ld = (struct locking_data *)new_data_p;
+	shares = (struct share_mode_entry *)(new_data_p + ld->u.s.entries_offset);
+	create_share_mode_entry(&shares[orig_num_share_modes], new_entry);
 	ld->u.s.num_share_mode_entries++;
 
-	/* Append the original delete_token and filenames. */
-	memcpy(new_data_p + sizeof(struct locking_data) + (ld->u.s.num_share_mode_entries * sizeof(struct share_mode_entry)),
-		db_data.dptr + sizeof(struct locking_data) + (orig_num_share_modes * sizeof(struct share_mode_entry)),
-		db_data.dsize - sizeof(struct locking_data) - (orig_num_share_modes * sizeof(struct share_mode_entry)));
-
-	new_data_size = db_data.dsize + sizeof(struct share_mode_entry);
-
-	free(db_data.dptr);
-
 	db_data.dptr = new_data_p;
 	db_data.dsize = new_data_size;
 
@@ -395,19 +412,21 @@ int smb_delete_share_mode_entry(struct smbdb_ctx *db_ctx,
 	int orig_num_share_modes = 0;
 	struct locking_data *ld = NULL; /* internal samba db state. */
 	struct share_mode_entry *shares = NULL;
-	uint8 *new_data_p = NULL;
-	size_t remaining_size = 0;
 	size_t i, num_share_modes;
-	const uint8 *remaining_ptr = NULL;
 
 	db_data = tdb_fetch(db_ctx->smb_tdb, locking_key);
 	if (!db_data.dptr) {
 		return -1; /* Error - missing entry ! */
 	}
 
+	shares = get_share_mode_entries(db_data);
+	if (shares == NULL) {
+		free(db_data.dptr);
+		return -1;
+	}
+
 	ld = (struct locking_data *)db_data.dptr;
 	orig_num_share_modes = ld->u.s.num_share_mode_entries;
-	shares = (struct share_mode_entry *)(db_data.dptr + sizeof(struct locking_data));
 
 	if (orig_num_share_modes == 1) {
 		/* Only one entry - better be ours... */
@@ -421,16 +440,10 @@ int smb_delete_share_mode_entry(struct smbdb_ctx *db_ctx,
 		return tdb_delete(db_ctx->smb_tdb, locking_key);
 	}
 
-	/* More than one - allocate a new record minus the one we'll delete. */
-	new_data_p = (uint8 *)malloc(
-		db_data.dsize - sizeof(struct share_mode_entry));
-	if (!new_data_p) {
-		free(db_data.dptr);
-		return -1;
-	}
-
-	/* Copy the header. */
-	memcpy(new_data_p, db_data.dptr, sizeof(struct locking_data));
+	/*
+	 * More than one - move the entries we keep down, the header and
+	 * names in front of them stay where they are.
+	 */
 
 	num_share_modes = 0;
 	for (i = 0; i < orig_num_share_modes; i++) {
@@ -446,37 +459,24 @@ int smb_delete_share_mode_entry(struct smbdb_ctx *db_ctx,
 			continue; /* This is our delete taget. */
 		}
 
-		memcpy(new_data_p + sizeof(struct locking_data) +
-				(num_share_modes * sizeof(struct share_mode_entry)),
-			share, sizeof(struct share_mode_entry) );
-
+		if (num_share_modes != i) {
+			memcpy(&shares[num_share_modes], share,
+			       sizeof(struct share_mode_entry));
+		}
 		num_share_modes++;
 	}
 
 	if (num_share_modes == 0) {
 		/* None left after pruning. Delete record. */
 		free(db_data.dptr);
-		free(new_data_p);
 		return tdb_delete(db_ctx->smb_tdb, locking_key);
 	}
 
-	/* Copy any delete token plus the terminating filenames. */
-	remaining_ptr = db_data.dptr + sizeof(struct locking_data) + (orig_num_share_modes * sizeof(struct share_mode_entry));
-	remaining_size = db_data.dsize - (remaining_ptr - db_data.dptr);
-
-	memcpy(new_data_p + sizeof(struct locking_data) + (num_share_modes * sizeof(struct share_mode_entry)),
-		remaining_ptr,
-		remaining_size);
-
-	free(db_data.dptr);
-
-	db_data.dptr = new_data_p;
-
 	/* Re-save smaller record. */
-	ld = (struct locking_data *)db_data.dptr;
 	ld->u.s.num_share_mode_entries = num_share_modes;
 
-	db_data.dsize = sizeof(struct locking_data) + (num_share_modes * sizeof(struct share_mode_entry)) + remaining_size;
+	db_data.dsize = ld->u.s.entries_offset +
+		(num_share_modes * sizeof(struct share_mode_entry));
 
 	if (tdb_store(db_ctx->smb_tdb, locking_key, db_data, TDB_REPLACE) == -1) {
 		free(db_data.dptr);
@@ -507,9 +507,14 @@ int smb_change_share_mode_entry(struct smbdb_ctx *db_ctx,
 		return -1; /* Error - missing entry ! */
 	}
 
+	shares = get_share_mode_entries(db_data);
+	if (shares == NULL) {
+		free(db_data.dptr);
+		return -1;
+	}
+
 	ld = (struct locking_data *)db_data.dptr;
 	num_share_modes = ld->u.s.num_share_mode_entries;
-	shares = (struct share_mode_entry *)(db_data.dptr + sizeof(struct locking_data));
 
 	for (i = 0; i < num_share_modes; i++) {
 		struct share_mode_entry *share = &shares[i];
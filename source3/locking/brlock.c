@@ -270,7 +270,7 @@ void brl_init(bool read_only)
 		return;
 	}
 
-	tdb_flags = TDB_DEFAULT|TDB_VOLATILE|TDB_CLEAR_IF_FIRST;
+	tdb_flags = TDB_DEFAULT|TDB_VOLATILE|TDB_CLEAR_IF_FIRST|TDB_INCOMPATIBLE_HASH;
 
 	if (!lp_clustering()) {
 		/*
@@ -318,6 +318,166 @@ static int lock_compare(const struct lock_struct *lck1,
 }
 #endif
 
+/****************************************************************************
+ Helpers for the lock array, which is kept sorted by start offset.
+****************************************************************************/
+
+#define BRL_INDEX_MIN_LOCKS 16
+
+static bool brl_lock_wraps(const struct lock_struct *lock)
+{
+	return (lock->start + lock->size < lock->start);
+}
+
+/* Index of the first lock starting at or after offset. */
+
+static unsigned int brl_lower_bound(const struct lock_struct *locks,
+				    unsigned int num_locks,
+				    br_off offset)
+{
+	unsigned int lo = 0, hi = num_locks;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (locks[mid].start < offset) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/* Index of the first lock starting after offset. */
+
+static unsigned int brl_upper_bound(const struct lock_struct *locks,
+				    unsigned int num_locks,
+				    br_off offset)
+{
+	unsigned int lo = 0, hi = num_locks;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (locks[mid].start <= offset) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/****************************************************************************
+ Sort a lock array by start offset. Locks with the same start keep
+ their order, so Windows unlocks still remove the oldest matching
+ lock. The array is almost always sorted already, so this is an
+ insertion sort.
+****************************************************************************/
+
+static void brl_sort_locks(struct lock_struct *locks, unsigned int num_locks)
+{
+	unsigned int i, j;
+
+	for (i = 1; i < num_locks; i++) {
+		struct lock_struct tmp;
+
+		if (locks[i].start >= locks[i-1].start) {
+			continue;
+		}
+		tmp = locks[i];
+		j = brl_upper_bound(locks, i, tmp.start);
+		memmove(&locks[j+1], &locks[j], sizeof(*locks) * (i - j));
+		locks[j] = tmp;
+	}
+}
+
+/****************************************************************************
+ Build the index used to find locks overlapping a range without looking
+ at every lock on the file. max_ends[i] is the highest end offset of
+ the locks 0..i, so the only candidates to overlap [start, end) are the
+ locks before the first one starting at or after end, going back as
+ long as max_ends stays above start.
+
+ Returns False if the index can't be used: for a few locks a linear
+ scan is as good, and wrapping locks are left to the linear scan as
+ well.
+****************************************************************************/
+
+static bool brl_index(struct byte_range_lock *br_lck)
+{
+	struct lock_struct *locks = br_lck->lock_data;
+	br_off max_end = 0;
+	bool sorted = True;
+	unsigned int i;
+
+	if (br_lck->max_ends != NULL) {
+		return True;
+	}
+
+	if (br_lck->num_locks < BRL_INDEX_MIN_LOCKS) {
+		return False;
+	}
+
+	for (i = 0; i < br_lck->num_locks; i++) {
+		if (brl_lock_wraps(&locks[i])) {
+			return False;
+		}
+		if (i > 0 && locks[i].start < locks[i-1].start) {
+			sorted = False;
+		}
+	}
+
+	if (!sorted) {
+		brl_sort_locks(locks, br_lck->num_locks);
+	}
+
+	br_lck->max_ends = TALLOC_ARRAY(br_lck, br_off, br_lck->num_locks);
+	if (br_lck->max_ends == NULL) {
+		return False;
+	}
+
+	for (i = 0; i < br_lck->num_locks; i++) {
+		br_off end = locks[i].start + locks[i].size;
+		if (end > max_end) {
+			max_end = end;
+		}
+		br_lck->max_ends[i] = max_end;
+	}
+	return True;
+}
+
+static void brl_index_invalidate(struct byte_range_lock *br_lck)
+{
+	TALLOC_FREE(br_lck->max_ends);
+}
+
+/****************************************************************************
+ Find a lock conflicting with plock using the index. plock must not
+ wrap.
+****************************************************************************/
+
+static bool brl_index_conflict(const struct byte_range_lock *br_lck,
+			       const struct lock_struct *plock,
+			       bool (*conflict)(const struct lock_struct *lck1,
+						const struct lock_struct *lck2),
+			       unsigned int *pidx)
+{
+	const struct lock_struct *locks = br_lck->lock_data;
+	unsigned int i;
+
+	i = brl_lower_bound(locks, br_lck->num_locks,
+			    plock->start + plock->size);
+
+	while (i > 0 && br_lck->max_ends[i-1] > plock->start) {
+		i--;
+		if (conflict(&locks[i], plock)) {
+			*pidx = i;
+			return True;
+		}
+	}
+	return False;
+}
+
 /****************************************************************************
  Lock a range of bytes - Windows lock semantics.
 ****************************************************************************/
@@ -332,7 +492,14 @@ NTSTATUS brl_lock_windows_default(struct byte_range_lock *br_lck,
 
 	SMB_ASSERT(plock->lock_type != UNLOCK_LOCK);
 
-	for (i=0; i < br_lck->num_locks; i++) {
+	if (!brl_lock_wraps(plock) && brl_index(br_lck)) {
+		/* Do any Windows or POSIX locks conflict ? */
+		if (brl_index_conflict(br_lck, plock, brl_conflict, &i)) {
+			/* Remember who blocked us. */
+			plock->context.smbpid = locks[i].context.smbpid;
+			return brl_lock_failed(fsp,plock,blocking_lock);
+		}
+	} else for (i=0; i < br_lck->num_locks; i++) {
 		if (locks[i].start + locks[i].size < locks[i].start) {
 			/* 64-bit wrap. Error. */
 			return NT_STATUS_INVALID_LOCK_RANGE;
@@ -384,17 +551,23 @@ NTSTATUS brl_lock_windows_default(struct byte_range_lock *br_lck,
 		}
 	}
 
-	/* no conflicts - add it to the list of locks */
+	/* no conflicts - add it to the list of locks, sorted by start */
 	locks = (struct lock_struct *)SMB_REALLOC(locks, (br_lck->num_locks + 1) * sizeof(*locks));
 	if (!locks) {
 		status = NT_STATUS_NO_MEMORY;
 		goto fail;
 	}
 
-	memcpy(&locks[br_lck->num_locks], plock, sizeof(struct lock_struct));
+	i = brl_upper_bound(locks, br_lck->num_locks, plock->start);
+	if (i < br_lck->num_locks) {
+		memmove(&locks[i+1], &locks[i],
+			(br_lck->num_locks - i)*sizeof(struct lock_struct));
+	}
+	memcpy(&locks[i], plock, sizeof(struct lock_struct));
 	br_lck->num_locks += 1;
 	br_lck->lock_data = locks;
 	br_lck->modified = True;
+	brl_index_invalidate(br_lck);
 
 	return NT_STATUS_OK;
  fail:
@@ -788,14 +961,11 @@ static NTSTATUS brl_lock_posix(struct messaging_context *msg_ctx,
 					     LEVEL2_CONTEND_POSIX_BRL);
 	}
 
-	/* Try and add the lock in order, sorted by lock start. */
-	for (i=0; i < count; i++) {
-		struct lock_struct *curr_lock = &tp[i];
+	/* Splitting POSIX locks can leave them out of order. */
+	brl_sort_locks(tp, count);
 
-		if (curr_lock->start <= plock->start) {
-			continue;
-		}
-	}
+	/* Add the lock in order, sorted by lock start. */
+	i = brl_upper_bound(tp, count, plock->start);
 
 	if (i < count) {
 		memmove(&tp[i+1], &tp[i],
@@ -851,6 +1021,7 @@ static NTSTATUS brl_lock_posix(struct messaging_context *msg_ctx,
 	br_lck->lock_data = tp;
 	locks = tp;
 	br_lck->modified = True;
+	brl_index_invalidate(br_lck);
 
 	/* A successful downgrade from write to read lock can trigger a lock
 	   re-evalutation where waiting readers can now proceed. */
@@ -963,6 +1134,7 @@ bool brl_unlock_windows_default(struct messaging_context *msg_ctx,
 			       const struct lock_struct *plock)
 {
 	unsigned int i, j;
+	unsigned int first = 0, last = br_lck->num_locks;
 	struct lock_struct *locks = br_lck->lock_data;
 	enum brl_type deleted_lock_type = READ_LOCK; /* shut the compiler up.... */
 
@@ -994,7 +1166,15 @@ bool brl_unlock_windows_default(struct messaging_context *msg_ctx,
 	}
 #endif
 
-	for (i = 0; i < br_lck->num_locks; i++) {
+	if (brl_index(br_lck)) {
+		/* Only locks with the same start can match. */
+		first = brl_lower_bound(locks, br_lck->num_locks,
+					plock->start);
+		last = brl_upper_bound(locks, br_lck->num_locks,
+				       plock->start);
+	}
+
+	for (i = first; i < last; i++) {
 		struct lock_struct *lock = &locks[i];
 
 		/* Only remove our own locks that match in start, size, and flavour. */
@@ -1008,7 +1188,7 @@ bool brl_unlock_windows_default(struct messaging_context *msg_ctx,
 		}
 	}
 
-	if (i == br_lck->num_locks) {
+	if (i == last) {
 		/* we didn't find it */
 		return False;
 	}
@@ -1025,6 +1205,7 @@ bool brl_unlock_windows_default(struct messaging_context *msg_ctx,
 
 	br_lck->num_locks -= 1;
 	br_lck->modified = True;
+	brl_index_invalidate(br_lck);
 
 	/* Unlock the underlying POSIX regions. */
 	if(lp_posix_locking(br_lck->fsp->conn->params)) {
@@ -1161,6 +1342,9 @@ static bool brl_unlock_posix(struct messaging_context *msg_ctx,
 		return True;
 	}
 
+	/* Splitting POSIX locks can leave them out of order. */
+	brl_sort_locks(tp, count);
+
 	/* Unlock any POSIX regions. */
 	if(lp_posix_locking(br_lck->fsp->conn->params)) {
 		release_posix_lock_posix_flavour(br_lck->fsp,
@@ -1192,6 +1376,7 @@ static bool brl_unlock_posix(struct messaging_context *msg_ctx,
 	locks = tp;
 	br_lck->lock_data = tp;
 	br_lck->modified = True;
+	brl_index_invalidate(br_lck);
 
 	/* Send unlock messages to any pending waiters that overlap. */
 
@@ -1285,7 +1470,11 @@ bool brl_locktest(struct byte_range_lock *br_lck,
 	lock.lock_flav = lock_flav;
 
 	/* Make sure existing locks don't conflict */
-	for (i=0; i < br_lck->num_locks; i++) {
+	if (!brl_lock_wraps(&lock) && brl_index(br_lck)) {
+		if (brl_index_conflict(br_lck, &lock, brl_conflict_other, &i)) {
+			return False;
+		}
+	} else for (i=0; i < br_lck->num_locks; i++) {
 		/*
 		 * Our own locks don't conflict.
 		 */
@@ -1315,6 +1504,19 @@ bool brl_locktest(struct byte_range_lock *br_lck,
 	return ret;
 }
 
+/****************************************************************************
+ See if an existing lock of either flavour conflicts with a lock query.
+****************************************************************************/
+
+static bool brl_conflict_lockquery(const struct lock_struct *exlock,
+				   const struct lock_struct *plock)
+{
+	if (exlock->lock_flav == WINDOWS_LOCK) {
+		return brl_conflict(exlock, plock);
+	}
+	return brl_conflict_posix(exlock, plock);
+}
+
 /****************************************************************************
  Query for existing locks.
 ****************************************************************************/
@@ -1328,6 +1530,7 @@ NTSTATUS brl_lockquery(struct byte_range_lock *br_lck,
 		enum brl_flavour lock_flav)
 {
 	unsigned int i;
+	bool conflict = False;
 	struct lock_struct lock;
 	const struct lock_struct *locks = br_lck->lock_data;
 	files_struct *fsp = br_lck->fsp;
@@ -1342,23 +1545,26 @@ NTSTATUS brl_lockquery(struct byte_range_lock *br_lck,
 	lock.lock_flav = lock_flav;
 
 	/* Make sure existing locks don't conflict */
-	for (i=0; i < br_lck->num_locks; i++) {
-		const struct lock_struct *exlock = &locks[i];
-		bool conflict = False;
-
-		if (exlock->lock_flav == WINDOWS_LOCK) {
-			conflict = brl_conflict(exlock, &lock);
-		} else {	
-			conflict = brl_conflict_posix(exlock, &lock);
+	if (!brl_lock_wraps(&lock) && brl_index(br_lck)) {
+		conflict = brl_index_conflict(br_lck, &lock,
+					      brl_conflict_lockquery, &i);
+	} else {
+		for (i=0; i < br_lck->num_locks; i++) {
+			conflict = brl_conflict_lockquery(&locks[i], &lock);
+			if (conflict) {
+				break;
+			}
 		}
+	}
 
-		if (conflict) {
-			*psmbpid = exlock->context.smbpid;
-        		*pstart = exlock->start;
-		        *psize = exlock->size;
-        		*plock_type = exlock->lock_type;
-			return NT_STATUS_LOCK_NOT_GRANTED;
-		}
+	if (conflict) {
+		const struct lock_struct *exlock = &locks[i];
+
+		*psmbpid = exlock->context.smbpid;
+		*pstart = exlock->start;
+		*psize = exlock->size;
+		*plock_type = exlock->lock_type;
+		return NT_STATUS_LOCK_NOT_GRANTED;
 	}
 
 	/*
@@ -1430,11 +1636,20 @@ bool brl_lock_cancel_default(struct byte_range_lock *br_lck,
 		struct lock_struct *plock)
 {
 	unsigned int i;
+	unsigned int first = 0, last = br_lck->num_locks;
 	struct lock_struct *locks = br_lck->lock_data;
 
 	SMB_ASSERT(plock);
 
-	for (i = 0; i < br_lck->num_locks; i++) {
+	if (brl_index(br_lck)) {
+		/* Only locks with the same start can match. */
+		first = brl_lower_bound(locks, br_lck->num_locks,
+					plock->start);
+		last = brl_upper_bound(locks, br_lck->num_locks,
+				       plock->start);
+	}
+
+	for (i = first; i < last; i++) {
 		struct lock_struct *lock = &locks[i];
 
 		/* For pending locks we *always* care about the fnum. */
@@ -1448,7 +1663,7 @@ bool brl_lock_cancel_default(struct byte_range_lock *br_lck,
 		}
 	}
 
-	if (i == br_lck->num_locks) {
+	if (i == last) {
 		/* Didn't find it. */
 		return False;
 	}
@@ -1461,6 +1676,7 @@ bool brl_lock_cancel_default(struct byte_range_lock *br_lck,
 
 	br_lck->num_locks -= 1;
 	br_lck->modified = True;
+	brl_index_invalidate(br_lck);
 	return True;
 }
 
@@ -1598,6 +1814,7 @@ void brl_close_fnum(struct messaging_context *msg_ctx,
 			}
 			br_lck->num_locks--;
 			br_lck->modified = True;
+			brl_index_invalidate(br_lck);
 			i--;
 			dcount++;
 		}
@@ -1848,6 +2065,7 @@ static struct byte_range_lock *brl_get_locks_internal(TALLOC_CTX *mem_ctx,
 
 	br_lck->read_only = read_only;
 	br_lck->lock_data = NULL;
+	br_lck->max_ends = NULL;
 
 	talloc_set_destructor(br_lck, byte_range_lock_destructor);
 
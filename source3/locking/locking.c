@@ -427,7 +427,8 @@ static bool locking_init_internal(bool read_only)
 
 	lock_db = db_open(NULL, lock_path("locking.tdb"),
 			  lp_open_files_db_hash_size(),
-			  TDB_DEFAULT|TDB_VOLATILE|TDB_CLEAR_IF_FIRST,
+			  TDB_DEFAULT|TDB_VOLATILE|TDB_CLEAR_IF_FIRST|
+			  TDB_INCOMPATIBLE_HASH,
 			  read_only?O_RDONLY:O_RDWR|O_CREAT, 0644);
 
 	if (!lock_db) {
@@ -498,8 +499,8 @@ char *share_mode_str(TALLOC_CTX *ctx, int num, const struct share_mode_entry *e)
 static void print_share_mode_table(struct locking_data *data)
 {
 	int num_share_modes = data->u.s.num_share_mode_entries;
-	struct share_mode_entry *shares =
-		(struct share_mode_entry *)(data + 1);
+	struct share_mode_entry *shares = (struct share_mode_entry *)
+		((uint8 *)data + data->u.s.entries_offset);
 	int i;
 
 	for (i = 0; i < num_share_modes; i++) {
@@ -527,6 +528,8 @@ static void print_share_mode_table(struct locking_data *data)
 static bool parse_share_modes(const TDB_DATA dbuf, struct share_mode_lock *lck)
 {
 	struct locking_data data;
+	const char *names;
+	size_t entries_offset;
 	int i;
 
 	if (dbuf.dsize < sizeof(struct locking_data)) {
@@ -535,6 +538,12 @@ static bool parse_share_modes(const TDB_DATA dbuf, struct share_mode_lock *lck)
 
 	memcpy(&data, dbuf.dptr, sizeof(data));
 
+	if (data.u.s.version != LOCKING_DATA_VERSION) {
+		DEBUG(0, ("parse_share_modes: unknown record version %u\n",
+			  (unsigned int)data.u.s.version));
+		smb_panic("parse_share_modes: unknown record version");
+	}
+
 	lck->delete_on_close = data.u.s.delete_on_close;
 	lck->old_write_time = data.u.s.old_write_time;
 	lck->changed_write_time = data.u.s.changed_write_time;
@@ -557,32 +566,38 @@ static bool parse_share_modes(const TDB_DATA dbuf, struct share_mode_lock *lck)
 		smb_panic("parse_share_modes: invalid number of share modes");
 	}
 
-	lck->share_modes = NULL;
-	
-	if (lck->num_share_modes != 0) {
+	entries_offset = data.u.s.entries_offset;
 
-		if (dbuf.dsize < (sizeof(struct locking_data) +
-				  (lck->num_share_modes *
-				   sizeof(struct share_mode_entry)))) {
-			smb_panic("parse_share_modes: buffer too short");
-		}
-				  
-		lck->share_modes = (struct share_mode_entry *)
-			TALLOC_MEMDUP(lck,
-				      dbuf.dptr+sizeof(struct locking_data),
-				      lck->num_share_modes *
-				      sizeof(struct share_mode_entry));
-
-		if (lck->share_modes == NULL) {
-			smb_panic("parse_share_modes: talloc failed");
-		}
+	if ((entries_offset % 8 != 0) ||
+	    (entries_offset < (sizeof(struct locking_data) +
+			       data.u.s.delete_token_size + 3)) ||
+	    (dbuf.dsize < (entries_offset +
+			   (lck->num_share_modes *
+			    sizeof(struct share_mode_entry))))) {
+		smb_panic("parse_share_modes: buffer too short");
 	}
 
+	/*
+	 * Take one aligned copy of the whole record. The share mode
+	 * entries are used and modified in there, and unless the names
+	 * or the delete token change, the destructor stores it back as
+	 * it is.
+	 */
+
+	lck->buf.dsize = entries_offset +
+		lck->num_share_modes * sizeof(struct share_mode_entry);
+	lck->buf.dptr = (uint8 *)TALLOC_MEMDUP(lck, dbuf.dptr,
+					       lck->buf.dsize);
+	if (lck->buf.dptr == NULL) {
+		smb_panic("parse_share_modes: talloc failed");
+	}
+
+	lck->share_modes = (struct share_mode_entry *)
+		(lck->buf.dptr + entries_offset);
+
 	/* Get any delete token. */
 	if (data.u.s.delete_token_size) {
-		uint8 *p = dbuf.dptr + sizeof(struct locking_data) +
-				(lck->num_share_modes *
-				sizeof(struct share_mode_entry));
+		uint8 *p = lck->buf.dptr + sizeof(struct locking_data);
 
 		if ((data.u.s.delete_token_size < sizeof(uid_t) + sizeof(gid_t)) ||
 				((data.u.s.delete_token_size - sizeof(uid_t)) % sizeof(gid_t)) != 0) {
@@ -626,20 +641,16 @@ static bool parse_share_modes(const TDB_DATA dbuf, struct share_mode_lock *lck)
 	}
 
 	/* Save off the associated service path and filename. */
-	lck->servicepath = (const char *)dbuf.dptr + sizeof(struct locking_data) +
-		(lck->num_share_modes *	sizeof(struct share_mode_entry)) +
+	names = (const char *)lck->buf.dptr + sizeof(struct locking_data) +
 		data.u.s.delete_token_size;
 
-	lck->base_name = (const char *)dbuf.dptr + sizeof(struct locking_data) +
-		(lck->num_share_modes *	sizeof(struct share_mode_entry)) +
-		data.u.s.delete_token_size +
-		strlen(lck->servicepath) + 1;
+	if (lck->buf.dptr[entries_offset-1] != '\0') {
+		smb_panic("parse_share_modes: names not terminated");
+	}
 
-	lck->stream_name = (const char *)dbuf.dptr + sizeof(struct locking_data) +
-		(lck->num_share_modes *	sizeof(struct share_mode_entry)) +
-		data.u.s.delete_token_size +
-		strlen(lck->servicepath) + 1 +
-		strlen(lck->base_name) + 1;
+	lck->servicepath = names;
+	lck->base_name = lck->servicepath + strlen(lck->servicepath) + 1;
+	lck->stream_name = lck->base_name + strlen(lck->base_name) + 1;
 
 	/*
 	 * Ensure that each entry has a real process attached.
@@ -648,6 +659,9 @@ static bool parse_share_modes(const TDB_DATA dbuf, struct share_mode_lock *lck)
 	for (i = 0; i < lck->num_share_modes; i++) {
 		struct share_mode_entry *entry_p = &lck->share_modes[i];
 		char *str = NULL;
+		if (is_unused_share_mode_entry(entry_p)) {
+			continue;
+		}
 		if (DEBUGLEVEL >= 10) {
 			str = share_mode_str(NULL, i, entry_p);
 		}
@@ -665,26 +679,79 @@ static bool parse_share_modes(const TDB_DATA dbuf, struct share_mode_lock *lck)
 	return True;
 }
 
+/*******************************************************************
+ Number of entries to store, unused ones at the end are dropped.
+********************************************************************/
+
+static int share_modes_num_to_store(const struct share_mode_lock *lck)
+{
+	int num = lck->num_share_modes;
+
+	while ((num > 0) &&
+	       is_unused_share_mode_entry(&lck->share_modes[num-1])) {
+		num -= 1;
+	}
+	return num;
+}
+
+/*******************************************************************
+ The record to store if only the entries, the delete on close flag or
+ the write times changed: Update the header of the parsed record.
+********************************************************************/
+
+static TDB_DATA update_share_modes(struct share_mode_lock *lck)
+{
+	TDB_DATA result = tdb_null;
+	struct locking_data *data;
+	int num;
+
+	num = share_modes_num_to_store(lck);
+	if (num == 0) {
+		return result;
+	}
+
+	data = (struct locking_data *)lck->buf.dptr;
+	data->u.s.num_share_mode_entries = num;
+	data->u.s.delete_on_close = lck->delete_on_close;
+	data->u.s.old_write_time = lck->old_write_time;
+	data->u.s.changed_write_time = lck->changed_write_time;
+
+	DEBUG(10,("update_share_modes: del: %d, owrt: %s cwrt: %s, num: %d\n",
+		  data->u.s.delete_on_close,
+		  timestring(talloc_tos(),
+			     convert_timespec_to_time_t(lck->old_write_time)),
+		  timestring(talloc_tos(),
+			     convert_timespec_to_time_t(
+				     lck->changed_write_time)),
+		  num));
+
+	result.dptr = lck->buf.dptr;
+	result.dsize = data->u.s.entries_offset +
+		num * sizeof(struct share_mode_entry);
+
+	if (DEBUGLEVEL >= 10) {
+		print_share_mode_table(data);
+	}
+
+	return result;
+}
+
 static TDB_DATA unparse_share_modes(const struct share_mode_lock *lck)
 {
 	TDB_DATA result;
-	int num_valid = 0;
+	int num;
 	int i;
 	struct locking_data *data;
 	ssize_t offset;
 	ssize_t sp_len, bn_len, sn_len;
 	uint32 delete_token_size;
+	size_t entries_offset;
 
 	result.dptr = NULL;
 	result.dsize = 0;
 
-	for (i=0; i<lck->num_share_modes; i++) {
-		if (!is_unused_share_mode_entry(&lck->share_modes[i])) {
-			num_valid += 1;
-		}
-	}
-
-	if (num_valid == 0) {
+	num = share_modes_num_to_store(lck);
+	if (num == 0) {
 		return result;
 	}
 
@@ -695,25 +762,24 @@ static TDB_DATA unparse_share_modes(const struct share_mode_lock *lck)
 	delete_token_size = (lck->delete_token ?
 			(sizeof(uid_t) + sizeof(gid_t) + (lck->delete_token->ngroups*sizeof(gid_t))) : 0);
 
-	result.dsize = sizeof(*data) +
-		lck->num_share_modes * sizeof(struct share_mode_entry) +
-		delete_token_size +
-		sp_len + 1 +
-		bn_len + 1 +
-		sn_len + 1;
-	result.dptr = TALLOC_ARRAY(lck, uint8, result.dsize);
+	entries_offset = LOCKING_DATA_ENTRIES_OFFSET(
+		delete_token_size, sp_len + 1 + bn_len + 1 + sn_len + 1);
+
+	result.dsize = entries_offset + num * sizeof(struct share_mode_entry);
+	result.dptr = TALLOC_ZERO_ARRAY(lck, uint8, result.dsize);
 
 	if (result.dptr == NULL) {
 		smb_panic("talloc failed");
 	}
 
 	data = (struct locking_data *)result.dptr;
-	ZERO_STRUCTP(data);
-	data->u.s.num_share_mode_entries = lck->num_share_modes;
+	data->u.s.num_share_mode_entries = num;
 	data->u.s.delete_on_close = lck->delete_on_close;
 	data->u.s.old_write_time = lck->old_write_time;
 	data->u.s.changed_write_time = lck->changed_write_time;
 	data->u.s.delete_token_size = delete_token_size;
+	data->u.s.version = LOCKING_DATA_VERSION;
+	data->u.s.entries_offset = entries_offset;
 
 	DEBUG(10,("unparse_share_modes: del: %d, owrt: %s cwrt: %s, tok: %u, "
 		  "num: %d\n", data->u.s.delete_on_close,
@@ -725,10 +791,7 @@ static TDB_DATA unparse_share_modes(const struct share_mode_lock *lck)
 		  (unsigned int)data->u.s.delete_token_size,
 		  data->u.s.num_share_mode_entries));
 
-	memcpy(result.dptr + sizeof(*data), lck->share_modes,
-	       sizeof(struct share_mode_entry)*lck->num_share_modes);
-	offset = sizeof(*data) +
-		sizeof(struct share_mode_entry)*lck->num_share_modes;
+	offset = sizeof(*data);
 
 	/* Store any delete on close token. */
 	if (lck->delete_token) {
@@ -756,6 +819,9 @@ static TDB_DATA unparse_share_modes(const struct share_mode_lock *lck)
 	safe_strcpy((char *)result.dptr + offset, lck->stream_name,
 		    result.dsize - offset - 1);
 
+	memcpy(result.dptr + entries_offset, lck->share_modes,
+	       sizeof(struct share_mode_entry) * num);
+
 	if (DEBUGLEVEL >= 10) {
 		print_share_mode_table(data);
 	}
@@ -772,7 +838,11 @@ static int share_mode_lock_destructor(struct share_mode_lock *lck)
 		return 0;
 	}
 
-	data = unparse_share_modes(lck);
+	if ((lck->buf.dptr != NULL) && !lck->names_modified) {
+		data = update_share_modes(lck);
+	} else {
+		data = unparse_share_modes(lck);
+	}
 
 	if (data.dptr == NULL) {
 		if (!lck->fresh) {
@@ -837,6 +907,8 @@ static bool fill_share_mode_lock(struct share_mode_lock *lck,
 	ZERO_STRUCT(lck->changed_write_time);
 	lck->fresh = False;
 	lck->modified = False;
+	lck->names_modified = False;
+	lck->buf = tdb_null;
 
 	lck->fresh = (share_mode_data.dptr == NULL);
 
@@ -875,16 +947,22 @@ struct share_mode_lock *get_share_mode_lock(TALLOC_CTX *mem_ctx,
 					    const struct smb_filename *smb_fname,
 					    const struct timespec *old_write_time)
 {
+	static struct latency_counter *fetch_latency;
 	struct share_mode_lock *lck;
 	struct file_id tmp;
 	TDB_DATA key = locking_key(&id, &tmp);
+	uint64_t start;
 
 	if (!(lck = TALLOC_P(mem_ctx, struct share_mode_lock))) {
 		DEBUG(0, ("talloc failed\n"));
 		return NULL;
 	}
 
-	if (!(lck->record = lock_db->fetch_locked(lock_db, lck, key))) {
+	start = latency_now();
+	lck->record = lock_db->fetch_locked(lock_db, lck, key);
+	latency_record(&fetch_latency, "locking", "share_mode_lock", start);
+
+	if (lck->record == NULL) {
 		DEBUG(3, ("Could not lock share entry\n"));
 		TALLOC_FREE(lck);
 		return NULL;
@@ -977,6 +1055,7 @@ bool rename_share_filename(struct messaging_context *msg_ctx,
 		return False;
 	}
 	lck->modified = True;
+	lck->names_modified = True;
 
 	sp_len = strlen(lck->servicepath);
 	bn_len = strlen(lck->base_name);
@@ -1130,6 +1209,50 @@ static void fill_deferred_open_entry(struct share_mode_entry *e,
 	e->flags = 0;
 }
 
+/*******************************************************************
+ Add an entry at the end of a parsed record. The buffer grows in
+ steps, so a file opened many times is not copied for every open.
+********************************************************************/
+
+static void append_share_mode_entry(struct share_mode_lock *lck,
+				    const struct share_mode_entry *entry)
+{
+	const struct locking_data *data =
+		(const struct locking_data *)lck->buf.dptr;
+	size_t entries_offset = data->u.s.entries_offset;
+	size_t names_offset = sizeof(*data) + data->u.s.delete_token_size;
+	size_t needed, space;
+	uint8 *buf;
+
+	needed = lck->buf.dsize + sizeof(struct share_mode_entry);
+	space = talloc_get_size(lck->buf.dptr);
+
+	if (needed > space) {
+		space = MAX(needed, space +
+			    (space - entries_offset) / 2);
+		buf = TALLOC_REALLOC_ARRAY(lck, lck->buf.dptr, uint8, space);
+		if (buf == NULL) {
+			smb_panic("append_share_mode_entry: talloc failed");
+		}
+		lck->buf.dptr = buf;
+
+		/* The names live in the buffer too. */
+		if (!lck->names_modified) {
+			lck->servicepath = (const char *)buf + names_offset;
+			lck->base_name = lck->servicepath +
+				strlen(lck->servicepath) + 1;
+			lck->stream_name = lck->base_name +
+				strlen(lck->base_name) + 1;
+		}
+	}
+
+	lck->share_modes = (struct share_mode_entry *)
+		(lck->buf.dptr + entries_offset);
+	lck->share_modes[lck->num_share_modes] = *entry;
+	lck->num_share_modes += 1;
+	lck->buf.dsize = needed;
+}
+
 static void add_share_mode_entry(struct share_mode_lock *lck,
 				 const struct share_mode_entry *entry)
 {
@@ -1145,8 +1268,12 @@ static void add_share_mode_entry(struct share_mode_lock *lck,
 
 	if (i == lck->num_share_modes) {
 		/* No unused entry found */
-		ADD_TO_ARRAY(lck, struct share_mode_entry, *entry,
-			     &lck->share_modes, &lck->num_share_modes);
+		if (lck->buf.dptr != NULL) {
+			append_share_mode_entry(lck, entry);
+		} else {
+			ADD_TO_ARRAY(lck, struct share_mode_entry, *entry,
+				     &lck->share_modes, &lck->num_share_modes);
+		}
 	}
 	lck->modified = True;
 }
@@ -1400,6 +1527,7 @@ void set_delete_on_close_token(struct share_mode_lock *lck, const UNIX_USER_TOKE
 	/* Copy the new token (can be NULL). */
 	lck->delete_token = copy_unix_token(lck, tok);
 	lck->modified = True;
+	lck->names_modified = True;
 }
 
 /****************************************************************************
@@ -1534,14 +1662,14 @@ static int traverse_fn(struct db_record *rec, void *_state)
 		return 0;
 
 	data = (struct locking_data *)rec->value.dptr;
-	shares = (struct share_mode_entry *)(rec->value.dptr + sizeof(*data));
+	if (data->u.s.version != LOCKING_DATA_VERSION) {
+		return 0;
+	}
+	shares = (struct share_mode_entry *)(rec->value.dptr +
+					     data->u.s.entries_offset);
 	sharepath = (const char *)rec->value.dptr + sizeof(*data) +
-		data->u.s.num_share_mode_entries*sizeof(*shares) +
 		data->u.s.delete_token_size;
-	fname = (const char *)rec->value.dptr + sizeof(*data) +
-		data->u.s.num_share_mode_entries*sizeof(*shares) +
-		data->u.s.delete_token_size +
-		strlen(sharepath) + 1;
+	fname = sharepath + strlen(sharepath) + 1;
 
 	for (i=0;i<data->u.s.num_share_mode_entries;i++) {
 		state->fn(&shares[i], sharepath, fname,
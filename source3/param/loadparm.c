@@ -200,6 +200,7 @@ struct global {
 	int  winbind_expand_groups;
 	bool bWinbindRefreshTickets;
 	bool bWinbindOfflineLogon;
+	bool bWinbindNssCache;
 	bool bWinbindNormalizeNames;
 	bool bWinbindRpcOnly;
 	bool bCreateKrb5Conf;
@@ -235,6 +236,8 @@ struct global {
 	int maxdisksize;
 	int lpqcachetime;
 	int iMaxSmbdProcesses;
+	int iAioMaxThreads;
+	int iAioSigningSize;
 	bool bDisableSpoolss;
 	int syslog;
 	int os_level;
@@ -251,6 +254,7 @@ struct global {
 	int winbind_cache_time;
 	int winbind_reconnect_delay;
 	int winbind_max_idle_children;
+	int winbind_max_domain_connections;
 	char **szWinbindNssInfo;
 	int iLockSpinTime;
 	char *szLdapMachineSuffix;
@@ -315,6 +319,7 @@ struct global {
 	bool bNTStatusSupport;
 	bool bStatCache;
 	int iMaxStatCacheSize;
+	int iDirNameIndexSize;
 	bool bKernelOplocks;
 	bool bAllowTrustedDomains;
 	bool bLanmanAuth;
@@ -501,6 +506,9 @@ struct service {
 	int iAioWriteSize;
 	int iMap_readonly;
 	int iDirectoryNameCacheSize;
+	int iNegativeStatCacheSize;
+	int iDirectoryStatPrefetch;
+	int iDirectoryListingCacheSize;
 	int ismb_encrypt;
 	struct param_opt_struct *param_opt;
 
@@ -649,6 +657,9 @@ static struct service sDefault = {
 #else
 	100,			/* iDirectoryNameCacheSize */
 #endif
+	64,			/* iNegativeStatCacheSize */
+	0,			/* iDirectoryStatPrefetch */
+	0,			/* iDirectoryListingCacheSize */
 	Auto,			/* ismb_encrypt */
 	NULL,			/* Parametric options */
 
@@ -1977,6 +1988,24 @@ static struct parm_struct parm_table[] = {
 		.enum_list	= NULL,
 		.flags		= FLAG_ADVANCED,
 	},
+	{
+		.label		= "aio max threads",
+		.type		= P_INTEGER,
+		.p_class	= P_GLOBAL,
+		.ptr		= &Globals.iAioMaxThreads,
+		.special	= NULL,
+		.enum_list	= NULL,
+		.flags		= FLAG_ADVANCED,
+	},
+	{
+		.label		= "aio signing size",
+		.type		= P_INTEGER,
+		.p_class	= P_GLOBAL,
+		.ptr		= &Globals.iAioSigningSize,
+		.special	= NULL,
+		.enum_list	= NULL,
+		.flags		= FLAG_ADVANCED,
+	},
 	{
 		.label		= "aio write behind",
 		.type		= P_STRING,
@@ -2376,6 +2405,33 @@ static struct parm_struct parm_table[] = {
 		.enum_list	= NULL,
 		.flags		= FLAG_ADVANCED | FLAG_SHARE,
 	},
+	{
+		.label		= "directory listing cache size",
+		.type		= P_INTEGER,
+		.p_class	= P_LOCAL,
+		.ptr		= &sDefault.iDirectoryListingCacheSize,
+		.special	= NULL,
+		.enum_list	= NULL,
+		.flags		= FLAG_ADVANCED | FLAG_SHARE,
+	},
+	{
+		.label		= "directory stat prefetch",
+		.type		= P_INTEGER,
+		.p_class	= P_LOCAL,
+		.ptr		= &sDefault.iDirectoryStatPrefetch,
+		.special	= NULL,
+		.enum_list	= NULL,
+		.flags		= FLAG_ADVANCED | FLAG_SHARE,
+	},
+	{
+		.label		= "negative stat cache size",
+		.type		= P_INTEGER,
+		.p_class	= P_LOCAL,
+		.ptr		= &sDefault.iNegativeStatCacheSize,
+		.special	= NULL,
+		.enum_list	= NULL,
+		.flags		= FLAG_ADVANCED | FLAG_SHARE,
+	},
 	{
 		.label		= "kernel change notify",
 		.type		= P_BOOL,
@@ -3087,6 +3143,15 @@ static struct parm_struct parm_table[] = {
 		.enum_list	= NULL,
 		.flags		= FLAG_ADVANCED,
 	},
+	{
+		.label		= "directory name index size",
+		.type		= P_INTEGER,
+		.p_class	= P_GLOBAL,
+		.ptr		= &Globals.iDirNameIndexSize,
+		.special	= NULL,
+		.enum_list	= NULL,
+		.flags		= FLAG_ADVANCED,
+	},
 	{
 		.label		= "stat cache",
 		.type		= P_BOOL,
@@ -4531,6 +4596,15 @@ static struct parm_struct parm_table[] = {
 		.enum_list	= NULL,
 		.flags		= FLAG_ADVANCED,
 	},
+	{
+		.label		= "winbind max domain connections",
+		.type		= P_INTEGER,
+		.p_class	= P_GLOBAL,
+		.ptr		= &Globals.winbind_max_domain_connections,
+		.special	= NULL,
+		.enum_list	= NULL,
+		.flags		= FLAG_ADVANCED,
+	},
 	{
 		.label		= "winbind enum users",
 		.type		= P_BOOL,
@@ -4612,6 +4686,15 @@ static struct parm_struct parm_table[] = {
 		.enum_list	= NULL,
 		.flags		= FLAG_ADVANCED,
 	},
+	{
+		.label		= "winbind nss cache",
+		.type		= P_BOOL,
+		.p_class	= P_GLOBAL,
+		.ptr		= &Globals.bWinbindNssCache,
+		.special	= NULL,
+		.enum_list	= NULL,
+		.flags		= FLAG_ADVANCED,
+	},
 	{
 		.label		= "winbind normalize names",
 		.type		= P_BOOL,
@@ -4998,6 +5081,8 @@ static void init_globals(bool first_time_only)
 	Globals.lpqcachetime = 30;	/* changed to handle large print servers better -- jerry */
 	Globals.bDisableSpoolss = False;
 	Globals.iMaxSmbdProcesses = 0;/* no limit specified */
+	Globals.iAioMaxThreads = 100;
+	Globals.iAioSigningSize = 0;
 	Globals.pwordlevel = 0;
 	Globals.unamelevel = 0;
 	Globals.deadtime = 0;
@@ -5053,6 +5138,7 @@ static void init_globals(bool first_time_only)
 	Globals.bNTStatusSupport = True; /* Use NT status by default. */
 	Globals.bStatCache = True;	/* use stat cache by default */
 	Globals.iMaxStatCacheSize = 256; /* 256k by default */
+	Globals.iDirNameIndexSize = 16384; /* 16M by default */
 	Globals.restrict_anonymous = 0;
 	Globals.bClientLanManAuth = False;	/* Do NOT use the LanMan hash if it is available */
 	Globals.bClientPlaintextAuth = False;	/* Do NOT use a plaintext password even if is requested by the server */
@@ -5152,6 +5238,7 @@ static void init_globals(bool first_time_only)
 
 	Globals.winbind_cache_time = 300;	/* 5 minutes */
 	Globals.winbind_reconnect_delay = 30;	/* 30 seconds */
+	Globals.winbind_max_domain_connections = 1;
 	Globals.bWinbindEnumUsers = False;
 	Globals.bWinbindEnumGroups = False;
 	Globals.bWinbindUseDefaultDomain = False;
@@ -5161,6 +5248,7 @@ static void init_globals(bool first_time_only)
 	Globals.szWinbindNssInfo = str_list_make_v3(talloc_autofree_context(), "template", NULL);
 	Globals.bWinbindRefreshTickets = False;
 	Globals.bWinbindOfflineLogon = False;
+	Globals.bWinbindNssCache = True;
 
 	Globals.iIdmapCacheTime = 86400 * 7; /* a week by default */
 	Globals.iIdmapNegativeCacheTime = 120; /* 2 minutes by default */
@@ -5428,6 +5516,7 @@ FN_GLOBAL_BOOL(lp_winbind_nested_groups, &Globals.bWinbindNestedGroups)
 FN_GLOBAL_INTEGER(lp_winbind_expand_groups, &Globals.winbind_expand_groups)
 FN_GLOBAL_BOOL(lp_winbind_refresh_tickets, &Globals.bWinbindRefreshTickets)
 FN_GLOBAL_BOOL(lp_winbind_offline_logon, &Globals.bWinbindOfflineLogon)
+FN_GLOBAL_BOOL(lp_winbind_nss_cache, &Globals.bWinbindNssCache)
 FN_GLOBAL_BOOL(lp_winbind_normalize_names, &Globals.bWinbindNormalizeNames)
 FN_GLOBAL_BOOL(lp_winbind_rpc_only, &Globals.bWinbindRpcOnly)
 FN_GLOBAL_BOOL(lp_create_krb5_conf, &Globals.bCreateKrb5Conf)
@@ -5506,6 +5595,7 @@ FN_GLOBAL_BOOL(lp_nt_pipe_support, &Globals.bNTPipeSupport)
 FN_GLOBAL_BOOL(lp_nt_status_support, &Globals.bNTStatusSupport)
 FN_GLOBAL_BOOL(lp_stat_cache, &Globals.bStatCache)
 FN_GLOBAL_INTEGER(lp_max_stat_cache_size, &Globals.iMaxStatCacheSize)
+FN_GLOBAL_INTEGER(lp_dir_name_index_size, &Globals.iDirNameIndexSize)
 FN_GLOBAL_BOOL(lp_allow_trusted_domains, &Globals.bAllowTrustedDomains)
 FN_GLOBAL_BOOL(lp_map_untrusted_to_domain, &Globals.bMapUntrustedToDomain)
 FN_GLOBAL_INTEGER(lp_restrict_anonymous, &Globals.restrict_anonymous)
@@ -5550,6 +5640,8 @@ FN_GLOBAL_BOOL(lp_paranoid_server_security, &Globals.paranoid_server_security)
 FN_GLOBAL_INTEGER(lp_maxdisksize, &Globals.maxdisksize)
 FN_GLOBAL_INTEGER(lp_lpqcachetime, &Globals.lpqcachetime)
 FN_GLOBAL_INTEGER(lp_max_smbd_processes, &Globals.iMaxSmbdProcesses)
+FN_GLOBAL_INTEGER(lp_aio_max_threads, &Globals.iAioMaxThreads)
+FN_GLOBAL_INTEGER(lp_aio_signing_size, &Globals.iAioSigningSize)
 FN_GLOBAL_BOOL(_lp_disable_spoolss, &Globals.bDisableSpoolss)
 FN_GLOBAL_INTEGER(lp_syslog, &Globals.syslog)
 static FN_GLOBAL_INTEGER(lp_announce_as, &Globals.announce_as)
@@ -5713,6 +5805,9 @@ FN_LOCAL_INTEGER(lp_aio_read_size, iAioReadSize)
 FN_LOCAL_INTEGER(lp_aio_write_size, iAioWriteSize)
 FN_LOCAL_INTEGER(lp_map_readonly, iMap_readonly)
 FN_LOCAL_INTEGER(lp_directory_name_cache_size, iDirectoryNameCacheSize)
+FN_LOCAL_INTEGER(lp_negative_stat_cache_size, iNegativeStatCacheSize)
+FN_LOCAL_INTEGER(lp_directory_stat_prefetch, iDirectoryStatPrefetch)
+FN_LOCAL_INTEGER(lp_directory_listing_cache_size, iDirectoryListingCacheSize)
 FN_LOCAL_INTEGER(lp_smb_encrypt, ismb_encrypt)
 FN_LOCAL_CHAR(lp_magicchar, magic_char)
 FN_GLOBAL_INTEGER(lp_winbind_cache_time, &Globals.winbind_cache_time)
@@ -9856,6 +9951,23 @@ int lp_min_receive_file_size(void)
 	return MIN(Globals.iminreceivefile, BUFFER_SIZE);
 }
 
+/*******************************************************************
+ The number of children winbindd forks per domain. The children
+ don't share their offline state, so with offline logons only one
+ is used.
+********************************************************************/
+
+int lp_winbind_max_domain_connections(void)
+{
+	if (lp_winbind_offline_logon() &&
+	    Globals.winbind_max_domain_connections > 1) {
+		DEBUG(1, ("offline logons active, restricting max domain "
+			  "connections to 1\n"));
+		return 1;
+	}
+	return MAX(1, Globals.winbind_max_domain_connections);
+}
+
 /*******************************************************************
  If socket address is an empty character string, it is necessary to 
  define it as "0.0.0.0". 
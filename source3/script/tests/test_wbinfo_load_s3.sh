@@ -0,0 +1,79 @@
+#!/bin/sh
+
+# Load test for winbindd: many concurrent sid2uid and getpwnam calls for
+# one domain. With "winbind max domain connections" > 1 they are spread
+# over several domain children instead of queueing behind each other.
+
+if [ $# -lt 4 ]; then
+cat <<EOF
+Usage: test_wbinfo_load_s3.sh DOMAIN USERNAME CLIENTS ROUNDS <wbinfo args>
+EOF
+exit 1;
+fi
+
+domain="$1"
+username="$2"
+clients="$3"
+rounds="$4"
+shift 4
+ADDARGS="$*"
+
+WBINFO="$VALGRIND ${WBINFO:-$BINDIR/wbinfo} $ADDARGS"
+
+test x"$TEST_FUNCTIONS_SH" != x"INCLUDED" && {
+incdir=`dirname $0`
+. $incdir/test_functions.sh
+}
+
+failed=0
+
+# Run "rounds" times the given wbinfo call in each of "clients"
+# concurrent loops, fail if any single call failed
+wbinfo_load()
+{
+    tmpdir=/tmp/wbinfo_load.$$
+    mkdir -p $tmpdir || return 1
+
+    start=`date +%s`
+
+    i=0
+    while [ $i -lt $clients ]; do
+	(
+	    j=0
+	    while [ $j -lt $rounds ]; do
+		$WBINFO "$@" >/dev/null 2>&1 || echo "$j" >> $tmpdir/failed.$i
+		j=`expr $j + 1`
+	    done
+	) &
+	i=`expr $i + 1`
+    done
+    wait
+
+    end=`date +%s`
+    echo "$clients x $rounds calls of wbinfo $@ took `expr $end - $start` seconds"
+
+    if [ -n "`ls $tmpdir`" ]; then
+	echo "`cat $tmpdir/failed.* | wc -l` calls failed"
+	rm -rf $tmpdir
+	false
+	return
+    fi
+
+    rm -rf $tmpdir
+    true
+}
+
+user_sid=`$WBINFO --name-to-sid="$domain\\$username" | cut -d " " -f1`
+
+testit "lookup sid of $domain\\$username" test -n "$user_sid" || \
+    failed=`expr $failed + 1`
+
+testit "concurrent sid2uid" \
+    wbinfo_load --sid-to-uid="$user_sid" || \
+    failed=`expr $failed + 1`
+
+testit "concurrent getpwnam" \
+    wbinfo_load --user-info="$domain\\$username" || \
+    failed=`expr $failed + 1`
+
+testok $0 $failed
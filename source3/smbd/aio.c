@@ -185,6 +185,7 @@ bool schedule_aio_read_and_X(connection_struct *conn,
 	}
 
 	outstanding_aio_calls++;
+	SMB_PERFCOUNT_DEFER_OP(&req->pcd, &req->pcd);
 	aio_ex->req = talloc_move(aio_ex, &req);
 
 	DEBUG(10,("schedule_aio_read_and_X: scheduled aio_read for file %s, "
@@ -280,6 +281,7 @@ bool schedule_aio_write_and_X(connection_struct *conn,
 	}
 
 	outstanding_aio_calls++;
+	SMB_PERFCOUNT_DEFER_OP(&req->pcd, &req->pcd);
 	aio_ex->req = talloc_move(aio_ex, &req);
 
 	/* This should actually be improved to span the write. */
@@ -728,3 +730,420 @@ int wait_for_aio_completion(files_struct *fsp)
 void smbd_aio_complete_mid(unsigned int mid);
 
 #endif
+
+#if WITH_PTHREADPOOL
+
+/****************************************************************************
+ Threaded pread/pwrite for SMB2. The VFS is not thread safe, so everything
+ except the actual pread/pwrite on the file descriptor is done in the main
+ thread. That pread/pwrite bypasses SMB_VFS_PREAD/SMB_VFS_PWRITE, so we only
+ do it on shares without vfs modules. A file with jobs in flight must not be
+ closed before they are done, see smbd_aio_wait_for_threads().
+*****************************************************************************/
+
+struct smbd_aio_job {
+	struct smbd_aio_job *prev, *next;
+	bool in_flight;
+	files_struct *fsp;
+	int fd;
+	uint8_t *buf;
+	size_t n;
+	SMB_OFF_T offset;
+	ssize_t ret;
+	int err;
+};
+
+struct smbd_aio_state {
+	struct smbd_aio_job *job;
+};
+
+/****************************************************************************
+ The helper thread pool, created on first use.
+*****************************************************************************/
+
+struct fncall_context *smbd_aio_fncall_context(void)
+{
+	if (aio_fncall_ctx == NULL) {
+		aio_fncall_ctx = fncall_context_init(NULL,
+						     lp_aio_max_threads());
+	}
+	return aio_fncall_ctx;
+}
+
+/* All jobs a helper thread might still work on */
+static struct smbd_aio_job *smbd_aio_jobs;
+
+static void smbd_aio_job_finished(struct smbd_aio_job *job)
+{
+	if (!job->in_flight) {
+		return;
+	}
+	job->in_flight = false;
+	job->fsp->num_aio_requests -= 1;
+	DLIST_REMOVE(smbd_aio_jobs, job);
+}
+
+static int smbd_aio_job_destructor(struct smbd_aio_job *job)
+{
+	smbd_aio_job_finished(job);
+	return 0;
+}
+
+static bool smbd_aio_pthread_possible(files_struct *fsp)
+{
+	connection_struct *conn = fsp->conn;
+	const char **vfs_objects;
+
+	if (lp_aio_max_threads() <= 0) {
+		return false;
+	}
+	vfs_objects = lp_vfs_objects(SNUM(conn));
+	if ((vfs_objects != NULL) && (vfs_objects[0] != NULL)) {
+		/* Modules might want to see the pread/pwrite */
+		return false;
+	}
+	if (fsp->base_fsp != NULL) {
+		/* No threaded I/O on streams yet */
+		return false;
+	}
+	if (fsp->print_file || fsp->is_directory || fsp->fh->fd == -1) {
+		return false;
+	}
+	if ((fsp->wcp != NULL) || (lp_write_cache_size(SNUM(conn)) != 0)) {
+		return false;
+	}
+	return true;
+}
+
+/****************************************************************************
+ Should a read of n bytes be done in a helper thread ?
+*****************************************************************************/
+
+bool smbd_aio_pthread_read_possible(files_struct *fsp, size_t n)
+{
+	size_t min_aio_read_size = lp_aio_read_size(SNUM(fsp->conn));
+
+	if (!min_aio_read_size || (n < min_aio_read_size)) {
+		return false;
+	}
+	return smbd_aio_pthread_possible(fsp);
+}
+
+/****************************************************************************
+ Should a write of n bytes be done in a helper thread ?
+*****************************************************************************/
+
+bool smbd_aio_pthread_write_possible(files_struct *fsp, size_t n)
+{
+	size_t min_aio_write_size = lp_aio_write_size(SNUM(fsp->conn));
+
+	if (!min_aio_write_size || (n < min_aio_write_size)) {
+		return false;
+	}
+	if (lp_strict_allocate(SNUM(fsp->conn))) {
+		/* vfs_fill_sparse() is not for helper threads */
+		return false;
+	}
+	return smbd_aio_pthread_possible(fsp);
+}
+
+static void smbd_aio_pread_do(void *private_data);
+static void smbd_aio_pwrite_do(void *private_data);
+static void smbd_aio_done(struct tevent_req *subreq);
+
+static struct tevent_req *smbd_aio_send(TALLOC_CTX *mem_ctx,
+					struct tevent_context *ev,
+					files_struct *fsp,
+					const void *buf_owner,
+					uint8_t *buf, size_t n,
+					SMB_OFF_T offset,
+					void (*fn)(void *private_data))
+{
+	struct tevent_req *req, *subreq;
+	struct smbd_aio_state *state;
+	struct fncall_context *ctx;
+	struct smbd_aio_job *job;
+
+	req = tevent_req_create(mem_ctx, &state, struct smbd_aio_state);
+	if (req == NULL) {
+		return NULL;
+	}
+
+	ctx = smbd_aio_fncall_context();
+	if (tevent_req_nomem(ctx, req)) {
+		return tevent_req_post(req, ev);
+	}
+
+	job = talloc_zero(state, struct smbd_aio_job);
+	if (tevent_req_nomem(job, req)) {
+		return tevent_req_post(req, ev);
+	}
+	job->fsp = fsp;
+	job->fd = fsp->fh->fd;
+	job->buf = buf;
+	job->n = n;
+	job->offset = offset;
+	job->ret = -1;
+
+	/* The helper thread might outlive the caller's buffer */
+	if (buf_owner == NULL) {
+		talloc_steal(job, buf);
+	} else if (tevent_req_nomem(talloc_reference(job, buf_owner), req)) {
+		return tevent_req_post(req, ev);
+	}
+
+	job->in_flight = true;
+	fsp->num_aio_requests += 1;
+	DLIST_ADD(smbd_aio_jobs, job);
+	talloc_set_destructor(job, smbd_aio_job_destructor);
+
+	/*
+	 * fncall_send moves the job away from us. If we go away before the
+	 * helper thread is done, fncall keeps the job until it is.
+	 */
+	state->job = job;
+
+	subreq = fncall_send(state, ev, ctx, fn, job);
+	if (tevent_req_nomem(subreq, req)) {
+		return tevent_req_post(req, ev);
+	}
+	tevent_req_set_callback(subreq, smbd_aio_done, req);
+	return req;
+}
+
+static void smbd_aio_pread_do(void *private_data)
+{
+	struct smbd_aio_job *job = (struct smbd_aio_job *)private_data;
+
+	job->ret = sys_pread(job->fd, job->buf, job->n, job->offset);
+	job->err = (job->ret == -1) ? errno : 0;
+}
+
+static void smbd_aio_pwrite_do(void *private_data)
+{
+	struct smbd_aio_job *job = (struct smbd_aio_job *)private_data;
+	size_t total = 0;
+
+	while (total < job->n) {
+		ssize_t ret;
+
+		ret = sys_pwrite(job->fd, job->buf + total, job->n - total,
+				 job->offset + total);
+		if (ret == -1) {
+			job->ret = -1;
+			job->err = errno;
+			return;
+		}
+		if (ret == 0) {
+			break;
+		}
+		total += ret;
+	}
+	job->ret = total;
+	job->err = 0;
+}
+
+static void smbd_aio_done(struct tevent_req *subreq)
+{
+	struct tevent_req *req = tevent_req_callback_data(
+		subreq, struct tevent_req);
+	struct smbd_aio_state *state = tevent_req_data(
+		req, struct smbd_aio_state);
+	int ret, err;
+
+	ret = fncall_recv(subreq, &err);
+	TALLOC_FREE(subreq);
+	if (ret == -1) {
+		/* The job went away with subreq */
+		state->job = NULL;
+		tevent_req_error(req, err);
+		return;
+	}
+	smbd_aio_job_finished(state->job);
+	tevent_req_done(req);
+}
+
+/****************************************************************************
+ Read n bytes at offset into buf in a helper thread. buf must be a talloc
+ pointer, it is owned by the request until smbd_aio_pread_recv() hands it
+ back to mem_ctx.
+*****************************************************************************/
+
+struct tevent_req *smbd_aio_pread_send(TALLOC_CTX *mem_ctx,
+				       struct tevent_context *ev,
+				       files_struct *fsp,
+				       uint8_t *buf, size_t n,
+				       SMB_OFF_T offset)
+{
+	return smbd_aio_send(mem_ctx, ev, fsp, NULL, buf, n, offset,
+			     smbd_aio_pread_do);
+}
+
+ssize_t smbd_aio_pread_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
+			    int *perr)
+{
+	struct smbd_aio_state *state = tevent_req_data(
+		req, struct smbd_aio_state);
+	struct smbd_aio_job *job = state->job;
+
+	if (job != NULL) {
+		talloc_steal(mem_ctx, job->buf);
+	}
+	if (tevent_req_is_unix_error(req, perr)) {
+		return -1;
+	}
+	if (job->ret == -1) {
+		*perr = job->err;
+		return -1;
+	}
+
+	/* Same bookkeeping as read_file() */
+	job->fsp->fh->pos = job->offset + job->ret;
+	job->fsp->fh->position_information = job->fsp->fh->pos;
+
+	return job->ret;
+}
+
+/****************************************************************************
+ Write n bytes from data at offset in a helper thread. data must be part
+ of the talloc object data_owner. The job might outlive the caller, so it
+ keeps data_owner around with a talloc reference. The caller must have
+ called prepare_async_write() on fsp.
+*****************************************************************************/
+
+struct tevent_req *smbd_aio_pwrite_send(TALLOC_CTX *mem_ctx,
+					struct tevent_context *ev,
+					files_struct *fsp,
+					const void *data_owner,
+					const uint8_t *data, size_t n,
+					SMB_OFF_T offset)
+{
+	return smbd_aio_send(mem_ctx, ev, fsp, data_owner,
+			     discard_const_p(uint8_t, data), n, offset,
+			     smbd_aio_pwrite_do);
+}
+
+ssize_t smbd_aio_pwrite_recv(struct tevent_req *req, int *perr)
+{
+	struct smbd_aio_state *state = tevent_req_data(
+		req, struct smbd_aio_state);
+	struct smbd_aio_job *job = state->job;
+
+	if (tevent_req_is_unix_error(req, perr)) {
+		return -1;
+	}
+	if (job->ret == -1) {
+		*perr = job->err;
+		return -1;
+	}
+
+	/* Same bookkeeping as real_write_file() */
+	job->fsp->fh->pos = job->offset + job->ret;
+
+	return job->ret;
+}
+
+/****************************************************************************
+ Wait for all helper thread jobs on fsp. Called before the fd is closed,
+ the completion callbacks of fsp's jobs run from in here. Jobs of other
+ files are left to the main event loop.
+*****************************************************************************/
+
+void smbd_aio_wait_for_threads(files_struct *fsp)
+{
+	while (fsp->num_aio_requests > 0) {
+		struct smbd_aio_job *job;
+
+		for (job = smbd_aio_jobs; job != NULL; job = job->next) {
+			if (job->fsp == fsp) {
+				break;
+			}
+		}
+		if (job == NULL) {
+			/*
+			 * We can't tell whether a helper thread still uses
+			 * the fd, closing it is not safe.
+			 */
+			DEBUG(0, ("smbd_aio_wait_for_threads: %d jobs "
+				  "counted but none found on %s\n",
+				  fsp->num_aio_requests, fsp_str_dbg(fsp)));
+			smb_panic("smbd_aio_wait_for_threads: lost a job");
+		}
+
+		DEBUG(10, ("smbd_aio_wait_for_threads: %d jobs outstanding "
+			   "on %s\n", fsp->num_aio_requests,
+			   fsp_str_dbg(fsp)));
+
+		if (fncall_wait_job(aio_fncall_ctx, job) == -1) {
+			if ((errno == EINTR) || (errno == EAGAIN)) {
+				continue;
+			}
+			DEBUG(0, ("smbd_aio_wait_for_threads: fncall_wait_job "
+				  "failed: %s\n", strerror(errno)));
+			smb_panic("smbd_aio_wait_for_threads: can't wait for "
+				  "helper threads");
+		}
+
+		/*
+		 * An orphaned job is gone now. A job whose request is
+		 * still around has been counted off in smbd_aio_done().
+		 */
+	}
+}
+
+#else /* WITH_PTHREADPOOL */
+
+struct fncall_context *smbd_aio_fncall_context(void)
+{
+	return NULL;
+}
+
+bool smbd_aio_pthread_read_possible(files_struct *fsp, size_t n)
+{
+	return false;
+}
+
+bool smbd_aio_pthread_write_possible(files_struct *fsp, size_t n)
+{
+	return false;
+}
+
+struct tevent_req *smbd_aio_pread_send(TALLOC_CTX *mem_ctx,
+				       struct tevent_context *ev,
+				       files_struct *fsp,
+				       uint8_t *buf, size_t n,
+				       SMB_OFF_T offset)
+{
+	errno = ENOSYS;
+	return NULL;
+}
+
+ssize_t smbd_aio_pread_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
+			    int *perr)
+{
+	*perr = ENOSYS;
+	return -1;
+}
+
+struct tevent_req *smbd_aio_pwrite_send(TALLOC_CTX *mem_ctx,
+					struct tevent_context *ev,
+					files_struct *fsp,
+					const void *data_owner,
+					const uint8_t *data, size_t n,
+					SMB_OFF_T offset)
+{
+	errno = ENOSYS;
+	return NULL;
+}
+
+ssize_t smbd_aio_pwrite_recv(struct tevent_req *req, int *perr)
+{
+	*perr = ENOSYS;
+	return -1;
+}
+
+void smbd_aio_wait_for_threads(files_struct *fsp)
+{
+}
+
+#endif /* WITH_PTHREADPOOL */
@@ -594,6 +594,11 @@ static NTSTATUS close_normal_file(struct smb_request *req, files_struct *fsp,
 	} else {
 		cancel_aio_by_fsp(fsp);
 	}
+
+	/*
+	 * Reads and writes in helper threads use our fd, wait for them.
+	 */
+	smbd_aio_wait_for_threads(fsp);
  
 	/*
 	 * If we're flushing on a close we can get a write
@@ -650,6 +655,14 @@ static NTSTATUS close_normal_file(struct smb_request *req, files_struct *fsp,
 
 	status = ntstatus_keeperror(status, tmp);
 
+	/*
+	 * Size and timestamps in a cached listing of the parent directory
+	 * are out of date now.
+	 */
+	if (fsp->modified) {
+		dir_listing_cache_delete_parent(conn, fsp->fsp_name->base_name);
+	}
+
 	DEBUG(2,("%s closed file %s (numopen=%d) %s\n",
 		conn->server_info->unix_name, fsp_str_dbg(fsp),
 		conn->num_files_open - 1,
@@ -37,6 +37,9 @@ struct name_cache_entry {
 	long offset;
 };
 
+struct dir_listing;
+struct dir_prefetch;
+
 struct smb_Dir {
 	connection_struct *conn;
 	SMB_STRUCT_DIR *dir;
@@ -46,6 +49,8 @@ struct smb_Dir {
 	struct name_cache_entry *name_cache;
 	unsigned int name_cache_index;
 	unsigned int file_number;
+	struct dir_listing *listing;
+	struct dir_prefetch *prefetch;
 };
 
 struct dptr_struct {
@@ -60,11 +65,15 @@ struct dptr_struct {
 	char *path;
 	bool has_wild; /* Set to true if the wcard entry has MS wildcard characters in it. */
 	bool did_stat; /* Optimisation for non-wcard searches. */
+	struct ms_fnmatch_compiled *matcher; /* Last mask used in this search. */
 };
 
 
 #define INVALID_DPTR_KEY (-3)
 
+static void dptr_set_listing_cache(struct dptr_struct *dptr);
+static void dptr_set_stat_prefetch(struct dptr_struct *dptr);
+
 /****************************************************************************
  Make a dir struct.
 ****************************************************************************/
@@ -195,6 +204,8 @@ static struct dptr_struct *dptr_get(struct smbd_server_connection *sconn,
 						strerror(errno)));
 					return False;
 				}
+				dptr_set_listing_cache(dptr);
+				dptr_set_stat_prefetch(dptr);
 			}
 			DLIST_PROMOTE(sconn->smb1.searches.dirptrs,dptr);
 			return dptr;
@@ -269,6 +280,7 @@ static void dptr_close_internal(struct dptr_struct *dptr)
 
 done:
 	TALLOC_FREE(dptr->dir_hnd);
+	TALLOC_FREE(dptr->matcher);
 
 	/* Lanman 2 specific code */
 	SAFE_FREE(dptr->wcard);
@@ -538,6 +550,9 @@ NTSTATUS dptr_create(connection_struct *conn, const char *path, bool old_handle,
 
 	dptr->attr = attr;
 
+	dptr_set_listing_cache(dptr);
+	dptr_set_stat_prefetch(dptr);
+
 	DLIST_ADD(sconn->smb1.searches.dirptrs, dptr);
 
 	DEBUG(3,("creating new dirptr %d for path %s, expect_close = %d\n",
@@ -558,6 +573,7 @@ int dptr_CloseDir(struct dptr_struct *dptr)
 	struct smbd_server_connection *sconn = dptr->conn->sconn;
 	DLIST_REMOVE(sconn->smb1.searches.dirptrs, dptr);
 	TALLOC_FREE(dptr->dir_hnd);
+	TALLOC_FREE(dptr->matcher);
 	return 0;
 }
 
@@ -576,6 +592,36 @@ bool dptr_has_wild(struct dptr_struct *dptr)
 	return dptr->has_wild;
 }
 
+/****************************************************************************
+ mask_match() for all entries of a search. The mask is only parsed once
+ and then kept with the dptr.
+****************************************************************************/
+
+bool dptr_mask_match(struct dptr_struct *dptr, const char *string,
+		     const char *mask, bool translate_pattern,
+		     bool is_case_sensitive)
+{
+	if (ISDOT(mask)) {
+		return false;
+	}
+
+	if ((dptr->matcher == NULL) ||
+	    !ms_fnmatch_compiled_for(dptr->matcher, mask, translate_pattern,
+				     is_case_sensitive)) {
+		/* dptr is malloced, it is freed with the dptr. */
+		TALLOC_FREE(dptr->matcher);
+		dptr->matcher = ms_fnmatch_compile(NULL, mask,
+						   translate_pattern,
+						   is_case_sensitive);
+		if (dptr->matcher == NULL) {
+			return ms_fnmatch(mask, string, translate_pattern,
+					  is_case_sensitive) == 0;
+		}
+	}
+
+	return ms_fnmatch_compiled(dptr->matcher, string) == 0;
+}
+
 int dptr_dnum(struct dptr_struct *dptr)
 {
 	return dptr->dnum;
@@ -861,16 +907,16 @@ bool dir_check_ftype(connection_struct *conn, uint32 mode, uint32 dirtype)
 	return True;
 }
 
-static bool mangle_mask_match(connection_struct *conn,
+static bool mangle_mask_match(struct dptr_struct *dptr,
 		const char *filename,
 		const char *mask)
 {
 	char mname[13];
 
-	if (!name_to_8_3(filename,mname,False,conn->params)) {
+	if (!name_to_8_3(filename,mname,False,dptr->conn->params)) {
 		return False;
 	}
-	return mask_match_search(mname,mask,False);
+	return dptr_mask_match(dptr, mname, mask, true, false);
 }
 
 bool smbd_dirptr_get_entry(TALLOC_CTX *ctx,
@@ -1023,11 +1069,12 @@ static bool smbd_dirptr_8_3_match_fn(TALLOC_CTX *ctx,
 				     const char *mask,
 				     char **_fname)
 {
-	connection_struct *conn = (connection_struct *)private_data;
+	struct dptr_struct *dptr = (struct dptr_struct *)private_data;
+	connection_struct *conn = dptr->conn;
 
 	if ((strcmp(mask,"*.*") == 0) ||
-	    mask_match_search(dname, mask, false) ||
-	    mangle_mask_match(conn, dname, mask)) {
+	    dptr_mask_match(dptr, dname, mask, true, false) ||
+	    mangle_mask_match(dptr, dname, mask)) {
 		char mname[13];
 		const char *fname;
 
@@ -1058,7 +1105,8 @@ static bool smbd_dirptr_8_3_mode_fn(TALLOC_CTX *ctx,
 				    struct smb_filename *smb_fname,
 				    uint32_t *_mode)
 {
-	connection_struct *conn = (connection_struct *)private_data;
+	struct dptr_struct *dptr = (struct dptr_struct *)private_data;
+	connection_struct *conn = dptr->conn;
 
 	if (!VALID_STAT(smb_fname->st)) {
 		if ((SMB_VFS_STAT(conn, smb_fname)) != 0) {
@@ -1101,7 +1149,7 @@ bool get_dir_entry(TALLOC_CTX *ctx,
 				   ask_sharemode,
 				   smbd_dirptr_8_3_match_fn,
 				   smbd_dirptr_8_3_mode_fn,
-				   conn,
+				   dirptr,
 				   &fname,
 				   &smb_fname,
 				   &mode,
@@ -1280,6 +1328,971 @@ bool is_visible_file(connection_struct *conn, const char *dir_path,
 	return ret;
 }
 
+/*******************************************************************
+ Directory listing cache.
+
+ When a share has "directory listing cache size" set, a search for "*"
+ that reads a directory from start to end records every name together
+ with its telldir offset and its stat information. If the directory did
+ not change while we read it, the listing is stored in
+ dirlisting.tdb, keyed by the file_id of the directory. Later wildcard
+ searches in any smbd find it there as long as the directory's mtime
+ and ctime are unchanged, and hand out names and stat information
+ without touching the directory at all.
+
+ Creates, deletes and renames change the directory's timestamps. For
+ changes to the files in the directory notify_fname() and closing a
+ modified file delete the directory's record, if there is one. Before
+ recording, a search makes sure a record exists, storing an empty one
+ with a random generation if necessary. The listing is only stored if
+ the record still carries that generation when we are done, so any
+ invalidation in between makes it refuse to store itself.
+
+ The sizes of all records are summed up under DIR_LISTING_BYTES_KEY.
+ When storing a listing would take the sum beyond
+ DIR_LISTING_CACHE_MAX_BYTES, all records are thrown away.
+
+ The offsets are the real telldir offsets, so a search can seek between
+ a cached and an uncached handle of the same directory.
+********************************************************************/
+
+#define DIR_LISTING_BYTES_KEY "DIR_LISTING_BYTES"
+#define DIR_LISTING_CACHE_MAX_BYTES (64*1024*1024)
+
+struct dir_listing_hdr {
+	uint64_t generation;
+	uint32_t num_entries;
+	uint32_t names_len;
+	struct timespec mtime;
+	struct timespec ctime;
+};
+
+struct dir_listing_entry {
+	long offset;
+	SMB_STRUCT_STAT st;
+};
+
+struct dir_listing {
+	struct file_id id;
+	struct timespec mtime;
+	struct timespec ctime;
+	struct timespec open_time;
+	bool recording;
+	uint64_t generation;
+	unsigned int max_entries;
+	unsigned int num_entries;
+	unsigned int next;
+	struct dir_listing_entry *entries;
+	const char **names;
+};
+
+static struct db_context *dir_listing_db_ctx;
+
+static struct db_context *dir_listing_db(void)
+{
+	if (dir_listing_db_ctx != NULL) {
+		return dir_listing_db_ctx;
+	}
+	dir_listing_db_ctx = db_open(NULL, lock_path("dirlisting.tdb"), 0,
+				     TDB_CLEAR_IF_FIRST|TDB_INCOMPATIBLE_HASH,
+				     O_RDWR|O_CREAT, 0644);
+	if (dir_listing_db_ctx == NULL) {
+		DEBUG(1, ("dir_listing_db: Could not open dirlisting.tdb: "
+			  "%s\n", strerror(errno)));
+	}
+	return dir_listing_db_ctx;
+}
+
+/*******************************************************************
+ Called by the parent smbd. dirlisting.tdb is opened with
+ TDB_CLEAR_IF_FIRST, keep it open so that it is not wiped every time
+ the last child using it exits. Don't create it if no share uses it.
+********************************************************************/
+
+void dir_listing_cache_init(void)
+{
+	int snum;
+
+	for (snum = 0; snum < lp_numservices(); snum++) {
+		if (lp_snum_ok(snum)
+		    && (lp_directory_listing_cache_size(snum) > 0)) {
+			dir_listing_db();
+			return;
+		}
+	}
+}
+
+static TDB_DATA dir_listing_key(const struct file_id *id)
+{
+	return make_tdb_data((const uint8_t *)id, sizeof(*id));
+}
+
+/*******************************************************************
+ Keep track of the bytes stored in dirlisting.tdb.
+********************************************************************/
+
+static void dir_listing_account(struct db_context *db, int32_t change)
+{
+	int32_t oldval = 0;
+	NTSTATUS status;
+
+	if (change == 0) {
+		return;
+	}
+	status = dbwrap_change_int32_atomic(db, DIR_LISTING_BYTES_KEY,
+					    &oldval, change);
+	if (!NT_STATUS_IS_OK(status)) {
+		DEBUG(5, ("dir_listing_account: %s\n", nt_errstr(status)));
+	}
+}
+
+static int dir_listing_wipe_fn(struct db_record *rec, void *private_data)
+{
+	rec->delete_rec(rec);
+	return 0;
+}
+
+/*******************************************************************
+ Make sure there is a record for the listing we are about to record
+ and remember its generation. Invalidation deletes the record, a new
+ one gets a new random generation.
+********************************************************************/
+
+static bool dir_listing_start_recording(struct db_context *db,
+					struct dir_listing *l,
+					TDB_DATA data)
+{
+	struct dir_listing_hdr hdr;
+	struct db_record *rec;
+	NTSTATUS status;
+
+	if (data.dsize >= sizeof(hdr)) {
+		memcpy(&hdr, data.dptr, sizeof(hdr));
+		l->generation = hdr.generation;
+		return true;
+	}
+
+	rec = db->fetch_locked(db, talloc_tos(), dir_listing_key(&l->id));
+	if (rec == NULL) {
+		return false;
+	}
+	if (rec->value.dsize >= sizeof(hdr)) {
+		/* someone else was faster */
+		memcpy(&hdr, rec->value.dptr, sizeof(hdr));
+		l->generation = hdr.generation;
+		TALLOC_FREE(rec);
+		return true;
+	}
+
+	ZERO_STRUCT(hdr);
+	generate_random_buffer((uint8_t *)&hdr.generation,
+			       sizeof(hdr.generation));
+	status = rec->store(rec, make_tdb_data((uint8_t *)&hdr, sizeof(hdr)),
+			    0);
+	TALLOC_FREE(rec);
+	if (!NT_STATUS_IS_OK(status)) {
+		DEBUG(5, ("dir_listing_start_recording: store failed: %s\n",
+			  nt_errstr(status)));
+		return false;
+	}
+	dir_listing_account(db, sizeof(hdr));
+	l->generation = hdr.generation;
+	return true;
+}
+
+static bool dir_listing_parse(struct dir_listing *l, TDB_DATA data,
+			      const char *servicename)
+{
+	struct dir_listing_hdr hdr;
+	const char *names, *p, *end;
+	size_t entries_len;
+	unsigned int i;
+
+	if (data.dsize < sizeof(hdr)) {
+		return false;
+	}
+	memcpy(&hdr, data.dptr, sizeof(hdr));
+
+	if ((timespec_compare(&hdr.mtime, &l->mtime) != 0) ||
+	    (timespec_compare(&hdr.ctime, &l->ctime) != 0)) {
+		return false;
+	}
+
+	if (hdr.num_entries > data.dsize / sizeof(struct dir_listing_entry)) {
+		return false;
+	}
+	entries_len = hdr.num_entries * sizeof(struct dir_listing_entry);
+	if ((hdr.names_len == 0) ||
+	    (sizeof(hdr) + entries_len + hdr.names_len != data.dsize)) {
+		return false;
+	}
+
+	names = (const char *)data.dptr + sizeof(hdr) + entries_len;
+	end = names + hdr.names_len;
+	if (end[-1] != '\0') {
+		return false;
+	}
+
+	/* The VFS modules of the share may change what stat returns. */
+	if (!strequal(names, servicename)) {
+		return false;
+	}
+
+	l->names = talloc_array(l, const char *, hdr.num_entries);
+	if (l->names == NULL) {
+		return false;
+	}
+	p = names + strlen(names) + 1;
+	for (i=0; i<hdr.num_entries; i++) {
+		if (p >= end) {
+			return false;
+		}
+		l->names[i] = p;
+		p += strlen(p) + 1;
+	}
+
+	l->entries = (struct dir_listing_entry *)(data.dptr + sizeof(hdr));
+	l->num_entries = hdr.num_entries;
+	return true;
+}
+
+static void dptr_set_listing_cache(struct dptr_struct *dptr)
+{
+	struct smb_Dir *dirp = dptr->dir_hnd;
+	connection_struct *conn = dptr->conn;
+	struct smb_filename smb_dname;
+	struct db_context *db;
+	struct dir_listing *l;
+	TDB_DATA data;
+	int max_entries;
+
+	max_entries = lp_directory_listing_cache_size(SNUM(conn));
+	if ((max_entries <= 0) || !dptr->has_wild || (dirp == NULL)
+	    || lp_posix_pathnames()) {
+		return;
+	}
+
+	db = dir_listing_db();
+	if (db == NULL) {
+		return;
+	}
+
+	l = talloc_zero(dirp, struct dir_listing);
+	if (l == NULL) {
+		return;
+	}
+	l->max_entries = max_entries;
+	l->open_time = timespec_current();
+
+	ZERO_STRUCT(smb_dname);
+	smb_dname.base_name = dirp->dir_path;
+	if (SMB_VFS_STAT(conn, &smb_dname) != 0) {
+		TALLOC_FREE(l);
+		return;
+	}
+	l->id = vfs_file_id_from_sbuf(conn, &smb_dname.st);
+	l->mtime = smb_dname.st.st_ex_mtime;
+	l->ctime = smb_dname.st.st_ex_ctime;
+
+	data = dbwrap_fetch(db, l, dir_listing_key(&l->id));
+	if ((data.dptr != NULL)
+	    && dir_listing_parse(l, data, lp_servicename(SNUM(conn)))) {
+		DEBUG(10, ("dptr_set_listing_cache: %s: using cached "
+			   "listing with %u entries\n", dirp->dir_path,
+			   l->num_entries));
+		dirp->listing = l;
+		return;
+	}
+	TALLOC_FREE(l->names);
+	l->num_entries = 0;
+
+	/*
+	 * Only record complete listings, a search for a specific
+	 * pattern skips the stat of all entries that don't match.
+	 */
+	if ((strcmp(dptr->wcard, "*") != 0)
+	    || !dir_listing_start_recording(db, l, data)) {
+		TALLOC_FREE(l);
+		return;
+	}
+	TALLOC_FREE(data.dptr);
+
+	DEBUG(10, ("dptr_set_listing_cache: %s: recording listing\n",
+		   dirp->dir_path));
+	l->recording = true;
+	dirp->listing = l;
+}
+
+static bool dir_listing_serving(struct smb_Dir *dirp)
+{
+	return ((dirp->listing != NULL) && !dirp->listing->recording);
+}
+
+/*******************************************************************
+ ReadDirName() for a directory with a cached listing.
+********************************************************************/
+
+static const char *dir_listing_next(struct smb_Dir *dirp, long *poffset,
+				    SMB_STRUCT_STAT *sbuf, char **ptalloced)
+{
+	struct dir_listing *l = dirp->listing;
+	const char *n;
+
+	*ptalloced = NULL;
+
+	if (l->next >= l->num_entries) {
+		*poffset = dirp->offset = END_OF_DIRECTORY_OFFSET;
+		return NULL;
+	}
+
+	n = l->names[l->next];
+	if (sbuf != NULL) {
+		*sbuf = l->entries[l->next].st;
+	}
+	*poffset = dirp->offset = l->entries[l->next].offset;
+	l->next += 1;
+	dirp->file_number++;
+	return n;
+}
+
+/*******************************************************************
+ Record a name read while recording a listing. We need the stat
+ information of every entry anyway, so do it here and hand it to our
+ caller.
+********************************************************************/
+
+static void dir_listing_add(struct smb_Dir *dirp, const char *name,
+			    SMB_STRUCT_STAT *sbuf)
+{
+	struct dir_listing *l = dirp->listing;
+	unsigned int num_alloc;
+
+	if ((l == NULL) || !l->recording) {
+		return;
+	}
+
+	if ((sbuf == NULL) || (l->num_entries >= l->max_entries)) {
+		DEBUG(10, ("dir_listing_add: %s: not recording\n",
+			   dirp->dir_path));
+		TALLOC_FREE(dirp->listing);
+		return;
+	}
+
+	if (!VALID_STAT(*sbuf)) {
+		struct smb_filename smb_fname;
+		size_t len = strlen(dirp->dir_path);
+		bool needslash = ((len == 0) || (dirp->dir_path[len-1] != '/'));
+
+		ZERO_STRUCT(smb_fname);
+		smb_fname.base_name = talloc_asprintf(
+			talloc_tos(), "%s%s%s", dirp->dir_path,
+			needslash ? "/" : "", name);
+		if (smb_fname.base_name == NULL) {
+			TALLOC_FREE(dirp->listing);
+			return;
+		}
+		if (SMB_VFS_STAT(dirp->conn, &smb_fname) == 0) {
+			*sbuf = smb_fname.st;
+		}
+		TALLOC_FREE(smb_fname.base_name);
+	}
+
+	num_alloc = talloc_array_length(l->entries);
+	if (l->num_entries == num_alloc) {
+		struct dir_listing_entry *entries;
+		const char **names;
+
+		num_alloc = MAX(num_alloc * 2, 64);
+
+		entries = TALLOC_REALLOC_ARRAY(l, l->entries,
+					       struct dir_listing_entry,
+					       num_alloc);
+		if (entries == NULL) {
+			TALLOC_FREE(dirp->listing);
+			return;
+		}
+		l->entries = entries;
+
+		names = TALLOC_REALLOC_ARRAY(l, l->names, const char *,
+					     num_alloc);
+		if (names == NULL) {
+			TALLOC_FREE(dirp->listing);
+			return;
+		}
+		l->names = names;
+	}
+
+	l->names[l->num_entries] = talloc_strdup(l->names, name);
+	if (l->names[l->num_entries] == NULL) {
+		TALLOC_FREE(dirp->listing);
+		return;
+	}
+	l->entries[l->num_entries].offset = dirp->offset;
+	l->entries[l->num_entries].st = *sbuf;
+	l->num_entries += 1;
+}
+
+/*******************************************************************
+ We have read to the end of the directory. Store what we recorded if
+ nothing changed in between.
+********************************************************************/
+
+static void dir_listing_done(struct smb_Dir *dirp)
+{
+	struct dir_listing *l = dirp->listing;
+	const char *servicename;
+	struct smb_filename smb_dname;
+	struct dir_listing_hdr hdr;
+	struct db_context *db;
+	struct db_record *rec;
+	struct timespec racy;
+	size_t entries_len, names_len, servicename_len;
+	uint8_t *buf, *p;
+	unsigned int i;
+	int32_t stored;
+	NTSTATUS status;
+
+	if ((l == NULL) || !l->recording) {
+		return;
+	}
+
+	db = dir_listing_db();
+	if (db == NULL) {
+		goto done;
+	}
+
+	ZERO_STRUCT(smb_dname);
+	smb_dname.base_name = dirp->dir_path;
+	if ((SMB_VFS_STAT(dirp->conn, &smb_dname) != 0)
+	    || (timespec_compare(&smb_dname.st.st_ex_mtime, &l->mtime) != 0)
+	    || (timespec_compare(&smb_dname.st.st_ex_ctime, &l->ctime) != 0)) {
+		DEBUG(10, ("dir_listing_done: %s changed\n", dirp->dir_path));
+		goto done;
+	}
+
+	/*
+	 * On file systems with coarse timestamps a change racing with our
+	 * readdir might not be visible in mtime.
+	 */
+	racy = l->open_time;
+	racy.tv_sec -= 2;
+	if ((timespec_compare(&l->mtime, &racy) >= 0) ||
+	    (timespec_compare(&l->ctime, &racy) >= 0)) {
+		DEBUG(10, ("dir_listing_done: %s changed recently\n",
+			   dirp->dir_path));
+		goto done;
+	}
+
+	servicename = lp_servicename(SNUM(dirp->conn));
+	servicename_len = strlen(servicename) + 1;
+
+	entries_len = l->num_entries * sizeof(struct dir_listing_entry);
+	names_len = servicename_len;
+	for (i=0; i<l->num_entries; i++) {
+		names_len += strlen(l->names[i]) + 1;
+	}
+
+	buf = TALLOC_ARRAY(talloc_tos(), uint8_t,
+			   sizeof(hdr) + entries_len + names_len);
+	if (buf == NULL) {
+		goto done;
+	}
+
+	/*
+	 * Throw everything away when we get too big. That deletes our
+	 * own empty record too, so the next search records again.
+	 */
+	stored = dbwrap_fetch_int32(db, DIR_LISTING_BYTES_KEY);
+	if ((stored >= 0) && ((size_t)stored + talloc_get_size(buf)
+			      > DIR_LISTING_CACHE_MAX_BYTES)) {
+		DEBUG(5, ("dir_listing_done: %d bytes cached, wiping "
+			  "dirlisting.tdb\n", (int)stored));
+		db->traverse(db, dir_listing_wipe_fn, NULL);
+		TALLOC_FREE(buf);
+		goto done;
+	}
+
+	ZERO_STRUCT(hdr);
+	hdr.generation = l->generation;
+	hdr.num_entries = l->num_entries;
+	hdr.names_len = names_len;
+	hdr.mtime = l->mtime;
+	hdr.ctime = l->ctime;
+
+	memcpy(buf, &hdr, sizeof(hdr));
+	p = buf + sizeof(hdr);
+	memcpy(p, l->entries, entries_len);
+	p += entries_len;
+	memcpy(p, servicename, servicename_len);
+	p += servicename_len;
+	for (i=0; i<l->num_entries; i++) {
+		size_t len = strlen(l->names[i]) + 1;
+		memcpy(p, l->names[i], len);
+		p += len;
+	}
+
+	rec = db->fetch_locked(db, talloc_tos(), dir_listing_key(&l->id));
+	if (rec == NULL) {
+		TALLOC_FREE(buf);
+		goto done;
+	}
+
+	/*
+	 * Someone invalidated the listing since we started, we can't know
+	 * whether our stat information is still current.
+	 */
+	if (rec->value.dsize >= sizeof(hdr)) {
+		memcpy(&hdr, rec->value.dptr, sizeof(hdr));
+	}
+	if ((rec->value.dsize < sizeof(hdr))
+	    || (hdr.generation != l->generation)) {
+		DEBUG(10, ("dir_listing_done: %s: invalidated\n",
+			   dirp->dir_path));
+		TALLOC_FREE(rec);
+		TALLOC_FREE(buf);
+		goto done;
+	}
+
+	status = rec->store(rec, make_tdb_data(buf, talloc_get_size(buf)), 0);
+	if (!NT_STATUS_IS_OK(status)) {
+		DEBUG(5, ("dir_listing_done: store failed: %s\n",
+			  nt_errstr(status)));
+	} else {
+		DEBUG(10, ("dir_listing_done: %s: stored %u entries\n",
+			   dirp->dir_path, l->num_entries));
+		dir_listing_account(db, (int32_t)talloc_get_size(buf)
+				    - (int32_t)rec->value.dsize);
+	}
+	TALLOC_FREE(rec);
+	TALLOC_FREE(buf);
+
+ done:
+	TALLOC_FREE(dirp->listing);
+}
+
+/*******************************************************************
+ Position a cached or recorded listing. Returns false if the offset is
+ not part of it.
+********************************************************************/
+
+static bool dir_listing_seek(struct smb_Dir *dirp, long offset)
+{
+	struct dir_listing *l = dirp->listing;
+	unsigned int i;
+
+	if (l == NULL) {
+		return true;
+	}
+
+	if ((offset == START_OF_DIRECTORY_OFFSET) ||
+	    (offset == DOT_DOT_DIRECTORY_OFFSET)) {
+		i = 0;
+	} else if (offset == END_OF_DIRECTORY_OFFSET) {
+		return true;
+	} else {
+		for (i=0; i<l->num_entries; i++) {
+			if (l->entries[i].offset == offset) {
+				break;
+			}
+		}
+		if (i == l->num_entries) {
+			return false;
+		}
+		i += 1;
+	}
+
+	if (l->recording) {
+		/* We'll read the rest again */
+		while (l->num_entries > i) {
+			l->num_entries -= 1;
+			talloc_free(discard_const_p(
+					    char, l->names[l->num_entries]));
+		}
+	} else {
+		l->next = i;
+	}
+	return true;
+}
+
+/*******************************************************************
+ Invalidate the cached listing of a directory.
+********************************************************************/
+
+static int dir_listing_exists_parser(TDB_DATA key, TDB_DATA data,
+				     void *private_data)
+{
+	return 0;
+}
+
+void dir_listing_cache_delete(connection_struct *conn,
+			      const struct file_id *id)
+{
+	struct db_context *db;
+	struct db_record *rec;
+	NTSTATUS status;
+
+	if (lp_directory_listing_cache_size(SNUM(conn)) <= 0) {
+		return;
+	}
+	db = dir_listing_db();
+	if (db == NULL) {
+		return;
+	}
+
+	/* Most directories are not cached, don't lock for them */
+	if (db->parse_record(db, dir_listing_key(id),
+			     dir_listing_exists_parser, NULL) != 0) {
+		return;
+	}
+
+	rec = db->fetch_locked(db, talloc_tos(), dir_listing_key(id));
+	if ((rec == NULL) || (rec->value.dptr == NULL)) {
+		TALLOC_FREE(rec);
+		return;
+	}
+	status = rec->delete_rec(rec);
+	if (!NT_STATUS_IS_OK(status)) {
+		DEBUG(5, ("dir_listing_cache_delete: delete failed: %s\n",
+			  nt_errstr(status)));
+	} else {
+		dir_listing_account(db, -(int32_t)rec->value.dsize);
+	}
+	TALLOC_FREE(rec);
+}
+
+void dir_listing_cache_delete_parent(connection_struct *conn,
+				     const char *path)
+{
+	struct smb_filename smb_dname;
+	const char *name;
+	char *parent;
+
+	if (lp_directory_listing_cache_size(SNUM(conn)) <= 0) {
+		return;
+	}
+	if (!parent_dirname(talloc_tos(), path, &parent, &name)) {
+		return;
+	}
+
+	ZERO_STRUCT(smb_dname);
+	smb_dname.base_name = parent;
+	if (SMB_VFS_STAT(conn, &smb_dname) == 0) {
+		struct file_id id = vfs_file_id_from_sbuf(conn,
+							  &smb_dname.st);
+		dir_listing_cache_delete(conn, &id);
+	}
+	TALLOC_FREE(parent);
+}
+
+#if WITH_PTHREADPOOL
+
+/*******************************************************************
+ Stat prefetch for wildcard searches. When "directory stat prefetch"
+ is set, ReadDirName() reads up to that many names ahead and hands an
+ absolute path for each of them to the helper threads, which stat them
+ in parallel. The names are handed out in directory order together
+ with the result of their stat, waiting for the helper thread if it is
+ not done yet. A failed stat is handed out as invalid, the caller then
+ stats itself.
+
+ The helper threads call sys_stat() like the default VFS does, so this
+ is only done on shares without "vfs objects".
+********************************************************************/
+
+struct dir_prefetch_job;
+
+struct dir_prefetch_entry {
+	char *name;
+	long offset;
+	SMB_STRUCT_STAT st;
+	struct dir_prefetch_job *job;
+};
+
+struct dir_prefetch {
+	const char *base_path;
+	struct dir_prefetch_entry *entries;
+	unsigned int num_entries;
+	unsigned int first;
+	unsigned int count;
+	bool eof;
+};
+
+struct dir_prefetch_job {
+	struct dir_prefetch_entry *e;
+	char *path;
+	bool fake_dir_create_times;
+	SMB_STRUCT_STAT st;
+	int ret;
+};
+
+static void dir_prefetch_stat_do(void *private_data)
+{
+	struct dir_prefetch_job *job = (struct dir_prefetch_job *)private_data;
+
+	job->ret = sys_stat(job->path, &job->st, job->fake_dir_create_times);
+}
+
+static void dir_prefetch_stat_done(struct tevent_req *subreq)
+{
+	struct dir_prefetch_job *job = tevent_req_callback_data(
+		subreq, struct dir_prefetch_job);
+	int ret, err;
+
+	ret = fncall_recv(subreq, &err);
+	TALLOC_FREE(subreq);
+
+	/* e is NULL if the entry was dropped meanwhile */
+	if (job->e != NULL) {
+		if ((ret == 0) && (job->ret == 0)) {
+			job->e->st = job->st;
+		}
+		job->e->job = NULL;
+	}
+	TALLOC_FREE(job);
+}
+
+static void dir_prefetch_stat_send(struct smb_Dir *dirp,
+				   struct dir_prefetch_entry *e)
+{
+	struct dir_prefetch *pf = dirp->prefetch;
+	struct dir_prefetch_job *job;
+	struct tevent_req *subreq;
+
+	job = talloc(pf, struct dir_prefetch_job);
+	if (job == NULL) {
+		return;
+	}
+	job->e = e;
+	job->fake_dir_create_times = lp_fake_dir_create_times(
+		SNUM(dirp->conn));
+	job->path = talloc_asprintf(job, "%s/%s", pf->base_path, e->name);
+	if (job->path == NULL) {
+		TALLOC_FREE(job);
+		return;
+	}
+
+	/*
+	 * fncall_send takes over the job until the helper thread is done
+	 * with it. If the directory is closed first, fncall keeps it
+	 * until then and frees it.
+	 */
+	subreq = fncall_send(pf, smbd_event_context(),
+			     smbd_aio_fncall_context(),
+			     dir_prefetch_stat_do, job);
+	if (subreq == NULL) {
+		TALLOC_FREE(job);
+		return;
+	}
+	tevent_req_set_callback(subreq, dir_prefetch_stat_done, job);
+	e->job = job;
+}
+
+/*******************************************************************
+ Forget about the stat job of an entry that is dropped.
+********************************************************************/
+
+static void dir_prefetch_entry_drop(struct dir_prefetch_entry *e)
+{
+	if (e->job != NULL) {
+		e->job->e = NULL;
+		e->job = NULL;
+	}
+	TALLOC_FREE(e->name);
+}
+
+/*******************************************************************
+ Read names into the look-ahead queue until it is full.
+********************************************************************/
+
+static void dir_prefetch_fill(struct smb_Dir *dirp)
+{
+	struct dir_prefetch *pf = dirp->prefetch;
+	connection_struct *conn = dirp->conn;
+	unsigned int submitted = 0;
+
+	if (pf->eof) {
+		return;
+	}
+
+	while (pf->count < pf->num_entries) {
+		struct dir_prefetch_entry *e;
+		char *talloced = NULL;
+		const char *n;
+
+		e = &pf->entries[(pf->first + pf->count) % pf->num_entries];
+
+		n = vfs_readdirname(conn, dirp->dir, &e->st, &talloced);
+		if (n == NULL) {
+			pf->eof = true;
+			break;
+		}
+		/* Ignore . and .. - ReadDirName has already returned them. */
+		if (*n == '.') {
+			if ((n[1] == '\0') || (n[1] == '.' && n[2] == '\0')) {
+				TALLOC_FREE(talloced);
+				continue;
+			}
+		}
+		if (talloced != NULL) {
+			e->name = talloc_move(pf, &talloced);
+		} else {
+			e->name = talloc_strdup(pf, n);
+		}
+		if (e->name == NULL) {
+			DEBUG(0, ("dir_prefetch_fill: talloc failed\n"));
+			pf->eof = true;
+			break;
+		}
+		e->offset = SMB_VFS_TELLDIR(conn, dirp->dir);
+		SET_STAT_INVALID(e->st);
+		e->job = NULL;
+		pf->count += 1;
+
+		dir_prefetch_stat_send(dirp, e);
+		submitted += 1;
+	}
+
+	DEBUG(10, ("dir_prefetch_fill: %s: submitted %u stat jobs, %u "
+		   "names queued%s\n", dirp->dir_path, submitted, pf->count,
+		   pf->eof ? ", end of directory" : ""));
+}
+
+/*******************************************************************
+ ReadDirName() for a directory with stat prefetch, hand out the next
+ queued name.
+********************************************************************/
+
+static const char *dir_prefetch_next(struct smb_Dir *dirp, long *poffset,
+				     SMB_STRUCT_STAT *sbuf, char **ptalloced)
+{
+	struct dir_prefetch *pf = dirp->prefetch;
+	struct dir_prefetch_entry *e;
+
+	if (pf->count <= pf->num_entries / 2) {
+		dir_prefetch_fill(dirp);
+	}
+
+	if (pf->count == 0) {
+		*poffset = dirp->offset = END_OF_DIRECTORY_OFFSET;
+		*ptalloced = NULL;
+		dir_listing_done(dirp);
+		return NULL;
+	}
+
+	e = &pf->entries[pf->first];
+	pf->first = (pf->first + 1) % pf->num_entries;
+	pf->count -= 1;
+
+	if ((e->job != NULL) &&
+	    (fncall_wait_job(smbd_aio_fncall_context(), e->job) == -1)) {
+		DEBUG(5, ("dir_prefetch_next: fncall_wait_job failed: %s\n",
+			  strerror(errno)));
+	}
+	if (e->job != NULL) {
+		/* Not done, the caller has to stat */
+		e->job->e = NULL;
+		e->job = NULL;
+	}
+
+	if (sbuf != NULL) {
+		*sbuf = e->st;
+	}
+	*poffset = dirp->offset = e->offset;
+	*ptalloced = talloc_move(talloc_tos(), &e->name);
+	dirp->file_number++;
+	dir_listing_add(dirp, *ptalloced, sbuf);
+	return *ptalloced;
+}
+
+/*******************************************************************
+ Drop the queued names. The caller must reposition the directory
+ stream, it is ahead of dirp->offset while names are queued.
+********************************************************************/
+
+static void dir_prefetch_reset(struct smb_Dir *dirp)
+{
+	struct dir_prefetch *pf = dirp->prefetch;
+
+	if (pf == NULL) {
+		return;
+	}
+	while (pf->count > 0) {
+		dir_prefetch_entry_drop(&pf->entries[pf->first]);
+		pf->first = (pf->first + 1) % pf->num_entries;
+		pf->count -= 1;
+	}
+	pf->first = 0;
+	pf->eof = false;
+}
+
+static void dptr_set_stat_prefetch(struct dptr_struct *dptr)
+{
+	struct smb_Dir *dirp = dptr->dir_hnd;
+	connection_struct *conn = dptr->conn;
+	const char **vfs_objects;
+	struct dir_prefetch *pf;
+	int num_entries;
+
+	num_entries = lp_directory_stat_prefetch(SNUM(conn));
+	if ((num_entries <= 0) || !dptr->has_wild || (dirp == NULL)
+	    || dir_listing_serving(dirp)) {
+		return;
+	}
+	vfs_objects = lp_vfs_objects(SNUM(conn));
+	if ((vfs_objects != NULL) && (vfs_objects[0] != NULL)) {
+		/* Modules might change what stat returns */
+		return;
+	}
+	if (smbd_aio_fncall_context() == NULL) {
+		return;
+	}
+
+	pf = talloc_zero(dirp, struct dir_prefetch);
+	if (pf == NULL) {
+		return;
+	}
+	pf->entries = talloc_zero_array(pf, struct dir_prefetch_entry,
+					num_entries);
+	if (pf->entries == NULL) {
+		TALLOC_FREE(pf);
+		return;
+	}
+	pf->num_entries = num_entries;
+
+	/*
+	 * The helper threads can't rely on our working directory, we
+	 * might chdir to another share while they run.
+	 */
+	if (dirp->dir_path[0] == '/') {
+		pf->base_path = dirp->dir_path;
+	} else if (ISDOT(dirp->dir_path)) {
+		pf->base_path = talloc_strdup(pf, conn->connectpath);
+	} else {
+		pf->base_path = talloc_asprintf(pf, "%s/%s", conn->connectpath,
+						dirp->dir_path);
+	}
+	if (pf->base_path == NULL) {
+		TALLOC_FREE(pf);
+		return;
+	}
+
+	dirp->prefetch = pf;
+}
+
+#else /* WITH_PTHREADPOOL */
+
+static void dir_prefetch_reset(struct smb_Dir *dirp)
+{
+	return;
+}
+
+static void dptr_set_stat_prefetch(struct dptr_struct *dptr)
+{
+	return;
+}
+
+#endif /* WITH_PTHREADPOOL */
+
 static int smb_Dir_destructor(struct smb_Dir *dirp)
 {
 	if (dirp->dir) {
@@ -1368,6 +2381,16 @@ const char *ReadDirName(struct smb_Dir *dirp, long *poffset,
 		SeekDir(dirp, *poffset);
 	}
 
+	if (dir_listing_serving(dirp)) {
+		return dir_listing_next(dirp, poffset, sbuf, ptalloced);
+	}
+
+#if WITH_PTHREADPOOL
+	if (dirp->prefetch != NULL) {
+		return dir_prefetch_next(dirp, poffset, sbuf, ptalloced);
+	}
+#endif
+
 	while ((n = vfs_readdirname(conn, dirp->dir, sbuf, &talloced))) {
 		/* Ignore . and .. - we've already returned them. */
 		if (*n == '.') {
@@ -1379,10 +2402,12 @@ const char *ReadDirName(struct smb_Dir *dirp, long *poffset,
 		*poffset = dirp->offset = SMB_VFS_TELLDIR(conn, dirp->dir);
 		*ptalloced = talloced;
 		dirp->file_number++;
+		dir_listing_add(dirp, n, sbuf);
 		return n;
 	}
 	*poffset = dirp->offset = END_OF_DIRECTORY_OFFSET;
 	*ptalloced = NULL;
+	dir_listing_done(dirp);
 	return NULL;
 }
 
@@ -1392,6 +2417,8 @@ const char *ReadDirName(struct smb_Dir *dirp, long *poffset,
 
 void RewindDir(struct smb_Dir *dirp, long *poffset)
 {
+	dir_listing_seek(dirp, START_OF_DIRECTORY_OFFSET);
+	dir_prefetch_reset(dirp);
 	SMB_VFS_REWINDDIR(dirp->conn, dirp->dir);
 	dirp->file_number = 0;
 	dirp->offset = START_OF_DIRECTORY_OFFSET;
@@ -1405,6 +2432,9 @@ void RewindDir(struct smb_Dir *dirp, long *poffset)
 void SeekDir(struct smb_Dir *dirp, long offset)
 {
 	if (offset != dirp->offset) {
+		if (!dir_listing_seek(dirp, offset)) {
+			TALLOC_FREE(dirp->listing);
+		}
 		if (offset == START_OF_DIRECTORY_OFFSET) {
 			RewindDir(dirp, &offset);
 			/*
@@ -1425,6 +2455,7 @@ void SeekDir(struct smb_Dir *dirp, long offset)
 		} else if (offset == END_OF_DIRECTORY_OFFSET) {
 			; /* Don't seek in this case. */
 		} else {
+			dir_prefetch_reset(dirp);
 			SMB_VFS_SEEKDIR(dirp->conn, dirp->dir, offset);
 		}
 		dirp->offset = offset;
@@ -1502,9 +2533,7 @@ bool SearchDir(struct smb_Dir *dirp, const char *name, long *poffset)
 	}
 
 	/* Not found in the name cache. Rewind directory and start from scratch. */
-	SMB_VFS_REWINDDIR(conn, dirp->dir);
-	dirp->file_number = 0;
-	*poffset = START_OF_DIRECTORY_OFFSET;
+	RewindDir(dirp, poffset);
 	while ((entry = ReadDirName(dirp, poffset, NULL, &talloced))) {
 		if (conn->case_sensitive ? (strcmp(entry, name) == 0) : strequal(entry, name)) {
 			TALLOC_FREE(talloced);
@@ -276,6 +276,66 @@ void trigger_write_time_update_immediate(struct files_struct *fsp)
 	(void)smb_set_file_time(fsp->conn, fsp, fsp->fsp_name, &ft, false);
 }
 
+/****************************************************************************
+ First write to a file: trigger the write time update, set the archive bit
+ and, if allowed and we have an exclusive oplock, set up the write cache.
+****************************************************************************/
+
+static void mark_file_modified(files_struct *fsp, bool allow_write_cache)
+{
+	int dosmode;
+
+	fsp->modified = True;
+
+	if (SMB_VFS_FSTAT(fsp, &fsp->fsp_name->st) != 0) {
+		return;
+	}
+
+	trigger_write_time_update(fsp);
+	dosmode = dos_mode(fsp->conn, fsp->fsp_name);
+	if ((lp_store_dos_attributes(SNUM(fsp->conn)) ||
+			MAP_ARCHIVE(fsp->conn)) &&
+			!IS_DOS_ARCHIVE(dosmode)) {
+		file_set_dosmode(fsp->conn, fsp->fsp_name,
+				 dosmode | aARCH, NULL, false);
+	}
+
+	/*
+	 * If this is the first write and we have an exclusive oplock then setup
+	 * the write cache.
+	 */
+
+	if (allow_write_cache && EXCLUSIVE_OPLOCK_TYPE(fsp->oplock_type) &&
+	    !fsp->wcp) {
+		setup_write_cache(fsp, fsp->fsp_name->st.st_ex_size);
+	}
+}
+
+/****************************************************************************
+ Do what write_file() does before the data goes to disk, for callers that
+ pwrite the data in a helper thread. Never sets up a write cache.
+****************************************************************************/
+
+bool prepare_async_write(files_struct *fsp)
+{
+	if (fsp->print_file || !fsp->can_write) {
+		errno = EPERM;
+		return false;
+	}
+
+	if (!fsp->modified) {
+		mark_file_modified(fsp, false);
+	}
+
+	DO_PROFILE_INC(writecache_total_writes);
+	DO_PROFILE_INC(writecache_direct_writes);
+
+	contend_level2_oplocks_begin(fsp, LEVEL2_CONTEND_WRITE);
+	contend_level2_oplocks_end(fsp, LEVEL2_CONTEND_WRITE);
+
+	return true;
+}
+
 /****************************************************************************
  Write to a file.
 ****************************************************************************/
@@ -309,30 +369,8 @@ ssize_t write_file(struct smb_request *req,
 	}
 
 	if (!fsp->modified) {
-		fsp->modified = True;
-
-		if (SMB_VFS_FSTAT(fsp, &fsp->fsp_name->st) == 0) {
-			int dosmode;
-			trigger_write_time_update(fsp);
-			dosmode = dos_mode(fsp->conn, fsp->fsp_name);
-			if ((lp_store_dos_attributes(SNUM(fsp->conn)) ||
-					MAP_ARCHIVE(fsp->conn)) &&
-					!IS_DOS_ARCHIVE(dosmode)) {
-				file_set_dosmode(fsp->conn, fsp->fsp_name,
-						 dosmode | aARCH, NULL, false);
-			}
-
-			/*
-			 * If this is the first write and we have an exclusive oplock then setup
-			 * the write cache.
-			 */
-
-			if (EXCLUSIVE_OPLOCK_TYPE(fsp->oplock_type) && !wcp) {
-				setup_write_cache(fsp,
-						 fsp->fsp_name->st.st_ex_size);
-				wcp = fsp->wcp;
-			}
-		}
+		mark_file_modified(fsp, true);
+		wcp = fsp->wcp;
 	}
 
 #ifdef WITH_PROFILE
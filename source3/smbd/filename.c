@@ -26,6 +26,11 @@
 
 #include "includes.h"
 
+extern struct current_user current_user;
+
+static int get_real_filename_cached(connection_struct *conn,
+				    const char *path, const char *name,
+				    TALLOC_CTX *mem_ctx, char **found_name);
 static NTSTATUS build_stream_path(TALLOC_CTX *mem_ctx,
 				  connection_struct *conn,
 				  const char *orig_path,
@@ -530,9 +535,9 @@ NTSTATUS unix_convert(TALLOC_CTX *ctx,
 			 */
 
 			if (name_has_wildcard ||
-			    (get_real_filename(conn, dirpath, start,
-					       talloc_tos(),
-					       &found_name) == -1)) {
+			    (get_real_filename_cached(conn, dirpath, start,
+						      talloc_tos(),
+						      &found_name) == -1)) {
 				char *unmangled;
 
 				if (end) {
@@ -882,6 +887,395 @@ static bool fname_equal(const char *name1, const char *name2,
 	return(strequal(name1,name2));
 }
 
+/*
+ * Case insensitive name index for large directories.
+ *
+ * Scanning a directory with 100k entries for every name lookup that
+ * misses the stat cache is expensive. For directories with at least
+ * DIR_NAME_INDEX_MIN_ENTRIES entries we keep a hash of the names, keyed
+ * by the upper cased name, shared by all lookups on the same share in
+ * this smbd. The share is part of the key, VFS modules and hide/veto
+ * settings make the names visible differ from share to share. An index
+ * is only used as long as the directory stats identically to when it
+ * was built, any create, rename or delete in it invalidates it.
+ *
+ * For directories that turn out to be smaller we keep an index without
+ * names, so that the next lookup goes straight to the directory scan
+ * which can stop at the first match.
+ */
+
+#define DIR_NAME_INDEX_MIN_ENTRIES 1024
+#define DIR_NAME_INDEX_END UINT32_MAX
+
+struct dir_name_index_entry {
+	uint32_t hash;
+	uint32_t next;		/* Next entry in the hash chain */
+	size_t name_ofs;	/* Offset of the name in names */
+};
+
+struct dir_name_index {
+	struct dir_name_index *prev, *next;
+	int snum;
+	SMB_DEV_T dev;
+	SMB_INO_T ino;
+	uid_t uid;
+	struct timespec mtime;
+	struct timespec ctime;
+	char *names;
+	size_t names_len;
+	struct dir_name_index_entry *entries;
+	uint32_t num_entries;
+	uint32_t *buckets;
+	uint32_t num_buckets;	/* Power of two */
+	size_t size;
+};
+
+/* Most recently used index first. */
+static struct dir_name_index *dir_name_indexes;
+static size_t dir_name_indexes_size;
+
+/****************************************************************************
+ Hash a name the way strequal() compares it.
+****************************************************************************/
+
+static uint32_t dir_name_index_hash(const char *name)
+{
+	const unsigned char *p;
+	char *upper;
+	uint32_t n = 0;
+
+	for (p = (const unsigned char *)name; *p != '\0'; p++) {
+		unsigned char c;
+
+		if (*p & 0x80) {
+			break;
+		}
+		c = toupper_ascii_fast(*p);
+		n = ((n << 5) + n) ^ (uint32_t)c;
+	}
+	if (*p == '\0') {
+		return n;
+	}
+
+	/* Not pure ASCII, take the slow path. */
+	upper = talloc_strdup_upper(talloc_tos(), name);
+	if (upper == NULL) {
+		return 0;
+	}
+	n = 0;
+	for (p = (const unsigned char *)upper; *p != '\0'; p++) {
+		n = ((n << 5) + n) ^ (uint32_t)*p;
+	}
+	TALLOC_FREE(upper);
+	return n;
+}
+
+/****************************************************************************
+ Drop least recently used indexes until we use at most max_size bytes.
+****************************************************************************/
+
+static void dir_name_index_shrink(size_t max_size)
+{
+	struct dir_name_index *idx, *last;
+
+	while ((dir_name_indexes != NULL) &&
+	       (dir_name_indexes_size > max_size)) {
+		for (last = dir_name_indexes; last->next; last = last->next) ;
+		idx = last;
+		DLIST_REMOVE(dir_name_indexes, idx);
+		dir_name_indexes_size -= idx->size;
+		TALLOC_FREE(idx);
+	}
+}
+
+/****************************************************************************
+ Find a valid index for the directory stat'ed in st.
+****************************************************************************/
+
+static struct dir_name_index *dir_name_index_find(connection_struct *conn,
+						  const SMB_STRUCT_STAT *st)
+{
+	struct dir_name_index *idx;
+
+	for (idx = dir_name_indexes; idx != NULL; idx = idx->next) {
+		if ((idx->snum == SNUM(conn)) &&
+		    (idx->dev == st->st_ex_dev) &&
+		    (idx->ino == st->st_ex_ino) &&
+		    (idx->uid == current_user.ut.uid)) {
+			break;
+		}
+	}
+	if (idx == NULL) {
+		return NULL;
+	}
+
+	if ((timespec_compare(&idx->mtime, &st->st_ex_mtime) != 0) ||
+	    (timespec_compare(&idx->ctime, &st->st_ex_ctime) != 0)) {
+		DEBUG(10, ("dir_name_index_find: directory changed, "
+			   "dropping index\n"));
+		DLIST_REMOVE(dir_name_indexes, idx);
+		dir_name_indexes_size -= idx->size;
+		TALLOC_FREE(idx);
+		return NULL;
+	}
+
+	DLIST_PROMOTE(dir_name_indexes, idx);
+	return idx;
+}
+
+/****************************************************************************
+ Read all names from a directory into a new index.
+****************************************************************************/
+
+static struct dir_name_index *dir_name_index_build(connection_struct *conn,
+						   const char *path,
+						   const SMB_STRUCT_STAT *st)
+{
+	struct dir_name_index *idx;
+	struct smb_Dir *cur_dir;
+	const char *dname = NULL;
+	char *talloced = NULL;
+	long curpos;
+	size_t names_alloc = 0;
+	uint32_t entries_alloc = 0;
+	uint32_t i;
+
+	idx = TALLOC_ZERO_P(NULL, struct dir_name_index);
+	if (idx == NULL) {
+		return NULL;
+	}
+	idx->snum = SNUM(conn);
+	idx->dev = st->st_ex_dev;
+	idx->ino = st->st_ex_ino;
+	idx->uid = current_user.ut.uid;
+	idx->mtime = st->st_ex_mtime;
+	idx->ctime = st->st_ex_ctime;
+
+	cur_dir = OpenDir(talloc_tos(), conn, path, NULL, 0);
+	if (cur_dir == NULL) {
+		DEBUG(3,("dir_name_index_build: didn't open dir [%s]\n",
+			 path));
+		TALLOC_FREE(idx);
+		return NULL;
+	}
+
+	curpos = 0;
+	while ((dname = ReadDirName(cur_dir, &curpos, NULL, &talloced))) {
+		size_t len;
+
+		if (ISDOT(dname) || ISDOTDOT(dname)) {
+			TALLOC_FREE(talloced);
+			continue;
+		}
+
+		len = strlen(dname) + 1;
+
+		if (idx->num_entries == DIR_NAME_INDEX_END - 1) {
+			goto nomem;
+		}
+		if (idx->num_entries == entries_alloc) {
+			entries_alloc = MAX(entries_alloc * 2, 256);
+			idx->entries = TALLOC_REALLOC_ARRAY(
+				idx, idx->entries, struct dir_name_index_entry,
+				entries_alloc);
+			if (idx->entries == NULL) {
+				goto nomem;
+			}
+		}
+		if (idx->names_len + len > names_alloc) {
+			names_alloc = MAX(names_alloc * 2,
+					  idx->names_len + len + 4096);
+			idx->names = TALLOC_REALLOC_ARRAY(
+				idx, idx->names, char, names_alloc);
+			if (idx->names == NULL) {
+				goto nomem;
+			}
+		}
+
+		memcpy(idx->names + idx->names_len, dname, len);
+		idx->entries[idx->num_entries].hash =
+			dir_name_index_hash(dname);
+		idx->entries[idx->num_entries].name_ofs = idx->names_len;
+		idx->names_len += len;
+		idx->num_entries += 1;
+
+		TALLOC_FREE(talloced);
+	}
+	TALLOC_FREE(cur_dir);
+
+	idx->num_buckets = 16;
+	while (idx->num_buckets < idx->num_entries) {
+		idx->num_buckets *= 2;
+	}
+	idx->buckets = TALLOC_ARRAY(idx, uint32_t, idx->num_buckets);
+	if (idx->buckets == NULL) {
+		goto nomem;
+	}
+	for (i = 0; i < idx->num_buckets; i++) {
+		idx->buckets[i] = DIR_NAME_INDEX_END;
+	}
+
+	/*
+	 * Insert backwards, so that a chain lists names in directory
+	 * order. Like the directory scan we return the first match.
+	 */
+	for (i = idx->num_entries; i > 0; i--) {
+		struct dir_name_index_entry *e = &idx->entries[i-1];
+		uint32_t b = e->hash & (idx->num_buckets - 1);
+
+		e->next = idx->buckets[b];
+		idx->buckets[b] = i-1;
+	}
+
+	idx->size = sizeof(struct dir_name_index)
+		+ entries_alloc * sizeof(struct dir_name_index_entry)
+		+ names_alloc
+		+ idx->num_buckets * sizeof(uint32_t);
+
+	return idx;
+
+ nomem:
+	TALLOC_FREE(talloced);
+	TALLOC_FREE(cur_dir);
+	TALLOC_FREE(idx);
+	return NULL;
+}
+
+static const char *dir_name_index_lookup(const struct dir_name_index *idx,
+					 const char *name)
+{
+	uint32_t hash = dir_name_index_hash(name);
+	uint32_t i;
+
+	for (i = idx->buckets[hash & (idx->num_buckets - 1)];
+	     i != DIR_NAME_INDEX_END;
+	     i = idx->entries[i].next) {
+		const char *dname = idx->names + idx->entries[i].name_ofs;
+
+		if ((idx->entries[i].hash == hash) && strequal(name, dname)) {
+			return dname;
+		}
+	}
+	return NULL;
+}
+
+/****************************************************************************
+ Find a filename case insensitively via the directory's name index.
+ Returns false if the index can't be used and the caller has to scan.
+****************************************************************************/
+
+static bool get_real_filename_indexed(connection_struct *conn,
+				      const char *path, const char *name,
+				      TALLOC_CTX *mem_ctx, char **found_name,
+				      int *pret)
+{
+	struct smb_filename smb_fname_dir;
+	struct dir_name_index *idx;
+	struct timespec scan_start, racy;
+	size_t max_size;
+	const char *dname;
+	bool keep, built;
+
+	max_size = (size_t)lp_dir_name_index_size() * 1024;
+	if (max_size == 0) {
+		dir_name_index_shrink(0);
+		return false;
+	}
+
+	ZERO_STRUCT(smb_fname_dir);
+	smb_fname_dir.base_name = discard_const_p(char, path);
+
+	scan_start = timespec_current();
+	if (SMB_VFS_STAT(conn, &smb_fname_dir) != 0) {
+		return false;
+	}
+
+	/*
+	 * Reading and hashing a directory that is clearly small costs
+	 * more than the scan. sys_stat() reports directories with size
+	 * 0, but where the file system allocates blocks for directories
+	 * no on-disk entry takes less than 8 bytes.
+	 */
+	if ((smb_fname_dir.st.st_ex_blocks != 0) &&
+	    (smb_fname_dir.st.st_ex_blocks * 512 <
+	     DIR_NAME_INDEX_MIN_ENTRIES * 8)) {
+		return false;
+	}
+
+	idx = dir_name_index_find(conn, &smb_fname_dir.st);
+	if ((idx != NULL) && (idx->num_entries < DIR_NAME_INDEX_MIN_ENTRIES)) {
+		return false;
+	}
+	keep = true;
+	built = false;
+
+	if (idx == NULL) {
+		/*
+		 * A directory changed just before we read it might
+		 * change again without a visible timestamp change on
+		 * file systems with coarse timestamps. Don't index it,
+		 * the plain scan can stop at the first match.
+		 */
+		racy = scan_start;
+		racy.tv_sec -= 2;
+		if ((timespec_compare(&smb_fname_dir.st.st_ex_mtime,
+				      &racy) >= 0) ||
+		    (timespec_compare(&smb_fname_dir.st.st_ex_ctime,
+				      &racy) >= 0)) {
+			return false;
+		}
+
+		idx = dir_name_index_build(conn, path, &smb_fname_dir.st);
+		if (idx == NULL) {
+			return false;
+		}
+
+		built = true;
+		keep = (idx->size <= max_size);
+		if (keep) {
+			DEBUG(10, ("get_real_filename_indexed: indexed %u "
+				   "names in [%s]\n",
+				   (unsigned int)idx->num_entries, path));
+			DLIST_ADD(dir_name_indexes, idx);
+		}
+	}
+
+	dname = dir_name_index_lookup(idx, name);
+	if (dname == NULL) {
+		errno = ENOENT;
+		*pret = -1;
+	} else {
+		*found_name = talloc_strdup(mem_ctx, dname);
+		if (*found_name == NULL) {
+			errno = ENOMEM;
+			*pret = -1;
+		} else {
+			*pret = 0;
+		}
+	}
+
+	if (!keep) {
+		TALLOC_FREE(idx);
+		return true;
+	}
+	if (!built) {
+		return true;
+	}
+
+	if (idx->num_entries < DIR_NAME_INDEX_MIN_ENTRIES) {
+		/* Only remember that the directory is small */
+		TALLOC_FREE(idx->names);
+		TALLOC_FREE(idx->entries);
+		TALLOC_FREE(idx->buckets);
+		idx->names_len = 0;
+		idx->num_buckets = 0;
+		idx->size = sizeof(struct dir_name_index);
+	}
+	dir_name_indexes_size += idx->size;
+	dir_name_index_shrink(max_size);
+	return true;
+}
+
 /****************************************************************************
  Scan a directory to find a filename, matching without case sensitivity.
  If the name looks like a mangled name then try via the mangling functions
@@ -937,6 +1331,16 @@ static int get_real_filename_full_scan(connection_struct *conn,
 		}
 	}
 
+	if (!mangled && !conn->case_sensitive) {
+		int ret;
+
+		if (get_real_filename_indexed(conn, path, name, mem_ctx,
+					      found_name, &ret)) {
+			TALLOC_FREE(unmangled_name);
+			return ret;
+		}
+	}
+
 	/* open the directory */
 	if (!(cur_dir = OpenDir(talloc_tos(), conn, path, NULL, 0))) {
 		DEBUG(3,("scan dir didn't open dir [%s]\n",path));
@@ -1023,6 +1427,52 @@ int get_real_filename(connection_struct *conn, const char *path,
 					   found_name);
 }
 
+/****************************************************************************
+ get_real_filename() with the negative stat cache in front of it. A name a
+ directory scan did not find is not searched for again as long as the
+ directory is unchanged.
+****************************************************************************/
+
+static int get_real_filename_cached(connection_struct *conn,
+				    const char *path, const char *name,
+				    TALLOC_CTX *mem_ctx, char **found_name)
+{
+	struct smb_filename smb_fname_dir;
+	struct timespec scan_start;
+	int ret;
+
+	if (!lp_stat_cache() ||
+	    (lp_negative_stat_cache_size(SNUM(conn)) == 0) ||
+	    mangle_is_mangled(name, conn->params)) {
+		return get_real_filename(conn, path, name, mem_ctx,
+					 found_name);
+	}
+
+	ZERO_STRUCT(smb_fname_dir);
+	smb_fname_dir.base_name = discard_const_p(
+		char, (*path == '\0') ? "." : path);
+
+	scan_start = timespec_current();
+	if (SMB_VFS_STAT(conn, &smb_fname_dir) != 0) {
+		return get_real_filename(conn, path, name, mem_ctx,
+					 found_name);
+	}
+
+	if (stat_cache_lookup_negative(conn, path, name,
+				       &smb_fname_dir.st)) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	ret = get_real_filename(conn, path, name, mem_ctx, found_name);
+	if ((ret == -1) && (errno == ENOENT)) {
+		stat_cache_add_negative(conn, path, name, &smb_fname_dir.st,
+					&scan_start);
+		errno = ENOENT;
+	}
+	return ret;
+}
+
 static NTSTATUS build_stream_path(TALLOC_CTX *mem_ctx,
 				  connection_struct *conn,
 				  const char *orig_path,
@@ -27,6 +27,10 @@ int aio_pending_size = 0;
 int outstanding_aio_calls = 0;
 #endif
 
+#if WITH_PTHREADPOOL
+struct fncall_context *aio_fncall_ctx = NULL;
+#endif
+
 /* dlink list we store pending lock records on. */
 struct blocking_lock_record *blocking_lock_queue = NULL;
 
@@ -25,6 +25,10 @@ extern int aio_pending_size;
 extern int outstanding_aio_calls;
 #endif
 
+#if WITH_PTHREADPOOL
+extern struct fncall_context *aio_fncall_ctx;
+#endif
+
 /* dlink list we store pending lock records on. */
 extern struct blocking_lock_record *blocking_lock_queue;
 
@@ -161,6 +165,22 @@ NTSTATUS smb2_signing_sign_pdu(DATA_BLOB session_key,
 NTSTATUS smb2_signing_check_pdu(DATA_BLOB session_key,
 				const struct iovec *vector,
 				int count);
+#if WITH_PTHREADPOOL
+struct tevent_req *smb2_signing_sign_pdu_send(TALLOC_CTX *mem_ctx,
+					      struct tevent_context *ev,
+					      struct fncall_context *ctx,
+					      DATA_BLOB session_key,
+					      struct iovec *vector,
+					      int count);
+NTSTATUS smb2_signing_sign_pdu_recv(struct tevent_req *req);
+struct tevent_req *smb2_signing_check_pdu_send(TALLOC_CTX *mem_ctx,
+					       struct tevent_context *ev,
+					       struct fncall_context *ctx,
+					       DATA_BLOB session_key,
+					       const struct iovec *vector,
+					       int count);
+NTSTATUS smb2_signing_check_pdu_recv(struct tevent_req *req);
+#endif
 
 struct smbd_lock_element {
 	uint32_t smbpid;
@@ -336,6 +356,9 @@ struct smbd_smb2_request {
 	int current_idx;
 	bool do_signing;
 
+	/* latency_now() when the current request was dispatched */
+	uint64_t latency_start;
+
 	struct files_struct *compat_chain_fsp;
 
 	NTSTATUS next_status;
@@ -390,6 +413,19 @@ struct smbd_smb2_request {
 		struct iovec *vector;
 		int vector_count;
 	} out;
+
+	/*
+	 * Set by SMB2 READ if the data should go out with sendfile
+	 * straight from the file. The dynamic part of the response
+	 * has no buffer then, see smbd_smb2_request_sendfile().
+	 */
+	struct {
+		struct files_struct *fsp;
+		/* fsp->fh->gen_id, fsp might have been reused */
+		unsigned long gen_id;
+		SMB_OFF_T offset;
+		struct lock_struct lock;
+	} sendfile;
 };
 
 struct smbd_server_connection;
@@ -495,6 +531,11 @@ struct smbd_server_connection {
 		struct tevent_queue *recv_queue;
 		struct tevent_queue *send_queue;
 		struct tstream_context *stream;
+		/*
+		 * Payload of a large unsigned WRITE that is still in the
+		 * socket, SMB2 WRITE receives it straight into the file.
+		 */
+		size_t unread_bytes;
 		struct {
 			/* an id tree used to allocate vuids */
 			/* this holds info on session vuids that are already
@@ -258,6 +258,7 @@ static void api_dcerpc_cmd(connection_struct *conn, struct smb_request *req,
 		reply_nterror(req, NT_STATUS_NO_MEMORY);
 		return;
 	}
+	SMB_PERFCOUNT_DEFER_OP(&req->pcd, &req->pcd);
 	tevent_req_set_callback(subreq, api_dcerpc_cmd_write_done,
 				talloc_move(conn, &req));
 }
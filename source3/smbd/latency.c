@@ -0,0 +1,217 @@
+/*
+   Unix SMB/CIFS implementation.
+   Per opcode latency histograms, the "latency" perfcount module
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "includes.h"
+#include "smbd/globals.h"
+#include "../libcli/smb/smb_common.h"
+
+/*
+ * "perfcount module = latency" times every SMB1 request from the
+ * moment it is read until the reply is sent. A chain is timed as a
+ * whole under its first command. SMB2 does not go through the perfcount
+ * hooks, smb2_server.c calls smbd_latency_smb2() directly.
+ */
+
+struct latency_op {
+	bool alloced;
+	int op;
+	uint64_t start;
+};
+
+/*
+ * Most requests are done before the next one is read. Every request
+ * that is answered later, after the next request started, moves to a
+ * copy with SMB_PERFCOUNT_DEFER_OP() when it goes async.
+ */
+static struct latency_op g_latency_op;
+
+static struct latency_counter *smb1_counters[256];
+static struct latency_counter *smb2_counters[SMB2_OP_BREAK + 2];
+
+static const char *smb2_op_names[] = {
+	"NEGPROT", "SESSSETUP", "LOGOFF", "TCON", "TDIS", "CREATE",
+	"CLOSE", "FLUSH", "READ", "WRITE", "LOCK", "IOCTL", "CANCEL",
+	"KEEPALIVE", "FIND", "NOTIFY", "GETINFO", "SETINFO", "BREAK",
+	"unknown"
+};
+
+static void latency_pcd_start(struct smb_perfcount_data *pcd)
+{
+	g_latency_op.alloced = false;
+	g_latency_op.op = -1;
+	g_latency_op.start = latency_now();
+
+	pcd->context = (g_latency_op.start != 0) ? &g_latency_op : NULL;
+}
+
+static void latency_pcd_add(struct smb_perfcount_data *pcd)
+{
+}
+
+static void latency_pcd_set_op(struct smb_perfcount_data *pcd, int op)
+{
+	struct latency_op *lop = (struct latency_op *)pcd->context;
+
+	if (lop == NULL) {
+		return;
+	}
+
+	/* no reply, nothing to time */
+	if (op == SMBntcancel) {
+		if (lop->alloced) {
+			SAFE_FREE(lop);
+		}
+		pcd->context = NULL;
+		return;
+	}
+
+	if (lop->op == -1) {
+		lop->op = op;
+	}
+}
+
+static void latency_pcd_set_subop(struct smb_perfcount_data *pcd, int subop)
+{
+}
+
+static void latency_pcd_set_ioctl(struct smb_perfcount_data *pcd, int io_ctl)
+{
+}
+
+static void latency_pcd_set_msglen_in(struct smb_perfcount_data *pcd,
+				      uint64_t in_bytes)
+{
+}
+
+static void latency_pcd_set_msglen_out(struct smb_perfcount_data *pcd,
+				       uint64_t out_bytes)
+{
+}
+
+static struct latency_op *latency_op_copy(const struct latency_op *lop)
+{
+	struct latency_op *copy = SMB_MALLOC_P(struct latency_op);
+
+	if (copy == NULL) {
+		return NULL;
+	}
+	*copy = *lop;
+	copy->alloced = true;
+	return copy;
+}
+
+static void latency_pcd_copy_context(struct smb_perfcount_data *pcd,
+				     struct smb_perfcount_data *new_pcd)
+{
+	struct latency_op *lop = (struct latency_op *)pcd->context;
+
+	new_pcd->handlers = pcd->handlers;
+	new_pcd->context = (lop != NULL) ? latency_op_copy(lop) : NULL;
+}
+
+/*
+ * A deferred request outlives g_latency_op, move it to a copy. The
+ * deferred open queue hands us a zeroed def_pcd, blocking locks, aio,
+ * notify and named pipe requests defer into the same pcd.
+ */
+static void latency_pcd_defer_op(struct smb_perfcount_data *pcd,
+				 struct smb_perfcount_data *def_pcd)
+{
+	struct latency_op *lop = (struct latency_op *)pcd->context;
+
+	if (lop == NULL) {
+		return;
+	}
+
+	if (!lop->alloced) {
+		lop = latency_op_copy(lop);
+	}
+
+	def_pcd->handlers = pcd->handlers;
+	def_pcd->context = lop;
+
+	if (pcd != def_pcd) {
+		pcd->context = NULL;
+	}
+}
+
+static void latency_pcd_end(struct smb_perfcount_data *pcd)
+{
+	struct latency_op *lop = (struct latency_op *)pcd->context;
+
+	if (lop == NULL) {
+		return;
+	}
+
+	if (lop->op != -1) {
+		latency_record(&smb1_counters[lop->op & 0xff], "SMB1",
+			       smb_fn_name(lop->op), lop->start);
+	}
+
+	if (lop->alloced) {
+		SAFE_FREE(lop);
+	}
+	pcd->context = NULL;
+}
+
+static struct smb_perfcount_handlers latency_pcd_handlers = {
+	latency_pcd_start,
+	latency_pcd_add,
+	latency_pcd_set_op,
+	latency_pcd_set_subop,
+	latency_pcd_set_ioctl,
+	latency_pcd_set_msglen_in,
+	latency_pcd_set_msglen_out,
+	latency_pcd_copy_context,
+	latency_pcd_defer_op,
+	latency_pcd_end
+};
+
+NTSTATUS perfcount_latency_init(void)
+{
+	return smb_register_perfcounter(SMB_PERFCOUNTER_INTERFACE_VERSION,
+					"latency", &latency_pcd_handlers);
+}
+
+/****************************************************************************
+ Record an SMB2 request that was dispatched at "start".
+****************************************************************************/
+
+void smbd_latency_smb2(uint16_t opcode, uint64_t start)
+{
+	if (opcode > SMB2_OP_BREAK) {
+		opcode = SMB2_OP_BREAK + 1;
+	}
+
+	latency_record(&smb2_counters[opcode], "SMB2",
+		       smb2_op_names[opcode], start);
+}
+
+/****************************************************************************
+ Called by the parent smbd. Open latency.tdb if the latency perfcount
+ module is configured, the children start recording right away.
+****************************************************************************/
+
+void smbd_latency_init(void)
+{
+	if (!strequal(lp_perfcount_module(), "latency")) {
+		return;
+	}
+
+	latency_init(smbd_event_context());
+}
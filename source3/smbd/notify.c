@@ -248,6 +248,7 @@ NTSTATUS change_notify_add_request(struct smb_request *req,
 	request->mid_map = map;
 	map->req = request;
 
+	SMB_PERFCOUNT_DEFER_OP(&req->pcd, &req->pcd);
 	request->req = talloc_move(request, &req);
 	request->max_param = max_param;
 	request->filter = filter;
@@ -366,6 +367,12 @@ void notify_fname(connection_struct *conn, uint32 action, uint32 filter,
 	if (path[0] == '.' && path[1] == '/') {
 		path += 2;
 	}
+
+	if ((action == NOTIFY_ACTION_ADDED) ||
+	    (action == NOTIFY_ACTION_NEW_NAME)) {
+		stat_cache_delete_negative(conn, path);
+	}
+
 	if (parent_dirname(talloc_tos(), path, &parent, &name)) {
 		struct smb_filename smb_fname_parent;
 
@@ -373,9 +380,12 @@ void notify_fname(connection_struct *conn, uint32 action, uint32 filter,
 		smb_fname_parent.base_name = parent;
 
 		if (SMB_VFS_STAT(conn, &smb_fname_parent) != -1) {
-			notify_onelevel(conn->notify_ctx, action, filter,
-			    SMB_VFS_FILE_ID_CREATE(conn, &smb_fname_parent.st),
-			    name);
+			struct file_id id = SMB_VFS_FILE_ID_CREATE(
+				conn, &smb_fname_parent.st);
+
+			dir_listing_cache_delete(conn, &id);
+			notify_onelevel(conn->notify_ctx, action, filter, id,
+					name);
 		}
 	}
 
@@ -71,25 +71,49 @@ static int inotify_rm_watch(int fd, int wd)
 #define IN_MASK_ADD 0x20000000
 #endif
 
+/*
+  one inotify fd per process, shared by all the connections it serves
+*/
 struct inotify_private {
-	struct sys_notify_context *ctx;
 	int fd;
+	struct inotify_dir *dirs;
+};
+
+/*
+  all the watches of this process on one directory, they share a
+  single kernel watch descriptor
+*/
+struct inotify_dir {
+	struct inotify_dir *next, *prev;
+	struct inotify_private *in;
+	int wd;
+	uint32_t mask; /* the inotify mask the kernel has for wd */
+	const char *path;
 	struct inotify_watch_context *watches;
 };
 
 struct inotify_watch_context {
 	struct inotify_watch_context *next, *prev;
-	struct inotify_private *in;
-	int wd;
+	struct inotify_dir *dir;
+	struct sys_notify_context *ctx;
 	void (*callback)(struct sys_notify_context *ctx, 
 			 void *private_data,
 			 struct notify_event *ev);
 	void *private_data;
 	uint32_t mask; /* the inotify mask */
 	uint32_t filter; /* the windows completion filter */
-	const char *path;
 };
 
+/* the bits of an inotify mask that select events */
+#define INOTIFY_EVENT_MASK (~(IN_MASK_ADD|IN_ONLYDIR))
+
+/*
+  how many of the previous events in a buffer are looked at when
+  coalescing repeated modifications of the same name
+*/
+#define INOTIFY_COALESCE_WINDOW 32
+
+static struct inotify_private *inotify_ctx;
 
 /*
   destroy the inotify private context
@@ -97,9 +121,32 @@ struct inotify_watch_context {
 static int inotify_destructor(struct inotify_private *in)
 {
 	close(in->fd);
+	if (inotify_ctx == in) {
+		inotify_ctx = NULL;
+	}
 	return 0;
 }
 
+/*
+  find the directory a watch descriptor belongs to. Busy directories
+  are kept at the front of the list
+*/
+static struct inotify_dir *inotify_find_dir(struct inotify_private *in,
+					    int wd)
+{
+	struct inotify_dir *dir;
+
+	for (dir=in->dirs;dir;dir=dir->next) {
+		if (dir->wd == wd) {
+			if (dir != in->dirs) {
+				DLIST_PROMOTE(in->dirs, dir);
+			}
+			return dir;
+		}
+	}
+	return NULL;
+}
+
 
 /*
   see if a particular event from inotify really does match a requested
@@ -155,13 +202,23 @@ static void inotify_dispatch(struct inotify_private *in,
 			     uint32_t prev_cookie,
 			     struct inotify_event *e2)
 {
+	struct inotify_dir *dir;
 	struct inotify_watch_context *w, *next;
 	struct notify_event ne;
 
 	DEBUG(10, ("inotify_dispatch called with mask=%x, name=[%s]\n",
 		   e->mask, e->len ? e->name : ""));
 
-	/* ignore extraneous events, such as unmount and IN_IGNORED events */
+	if (e->mask & IN_IGNORED) {
+		/* the kernel dropped the watch, its wd can be reused */
+		dir = inotify_find_dir(in, e->wd);
+		if (dir != NULL) {
+			dir->wd = -1;
+		}
+		return;
+	}
+
+	/* ignore extraneous events, such as unmount events */
 	if ((e->mask & (IN_ATTRIB|IN_MODIFY|IN_CREATE|IN_DELETE|
 			IN_MOVED_FROM|IN_MOVED_TO)) == 0) {
 		return;
@@ -194,10 +251,15 @@ static void inotify_dispatch(struct inotify_private *in,
 		   ne.action, ne.path));
 
 	/* find any watches that have this watch descriptor */
-	for (w=in->watches;w;w=next) {
+	dir = inotify_find_dir(in, e->wd);
+	if (dir == NULL) {
+		return;
+	}
+
+	for (w=dir->watches;w;w=next) {
 		next = w->next;
-		if (w->wd == e->wd && filter_match(w, e)) {
-			w->callback(in->ctx, w->private_data, &ne);
+		if (filter_match(w, e)) {
+			w->callback(w->ctx, w->private_data, &ne);
 		}
 	}
 
@@ -212,15 +274,55 @@ static void inotify_dispatch(struct inotify_private *in,
 	ne.action = NOTIFY_ACTION_MODIFIED;
 	e->mask = IN_ATTRIB;
 
-	for (w=in->watches;w;w=next) {
+	/* the callbacks above may have removed the last watch */
+	dir = inotify_find_dir(in, e->wd);
+	if (dir == NULL) {
+		return;
+	}
+
+	for (w=dir->watches;w;w=next) {
 		next = w->next;
-		if (w->wd == e->wd && filter_match(w, e) &&
+		if (filter_match(w, e) &&
 		    !(w->filter & FILE_NOTIFY_CHANGE_CREATION)) {
-			w->callback(in->ctx, w->private_data, &ne);
+			w->callback(w->ctx, w->private_data, &ne);
 		}
 	}
 }
 
+/*
+  see if an event only repeats a modification that was already
+  dispatched from this buffer. Creates, deletes and renames are never
+  dropped, and any of them on the name in between ends the run, so
+  the client still sees the changes in the order they happened
+*/
+static bool inotify_event_repeated(struct inotify_event **seen,
+				   int num_seen,
+				   struct inotify_event *e)
+{
+	int i, n;
+
+	if ((e->mask & (IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO)) ||
+	    (e->mask & (IN_MODIFY|IN_ATTRIB)) == 0) {
+		return False;
+	}
+
+	n = MIN(num_seen, INOTIFY_COALESCE_WINDOW);
+
+	for (i=1;i<=n;i++) {
+		struct inotify_event *p =
+			seen[(num_seen - i) % INOTIFY_COALESCE_WINDOW];
+
+		if (p->wd != e->wd) {
+			continue;
+		}
+		if (strcmp(p->len ? p->name : "", e->len ? e->name : "")) {
+			continue;
+		}
+		return (p->mask == e->mask);
+	}
+	return False;
+}
+
 /*
   called when the kernel has some events for us
 */
@@ -231,6 +333,8 @@ static void inotify_handler(struct event_context *ev, struct fd_event *fde,
 						     struct inotify_private);
 	int bufsize = 0;
 	struct inotify_event *e0, *e;
+	struct inotify_event *seen[INOTIFY_COALESCE_WINDOW];
+	int num_seen = 0;
 	uint32_t prev_cookie=0;
 	NTSTATUS status;
 
@@ -267,7 +371,14 @@ static void inotify_handler(struct event_context *ev, struct fd_event *fde,
 		if (bufsize >= sizeof(*e)) {
 			e2 = (struct inotify_event *)(e->len + sizeof(*e) + (char *)e);
 		}
-		inotify_dispatch(in, e, prev_cookie, e2);
+		if (inotify_event_repeated(seen, num_seen, e)) {
+			DEBUG(10, ("inotify_handler: coalescing mask=%x, "
+				   "name=[%s]\n", e->mask,
+				   e->len ? e->name : ""));
+		} else {
+			inotify_dispatch(in, e, prev_cookie, e2);
+		}
+		seen[num_seen++ % INOTIFY_COALESCE_WINDOW] = e;
 		prev_cookie = e->cookie;
 		e = e2;
 	}
@@ -276,8 +387,9 @@ static void inotify_handler(struct event_context *ev, struct fd_event *fde,
 }
 
 /*
-  setup the inotify handle - called the first time a watch is added on
-  this context
+  setup the inotify handle - called the first time a watch is added in
+  this process. The handle stays around for the life of the process,
+  events can still be in flight when the last watch goes away
 */
 static NTSTATUS inotify_setup(struct sys_notify_context *ctx)
 {
@@ -287,7 +399,7 @@ static NTSTATUS inotify_setup(struct sys_notify_context *ctx)
 		return NT_STATUS_INVALID_SYSTEM_SERVICE;
 	}
 
-	in = talloc(ctx, struct inotify_private);
+	in = talloc(NULL, struct inotify_private);
 	NT_STATUS_HAVE_NO_MEMORY(in);
 	in->fd = inotify_init();
 	if (in->fd == -1) {
@@ -295,10 +407,9 @@ static NTSTATUS inotify_setup(struct sys_notify_context *ctx)
 		talloc_free(in);
 		return map_nt_error_from_unix(errno);
 	}
-	in->ctx = ctx;
-	in->watches = NULL;
+	in->dirs = NULL;
 
-	ctx->private_data = in;
+	inotify_ctx = in;
 	talloc_set_destructor(in, inotify_destructor);
 
 	/* add a event waiting for the inotify fd to be readable */
@@ -338,27 +449,78 @@ static uint32_t inotify_map(struct notify_entry *e)
 	return out;
 }
 
+/*
+  narrow the kernel watch on a directory down to what its remaining
+  watches ask for, so that the kernel stops queueing events nobody
+  wants any more
+*/
+static void inotify_dir_shrink(struct inotify_dir *dir)
+{
+	struct inotify_private *in = dir->in;
+	struct inotify_watch_context *w;
+	struct inotify_dir *other;
+	uint32_t mask = 0;
+	int wd;
+
+	for (w=dir->watches;w;w=w->next) {
+		mask |= (w->mask & INOTIFY_EVENT_MASK);
+	}
+	if ((dir->wd == -1) || (mask == dir->mask)) {
+		return;
+	}
+
+	/* without IN_MASK_ADD this replaces the mask of the watch */
+	wd = inotify_add_watch(in->fd, dir->path, mask | IN_ONLYDIR);
+	if (wd == dir->wd) {
+		DEBUG(10, ("inotify watch %d on %s narrowed to mask %x\n",
+			   wd, dir->path, mask));
+		dir->mask = mask;
+		return;
+	}
+	if (wd == -1) {
+		return;
+	}
+
+	/*
+	 * The directory was renamed and the path now leads somewhere
+	 * else. Undo what we did to that one.
+	 */
+	for (other=in->dirs;other;other=other->next) {
+		if (other->wd == wd) {
+			break;
+		}
+	}
+	if (other == NULL) {
+		inotify_rm_watch(in->fd, wd);
+	} else {
+		inotify_add_watch(in->fd, other->path,
+				  other->mask | IN_MASK_ADD | IN_ONLYDIR);
+	}
+}
+
 /*
   destroy a watch
 */
 static int watch_destructor(struct inotify_watch_context *w)
 {
-	struct inotify_private *in = w->in;
-	int wd = w->wd;
-	DLIST_REMOVE(w->in->watches, w);
+	struct inotify_dir *dir = w->dir;
+	struct inotify_private *in = dir->in;
+
+	DLIST_REMOVE(dir->watches, w);
 
 	/* only rm the watch if its the last one with this wd */
-	for (w=in->watches;w;w=w->next) {
-		if (w->wd == wd) break;
+	if (dir->watches != NULL) {
+		inotify_dir_shrink(dir);
+		return 0;
 	}
-	if (w == NULL) {
-		DEBUG(10, ("Deleting inotify watch %d\n", wd));
-		if (inotify_rm_watch(in->fd, wd) == -1) {
-			DEBUG(1, ("inotify_rm_watch returned %s\n",
-				  strerror(errno)));
-		}
 
+	DEBUG(10, ("Deleting inotify watch %d\n", dir->wd));
+	if ((dir->wd != -1) && (inotify_rm_watch(in->fd, dir->wd) == -1)) {
+		DEBUG(1, ("inotify_rm_watch returned %s\n",
+			  strerror(errno)));
 	}
+	DLIST_REMOVE(in->dirs, dir);
+	talloc_free(dir);
 	return 0;
 }
 
@@ -378,18 +540,19 @@ NTSTATUS inotify_watch(struct sys_notify_context *ctx,
 	struct inotify_private *in;
 	int wd;
 	uint32_t mask;
+	struct inotify_dir *dir;
 	struct inotify_watch_context *w;
 	uint32_t filter = e->filter;
 	void **handle = (void **)handle_p;
 
 	/* maybe setup the inotify fd */
-	if (ctx->private_data == NULL) {
+	if (inotify_ctx == NULL) {
 		NTSTATUS status;
 		status = inotify_setup(ctx);
 		NT_STATUS_NOT_OK_RETURN(status);
 	}
 
-	in = talloc_get_type(ctx->private_data, struct inotify_private);
+	in = inotify_ctx;
 
 	mask = inotify_map(e);
 	if (mask == 0) {
@@ -412,29 +575,50 @@ NTSTATUS inotify_watch(struct sys_notify_context *ctx,
 	DEBUG(10, ("inotify_add_watch for %s mask %x returned wd %d\n",
 		   e->path, mask, wd));
 
+	dir = inotify_find_dir(in, wd);
+	if (dir == NULL) {
+		dir = talloc(in, struct inotify_dir);
+		if (dir == NULL) {
+			inotify_rm_watch(in->fd, wd);
+			e->filter = filter;
+			return NT_STATUS_NO_MEMORY;
+		}
+		dir->in = in;
+		dir->wd = wd;
+		dir->mask = 0;
+		dir->watches = NULL;
+		dir->path = talloc_strdup(dir, e->path);
+		if (dir->path == NULL) {
+			inotify_rm_watch(in->fd, wd);
+			talloc_free(dir);
+			e->filter = filter;
+			return NT_STATUS_NO_MEMORY;
+		}
+		DLIST_ADD(in->dirs, dir);
+	}
+	dir->mask |= (mask & INOTIFY_EVENT_MASK);
+
 	w = talloc(in, struct inotify_watch_context);
 	if (w == NULL) {
-		inotify_rm_watch(in->fd, wd);
+		if (dir->watches == NULL) {
+			inotify_rm_watch(in->fd, wd);
+			DLIST_REMOVE(in->dirs, dir);
+			talloc_free(dir);
+		}
 		e->filter = filter;
 		return NT_STATUS_NO_MEMORY;
 	}
 
-	w->in = in;
-	w->wd = wd;
+	w->dir = dir;
+	w->ctx = ctx;
 	w->callback = callback;
 	w->private_data = private_data;
 	w->mask = mask;
 	w->filter = filter;
-	w->path = talloc_strdup(w, e->path);
-	if (w->path == NULL) {
-		inotify_rm_watch(in->fd, wd);
-		e->filter = filter;
-		return NT_STATUS_NO_MEMORY;
-	}
 
 	(*handle) = w;
 
-	DLIST_ADD(in->watches, w);
+	DLIST_ADD(dir->watches, w);
 
 	/* the caller frees the handle to stop watching */
 	talloc_set_destructor(w, watch_destructor);
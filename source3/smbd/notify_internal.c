@@ -32,10 +32,7 @@ struct notify_context {
 	struct server_id server;
 	struct messaging_context *messaging_ctx;
 	struct notify_list *list;
-	struct notify_array *array;
-	int seqnum;
 	struct sys_notify_context *sys_notify_ctx;
-	TDB_DATA key;
 };
 
 
@@ -44,16 +41,15 @@ struct notify_list {
 	void *private_data;
 	void (*callback)(void *, const struct notify_event *);
 	void *sys_notify_handle;
-	int depth;
+	char *path; /* key of our entry in notify.tdb, NULL if none */
 };
 
-#define NOTIFY_KEY "notify array"
-
 #define NOTIFY_ENABLE		"notify:enable"
 #define NOTIFY_ENABLE_DEFAULT	True
 
-static NTSTATUS notify_remove_all(struct notify_context *notify,
-				  const struct server_id *server);
+static NTSTATUS notify_del_entry(struct db_context *db, TDB_DATA key,
+				 const struct server_id *server,
+				 void *private_data);
 static void notify_handler(struct messaging_context *msg_ctx, void *private_data, 
 			   uint32_t msg_type, struct server_id server_id, DATA_BLOB *data);
 
@@ -62,10 +58,17 @@ static void notify_handler(struct messaging_context *msg_ctx, void *private_data
 */
 static int notify_destructor(struct notify_context *notify)
 {
+	struct notify_list *listel;
+
 	messaging_deregister(notify->messaging_ctx, MSG_PVFS_NOTIFY, notify);
 
-	if (notify->list != NULL) {
-		notify_remove_all(notify, &notify->server);
+	for (listel=notify->list;listel;listel=listel->next) {
+		if (listel->path == NULL) {
+			continue;
+		}
+		notify_del_entry(notify->db_recursive,
+				 string_tdb_data(listel->path),
+				 &notify->server, listel->private_data);
 	}
 
 	return 0;
@@ -93,7 +96,7 @@ struct notify_context *notify_init(TALLOC_CTX *mem_ctx, struct server_id server,
 	}
 
 	notify->db_recursive = db_open(notify, lock_path("notify.tdb"),
-				       0, TDB_SEQNUM|TDB_CLEAR_IF_FIRST,
+				       0, TDB_CLEAR_IF_FIRST,
 				       O_RDWR|O_CREAT, 0644);
 	if (notify->db_recursive == NULL) {
 		talloc_free(notify);
@@ -111,10 +114,6 @@ struct notify_context *notify_init(TALLOC_CTX *mem_ctx, struct server_id server,
 	notify->server = server;
 	notify->messaging_ctx = messaging_ctx;
 	notify->list = NULL;
-	notify->array = NULL;
-	notify->seqnum = notify->db_recursive->get_seqnum(
-		notify->db_recursive);
-	notify->key = string_term_tdb_data(NOTIFY_KEY);
 
 	talloc_set_destructor(notify, notify_destructor);
 
@@ -129,131 +128,164 @@ struct notify_context *notify_init(TALLOC_CTX *mem_ctx, struct server_id server,
 }
 
 /*
-  lock and fetch the record
+  parse the watchers stored in a notify.tdb or notify_onelevel.tdb
+  record. notify.tdb is keyed by the watched path, notify_onelevel.tdb
+  by the file id of the watched directory
 */
-static NTSTATUS notify_fetch_locked(struct notify_context *notify, struct db_record **rec)
+static NTSTATUS notify_pull_entries(TALLOC_CTX *mem_ctx, TDB_DATA dbuf,
+				    struct notify_entry_array **parray)
 {
-	*rec = notify->db_recursive->fetch_locked(notify->db_recursive,
-						  notify, notify->key);
-	if (*rec == NULL) {
-		return NT_STATUS_INTERNAL_DB_CORRUPTION;
+	struct notify_entry_array *array;
+	DATA_BLOB blob;
+
+	array = talloc_zero(mem_ctx, struct notify_entry_array);
+	NT_STATUS_HAVE_NO_MEMORY(array);
+
+	blob.data = (uint8_t *)dbuf.dptr;
+	blob.length = dbuf.dsize;
+
+	if (blob.length > 0) {
+		enum ndr_err_code ndr_err;
+		ndr_err = ndr_pull_struct_blob(
+			&blob, array, NULL, array,
+			(ndr_pull_flags_fn_t)ndr_pull_notify_entry_array);
+		if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
+			DEBUG(10, ("ndr_pull_notify_entry_array failed: %s\n",
+				   ndr_errstr(ndr_err)));
+			TALLOC_FREE(array);
+			return ndr_map_error2ntstatus(ndr_err);
+		}
+		if (DEBUGLEVEL >= 10) {
+			DEBUG(10, ("notify_pull_entries:\n"));
+			NDR_PRINT_DEBUG(notify_entry_array, array);
+		}
 	}
+
+	*parray = array;
 	return NT_STATUS_OK;
 }
 
 /*
-  load the notify array
+  write back the watchers of a record, deleting it with the last one
 */
-static NTSTATUS notify_load(struct notify_context *notify, struct db_record *rec)
+static NTSTATUS notify_store_entries(struct db_record *rec,
+				     struct notify_entry_array *array)
 {
-	TDB_DATA dbuf;
 	DATA_BLOB blob;
-	NTSTATUS status;
-	int seqnum;
+	TDB_DATA dbuf;
+	enum ndr_err_code ndr_err;
 
-	seqnum = notify->db_recursive->get_seqnum(notify->db_recursive);
+	if (array->num_entries == 0) {
+		return rec->delete_rec(rec);
+	}
 
-	if (seqnum == notify->seqnum && notify->array != NULL) {
-		return NT_STATUS_OK;
+	ndr_err = ndr_push_struct_blob(
+		&blob, array, NULL, array,
+		(ndr_push_flags_fn_t)ndr_push_notify_entry_array);
+	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
+		DEBUG(10, ("ndr_push_notify_entry_array failed: %s\n",
+			   ndr_errstr(ndr_err)));
+		return ndr_map_error2ntstatus(ndr_err);
 	}
 
-	notify->seqnum = seqnum;
+	if (DEBUGLEVEL >= 10) {
+		DEBUG(10, ("notify_store_entries:\n"));
+		NDR_PRINT_DEBUG(notify_entry_array, array);
+	}
 
-	talloc_free(notify->array);
-	notify->array = TALLOC_ZERO_P(notify, struct notify_array);
-	NT_STATUS_HAVE_NO_MEMORY(notify->array);
+	dbuf.dptr = blob.data;
+	dbuf.dsize = blob.length;
 
-	if (!rec) {
-		if (notify->db_recursive->fetch(notify->db_recursive, notify,
-						notify->key, &dbuf) != 0) {
-			return NT_STATUS_INTERNAL_DB_CORRUPTION;
-		}
-	} else {
-		dbuf = rec->value;
-	}
+	return rec->store(rec, dbuf, TDB_REPLACE);
+}
 
-	blob.data = (uint8 *)dbuf.dptr;
-	blob.length = dbuf.dsize;
+/*
+  add a watcher to the record stored under key
+*/
+static NTSTATUS notify_add_entry(struct notify_context *notify,
+				 struct db_context *db, TDB_DATA key,
+				 const struct notify_entry *e,
+				 void *private_data)
+{
+	struct notify_entry_array *array;
+	struct notify_entry *ee;
+	struct db_record *rec;
+	NTSTATUS status;
 
-	status = NT_STATUS_OK;
-	if (blob.length > 0) {
-		enum ndr_err_code ndr_err;
-		ndr_err = ndr_pull_struct_blob(&blob, notify->array, NULL, notify->array,
-					       (ndr_pull_flags_fn_t)ndr_pull_notify_array);
-		if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
-			status = ndr_map_error2ntstatus(ndr_err);
-		}
+	rec = db->fetch_locked(db, talloc_tos(), key);
+	if (rec == NULL) {
+		return NT_STATUS_INTERNAL_DB_CORRUPTION;
 	}
 
-	if (DEBUGLEVEL >= 10) {
-		DEBUG(10, ("notify_load:\n"));
-		NDR_PRINT_DEBUG(notify_array, notify->array);
+	status = notify_pull_entries(rec, rec->value, &array);
+	if (!NT_STATUS_IS_OK(status)) {
+		TALLOC_FREE(rec);
+		return status;
 	}
 
-	if (!rec) {
-		talloc_free(dbuf.dptr);
+	ee = talloc_realloc(array, array->entries, struct notify_entry,
+			    array->num_entries+1);
+	if (ee == NULL) {
+		TALLOC_FREE(rec);
+		return NT_STATUS_NO_MEMORY;
 	}
+	array->entries = ee;
 
-	return status;
-}
+	ee = &array->entries[array->num_entries];
+	*ee = *e;
+	ee->private_data = private_data;
+	ee->server = notify->server;
+	ee->path_len = strlen(e->path);
+	array->num_entries += 1;
 
-/*
-  compare notify entries for sorting
-*/
-static int notify_compare(const void *p1, const void *p2)
-{
-	const struct notify_entry *e1 = (const struct notify_entry *)p1;
-	const struct notify_entry *e2 = (const struct notify_entry *)p2;
-	return strcmp(e1->path, e2->path);
+	status = notify_store_entries(rec, array);
+	TALLOC_FREE(rec);
+	return status;
 }
 
 /*
-  save the notify array
+  remove a watcher from the record stored under key
 */
-static NTSTATUS notify_save(struct notify_context *notify, struct db_record *rec)
+static NTSTATUS notify_del_entry(struct db_context *db, TDB_DATA key,
+				 const struct server_id *server,
+				 void *private_data)
 {
-	TDB_DATA dbuf;
-	DATA_BLOB blob;
+	struct notify_entry_array *array;
+	struct db_record *rec;
 	NTSTATUS status;
-	enum ndr_err_code ndr_err;
-	TALLOC_CTX *tmp_ctx;
+	int i;
 
-	/* if possible, remove some depth arrays */
-	while (notify->array->num_depths > 0 &&
-	       notify->array->depth[notify->array->num_depths-1].num_entries == 0) {
-		notify->array->num_depths--;
+	rec = db->fetch_locked(db, talloc_tos(), key);
+	if (rec == NULL) {
+		return NT_STATUS_INTERNAL_DB_CORRUPTION;
 	}
 
-	/* we might just be able to delete the record */
-	if (notify->array->num_depths == 0) {
-		return rec->delete_rec(rec);
+	status = notify_pull_entries(rec, rec->value, &array);
+	if (!NT_STATUS_IS_OK(status)) {
+		TALLOC_FREE(rec);
+		return status;
 	}
 
-	tmp_ctx = talloc_new(notify);
-	NT_STATUS_HAVE_NO_MEMORY(tmp_ctx);
-
-	ndr_err = ndr_push_struct_blob(&blob, tmp_ctx, NULL, notify->array,
-				      (ndr_push_flags_fn_t)ndr_push_notify_array);
-	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
-		talloc_free(tmp_ctx);
-		return ndr_map_error2ntstatus(ndr_err);
+	for (i=0; i<array->num_entries; i++) {
+		if ((private_data == array->entries[i].private_data) &&
+		    cluster_id_equal(server, &array->entries[i].server)) {
+			break;
+		}
 	}
 
-	if (DEBUGLEVEL >= 10) {
-		DEBUG(10, ("notify_save:\n"));
-		NDR_PRINT_DEBUG(notify_array, notify->array);
+	if (i == array->num_entries) {
+		TALLOC_FREE(rec);
+		return NT_STATUS_OBJECT_NAME_NOT_FOUND;
 	}
 
-	dbuf.dptr = blob.data;
-	dbuf.dsize = blob.length;
-
-	status = rec->store(rec, dbuf, TDB_REPLACE);
-	talloc_free(tmp_ctx);
+	array->entries[i] = array->entries[array->num_entries-1];
+	array->num_entries -= 1;
 
+	status = notify_store_entries(rec, array);
+	TALLOC_FREE(rec);
 	return status;
 }
 
-
 /*
   handle incoming notify messages
 */
@@ -300,61 +332,6 @@ static void sys_notify_callback(struct sys_notify_context *ctx,
 	listel->callback(listel->private_data, ev);
 }
 
-/*
-  add an entry to the notify array
-*/
-static NTSTATUS notify_add_array(struct notify_context *notify, struct db_record *rec,
-				 struct notify_entry *e,
-				 void *private_data, int depth)
-{
-	int i;
-	struct notify_depth *d;
-	struct notify_entry *ee;
-
-	/* possibly expand the depths array */
-	if (depth >= notify->array->num_depths) {
-		d = talloc_realloc(notify->array, notify->array->depth, 
-				   struct notify_depth, depth+1);
-		NT_STATUS_HAVE_NO_MEMORY(d);
-		for (i=notify->array->num_depths;i<=depth;i++) {
-			ZERO_STRUCT(d[i]);
-		}
-		notify->array->depth = d;
-		notify->array->num_depths = depth+1;
-	}
-	d = &notify->array->depth[depth];
-
-	/* expand the entries array */
-	ee = talloc_realloc(notify->array->depth, d->entries, struct notify_entry,
-			    d->num_entries+1);
-	NT_STATUS_HAVE_NO_MEMORY(ee);
-	d->entries = ee;
-
-	d->entries[d->num_entries] = *e;
-	d->entries[d->num_entries].private_data = private_data;
-	d->entries[d->num_entries].server = notify->server;
-	d->entries[d->num_entries].path_len = strlen(e->path);
-	d->num_entries++;
-
-	d->max_mask |= e->filter;
-	d->max_mask_subdir |= e->subdir_filter;
-
-	if (d->num_entries > 1) {
-		qsort(d->entries, d->num_entries, sizeof(d->entries[0]), notify_compare);
-	}
-
-	/* recalculate the maximum masks */
-	d->max_mask = 0;
-	d->max_mask_subdir = 0;
-
-	for (i=0;i<d->num_entries;i++) {
-		d->max_mask |= d->entries[i].filter;
-		d->max_mask_subdir |= d->entries[i].subdir_filter;
-	}
-
-	return notify_save(notify, rec);
-}
-
 /*
   Add a non-recursive watch
 */
@@ -362,81 +339,15 @@ static NTSTATUS notify_add_array(struct notify_context *notify, struct db_record
 static void notify_add_onelevel(struct notify_context *notify,
 				struct notify_entry *e, void *private_data)
 {
-	struct notify_entry_array *array;
-	struct db_record *rec;
-	DATA_BLOB blob;
-	TDB_DATA dbuf;
-	enum ndr_err_code ndr_err;
 	NTSTATUS status;
 
-	array = talloc_zero(talloc_tos(), struct notify_entry_array);
-	if (array == NULL) {
-		return;
-	}
-
-	rec = notify->db_onelevel->fetch_locked(
-		notify->db_onelevel, talloc_tos(),
-		make_tdb_data((uint8_t *)&e->dir_id, sizeof(e->dir_id)));
-	if (rec == NULL) {
-		DEBUG(10, ("notify_add_onelevel: fetch_locked for %s failed"
-			   "\n", file_id_string_tos(&e->dir_id)));
-		TALLOC_FREE(array);
-		return;
-	}
-
-	blob.data = (uint8_t *)rec->value.dptr;
-	blob.length = rec->value.dsize;
-
-	if (blob.length > 0) {
-		ndr_err = ndr_pull_struct_blob(
-			&blob, array, NULL, array,
-			(ndr_pull_flags_fn_t)ndr_pull_notify_entry_array);
-		if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
-			DEBUG(10, ("ndr_pull_notify_entry_array failed: %s\n",
-				   ndr_errstr(ndr_err)));
-			TALLOC_FREE(array);
-			return;
-		}
-		if (DEBUGLEVEL >= 10) {
-			DEBUG(10, ("notify_add_onelevel:\n"));
-			NDR_PRINT_DEBUG(notify_entry_array, array);
-		}
-	}
-
-	array->entries = talloc_realloc(array, array->entries,
-					struct notify_entry,
-					array->num_entries+1);
-	if (array->entries == NULL) {
-		TALLOC_FREE(array);
-		return;
-	}
-	array->entries[array->num_entries] = *e;
-	array->entries[array->num_entries].private_data = private_data;
-	array->entries[array->num_entries].server = notify->server;
-	array->num_entries += 1;
-
-	ndr_err = ndr_push_struct_blob(
-		&blob, rec, NULL, array,
-		(ndr_push_flags_fn_t)ndr_push_notify_entry_array);
-	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
-		DEBUG(10, ("ndr_push_notify_entry_array failed: %s\n",
-			   ndr_errstr(ndr_err)));
-		TALLOC_FREE(array);
-		return;
-	}
-
-	if (DEBUGLEVEL >= 10) {
-		DEBUG(10, ("notify_add_onelevel:\n"));
-		NDR_PRINT_DEBUG(notify_entry_array, array);
-	}
-
-	dbuf.dptr = blob.data;
-	dbuf.dsize = blob.length;
-
-	status = rec->store(rec, dbuf, TDB_REPLACE);
-	TALLOC_FREE(array);
+	status = notify_add_entry(
+		notify, notify->db_onelevel,
+		make_tdb_data((uint8_t *)&e->dir_id, sizeof(e->dir_id)),
+		e, private_data);
 	if (!NT_STATUS_IS_OK(status)) {
-		DEBUG(10, ("notify_add_onelevel: store failed: %s\n",
+		DEBUG(10, ("notify_add_onelevel: adding %s failed: %s\n",
+			   file_id_string_tos(&e->dir_id),
 			   nt_errstr(status)));
 		return;
 	}
@@ -458,22 +369,13 @@ NTSTATUS notify_add(struct notify_context *notify, struct notify_entry *e0,
 	char *tmp_path = NULL;
 	struct notify_list *listel;
 	size_t len;
-	int depth;
-	struct db_record *rec;
 
 	/* see if change notify is enabled at all */
 	if (notify == NULL) {
 		return NT_STATUS_NOT_IMPLEMENTED;
 	}
 
-	status = notify_fetch_locked(notify, &rec);
-	NT_STATUS_NOT_OK_RETURN(status);
-
-	status = notify_load(notify, rec);
-	if (!NT_STATUS_IS_OK(status)) {
-		talloc_free(rec);
-		return status;
-	}
+	status = NT_STATUS_OK;
 
 	/* cope with /. on the end of the path */
 	len = strlen(e.path);
@@ -486,8 +388,6 @@ NTSTATUS notify_add(struct notify_context *notify, struct notify_entry *e0,
 		e.path = tmp_path;
 	}
 
-	depth = count_chars(e.path, '/');
-
 	listel = TALLOC_ZERO_P(notify, struct notify_list);
 	if (listel == NULL) {
 		status = NT_STATUS_NO_MEMORY;
@@ -496,7 +396,6 @@ NTSTATUS notify_add(struct notify_context *notify, struct notify_entry *e0,
 
 	listel->private_data = private_data;
 	listel->callback = callback;
-	listel->depth = depth;
 	DLIST_ADD(notify->list, listel);
 
 	/* ignore failures from sys_notify */
@@ -523,11 +422,20 @@ NTSTATUS notify_add(struct notify_context *notify, struct notify_entry *e0,
 	   then we need to install it in the array used for the
 	   intra-samba notify handling */
 	if (e.filter != 0 || e.subdir_filter != 0) {
-		status = notify_add_array(notify, rec, &e, private_data, depth);
+		listel->path = talloc_strdup(listel, e.path);
+		if (listel->path == NULL) {
+			status = NT_STATUS_NO_MEMORY;
+			goto done;
+		}
+		status = notify_add_entry(notify, notify->db_recursive,
+					  string_tdb_data(e.path), &e,
+					  private_data);
+		if (!NT_STATUS_IS_OK(status)) {
+			TALLOC_FREE(listel->path);
+		}
 	}
 
 done:
-	talloc_free(rec);
 	talloc_free(tmp_path);
 
 	return status;
@@ -537,100 +445,13 @@ NTSTATUS notify_remove_onelevel(struct notify_context *notify,
 				const struct file_id *fid,
 				void *private_data)
 {
-	struct notify_entry_array *array;
-	struct db_record *rec;
-	DATA_BLOB blob;
-	TDB_DATA dbuf;
-	enum ndr_err_code ndr_err;
-	NTSTATUS status;
-	int i;
-
 	if (notify == NULL) {
 		return NT_STATUS_NOT_IMPLEMENTED;
 	}
 
-	array = talloc_zero(talloc_tos(), struct notify_entry_array);
-	if (array == NULL) {
-		return NT_STATUS_NO_MEMORY;
-	}
-
-	rec = notify->db_onelevel->fetch_locked(
-		notify->db_onelevel, array,
-		make_tdb_data((uint8_t *)fid, sizeof(*fid)));
-	if (rec == NULL) {
-		DEBUG(10, ("notify_remove_onelevel: fetch_locked for %s failed"
-			   "\n", file_id_string_tos(fid)));
-		TALLOC_FREE(array);
-		return NT_STATUS_INTERNAL_DB_CORRUPTION;
-	}
-
-	blob.data = (uint8_t *)rec->value.dptr;
-	blob.length = rec->value.dsize;
-
-	if (blob.length > 0) {
-		ndr_err = ndr_pull_struct_blob(
-			&blob, array, NULL, array,
-			(ndr_pull_flags_fn_t)ndr_pull_notify_entry_array);
-		if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
-			DEBUG(10, ("ndr_pull_notify_entry_array failed: %s\n",
-				   ndr_errstr(ndr_err)));
-			TALLOC_FREE(array);
-			return ndr_map_error2ntstatus(ndr_err);
-		}
-		if (DEBUGLEVEL >= 10) {
-			DEBUG(10, ("notify_remove_onelevel:\n"));
-			NDR_PRINT_DEBUG(notify_entry_array, array);
-		}
-	}
-
-	for (i=0; i<array->num_entries; i++) {
-		if ((private_data == array->entries[i].private_data) &&
-		    cluster_id_equal(&notify->server,
-				     &array->entries[i].server)) {
-			break;
-		}
-	}
-
-	if (i == array->num_entries) {
-		TALLOC_FREE(array);
-		return NT_STATUS_OBJECT_NAME_NOT_FOUND;
-	}
-
-	array->entries[i] = array->entries[array->num_entries-1];
-	array->num_entries -= 1;
-
-	if (array->num_entries == 0) {
-		rec->delete_rec(rec);
-		TALLOC_FREE(array);
-		return NT_STATUS_OK;
-	}
-
-	ndr_err = ndr_push_struct_blob(
-		&blob, rec, NULL, array,
-		(ndr_push_flags_fn_t)ndr_push_notify_entry_array);
-	if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
-		DEBUG(10, ("ndr_push_notify_entry_array failed: %s\n",
-			   ndr_errstr(ndr_err)));
-		TALLOC_FREE(array);
-		return ndr_map_error2ntstatus(ndr_err);
-	}
-
-	if (DEBUGLEVEL >= 10) {
-		DEBUG(10, ("notify_add_onelevel:\n"));
-		NDR_PRINT_DEBUG(notify_entry_array, array);
-	}
-
-	dbuf.dptr = blob.data;
-	dbuf.dsize = blob.length;
-
-	status = rec->store(rec, dbuf, TDB_REPLACE);
-	TALLOC_FREE(array);
-	if (!NT_STATUS_IS_OK(status)) {
-		DEBUG(10, ("notify_add_onelevel: store failed: %s\n",
-			   nt_errstr(status)));
-		return status;
-	}
-	return NT_STATUS_OK;
+	return notify_del_entry(notify->db_onelevel,
+				make_tdb_data((uint8_t *)fid, sizeof(*fid)),
+				&notify->server, private_data);
 }
 
 /*
@@ -640,9 +461,6 @@ NTSTATUS notify_remove(struct notify_context *notify, void *private_data)
 {
 	NTSTATUS status;
 	struct notify_list *listel;
-	int i, depth;
-	struct notify_depth *d;
-	struct db_record *rec;
 
 	/* see if change notify is enabled at all */
 	if (notify == NULL) {
@@ -659,97 +477,21 @@ NTSTATUS notify_remove(struct notify_context *notify, void *private_data)
 		return NT_STATUS_OBJECT_NAME_NOT_FOUND;
 	}
 
-	depth = listel->depth;
-
-	talloc_free(listel);
-
-	status = notify_fetch_locked(notify, &rec);
-	NT_STATUS_NOT_OK_RETURN(status);
-
-	status = notify_load(notify, rec);
-	if (!NT_STATUS_IS_OK(status)) {
-		talloc_free(rec);
-		return status;
-	}
-
-	if (depth >= notify->array->num_depths) {
-		talloc_free(rec);
-		return NT_STATUS_OBJECT_NAME_NOT_FOUND;
-	}
-
-	/* we only have to search at the depth of this element */
-	d = &notify->array->depth[depth];
-
-	for (i=0;i<d->num_entries;i++) {
-		if (private_data == d->entries[i].private_data &&
-		    cluster_id_equal(&notify->server, &d->entries[i].server)) {
-			break;
-		}
-	}
-	if (i == d->num_entries) {
-		talloc_free(rec);
-		return NT_STATUS_OBJECT_NAME_NOT_FOUND;
-	}
-
-	if (i < d->num_entries-1) {
-		memmove(&d->entries[i], &d->entries[i+1], 
-			sizeof(d->entries[i])*(d->num_entries-(i+1)));
-	}
-	d->num_entries--;
-
-	status = notify_save(notify, rec);
-
-	talloc_free(rec);
-
-	return status;
-}
-
-/*
-  remove all notify watches for a messaging server
-*/
-static NTSTATUS notify_remove_all(struct notify_context *notify,
-				  const struct server_id *server)
-{
-	NTSTATUS status;
-	int i, depth, del_count=0;
-	struct db_record *rec;
-
-	status = notify_fetch_locked(notify, &rec);
-	NT_STATUS_NOT_OK_RETURN(status);
-
-	status = notify_load(notify, rec);
-	if (!NT_STATUS_IS_OK(status)) {
-		talloc_free(rec);
-		return status;
-	}
-
-	/* we have to search for all entries across all depths, looking for matches
-	   for the server id */
-	for (depth=0;depth<notify->array->num_depths;depth++) {
-		struct notify_depth *d = &notify->array->depth[depth];
-		for (i=0;i<d->num_entries;i++) {
-			if (cluster_id_equal(server, &d->entries[i].server)) {
-				if (i < d->num_entries-1) {
-					memmove(&d->entries[i], &d->entries[i+1], 
-						sizeof(d->entries[i])*(d->num_entries-(i+1)));
-				}
-				i--;
-				d->num_entries--;
-				del_count++;
-			}
-		}
+	/* everything was handled by sys_notify or the onelevel db */
+	if (listel->path == NULL) {
+		talloc_free(listel);
+		return NT_STATUS_OK;
 	}
 
-	if (del_count > 0) {
-		status = notify_save(notify, rec);
-	}
+	status = notify_del_entry(notify->db_recursive,
+				  string_tdb_data(listel->path),
+				  &notify->server, private_data);
 
-	talloc_free(rec);
+	talloc_free(listel);
 
 	return status;
 }
 
-
 /*
   send a notify message to another messaging server
 */
@@ -786,53 +528,31 @@ void notify_onelevel(struct notify_context *notify, uint32_t action,
 {
 	struct notify_entry_array *array;
 	TDB_DATA dbuf;
-	DATA_BLOB blob;
 	bool have_dead_entries = false;
+	NTSTATUS status;
 	int i;
 
 	if (notify == NULL) {
 		return;
 	}
 
-	array = talloc_zero(talloc_tos(), struct notify_entry_array);
-	if (array == NULL) {
-		return;
-	}
-
 	if (notify->db_onelevel->fetch(
-		    notify->db_onelevel, array,
+		    notify->db_onelevel, talloc_tos(),
 		    make_tdb_data((uint8_t *)&fid, sizeof(fid)),
 		    &dbuf) == -1) {
-		TALLOC_FREE(array);
 		return;
 	}
 
-	blob.data = (uint8 *)dbuf.dptr;
-	blob.length = dbuf.dsize;
-
-	if (blob.length > 0) {
-		enum ndr_err_code ndr_err;
-		ndr_err = ndr_pull_struct_blob(
-			&blob, array, NULL, array,
-			(ndr_pull_flags_fn_t)ndr_pull_notify_entry_array);
-		if (!NDR_ERR_CODE_IS_SUCCESS(ndr_err)) {
-			DEBUG(10, ("ndr_pull_notify_entry_array failed: %s\n",
-				   ndr_errstr(ndr_err)));
-			TALLOC_FREE(array);
-			return;
-		}
-		if (DEBUGLEVEL >= 10) {
-			DEBUG(10, ("notify_onelevel:\n"));
-			NDR_PRINT_DEBUG(notify_entry_array, array);
-		}
+	status = notify_pull_entries(talloc_tos(), dbuf, &array);
+	TALLOC_FREE(dbuf.dptr);
+	if (!NT_STATUS_IS_OK(status)) {
+		return;
 	}
 
 	for (i=0; i<array->num_entries; i++) {
 		struct notify_entry *e = &array->entries[i];
 
 		if ((e->filter & filter) != 0) {
-			NTSTATUS status;
-
 			status = notify_send(notify, e, name, action);
 			if (NT_STATUS_EQUAL(
 				    status, NT_STATUS_INVALID_HANDLE)) {
@@ -873,115 +593,90 @@ void notify_onelevel(struct notify_context *notify, uint32_t action,
 }
 
 /*
-  trigger a notify message for anyone waiting on a matching event
-
-  This function is called a lot, and needs to be very fast. The unusual data structure
-  and traversal is designed to be fast in the average case, even for large numbers of
-  notifies
+  send a change to everyone watching the directory that is the first
+  dir_len bytes of path. subdir says whether the change is below that
+  directory rather than directly in it
 */
-void notify_trigger(struct notify_context *notify,
-		    uint32_t action, uint32_t filter, const char *path)
+static void notify_trigger_dir(struct notify_context *notify,
+			       uint32_t action, uint32_t filter,
+			       const char *path, size_t dir_len, bool subdir)
 {
+	TDB_DATA key = make_tdb_data((const uint8_t *)path, dir_len);
+	struct notify_entry_array *array;
+	TDB_DATA dbuf;
 	NTSTATUS status;
-	int depth;
-	const char *p, *next_p;
-
-	DEBUG(10, ("notify_trigger called action=0x%x, filter=0x%x, "
-		   "path=%s\n", (unsigned)action, (unsigned)filter, path));
+	int i;
 
-	/* see if change notify is enabled at all */
-	if (notify == NULL) {
+	if (notify->db_recursive->fetch(notify->db_recursive, talloc_tos(),
+					key, &dbuf) == -1) {
+		return;
+	}
+	if (dbuf.dptr == NULL) {
+		/* nobody watches this directory */
 		return;
 	}
 
- again:
-	status = notify_load(notify, NULL);
+	status = notify_pull_entries(talloc_tos(), dbuf, &array);
+	TALLOC_FREE(dbuf.dptr);
 	if (!NT_STATUS_IS_OK(status)) {
 		return;
 	}
 
-	/* loop along the given path, working with each directory depth separately */
-	for (depth=0,p=path;
-	     p && depth < notify->array->num_depths;
-	     p=next_p,depth++) {
-		int p_len = p - path;
-		int min_i, max_i, i;
-		struct notify_depth *d = &notify->array->depth[depth];
-		next_p = strchr(p+1, '/');
-
-		/* see if there are any entries at this depth */
-		if (d->num_entries == 0) continue;
+	for (i=0; i<array->num_entries; i++) {
+		struct notify_entry *e = &array->entries[i];
 
-		/* try to skip based on the maximum mask. If next_p is
-		 NULL then we know it will be a 'this directory'
-		 match, otherwise it must be a subdir match */
-		if (next_p != NULL) {
-			if (0 == (filter & d->max_mask_subdir)) {
+		if (subdir) {
+			if (0 == (filter & e->subdir_filter)) {
 				continue;
 			}
 		} else {
-			if (0 == (filter & d->max_mask)) {
+			if (0 == (filter & e->filter)) {
 				continue;
 			}
 		}
 
-		/* we know there is an entry here worth looking
-		 for. Use a bisection search to find the first entry
-		 with a matching path */
-		min_i = 0;
-		max_i = d->num_entries-1;
-
-		while (min_i < max_i) {
-			struct notify_entry *e;
-			int cmp;
-			i = (min_i+max_i)/2;
-			e = &d->entries[i];
-			cmp = strncmp(path, e->path, p_len);
-			if (cmp == 0) {
-				if (p_len == e->path_len) {
-					max_i = i;
-				} else {
-					max_i = i-1;
-				}
-			} else if (cmp < 0) {
-				max_i = i-1;
-			} else {
-				min_i = i+1;
-			}
-		}
+		status = notify_send(notify, e, path + dir_len + 1, action);
 
-		if (min_i != max_i) {
-			/* none match */
-			continue;
+		if (NT_STATUS_EQUAL(status, NT_STATUS_INVALID_HANDLE)) {
+			DEBUG(10, ("Deleting notify entry for process %s "
+				   "because it's gone\n",
+				   procid_str_static(&e->server)));
+			notify_del_entry(notify->db_recursive, key,
+					 &e->server, e->private_data);
 		}
+	}
 
-		/* we now know that the entries start at min_i */
-		for (i=min_i;i<d->num_entries;i++) {
-			struct notify_entry *e = &d->entries[i];
-			if (p_len != e->path_len ||
-			    strncmp(path, e->path, p_len) != 0) break;
-			if (next_p != NULL) {
-				if (0 == (filter & e->subdir_filter)) {
-					continue;
-				}
-			} else {
-				if (0 == (filter & e->filter)) {
-					continue;
-				}
-			}
-			status = notify_send(notify, e,	path + e->path_len + 1,
-					     action);
+	TALLOC_FREE(array);
+}
 
-			if (NT_STATUS_EQUAL(
-				    status, NT_STATUS_INVALID_HANDLE)) {
-				struct server_id server = e->server;
+/*
+  trigger a notify message for anyone waiting on a matching event
 
-				DEBUG(10, ("Deleting notify entries for "
-					   "process %s because it's gone\n",
-					   procid_str_static(&e->server)));
-				notify_remove_all(notify, &server);
-				goto again;
-			}
+  This function is called a lot, and needs to be very fast. The
+  watchers are stored under the path they watch, so we only look at
+  the records of the directories above path, however many other
+  watchers there are
+*/
+void notify_trigger(struct notify_context *notify,
+		    uint32_t action, uint32_t filter, const char *path)
+{
+	const char *p, *next_p;
+
+	DEBUG(10, ("notify_trigger called action=0x%x, filter=0x%x, "
+		   "path=%s\n", (unsigned)action, (unsigned)filter, path));
+
+	/* see if change notify is enabled at all */
+	if (notify == NULL) {
+		return;
+	}
+
+	/* loop along the given path, looking up each parent directory */
+	for (p=path; p != NULL; p=next_p) {
+		next_p = strchr(p+1, '/');
+		if (p == path) {
+			continue;
 		}
+		notify_trigger_dir(notify, action, filter, path, p - path,
+				   next_p != NULL);
 	}
 }
@@ -70,8 +70,10 @@ NTSTATUS smbd_check_open_rights(struct connection_struct *conn,
 				uint32_t *access_granted)
 {
 	/* Check if we have rights to open. */
+	static struct latency_counter *get_nt_acl_latency;
 	NTSTATUS status;
 	struct security_descriptor *sd = NULL;
+	uint64_t start;
 
 	*access_granted = 0;
 
@@ -84,10 +86,12 @@ NTSTATUS smbd_check_open_rights(struct connection_struct *conn,
 		return NT_STATUS_OK;
 	}
 
+	start = latency_now();
 	status = SMB_VFS_GET_NT_ACL(conn, smb_fname->base_name,
 			(OWNER_SECURITY_INFORMATION |
 			GROUP_SECURITY_INFORMATION |
 			DACL_SECURITY_INFORMATION),&sd);
+	latency_record(&get_nt_acl_latency, "VFS", "get_nt_acl", start);
 
 	if (!NT_STATUS_IS_OK(status)) {
 		DEBUG(10, ("smbd_check_open_rights: Could not get acl "
@@ -131,8 +135,10 @@ static NTSTATUS fd_open(struct connection_struct *conn,
 		    int flags,
 		    mode_t mode)
 {
+	static struct latency_counter *open_latency;
 	struct smb_filename *smb_fname = fsp->fsp_name;
 	NTSTATUS status = NT_STATUS_OK;
+	uint64_t start;
 
 #ifdef O_NOFOLLOW
 	/* 
@@ -145,7 +151,9 @@ static NTSTATUS fd_open(struct connection_struct *conn,
 	}
 #endif
 
+	start = latency_now();
 	fsp->fh->fd = SMB_VFS_OPEN(conn, smb_fname, fsp, flags, mode);
+	latency_record(&open_latency, "VFS", "open", start);
 	if (fsp->fh->fd == -1) {
 		status = map_nt_error_from_unix(errno);
 		if (errno == EMFILE) {
@@ -354,7 +354,12 @@ static void add_oplock_timeout_handler(files_struct *fsp)
 	}
 }
 
-void break_level2_to_none_async(files_struct *fsp)
+/****************************************************************************
+ Tell the client its level2 oplock is gone. Returns false if there is no
+ oplock left to remove.
+****************************************************************************/
+
+static bool send_level2_break_to_none(files_struct *fsp)
 {
 	char *break_msg;
 
@@ -363,15 +368,14 @@ void break_level2_to_none_async(files_struct *fsp)
 		 * it.  just ignore. */
 		DEBUG(3, ("process_oplock_async_level2_break_message: already "
 			  "broken to none, ignoring.\n"));
-		return;
+		return False;
 	}
 
 	if (fsp->oplock_type == FAKE_LEVEL_II_OPLOCK) {
 		/* Don't tell the client, just downgrade. */
 		DEBUG(3, ("process_oplock_async_level2_break_message: "
 			  "downgrading fake level 2 oplock.\n"));
-		remove_oplock(fsp);
-		return;
+		return True;
 	}
 
 	/* Ensure we're really at level2 state. */
@@ -396,10 +400,17 @@ void break_level2_to_none_async(files_struct *fsp)
 	}
 
 	TALLOC_FREE(break_msg);
+	return True;
+}
+
+void break_level2_to_none_async(files_struct *fsp)
+{
+	if (!send_level2_break_to_none(fsp)) {
+		return;
+	}
 
 	/* Async level2 request, don't send a reply, just remove the oplock. */
 	remove_oplock(fsp);
-
 }
 
 /*******************************************************************
@@ -408,6 +419,9 @@ void break_level2_to_none_async(files_struct *fsp)
  When we get this message we may be in any of three states :
  NO_OPLOCK, LEVEL_II, FAKE_LEVEL2. We only send a message to
  the client for LEVEL2.
+ The message carries all the share mode entries of this process
+ for one file. The clients are told first, then all the oplocks
+ are removed under a single share mode lock.
 *******************************************************************/
 
 void process_oplock_async_level2_break_message(struct messaging_context *msg_ctx,
@@ -416,37 +430,90 @@ void process_oplock_async_level2_break_message(struct messaging_context *msg_ctx
 						      struct server_id src,
 						      DATA_BLOB *data)
 {
-	struct share_mode_entry msg;
-	files_struct *fsp;
+	struct share_mode_lock *lck = NULL;
+	files_struct **fsps;
+	size_t i, num_entries, num_fsps;
 
 	if (data->data == NULL) {
 		DEBUG(0, ("Got NULL buffer\n"));
 		return;
 	}
 
-	if (data->length != MSG_SMB_SHARE_MODE_ENTRY_SIZE) {
+	if ((data->length == 0) ||
+	    (data->length % MSG_SMB_SHARE_MODE_ENTRY_SIZE != 0)) {
 		DEBUG(0, ("Got invalid msg len %d\n", (int)data->length));
 		return;
 	}
 
-	/* De-linearize incoming message. */
-	message_to_share_mode_entry(&msg, (char *)data->data);
+	num_entries = data->length / MSG_SMB_SHARE_MODE_ENTRY_SIZE;
 
-	DEBUG(10, ("Got oplock async level 2 break message from pid %s: "
-		   "%s/%lu\n", procid_str(talloc_tos(), &src),
-		   file_id_string_tos(&msg.id), msg.share_file_id));
+	fsps = TALLOC_ARRAY(talloc_tos(), files_struct *, num_entries);
+	if (fsps == NULL) {
+		DEBUG(0, ("talloc failed\n"));
+		return;
+	}
+	num_fsps = 0;
+
+	for (i = 0; i < num_entries; i++) {
+		struct share_mode_entry msg;
+		files_struct *fsp;
+
+		/* De-linearize incoming message. */
+		message_to_share_mode_entry(
+			&msg,
+			(char *)data->data + i * MSG_SMB_SHARE_MODE_ENTRY_SIZE);
+
+		DEBUG(10, ("Got oplock async level 2 break message from pid "
+			   "%s: %s/%lu\n", procid_str(talloc_tos(), &src),
+			   file_id_string_tos(&msg.id), msg.share_file_id));
+
+		fsp = initial_break_processing(msg.id, msg.share_file_id);
+
+		if (fsp == NULL) {
+			/* We hit a race here. Break messages are sent, and
+			 * before we get to process this message, we have
+			 * closed the file. No need to reply as this is an
+			 * async message. */
+			DEBUG(3, ("process_oplock_async_level2_break_message: "
+				  "Did not find fsp, ignoring\n"));
+			continue;
+		}
 
-	fsp = initial_break_processing(msg.id, msg.share_file_id);
+		if (send_level2_break_to_none(fsp)) {
+			fsps[num_fsps++] = fsp;
+		}
+	}
 
-	if (fsp == NULL) {
-		/* We hit a race here. Break messages are sent, and before we
-		 * get to process this message, we have closed the file. 
-		 * No need to reply as this is an async message. */
-		DEBUG(3, ("process_oplock_async_level2_break_message: Did not find fsp, ignoring\n"));
-		return;
+	/* Async level2 request, don't send a reply, just remove the oplocks. */
+
+	for (i = 0; i < num_fsps; i++) {
+		files_struct *fsp = fsps[i];
+
+		if ((lck != NULL) && !file_id_equal(&lck->id, &fsp->file_id)) {
+			TALLOC_FREE(lck);
+		}
+		if (lck == NULL) {
+			lck = get_share_mode_lock(talloc_tos(), fsp->file_id,
+						  NULL, NULL, NULL);
+		}
+		if (lck == NULL) {
+			DEBUG(0,("process_oplock_async_level2_break_message: "
+				 "failed to lock share entry for file %s\n",
+				 fsp_str_dbg(fsp)));
+			continue;
+		}
+		if (!remove_share_oplock(lck, fsp)) {
+			DEBUG(0,("process_oplock_async_level2_break_message: "
+				 "failed to remove share oplock for file %s "
+				 "fnum %d, %s\n",
+				 fsp_str_dbg(fsp), fsp->fnum,
+				 file_id_string_tos(&fsp->file_id)));
+		}
+		release_file_oplock(fsp);
 	}
 
-	break_level2_to_none_async(fsp);
+	TALLOC_FREE(lck);
+	TALLOC_FREE(fsps);
 }
 
 /*******************************************************************
@@ -716,6 +783,76 @@ static void process_open_retry_message(struct messaging_context *msg_ctx,
 	schedule_deferred_open_smb_message(msg.op_mid);
 }
 
+/****************************************************************************
+ Sort share mode entries by the process holding them.
+****************************************************************************/
+
+static int compare_share_mode_entry_pids(const void *p1, const void *p2)
+{
+	const struct share_mode_entry *e1 =
+		*(const struct share_mode_entry * const *)p1;
+	const struct share_mode_entry *e2 =
+		*(const struct share_mode_entry * const *)p2;
+
+	if (e1->pid.pid != e2->pid.pid) {
+		return (e1->pid.pid < e2->pid.pid) ? -1 : 1;
+	}
+#ifdef CLUSTER_SUPPORT
+	if (e1->pid.vnn != e2->pid.vnn) {
+		return (e1->pid.vnn < e2->pid.vnn) ? -1 : 1;
+	}
+#endif
+	return 0;
+}
+
+/* Entries per MSG_SMB_ASYNC_LEVEL2_BREAK, keeps it below 64k */
+#define LEVEL2_BREAK_BATCH_SIZE 512
+
+/****************************************************************************
+ Send the level2 break messages for a file, one message for all the
+ entries a process holds.
+****************************************************************************/
+
+static void send_level2_break_messages(struct share_mode_entry **entries,
+				       int num_entries)
+{
+	int i, j, k;
+
+	qsort(entries, num_entries, sizeof(struct share_mode_entry *),
+	      compare_share_mode_entry_pids);
+
+	for (i = 0; i < num_entries; i = j) {
+		char *msg;
+
+		for (j = i + 1; j < num_entries; j++) {
+			if ((j - i == LEVEL2_BREAK_BATCH_SIZE) ||
+			    !procid_equal(&entries[j]->pid, &entries[i]->pid)) {
+				break;
+			}
+		}
+
+		msg = TALLOC_ARRAY(talloc_tos(), char,
+				   (j - i) * MSG_SMB_SHARE_MODE_ENTRY_SIZE);
+		if (msg == NULL) {
+			DEBUG(0, ("talloc failed\n"));
+			return;
+		}
+
+		for (k = i; k < j; k++) {
+			share_mode_entry_to_message(
+				msg + (k - i) * MSG_SMB_SHARE_MODE_ENTRY_SIZE,
+				entries[k]);
+		}
+
+		messaging_send_buf(smbd_messaging_context(),
+				   entries[i]->pid,
+				   MSG_SMB_ASYNC_LEVEL2_BREAK,
+				   (uint8 *)msg,
+				   (j - i) * MSG_SMB_SHARE_MODE_ENTRY_SIZE);
+		TALLOC_FREE(msg);
+	}
+}
+
 /****************************************************************************
  This function is called on any file modification or lock request. If a file
  is level 2 oplocked then it must tell all other level 2 holders to break to
@@ -727,6 +864,8 @@ static void contend_level2_oplocks_begin_default(files_struct *fsp,
 {
 	int i;
 	struct share_mode_lock *lck;
+	struct share_mode_entry **breaks;
+	int num_breaks = 0;
 
 	/*
 	 * If this file is level II oplocked then we need
@@ -750,9 +889,16 @@ static void contend_level2_oplocks_begin_default(files_struct *fsp,
 	DEBUG(10,("release_level_2_oplocks_on_change: num_share_modes = %d\n", 
 		  lck->num_share_modes ));
 
+	breaks = TALLOC_ARRAY(lck, struct share_mode_entry *,
+			      lck->num_share_modes);
+	if (breaks == NULL) {
+		DEBUG(0, ("talloc failed\n"));
+		TALLOC_FREE(lck);
+		return;
+	}
+
 	for(i = 0; i < lck->num_share_modes; i++) {
 		struct share_mode_entry *share_entry = &lck->share_modes[i];
-		char msg[MSG_SMB_SHARE_MODE_ENTRY_SIZE];
 
 		if (!is_valid_share_mode_entry(share_entry)) {
 			continue;
@@ -786,8 +932,6 @@ static void contend_level2_oplocks_begin_default(files_struct *fsp,
 			abort();
 		}
 
-		share_mode_entry_to_message(msg, share_entry);
-
 		/*
 		 * Deal with a race condition when breaking level2
  		 * oplocks. Don't send all the messages and release
@@ -804,14 +948,18 @@ static void contend_level2_oplocks_begin_default(files_struct *fsp,
 			wait_before_sending_break();
 			break_level2_to_none_async(fsp);
 		} else {
-			messaging_send_buf(smbd_messaging_context(),
-					share_entry->pid,
-					MSG_SMB_ASYNC_LEVEL2_BREAK,
-					(uint8 *)msg,
-					MSG_SMB_SHARE_MODE_ENTRY_SIZE);
+			breaks[num_breaks++] = share_entry;
 		}
 	}
 
+	/*
+	 * Other processes get one message each with all their entries,
+	 * so a file held by many clients doesn't flood the messaging
+	 * layer.
+	 */
+
+	send_level2_break_messages(breaks, num_breaks);
+
 	/* We let the message receivers handle removing the oplock state
 	   in the share mode lock db. */
 
@@ -177,6 +177,9 @@ bool smb_perfcount_init(void)
 
 	perfcount_object = lp_perfcount_module();
 
+	/* built in modules */
+	perfcount_latency_init();
+
 	/* don't init */
 	if (!perfcount_object || !perfcount_object[0])
 		return True;
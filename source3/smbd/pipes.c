@@ -201,6 +201,7 @@ void reply_pipe_write(struct smb_request *req)
 		reply_nterror(req, NT_STATUS_NO_MEMORY);
 		return;
 	}
+	SMB_PERFCOUNT_DEFER_OP(&req->pcd, &req->pcd);
 	tevent_req_set_callback(subreq, pipe_write_done,
 				talloc_move(req->conn, &req));
 }
@@ -317,6 +318,7 @@ void reply_pipe_write_and_X(struct smb_request *req)
 		reply_nterror(req, NT_STATUS_NO_MEMORY);
 		return;
 	}
+	SMB_PERFCOUNT_DEFER_OP(&req->pcd, &req->pcd);
 	tevent_req_set_callback(subreq, pipe_write_andx_done,
 				talloc_move(req->conn, &req));
 }
@@ -424,6 +426,7 @@ void reply_pipe_read_and_X(struct smb_request *req)
 		reply_nterror(req, NT_STATUS_NO_MEMORY);
 		return;
 	}
+	SMB_PERFCOUNT_DEFER_OP(&req->pcd, &req->pcd);
 	tevent_req_set_callback(subreq, pipe_read_andx_done,
 				talloc_move(req->conn, &req));
 }
@@ -2772,8 +2772,8 @@ static void fail_readraw(void)
  Fake (read/write) sendfile. Returns -1 on read or write fail.
 ****************************************************************************/
 
-static ssize_t fake_sendfile(files_struct *fsp, SMB_OFF_T startpos,
-			     size_t nread)
+ssize_t fake_sendfile(files_struct *fsp, SMB_OFF_T startpos,
+		      size_t nread)
 {
 	size_t bufsize;
 	size_t tosend = nread;
@@ -2827,10 +2827,10 @@ static ssize_t fake_sendfile(files_struct *fsp, SMB_OFF_T startpos,
  requested. Fill with zeros (all we can do).
 ****************************************************************************/
 
-static void sendfile_short_send(files_struct *fsp,
-				ssize_t nread,
-				size_t headersize,
-				size_t smb_maxcnt)
+void sendfile_short_send(files_struct *fsp,
+			 ssize_t nread,
+			 size_t headersize,
+			 size_t smb_maxcnt)
 {
 #define SHORT_SEND_BUFSIZE 1024
 	if (nread < headersize) {
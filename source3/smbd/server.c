@@ -96,6 +96,7 @@ static void smb_conf_updated(struct messaging_context *msg,
 		  "updated. Reloading.\n"));
 	change_to_root_user();
 	reload_services(False);
+	dir_listing_cache_init();
 }
 
 
@@ -870,6 +871,7 @@ static void exit_server_common(enum server_exit_reason how,
 	}
 #endif
 
+	latency_flush();
 	locking_end();
 	printing_end();
 
@@ -1269,6 +1271,10 @@ extern void build_options(bool screen);
 		exit(1);
 	}
 
+	dir_listing_cache_init();
+
+	smbd_latency_init();
+
 	/* only start the background queue daemon if we are 
 	   running as a daemon -- bad things will happen if
 	   smbd is launched via inetd and we fork a copy of 
@@ -170,11 +170,55 @@ static void smbd_smb2_request_read_done(struct tevent_req *subreq)
 
 struct smbd_smb2_read_state {
 	struct smbd_smb2_request *smb2req;
+	files_struct *fsp;
+	struct lock_struct lock;
 	DATA_BLOB out_data;
 	uint32_t out_remaining;
 };
 
 static void smbd_smb2_read_pipe_done(struct tevent_req *subreq);
+static void smbd_smb2_read_aio_done(struct tevent_req *subreq);
+
+/*
+ * Can the response data be sent with sendfile? Only for a single
+ * unsigned request that reads completely from a regular file, the
+ * response header has to carry the final length before any data is
+ * sent. Short reads take the normal path.
+ */
+
+static bool smbd_smb2_read_sendfile_possible(struct smbd_smb2_request *smb2req,
+					     files_struct *fsp,
+					     uint64_t in_offset,
+					     uint32_t in_length)
+{
+#if defined(WITH_SENDFILE)
+	if (smb2req->do_signing) {
+		return false;
+	}
+	if (smb2req->in.vector_count != 4) {
+		/* compound request */
+		return false;
+	}
+	if (!lp_use_sendfile(SNUM(fsp->conn), NULL)) {
+		return false;
+	}
+	if ((fsp->base_fsp != NULL) || (fsp->wcp != NULL) ||
+	    fsp->print_file || (in_length == 0)) {
+		return false;
+	}
+	if (fsp_stat(fsp) == -1) {
+		return false;
+	}
+	if (!S_ISREG(fsp->fsp_name->st.st_ex_mode) ||
+	    (in_offset >= fsp->fsp_name->st.st_ex_size) ||
+	    (in_length > (fsp->fsp_name->st.st_ex_size - in_offset))) {
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
 
 static struct tevent_req *smbd_smb2_read_send(TALLOC_CTX *mem_ctx,
 					      struct tevent_context *ev,
@@ -225,11 +269,6 @@ static struct tevent_req *smbd_smb2_read_send(TALLOC_CTX *mem_ctx,
 		return tevent_req_post(req, ev);
 	}
 
-	state->out_data = data_blob_talloc(state, NULL, in_length);
-	if (in_length > 0 && tevent_req_nomem(state->out_data.data, req)) {
-		return tevent_req_post(req, ev);
-	}
-
 	if (IS_IPC(smbreq->conn)) {
 		struct tevent_req *subreq;
 
@@ -238,6 +277,12 @@ static struct tevent_req *smbd_smb2_read_send(TALLOC_CTX *mem_ctx,
 			return tevent_req_post(req, ev);
 		}
 
+		state->out_data = data_blob_talloc(state, NULL, in_length);
+		if (in_length > 0 &&
+		    tevent_req_nomem(state->out_data.data, req)) {
+			return tevent_req_post(req, ev);
+		}
+
 		subreq = np_read_send(state, smbd_event_context(),
 				      fsp->fake_file_handle,
 				      state->out_data.data,
@@ -268,6 +313,53 @@ static struct tevent_req *smbd_smb2_read_send(TALLOC_CTX *mem_ctx,
 		return tevent_req_post(req, ev);
 	}
 
+	if (smbd_smb2_read_sendfile_possible(smb2req, fsp,
+					     in_offset, in_length)) {
+		/*
+		 * The data is sent straight from the file when the
+		 * response goes out, the strict lock is dropped there.
+		 */
+		smb2req->sendfile.fsp = fsp;
+		smb2req->sendfile.gen_id = fsp->fh->gen_id;
+		smb2req->sendfile.offset = in_offset;
+		smb2req->sendfile.lock = lock;
+
+		state->out_data = data_blob_const(NULL, in_length);
+		state->out_remaining = 0;
+		tevent_req_done(req);
+		return tevent_req_post(req, ev);
+	}
+
+	state->out_data = data_blob_talloc(state, NULL, in_length);
+	if (in_length > 0 && tevent_req_nomem(state->out_data.data, req)) {
+		SMB_VFS_STRICT_UNLOCK(conn, fsp, &lock);
+		return tevent_req_post(req, ev);
+	}
+
+	if (smbd_aio_pthread_read_possible(fsp, in_length)) {
+		struct tevent_req *subreq;
+
+		/*
+		 * Don't block the other requests on this connection,
+		 * let a helper thread wait for the disk.
+		 */
+		state->fsp = fsp;
+		state->lock = lock;
+
+		subreq = smbd_aio_pread_send(state, ev, fsp,
+					     state->out_data.data,
+					     in_length,
+					     in_offset);
+		if (tevent_req_nomem(subreq, req)) {
+			SMB_VFS_STRICT_UNLOCK(conn, fsp, &lock);
+			return tevent_req_post(req, ev);
+		}
+		tevent_req_set_callback(subreq,
+					smbd_smb2_read_aio_done,
+					req);
+		return req;
+	}
+
 	nread = read_file(fsp,
 			  (char *)state->out_data.data,
 			  in_offset,
@@ -322,6 +414,40 @@ static void smbd_smb2_read_pipe_done(struct tevent_req *subreq)
 	tevent_req_done(req);
 }
 
+static void smbd_smb2_read_aio_done(struct tevent_req *subreq)
+{
+	struct tevent_req *req = tevent_req_callback_data(subreq,
+				 struct tevent_req);
+	struct smbd_smb2_read_state *state = tevent_req_data(req,
+					     struct smbd_smb2_read_state);
+	files_struct *fsp = state->fsp;
+	ssize_t nread;
+	int err = 0;
+
+	nread = smbd_aio_pread_recv(subreq, state, &err);
+	TALLOC_FREE(subreq);
+
+	SMB_VFS_STRICT_UNLOCK(fsp->conn, fsp, &state->lock);
+
+	if (nread < 0) {
+		DEBUG(5,("smbd_smb2_read: aio read[%s] failed: %s\n",
+			 fsp_str_dbg(fsp), strerror(err)));
+		tevent_req_nterror(req, NT_STATUS_ACCESS_DENIED);
+		return;
+	}
+	if (nread == 0 && state->out_data.length != 0) {
+		DEBUG(5,("smbd_smb2_read: aio read[%s] end of file\n",
+			 fsp_str_dbg(fsp)));
+		tevent_req_nterror(req, NT_STATUS_END_OF_FILE);
+		return;
+	}
+
+	state->out_data.length = nread;
+	state->out_remaining = 0;
+
+	tevent_req_done(req);
+}
+
 static NTSTATUS smbd_smb2_read_recv(struct tevent_req *req,
 				    TALLOC_CTX *mem_ctx,
 				    DATA_BLOB *out_data,
@@ -71,6 +71,9 @@ static NTSTATUS smbd_initialize_smb2(struct smbd_server_connection *sconn)
 
 	/* Ensure child is set to non-blocking mode */
 	set_blocking(smbd_server_fd(),false);
+
+	/* WRITE payloads for recvfile may go through splice */
+	sys_recvfile_try_splice();
 	return NT_STATUS_OK;
 }
 
@@ -105,8 +108,46 @@ static int smbd_smb2_request_parent_destructor(struct smbd_smb2_request **req)
 	return 0;
 }
 
+/*
+ * The file of a READ response still to be sent with sendfile, NULL if
+ * there is none or it was closed in the meantime. The strict lock went
+ * away with a closed file.
+ */
+
+static files_struct *smbd_smb2_request_sendfile_fsp(
+	struct smbd_smb2_request *req)
+{
+	files_struct *fsp = req->sendfile.fsp;
+
+	if (fsp == NULL) {
+		return NULL;
+	}
+	if ((file_find_fsp(fsp) == NULL) ||
+	    (fsp->fh->gen_id != req->sendfile.gen_id)) {
+		return NULL;
+	}
+	return fsp;
+}
+
+/*
+ * Drop the strict lock SMB2 READ left us for sendfile, the response
+ * data is out or won't be sent from the file anymore.
+ */
+
+static void smbd_smb2_request_sendfile_unlock(struct smbd_smb2_request *req)
+{
+	files_struct *fsp = smbd_smb2_request_sendfile_fsp(req);
+
+	if (fsp != NULL) {
+		SMB_VFS_STRICT_UNLOCK(fsp->conn, fsp, &req->sendfile.lock);
+	}
+	req->sendfile.fsp = NULL;
+}
+
 static int smbd_smb2_request_destructor(struct smbd_smb2_request *req)
 {
+	smbd_smb2_request_sendfile_unlock(req);
+
 	if (req->out.vector) {
 		DLIST_REMOVE(req->sconn->smb2.requests, req);
 	}
@@ -573,6 +614,33 @@ static NTSTATUS smbd_smb2_request_process_cancel(struct smbd_smb2_request *req)
 	return NT_STATUS_OK;
 }
 
+#if WITH_PTHREADPOOL
+/*
+ * Should the signature of this PDU be calculated in a helper thread ?
+ */
+static bool smbd_smb2_signing_async_possible(const struct iovec *vector)
+{
+	size_t min_size = lp_aio_signing_size();
+	size_t len;
+
+	if (min_size == 0 || lp_aio_max_threads() <= 0) {
+		return false;
+	}
+
+	len = vector[0].iov_len + vector[1].iov_len + vector[2].iov_len;
+	if (len < min_size) {
+		return false;
+	}
+
+	return (smbd_aio_fncall_context() != NULL);
+}
+
+static void smbd_smb2_request_check_done(struct tevent_req *subreq);
+#endif
+
+static NTSTATUS smbd_smb2_request_dispatch_checked(struct smbd_smb2_request *req,
+						   NTSTATUS session_status);
+
 static NTSTATUS smbd_smb2_request_dispatch(struct smbd_smb2_request *req)
 {
 	const uint8_t *inhdr;
@@ -583,6 +651,8 @@ static NTSTATUS smbd_smb2_request_dispatch(struct smbd_smb2_request *req)
 	NTSTATUS session_status;
 	uint32_t allowed_flags;
 
+	req->latency_start = latency_now();
+
 	inhdr = (const uint8_t *)req->in.vector[i].iov_base;
 
 	/* TODO: verify more things */
@@ -610,6 +680,25 @@ static NTSTATUS smbd_smb2_request_dispatch(struct smbd_smb2_request *req)
 		}
 
 		req->do_signing = true;
+#if WITH_PTHREADPOOL
+		if (smbd_smb2_signing_async_possible(&req->in.vector[i])) {
+			struct tevent_req *subreq;
+
+			subreq = smb2_signing_check_pdu_send(
+				req, req->sconn->smb2.event_ctx,
+				smbd_aio_fncall_context(),
+				req->session->session_key,
+				&req->in.vector[i], 3);
+			if (subreq == NULL) {
+				return smbd_smb2_request_error(
+					req, NT_STATUS_NO_MEMORY);
+			}
+			tevent_req_set_callback(subreq,
+						smbd_smb2_request_check_done,
+						req);
+			return NT_STATUS_OK;
+		}
+#endif
 		status = smb2_signing_check_pdu(req->session->session_key,
 						&req->in.vector[i], 3);
 		if (!NT_STATUS_IS_OK(status)) {
@@ -619,6 +708,60 @@ static NTSTATUS smbd_smb2_request_dispatch(struct smbd_smb2_request *req)
 		return smbd_smb2_request_error(req, NT_STATUS_ACCESS_DENIED);
 	}
 
+	return smbd_smb2_request_dispatch_checked(req, session_status);
+}
+
+#if WITH_PTHREADPOOL
+static void smbd_smb2_request_check_done(struct tevent_req *subreq)
+{
+	struct smbd_smb2_request *req = tevent_req_callback_data(subreq,
+					struct smbd_smb2_request);
+	struct smbd_server_connection *sconn = req->sconn;
+	NTSTATUS session_status;
+	NTSTATUS status;
+
+	status = smb2_signing_check_pdu_recv(subreq);
+	TALLOC_FREE(subreq);
+	if (!NT_STATUS_IS_OK(status)) {
+		status = smbd_smb2_request_error(req, status);
+	} else {
+		/*
+		 * The session might have been logged off while we were
+		 * waiting, then there is no key left to sign the reply.
+		 */
+		session_status = smbd_smb2_request_check_session(req);
+		if (!NT_STATUS_IS_OK(session_status)) {
+			req->session = NULL;
+			req->do_signing = false;
+		}
+		status = smbd_smb2_request_dispatch_checked(req,
+							    session_status);
+	}
+	if (!NT_STATUS_IS_OK(status)) {
+		smbd_server_connection_terminate(sconn, nt_errstr(status));
+		return;
+	}
+}
+#endif
+
+/*
+ * The rest of smbd_smb2_request_dispatch(), once the signature has been
+ * checked.
+ */
+static NTSTATUS smbd_smb2_request_dispatch_checked(struct smbd_smb2_request *req,
+						   NTSTATUS session_status)
+{
+	const uint8_t *inhdr;
+	int i = req->current_idx;
+	uint16_t opcode;
+	uint32_t flags;
+	NTSTATUS status;
+
+	inhdr = (const uint8_t *)req->in.vector[i].iov_base;
+
+	flags = IVAL(inhdr, SMB2_HDR_FLAGS);
+	opcode = IVAL(inhdr, SMB2_HDR_OPCODE);
+
 	if (flags & SMB2_HDR_FLAG_CHAINED) {
 		/*
 		 * This check is mostly for giving the correct error code
@@ -799,6 +942,13 @@ static NTSTATUS smbd_smb2_request_dispatch(struct smbd_smb2_request *req)
 
 static void smbd_smb2_request_dispatch_compound(struct tevent_req *subreq);
 static void smbd_smb2_request_writev_done(struct tevent_req *subreq);
+#if defined(WITH_SENDFILE)
+static NTSTATUS smbd_smb2_request_sendfile(struct smbd_smb2_request *req);
+#endif
+static NTSTATUS smbd_smb2_request_reply_signed(struct smbd_smb2_request *req);
+#if WITH_PTHREADPOOL
+static void smbd_smb2_request_signed(struct tevent_req *subreq);
+#endif
 
 static NTSTATUS smbd_smb2_request_reply(struct smbd_smb2_request *req)
 {
@@ -806,11 +956,41 @@ static NTSTATUS smbd_smb2_request_reply(struct smbd_smb2_request *req)
 
 	req->subreq = NULL;
 
+	if (req->latency_start != 0) {
+		const uint8_t *outhdr = (const uint8_t *)
+			req->out.vector[req->current_idx].iov_base;
+		smbd_latency_smb2(SVAL(outhdr, SMB2_HDR_OPCODE),
+				  req->latency_start);
+		req->latency_start = 0;
+	}
+
 	smb2_setup_nbt_length(req->out.vector, req->out.vector_count);
 
+#if defined(WITH_SENDFILE)
+	if (req->sendfile.fsp != NULL) {
+		return smbd_smb2_request_sendfile(req);
+	}
+#endif
+
 	if (req->do_signing) {
 		int i = req->current_idx;
 		NTSTATUS status;
+#if WITH_PTHREADPOOL
+		if (smbd_smb2_signing_async_possible(&req->out.vector[i])) {
+			subreq = smb2_signing_sign_pdu_send(
+				req, req->sconn->smb2.event_ctx,
+				smbd_aio_fncall_context(),
+				req->session->session_key,
+				&req->out.vector[i], 3);
+			if (subreq == NULL) {
+				return NT_STATUS_NO_MEMORY;
+			}
+			tevent_req_set_callback(subreq,
+						smbd_smb2_request_signed,
+						req);
+			return NT_STATUS_OK;
+		}
+#endif
 		status = smb2_signing_sign_pdu(req->session->session_key,
 					       &req->out.vector[i], 3);
 		if (!NT_STATUS_IS_OK(status)) {
@@ -818,6 +998,36 @@ static NTSTATUS smbd_smb2_request_reply(struct smbd_smb2_request *req)
 		}
 	}
 
+	return smbd_smb2_request_reply_signed(req);
+}
+
+#if WITH_PTHREADPOOL
+static void smbd_smb2_request_signed(struct tevent_req *subreq)
+{
+	struct smbd_smb2_request *req = tevent_req_callback_data(subreq,
+					struct smbd_smb2_request);
+	struct smbd_server_connection *sconn = req->sconn;
+	NTSTATUS status;
+
+	status = smb2_signing_sign_pdu_recv(subreq);
+	TALLOC_FREE(subreq);
+	if (NT_STATUS_IS_OK(status)) {
+		status = smbd_smb2_request_reply_signed(req);
+	}
+	if (!NT_STATUS_IS_OK(status)) {
+		smbd_server_connection_terminate(sconn, nt_errstr(status));
+		return;
+	}
+}
+#endif
+
+/*
+ * Queue the (signed) reply or go on with the next compound request.
+ */
+static NTSTATUS smbd_smb2_request_reply_signed(struct smbd_smb2_request *req)
+{
+	struct tevent_req *subreq;
+
 	req->current_idx += 3;
 
 	if (req->current_idx < req->out.vector_count) {
@@ -849,6 +1059,149 @@ static NTSTATUS smbd_smb2_request_reply(struct smbd_smb2_request *req)
 	return NT_STATUS_OK;
 }
 
+#if defined(WITH_SENDFILE)
+/*
+ * Send a READ response whose data is still in the file. This is only
+ * possible if nothing else is queued for the socket, otherwise we read
+ * the data into a buffer and send it the normal way.
+ */
+
+static NTSTATUS smbd_smb2_request_sendfile_fallback(struct smbd_smb2_request *req,
+						   files_struct *fsp,
+						   SMB_OFF_T offset)
+{
+	struct iovec *dyn = &req->out.vector[req->out.vector_count-1];
+	size_t length = dyn->iov_len;
+	uint8_t *buf;
+	ssize_t nread;
+
+	buf = talloc_array(req->out.vector, uint8_t, length);
+	if (buf == NULL) {
+		smbd_smb2_request_sendfile_unlock(req);
+		return smbd_smb2_request_error(req, NT_STATUS_NO_MEMORY);
+	}
+
+	nread = read_file(fsp, (char *)buf, offset, length);
+
+	smbd_smb2_request_sendfile_unlock(req);
+
+	if (nread == -1) {
+		DEBUG(5,("smbd_smb2_request_sendfile: read_file[%s] "
+			 "failed: %s\n", fsp_str_dbg(fsp), strerror(errno)));
+		return smbd_smb2_request_error(req, NT_STATUS_ACCESS_DENIED);
+	}
+	if (nread < length) {
+		/* The file was truncated under us, all we can do */
+		memset(buf + nread, '\0', length - nread);
+	}
+
+	dyn->iov_base = (void *)buf;
+
+	return smbd_smb2_request_reply(req);
+}
+
+static NTSTATUS smbd_smb2_request_sendfile(struct smbd_smb2_request *req)
+{
+	files_struct *fsp = smbd_smb2_request_sendfile_fsp(req);
+	SMB_OFF_T offset = req->sendfile.offset;
+	int count = req->out.vector_count;
+	size_t length = req->out.vector[count-1].iov_len;
+	DATA_BLOB header;
+	size_t ofs;
+	ssize_t nread;
+	int i;
+
+	/*
+	 * Until the strict lock is dropped, req->sendfile.fsp stays set.
+	 * Clear it before any other reply, smbd_smb2_request_reply() would
+	 * come back here.
+	 */
+
+	if (fsp == NULL) {
+		/* closed in the meantime */
+		req->sendfile.fsp = NULL;
+		return smbd_smb2_request_error(req, NT_STATUS_FILE_CLOSED);
+	}
+
+	if (tevent_queue_length(req->sconn->smb2.send_queue) != 0) {
+		return smbd_smb2_request_sendfile_fallback(req, fsp, offset);
+	}
+
+	header.length = 0;
+	for (i=0; i < count-1; i++) {
+		header.length += req->out.vector[i].iov_len;
+	}
+	header.data = talloc_array(req, uint8_t, header.length);
+	if (header.data == NULL) {
+		return smbd_smb2_request_sendfile_fallback(req, fsp, offset);
+	}
+	ofs = 0;
+	for (i=0; i < count-1; i++) {
+		memcpy(header.data + ofs, req->out.vector[i].iov_base,
+		       req->out.vector[i].iov_len);
+		ofs += req->out.vector[i].iov_len;
+	}
+
+	/*
+	 * The send queue is empty, so nobody else is in the middle of
+	 * a PDU. Send header and data in one go with the socket blocking,
+	 * just as send_file_readX() does for SMB1.
+	 */
+	set_blocking(smbd_server_fd(), true);
+
+	nread = SMB_VFS_SENDFILE(smbd_server_fd(), fsp, &header,
+				 offset, length);
+	if (nread == -1) {
+		if (errno == ENOSYS) {
+			/* Nothing was sent, do a normal read */
+			set_blocking(smbd_server_fd(), false);
+			data_blob_free(&header);
+			return smbd_smb2_request_sendfile_fallback(
+				req, fsp, offset);
+		}
+		if (errno != EINTR) {
+			DEBUG(0,("smbd_smb2_request_sendfile: sendfile failed "
+				 "for file %s (%s). Terminating\n",
+				 fsp_str_dbg(fsp), strerror(errno)));
+			exit_server_cleanly("smbd_smb2_request_sendfile "
+					    "sendfile failed");
+		}
+
+		/*
+		 * The header went out, but sendfile does not work here.
+		 * Fake the data with read/write, see send_file_readX().
+		 */
+		set_use_sendfile(SNUM(fsp->conn), False);
+		DEBUG(0,("smbd_smb2_request_sendfile: sendfile not "
+			 "available. Faking..\n"));
+		if (fake_sendfile(fsp, offset, length) == -1) {
+			DEBUG(0,("smbd_smb2_request_sendfile: fake_sendfile "
+				 "failed for file %s (%s).\n",
+				 fsp_str_dbg(fsp), strerror(errno)));
+			exit_server_cleanly("smbd_smb2_request_sendfile: "
+					    "fake_sendfile failed");
+		}
+	} else if (nread == 0) {
+		/* Nothing was sent, do a normal read */
+		set_blocking(smbd_server_fd(), false);
+		data_blob_free(&header);
+		return smbd_smb2_request_sendfile_fallback(req, fsp, offset);
+	} else if (nread != length + header.length) {
+		sendfile_short_send(fsp, nread, header.length, length);
+	}
+
+	set_blocking(smbd_server_fd(), false);
+
+	DEBUG(10,("smbd_smb2_request_sendfile: %s offset %.0f len %u\n",
+		  fsp_str_dbg(fsp), (double)offset, (unsigned int)length));
+
+	smbd_smb2_request_sendfile_unlock(req);
+
+	TALLOC_FREE(req);
+	return NT_STATUS_OK;
+}
+#endif /* WITH_SENDFILE */
+
 static void smbd_smb2_request_dispatch_compound(struct tevent_req *subreq)
 {
 	struct smbd_smb2_request *req = tevent_req_callback_data(subreq,
@@ -900,6 +1253,9 @@ NTSTATUS smbd_smb2_request_error_ex(struct smbd_smb2_request *req,
 		  i, nt_errstr(status), info ? " +info" : "",
 		  location));
 
+	/* An error response carries no READ data */
+	smbd_smb2_request_sendfile_unlock(req);
+
 	outhdr = (uint8_t *)req->out.vector[i].iov_base;
 
 	SIVAL(outhdr, SMB2_HDR_STATUS, NT_STATUS_V(status));
@@ -1123,9 +1479,50 @@ static void smbd_smb2_oplock_break_writev_done(struct tevent_req *subreq)
 struct smbd_smb2_request_read_state {
 	size_t missing;
 	bool asked_for_header;
+	bool asked_for_write_body;
+	size_t write_dyn_size;
 	struct smbd_smb2_request *smb2_req;
 };
 
+/*
+ * Could this be a WRITE whose payload we leave in the socket for
+ * SMB_VFS_RECVFILE? We only know the header so far. Signed requests
+ * need the payload in memory, and compound requests can't leave
+ * bytes in the socket.
+ */
+
+static bool smbd_smb2_is_recvfile_candidate(const uint8_t *hdr,
+					    int idx,
+					    size_t body_size,
+					    size_t dyn_size)
+{
+	size_t min_recvfile_size = lp_min_receive_file_size();
+
+	if (min_recvfile_size == 0) {
+		return false;
+	}
+	if (idx != 2) {
+		/* not the first request in the PDU */
+		return false;
+	}
+	if (IVAL(hdr, SMB2_HDR_NEXT_COMMAND) != 0) {
+		return false;
+	}
+	if (SVAL(hdr, SMB2_HDR_OPCODE) != SMB2_OP_WRITE) {
+		return false;
+	}
+	if (IVAL(hdr, SMB2_HDR_FLAGS) & SMB2_HDR_FLAG_SIGNED) {
+		return false;
+	}
+	if (body_size != 0x30) {
+		return false;
+	}
+	if (dyn_size < min_recvfile_size) {
+		return false;
+	}
+	return true;
+}
+
 static int smbd_smb2_request_next_vector(struct tstream_context *stream,
 					 void *private_data,
 					 TALLOC_CTX *mem_ctx,
@@ -1281,6 +1678,54 @@ static int smbd_smb2_request_next_vector(struct tstream_context *stream,
 		return 0;
 	}
 
+	if (state->asked_for_write_body) {
+		const uint8_t *body;
+		size_t dyn_size = state->write_dyn_size;
+		uint8_t *dyn;
+
+		state->asked_for_write_body = false;
+
+		/*
+		 * We have the fixed WRITE body now. If the data follows it
+		 * directly and fills the rest of the PDU, leave it in the
+		 * socket, smbd_smb2_request_process_write() receives it.
+		 */
+		body = (const uint8_t *)req->in.vector[idx-2].iov_base;
+
+		if ((SVAL(body, 0x02) == SMB2_HDR_BODY + 0x30) &&
+		    (IVAL(body, 0x04) == dyn_size)) {
+			DEBUG(10,("smbd_smb2_request_next_vector: leaving "
+				  "%u bytes of WRITE data for recvfile\n",
+				  (unsigned int)dyn_size));
+			req->sconn->smb2.unread_bytes = dyn_size;
+			state->missing -= dyn_size;
+			*_vector = NULL;
+			*_count = 0;
+			return 0;
+		}
+
+		dyn = talloc_array(req->in.vector, uint8_t, dyn_size);
+		if (dyn == NULL) {
+			return -1;
+		}
+
+		req->in.vector[idx-1].iov_base	= (void *)dyn;
+		req->in.vector[idx-1].iov_len	= dyn_size;
+
+		state->missing -= dyn_size;
+
+		vector = talloc_array(mem_ctx, struct iovec, 1);
+		if (vector == NULL) {
+			return -1;
+		}
+
+		vector[0] = req->in.vector[idx-1];
+
+		*_vector = vector;
+		*_count = 1;
+		return 0;
+	}
+
 	if (state->asked_for_header) {
 		const uint8_t *hdr;
 		size_t full_size;
@@ -1361,6 +1806,43 @@ static int smbd_smb2_request_next_vector(struct tstream_context *stream,
 
 		dyn_size = full_size - (SMB2_HDR_BODY + body_size);
 
+		if (!invalid &&
+		    smbd_smb2_is_recvfile_candidate(hdr, idx,
+						    body_size, dyn_size)) {
+			/*
+			 * Only get the fixed body for now, the WRITE
+			 * data might go straight into the file.
+			 */
+			state->missing -= (body_size - 2);
+
+			body = talloc_array(req->in.vector, uint8_t,
+					    body_size);
+			if (body == NULL) {
+				return -1;
+			}
+
+			req->in.vector[idx].iov_base	= (void *)body;
+			req->in.vector[idx].iov_len	= body_size;
+			req->in.vector[idx+1].iov_base	= NULL;
+			req->in.vector[idx+1].iov_len	= 0;
+
+			vector = talloc_array(mem_ctx, struct iovec, 1);
+			if (vector == NULL) {
+				return -1;
+			}
+
+			memcpy(body, hdr + SMB2_HDR_BODY, 2);
+			vector[0].iov_base = body + 2;
+			vector[0].iov_len = body_size - 2;
+
+			state->asked_for_write_body = true;
+			state->write_dyn_size = dyn_size;
+
+			*_vector = vector;
+			*_count = 1;
+			return 0;
+		}
+
 		state->missing -= (body_size - 2) + dyn_size;
 
 		body = talloc_array(req->in.vector, uint8_t, body_size);
@@ -1488,6 +1970,28 @@ static NTSTATUS smbd_smb2_request_read_recv(struct tevent_req *req,
 
 static void smbd_smb2_request_incoming(struct tevent_req *subreq);
 
+/*
+ * Throw away WRITE data left in the socket that nobody received,
+ * e.g. because the request failed before it got to the file.
+ */
+
+static bool smbd_smb2_drain_unread(struct smbd_server_connection *sconn)
+{
+	size_t unread = sconn->smb2.unread_bytes;
+	ssize_t ret;
+
+	sconn->smb2.unread_bytes = 0;
+
+	DEBUG(10,("smbd_smb2_drain_unread: draining %u bytes\n",
+		  (unsigned int)unread));
+
+	set_blocking(smbd_server_fd(), true);
+	ret = drain_socket(smbd_server_fd(), unread);
+	set_blocking(smbd_server_fd(), false);
+
+	return (ret == unread);
+}
+
 void smbd_smb2_first_negprot(struct smbd_server_connection *sconn,
 			     const uint8_t *inbuf, size_t size)
 {
@@ -1575,6 +2079,11 @@ static void smbd_smb2_request_incoming(struct tevent_req *subreq)
 		return;
 	}
 
+	if ((sconn->smb2.unread_bytes != 0) && !smbd_smb2_drain_unread(sconn)) {
+		smbd_server_connection_terminate(sconn, "failed to drain socket");
+		return;
+	}
+
 next:
 	/* ask for the next request (this constructs the main loop) */
 	subreq = smbd_smb2_request_read_send(sconn, sconn->smb2.event_ctx, sconn);
@@ -23,25 +23,55 @@
 #include "../libcli/smb/smb_common.h"
 #include "../lib/crypto/crypto.h"
 
-NTSTATUS smb2_signing_sign_pdu(DATA_BLOB session_key,
-			       struct iovec *vector,
-			       int count)
+/*
+ * Calculate the signature over a PDU whose signature field is treated as
+ * zero. This only does the HMAC, no DEBUG or talloc, so it is safe to
+ * call from a helper thread.
+ */
+static void smb2_signing_calc_pdu(const uint8_t *key, size_t key_len,
+				  const struct iovec *vector, int count,
+				  uint8_t res[SHA256_DIGEST_LENGTH])
 {
-	uint8_t *hdr;
-	uint64_t session_id;
+	const uint8_t *hdr = (const uint8_t *)vector[0].iov_base;
 	struct HMACSHA256Context m;
-	uint8_t res[SHA256_DIGEST_LENGTH];
+	static const uint8_t zero_sig[16] = { 0, };
 	int i;
 
+	ZERO_STRUCT(m);
+	hmac_sha256_init(key, key_len, &m);
+	hmac_sha256_update(hdr, SMB2_HDR_SIGNATURE, &m);
+	hmac_sha256_update(zero_sig, 16, &m);
+	for (i=1; i < count; i++) {
+		hmac_sha256_update((const uint8_t *)vector[i].iov_base,
+				   vector[i].iov_len, &m);
+	}
+	hmac_sha256_final(res, &m);
+}
+
+/*
+ * Checks common to signing and verifying. Returns true if the PDU needs
+ * a signature, false with *status set otherwise.
+ */
+static bool smb2_signing_needed(DATA_BLOB session_key,
+				const struct iovec *vector,
+				int count,
+				bool check,
+				NTSTATUS *status)
+{
+	const uint8_t *hdr;
+	uint64_t session_id;
+
 	if (count < 2) {
-		return NT_STATUS_INVALID_PARAMETER;
+		*status = NT_STATUS_INVALID_PARAMETER;
+		return false;
 	}
 
 	if (vector[0].iov_len != SMB2_HDR_BODY) {
-		return NT_STATUS_INVALID_PARAMETER;
+		*status = NT_STATUS_INVALID_PARAMETER;
+		return false;
 	}
 
-	hdr = (uint8_t *)vector[0].iov_base;
+	hdr = (const uint8_t *)vector[0].iov_base;
 
 	session_id = BVAL(hdr, SMB2_HDR_SESSION_ID);
 	if (session_id == 0) {
@@ -49,26 +79,68 @@ NTSTATUS smb2_signing_sign_pdu(DATA_BLOB session_key,
 		 * do not sign messages with a zero session_id.
 		 * See MS-SMB2 3.2.4.1.1
 		 */
-		return NT_STATUS_OK;
+		*status = NT_STATUS_OK;
+		return false;
 	}
 
 	if (session_key.length == 0) {
+		if (check) {
+			/* we don't have the session key yet */
+			*status = NT_STATUS_OK;
+			return false;
+		}
 		DEBUG(2,("Wrong session key length %u for SMB2 signing\n",
 			 (unsigned)session_key.length));
-		return NT_STATUS_ACCESS_DENIED;
+		*status = NT_STATUS_ACCESS_DENIED;
+		return false;
 	}
 
+	return true;
+}
+
+static void smb2_signing_prepare_sign(struct iovec *vector)
+{
+	uint8_t *hdr = (uint8_t *)vector[0].iov_base;
+
 	memset(hdr + SMB2_HDR_SIGNATURE, 0, 16);
 
 	SIVAL(hdr, SMB2_HDR_FLAGS, IVAL(hdr, SMB2_HDR_FLAGS) | SMB2_HDR_FLAG_SIGNED);
+}
 
-	ZERO_STRUCT(m);
-	hmac_sha256_init(session_key.data, MIN(session_key.length, 16), &m);
-	for (i=0; i < count; i++) {
-		hmac_sha256_update((const uint8_t *)vector[i].iov_base,
-				   vector[i].iov_len, &m);
+static NTSTATUS smb2_signing_compare(const struct iovec *vector,
+				     const uint8_t res[SHA256_DIGEST_LENGTH])
+{
+	const uint8_t *hdr = (const uint8_t *)vector[0].iov_base;
+	const uint8_t *sig = hdr+SMB2_HDR_SIGNATURE;
+
+	if (memcmp(res, sig, 16) != 0) {
+		DEBUG(0,("Bad SMB2 signature for message\n"));
+		dump_data(0, sig, 16);
+		dump_data(0, res, 16);
+		return NT_STATUS_ACCESS_DENIED;
 	}
-	hmac_sha256_final(res, &m);
+
+	return NT_STATUS_OK;
+}
+
+NTSTATUS smb2_signing_sign_pdu(DATA_BLOB session_key,
+			       struct iovec *vector,
+			       int count)
+{
+	uint8_t *hdr;
+	uint8_t res[SHA256_DIGEST_LENGTH];
+	NTSTATUS status;
+
+	if (!smb2_signing_needed(session_key, vector, count, false, &status)) {
+		return status;
+	}
+
+	hdr = (uint8_t *)vector[0].iov_base;
+
+	smb2_signing_prepare_sign(vector);
+
+	smb2_signing_calc_pdu(session_key.data, MIN(session_key.length, 16),
+			      vector, count, res);
 	DEBUG(5,("signed SMB2 message\n"));
 
 	memcpy(hdr + SMB2_HDR_SIGNATURE, res, 16);
@@ -80,56 +152,196 @@ NTSTATUS smb2_signing_check_pdu(DATA_BLOB session_key,
 				const struct iovec *vector,
 				int count)
 {
-	const uint8_t *hdr;
-	const uint8_t *sig;
-	uint64_t session_id;
-	struct HMACSHA256Context m;
 	uint8_t res[SHA256_DIGEST_LENGTH];
-	static const uint8_t zero_sig[16] = { 0, };
+	NTSTATUS status;
+
+	if (!smb2_signing_needed(session_key, vector, count, true, &status)) {
+		return status;
+	}
+
+	smb2_signing_calc_pdu(session_key.data, MIN(session_key.length, 16),
+			      vector, count, res);
+
+	return smb2_signing_compare(vector, res);
+}
+
+#if WITH_PTHREADPOOL
+
+/*
+ * Signing and verifying large PDUs in a helper thread. The job is
+ * orphaned to the fncall context if the request goes away before the
+ * thread is done, so it carries copies of the session key and of the
+ * PDU. The copy is cheap compared to the HMAC over it.
+ */
+
+struct smb2_signing_job {
+	uint8_t key[16];
+	size_t key_len;
+	struct iovec *vector;
+	int count;
+	uint8_t res[SHA256_DIGEST_LENGTH];
+};
+
+struct smb2_signing_state {
+	struct iovec *vector;
+	bool check;
+	bool needed;
+	NTSTATUS status;
+	struct smb2_signing_job *job;
+};
+
+static void smb2_signing_job_do(void *private_data);
+static void smb2_signing_job_done(struct tevent_req *subreq);
+
+static struct tevent_req *smb2_signing_send(TALLOC_CTX *mem_ctx,
+					    struct tevent_context *ev,
+					    struct fncall_context *ctx,
+					    DATA_BLOB session_key,
+					    struct iovec *vector,
+					    int count,
+					    bool check)
+{
+	struct tevent_req *req, *subreq;
+	struct smb2_signing_state *state;
+	struct smb2_signing_job *job;
+	uint8_t *buf;
+	size_t len;
 	int i;
 
-	if (count < 2) {
-		return NT_STATUS_INVALID_PARAMETER;
+	req = tevent_req_create(mem_ctx, &state, struct smb2_signing_state);
+	if (req == NULL) {
+		return NULL;
 	}
+	state->vector = vector;
+	state->check = check;
 
-	if (vector[0].iov_len != SMB2_HDR_BODY) {
-		return NT_STATUS_INVALID_PARAMETER;
+	state->needed = smb2_signing_needed(session_key, vector, count,
+					    check, &state->status);
+	if (!state->needed) {
+		tevent_req_done(req);
+		return tevent_req_post(req, ev);
 	}
 
-	hdr = (const uint8_t *)vector[0].iov_base;
+	if (!check) {
+		smb2_signing_prepare_sign(vector);
+	}
 
-	session_id = BVAL(hdr, SMB2_HDR_SESSION_ID);
-	if (session_id == 0) {
-		/*
-		 * do not sign messages with a zero session_id.
-		 * See MS-SMB2 3.2.4.1.1
-		 */
-		return NT_STATUS_OK;
+	job = talloc_zero(state, struct smb2_signing_job);
+	if (tevent_req_nomem(job, req)) {
+		return tevent_req_post(req, ev);
 	}
+	job->key_len = MIN(session_key.length, sizeof(job->key));
+	memcpy(job->key, session_key.data, job->key_len);
 
-	if (session_key.length == 0) {
-		/* we don't have the session key yet */
-		return NT_STATUS_OK;
+	len = 0;
+	for (i=0; i<count; i++) {
+		len += vector[i].iov_len;
 	}
+	job->vector = talloc_array(job, struct iovec, count);
+	if (tevent_req_nomem(job->vector, req)) {
+		return tevent_req_post(req, ev);
+	}
+	buf = talloc_array(job, uint8_t, len);
+	if (tevent_req_nomem(buf, req)) {
+		return tevent_req_post(req, ev);
+	}
+	for (i=0; i<count; i++) {
+		memcpy(buf, vector[i].iov_base, vector[i].iov_len);
+		job->vector[i].iov_base = (void *)buf;
+		job->vector[i].iov_len = vector[i].iov_len;
+		buf += vector[i].iov_len;
+	}
+	job->count = count;
 
-	sig = hdr+SMB2_HDR_SIGNATURE;
+	state->job = job;
 
-	ZERO_STRUCT(m);
-	hmac_sha256_init(session_key.data, MIN(session_key.length, 16), &m);
-	hmac_sha256_update(hdr, SMB2_HDR_SIGNATURE, &m);
-	hmac_sha256_update(zero_sig, 16, &m);
-	for (i=1; i < count; i++) {
-		hmac_sha256_update((const uint8_t *)vector[i].iov_base,
-				   vector[i].iov_len, &m);
+	subreq = fncall_send(state, ev, ctx, smb2_signing_job_do, job);
+	if (tevent_req_nomem(subreq, req)) {
+		return tevent_req_post(req, ev);
 	}
-	hmac_sha256_final(res, &m);
+	tevent_req_set_callback(subreq, smb2_signing_job_done, req);
+	return req;
+}
 
-	if (memcmp(res, sig, 16) != 0) {
-		DEBUG(0,("Bad SMB2 signature for message\n"));
-		dump_data(0, sig, 16);
-		dump_data(0, res, 16);
-		return NT_STATUS_ACCESS_DENIED;
+static void smb2_signing_job_do(void *private_data)
+{
+	struct smb2_signing_job *job = (struct smb2_signing_job *)private_data;
+
+	smb2_signing_calc_pdu(job->key, job->key_len,
+			      job->vector, job->count, job->res);
+}
+
+static void smb2_signing_job_done(struct tevent_req *subreq)
+{
+	struct tevent_req *req = tevent_req_callback_data(
+		subreq, struct tevent_req);
+	int ret, err;
+
+	ret = fncall_recv(subreq, &err);
+	TALLOC_FREE(subreq);
+	if (ret == -1) {
+		tevent_req_nterror(req, map_nt_error_from_unix(err));
+		return;
+	}
+	tevent_req_done(req);
+}
+
+static NTSTATUS smb2_signing_recv(struct tevent_req *req)
+{
+	struct smb2_signing_state *state = tevent_req_data(
+		req, struct smb2_signing_state);
+	uint8_t *hdr;
+	NTSTATUS status;
+
+	if (tevent_req_is_nterror(req, &status)) {
+		return status;
+	}
+	if (!state->needed) {
+		return state->status;
 	}
 
+	if (state->check) {
+		return smb2_signing_compare(state->vector, state->job->res);
+	}
+
+	hdr = (uint8_t *)state->vector[0].iov_base;
+	memcpy(hdr + SMB2_HDR_SIGNATURE, state->job->res, 16);
+	DEBUG(5,("signed SMB2 message in helper thread\n"));
+
 	return NT_STATUS_OK;
 }
+
+struct tevent_req *smb2_signing_sign_pdu_send(TALLOC_CTX *mem_ctx,
+					      struct tevent_context *ev,
+					      struct fncall_context *ctx,
+					      DATA_BLOB session_key,
+					      struct iovec *vector,
+					      int count)
+{
+	return smb2_signing_send(mem_ctx, ev, ctx, session_key,
+				 vector, count, false);
+}
+
+NTSTATUS smb2_signing_sign_pdu_recv(struct tevent_req *req)
+{
+	return smb2_signing_recv(req);
+}
+
+struct tevent_req *smb2_signing_check_pdu_send(TALLOC_CTX *mem_ctx,
+					       struct tevent_context *ev,
+					       struct fncall_context *ctx,
+					       DATA_BLOB session_key,
+					       const struct iovec *vector,
+					       int count)
+{
+	return smb2_signing_send(mem_ctx, ev, ctx, session_key,
+				 discard_const_p(struct iovec, vector),
+				 count, true);
+}
+
+NTSTATUS smb2_signing_check_pdu_recv(struct tevent_req *req)
+{
+	return smb2_signing_recv(req);
+}
+
+#endif /* WITH_PTHREADPOOL */
@@ -33,6 +33,37 @@ static struct tevent_req *smbd_smb2_write_send(TALLOC_CTX *mem_ctx,
 static NTSTATUS smbd_smb2_write_recv(struct tevent_req *req,
 				     uint32_t *out_count);
 
+/*
+ * Pull WRITE data that smbd_smb2_request_next_vector() left in the
+ * socket into memory.
+ */
+
+static NTSTATUS smbd_smb2_write_read_unread(struct smbd_smb2_request *req)
+{
+	int i = req->current_idx;
+	size_t unread = req->sconn->smb2.unread_bytes;
+	uint8_t *buf;
+	NTSTATUS status;
+
+	buf = talloc_array(req->in.vector, uint8_t, unread);
+	if (buf == NULL) {
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	set_blocking(smbd_server_fd(), true);
+	status = read_data(smbd_server_fd(), (char *)buf, unread);
+	set_blocking(smbd_server_fd(), false);
+	if (!NT_STATUS_IS_OK(status)) {
+		return status;
+	}
+
+	req->sconn->smb2.unread_bytes = 0;
+	req->in.vector[i+2].iov_base = (void *)buf;
+	req->in.vector[i+2].iov_len = unread;
+
+	return NT_STATUS_OK;
+}
+
 static void smbd_smb2_request_write_done(struct tevent_req *subreq);
 NTSTATUS smbd_smb2_request_process_write(struct smbd_smb2_request *req)
 {
@@ -76,10 +107,6 @@ NTSTATUS smbd_smb2_request_process_write(struct smbd_smb2_request *req)
 		return smbd_smb2_request_error(req, NT_STATUS_INVALID_PARAMETER);
 	}
 
-	if (in_data_length > req->in.vector[i+2].iov_len) {
-		return smbd_smb2_request_error(req, NT_STATUS_INVALID_PARAMETER);
-	}
-
 	/* check the max write size */
 	if (in_data_length > 0x00010000) {
 		DEBUG(0,("here:%s: 0x%08X: 0x%08X\n",
@@ -87,6 +114,30 @@ NTSTATUS smbd_smb2_request_process_write(struct smbd_smb2_request *req)
 		return smbd_smb2_request_error(req, NT_STATUS_INVALID_PARAMETER);
 	}
 
+	if (req->sconn->smb2.unread_bytes != 0) {
+		connection_struct *conn = req->tcon->compat_conn;
+
+		/*
+		 * The data is still in the socket, see
+		 * smbd_smb2_request_next_vector(). Pipes and printers
+		 * can't receive it straight from there.
+		 */
+		if (IS_IPC(conn) || IS_PRINT(conn)) {
+			NTSTATUS status = smbd_smb2_write_read_unread(req);
+			if (!NT_STATUS_IS_OK(status)) {
+				return status;
+			}
+		}
+	}
+
+	if (req->sconn->smb2.unread_bytes != 0) {
+		if (in_data_length != req->sconn->smb2.unread_bytes) {
+			return smbd_smb2_request_error(req, NT_STATUS_INVALID_PARAMETER);
+		}
+	} else if (in_data_length > req->in.vector[i+2].iov_len) {
+		return smbd_smb2_request_error(req, NT_STATUS_INVALID_PARAMETER);
+	}
+
 	in_data_buffer.data = (uint8_t *)req->in.vector[i+2].iov_base;
 	in_data_buffer.length = in_data_length;
 
@@ -167,11 +218,15 @@ static void smbd_smb2_request_write_done(struct tevent_req *subreq)
 
 struct smbd_smb2_write_state {
 	struct smbd_smb2_request *smb2req;
+	files_struct *fsp;
+	struct lock_struct lock;
+	bool write_through;
 	uint32_t in_length;
 	uint32_t out_count;
 };
 
 static void smbd_smb2_write_pipe_done(struct tevent_req *subreq);
+static void smbd_smb2_write_aio_done(struct tevent_req *subreq);
 
 static struct tevent_req *smbd_smb2_write_send(TALLOC_CTX *mem_ctx,
 					       struct tevent_context *ev,
@@ -261,11 +316,60 @@ static struct tevent_req *smbd_smb2_write_send(TALLOC_CTX *mem_ctx,
 		return tevent_req_post(req, ev);
 	}
 
+	/*
+	 * If the data is still in the socket, write_file() receives it
+	 * with SMB_VFS_RECVFILE.
+	 */
+	smbreq->unread_bytes = smb2req->sconn->smb2.unread_bytes;
+
+	if ((smbreq->unread_bytes == 0) &&
+	    smbd_aio_pthread_write_possible(fsp, in_data.length)) {
+		struct tevent_req *subreq;
+
+		if (!prepare_async_write(fsp)) {
+			SMB_VFS_STRICT_UNLOCK(conn, fsp, &lock);
+			tevent_req_nterror(req, NT_STATUS_ACCESS_DENIED);
+			return tevent_req_post(req, ev);
+		}
+
+		/*
+		 * in_data lives below smb2req->in.vector, the helper
+		 * thread keeps that around until it is done.
+		 */
+		state->fsp = fsp;
+		state->lock = lock;
+		state->write_through = (in_flags & 0x00000001);
+
+		subreq = smbd_aio_pwrite_send(state, ev, fsp,
+					      smb2req->in.vector,
+					      in_data.data,
+					      in_data.length,
+					      in_offset);
+		if (tevent_req_nomem(subreq, req)) {
+			SMB_VFS_STRICT_UNLOCK(conn, fsp, &lock);
+			return tevent_req_post(req, ev);
+		}
+		tevent_req_set_callback(subreq,
+					smbd_smb2_write_aio_done,
+					req);
+		return req;
+	}
+
+	if (smbreq->unread_bytes != 0) {
+		set_blocking(smbd_server_fd(), true);
+	}
+
 	nwritten = write_file(smbreq, fsp,
 			      (const char *)in_data.data,
 			      in_offset,
 			      in_data.length);
 
+	if (smb2req->sconn->smb2.unread_bytes != 0) {
+		set_blocking(smbd_server_fd(), false);
+		/* whatever is left is drained by the caller */
+		smb2req->sconn->smb2.unread_bytes = smbreq->unread_bytes;
+	}
+
 	if (((nwritten == 0) && (in_data.length != 0)) || (nwritten < 0)) {
 		DEBUG(5,("smbd_smb2_write: write_file[%s] disk full\n",
 			 fsp_str_dbg(fsp)));
@@ -325,6 +429,48 @@ static void smbd_smb2_write_pipe_done(struct tevent_req *subreq)
 	tevent_req_done(req);
 }
 
+static void smbd_smb2_write_aio_done(struct tevent_req *subreq)
+{
+	struct tevent_req *req = tevent_req_callback_data(subreq,
+				 struct tevent_req);
+	struct smbd_smb2_write_state *state = tevent_req_data(req,
+					      struct smbd_smb2_write_state);
+	files_struct *fsp = state->fsp;
+	NTSTATUS status;
+	ssize_t nwritten;
+	int err = 0;
+
+	nwritten = smbd_aio_pwrite_recv(subreq, &err);
+	TALLOC_FREE(subreq);
+
+	if (((nwritten == 0) && (state->in_length != 0)) || (nwritten < 0)) {
+		DEBUG(5,("smbd_smb2_write: aio write[%s] disk full: %s\n",
+			 fsp_str_dbg(fsp), strerror(err)));
+		SMB_VFS_STRICT_UNLOCK(fsp->conn, fsp, &state->lock);
+		tevent_req_nterror(req, NT_STATUS_DISK_FULL);
+		return;
+	}
+
+	DEBUG(3,("smbd_smb2_write: fnum=[%d/%s] length=%d wrote=%d (aio)\n",
+		fsp->fnum, fsp_str_dbg(fsp), (int)state->in_length,
+		(int)nwritten));
+
+	status = sync_file(fsp->conn, fsp, state->write_through);
+	if (!NT_STATUS_IS_OK(status)) {
+		DEBUG(5,("smbd_smb2_write: sync_file for %s returned %s\n",
+			fsp_str_dbg(fsp), nt_errstr(status)));
+		SMB_VFS_STRICT_UNLOCK(fsp->conn, fsp, &state->lock);
+		tevent_req_nterror(req, status);
+		return;
+	}
+
+	SMB_VFS_STRICT_UNLOCK(fsp->conn, fsp, &state->lock);
+
+	state->out_count = nwritten;
+
+	tevent_req_done(req);
+}
+
 static NTSTATUS smbd_smb2_write_recv(struct tevent_req *req,
 				     uint32_t *out_count)
 {
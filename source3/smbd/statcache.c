@@ -331,6 +331,198 @@ bool stat_cache_lookup(connection_struct *conn,
 	return (namelen == translated_path_length);
 }
 
+/*
+ * Negative stat cache.
+ *
+ * When a case insensitive name lookup has to scan a directory and does
+ * not find the name, unix_convert() remembers that in a per connection
+ * memcache, together with the timestamps of the directory at the time
+ * of the scan. Any create, rename or delete in the directory changes
+ * those timestamps, so a later lookup can trust the entry as long as
+ * the directory still stats identically. Changes made by this smbd are
+ * in addition removed via notify_fname().
+ */
+
+struct stat_cache_negative_val {
+	SMB_DEV_T dev;
+	SMB_INO_T ino;
+	struct timespec mtime;
+	struct timespec ctime;
+};
+
+static char *stat_cache_negative_key(TALLOC_CTX *mem_ctx,
+				     connection_struct *conn,
+				     const char *dirpath,
+				     const char *name)
+{
+	if (ISDOT(dirpath)) {
+		dirpath = "";
+	}
+
+	if (conn->case_sensitive) {
+		return talloc_asprintf(mem_ctx, "%s/%s", dirpath, name);
+	}
+	return talloc_asprintf_strupper_m(mem_ctx, "%s/%s", dirpath, name);
+}
+
+/**
+ * Look for a cached negative result of a directory scan
+ *
+ * @param conn    The connection the scan was done on.
+ * @param dirpath The (already translated) directory name.
+ * @param name    The name we are looking for in dirpath.
+ * @param dir_st  A fresh stat of dirpath.
+ *
+ * @return True if an earlier scan of the unchanged directory did not
+ *         find name.
+ */
+
+bool stat_cache_lookup_negative(connection_struct *conn,
+				const char *dirpath,
+				const char *name,
+				const SMB_STRUCT_STAT *dir_st)
+{
+	struct stat_cache_negative_val val;
+	DATA_BLOB key, data_val;
+	char *chk_name;
+
+	if ((conn->negative_stat_cache == NULL) || !lp_stat_cache()) {
+		return False;
+	}
+
+	chk_name = stat_cache_negative_key(talloc_tos(), conn, dirpath, name);
+	if (chk_name == NULL) {
+		return False;
+	}
+	key = data_blob_const(chk_name, strlen(chk_name));
+
+	if (!memcache_lookup(conn->negative_stat_cache, STAT_CACHE_NEGATIVE,
+			     key, &data_val)
+	    || (data_val.length != sizeof(val))) {
+		DO_PROFILE_INC(statcache_negative_misses);
+		TALLOC_FREE(chk_name);
+		return False;
+	}
+	memcpy(&val, data_val.data, sizeof(val));
+
+	if ((val.dev != dir_st->st_ex_dev) ||
+	    (val.ino != dir_st->st_ex_ino) ||
+	    (timespec_compare(&val.mtime, &dir_st->st_ex_mtime) != 0) ||
+	    (timespec_compare(&val.ctime, &dir_st->st_ex_ctime) != 0)) {
+		DEBUG(10, ("stat_cache_lookup_negative: directory changed, "
+			   "dropping [%s]\n", chk_name));
+		DO_PROFILE_INC(statcache_negative_stale);
+		memcache_delete(conn->negative_stat_cache,
+				STAT_CACHE_NEGATIVE, key);
+		TALLOC_FREE(chk_name);
+		return False;
+	}
+
+	DEBUG(10, ("stat_cache_lookup_negative: [%s] does not exist\n",
+		   chk_name));
+	DO_PROFILE_INC(statcache_negative_hits);
+	TALLOC_FREE(chk_name);
+	return True;
+}
+
+/**
+ * Remember that a directory scan did not find a name
+ *
+ * @param conn       The connection the scan was done on.
+ * @param dirpath    The (already translated) directory name.
+ * @param name       The name that was not found in dirpath.
+ * @param dir_st     The stat of dirpath taken before the scan started.
+ * @param scan_start The time just before dir_st was taken.
+ *
+ * @note Directories changed within the last two seconds before the scan
+ *       are not cached: on file systems with coarse timestamps a change
+ *       racing with the scan might not be visible in dir_st.
+ */
+
+void stat_cache_add_negative(connection_struct *conn,
+			     const char *dirpath,
+			     const char *name,
+			     const SMB_STRUCT_STAT *dir_st,
+			     const struct timespec *scan_start)
+{
+	struct stat_cache_negative_val val;
+	struct timespec racy;
+	size_t max_size;
+	char *chk_name;
+
+	if (!lp_stat_cache()) {
+		return;
+	}
+
+	max_size = lp_negative_stat_cache_size(SNUM(conn)) * 1024;
+	if (max_size == 0) {
+		return;
+	}
+
+	racy = *scan_start;
+	racy.tv_sec -= 2;
+	if ((timespec_compare(&dir_st->st_ex_mtime, &racy) >= 0) ||
+	    (timespec_compare(&dir_st->st_ex_ctime, &racy) >= 0)) {
+		return;
+	}
+
+	if (conn->negative_stat_cache == NULL) {
+		conn->negative_stat_cache = memcache_init(conn, max_size);
+		if (conn->negative_stat_cache == NULL) {
+			return;
+		}
+	}
+
+	chk_name = stat_cache_negative_key(talloc_tos(), conn, dirpath, name);
+	if (chk_name == NULL) {
+		return;
+	}
+
+	ZERO_STRUCT(val);
+	val.dev = dir_st->st_ex_dev;
+	val.ino = dir_st->st_ex_ino;
+	val.mtime = dir_st->st_ex_mtime;
+	val.ctime = dir_st->st_ex_ctime;
+
+	memcache_add(conn->negative_stat_cache, STAT_CACHE_NEGATIVE,
+		     data_blob_const(chk_name, strlen(chk_name)),
+		     data_blob_const(&val, sizeof(val)));
+
+	DEBUG(10, ("stat_cache_add_negative: added [%s]\n", chk_name));
+	TALLOC_FREE(chk_name);
+}
+
+/***************************************************************************
+ A name was created on this connection, forget that it did not exist.
+**************************************************************************/
+
+void stat_cache_delete_negative(connection_struct *conn, const char *path)
+{
+	char *parent;
+	const char *name;
+	char *chk_name;
+
+	if (conn->negative_stat_cache == NULL) {
+		return;
+	}
+
+	if (!parent_dirname(talloc_tos(), path, &parent, &name)) {
+		return;
+	}
+
+	chk_name = stat_cache_negative_key(talloc_tos(), conn, parent, name);
+	if (chk_name != NULL) {
+		DEBUG(10, ("stat_cache_delete_negative: deleting [%s]\n",
+			   chk_name));
+		memcache_delete(conn->negative_stat_cache,
+				STAT_CACHE_NEGATIVE,
+				data_blob_const(chk_name,
+						strlen(chk_name)));
+	}
+	TALLOC_FREE(chk_name);
+	TALLOC_FREE(parent);
+}
+
 /***************************************************************************
  Tell all smbd's to delete an entry.
 **************************************************************************/
@@ -22,6 +22,7 @@
 #include "nsswitch/libwbclient/wbc_async.h"
 #include "torture/proto.h"
 #include "libcli/security/dom_sid.h"
+#include "winbindd/winbindd_cache_rec.h"
 
 extern char *optarg;
 extern int optind;
@@ -3243,6 +3244,156 @@ static bool run_oplock3(int dummy)
 /* What are we looking for here?  What's sucess and what's FAILURE? */
 }
 
+/*
+  Time how long it takes until many level2 oplock holders of one file
+  are all told about a write to it. Every connection holds several
+  opens, as a client with many handles on a shared file would.
+*/
+#define OPLOCK_BREAK_BENCH_CONNS 50
+#define OPLOCK_BREAK_BENCH_OPENS 10
+
+static bool run_oplock_break_bench(int dummy)
+{
+	const char *fname = "\\oplock_bench.dat";
+	int saved_use_oplocks = use_oplocks;
+	struct tevent_context *ev;
+	struct cli_state *cli;
+	struct cli_state *holders[OPLOCK_BREAK_BENCH_CONNS];
+	uint16_t fnum;
+	char buf[4] = { 'a', 'b', 'c', 'd' };
+	struct timeval tv;
+	double write_time;
+	int i, j;
+	bool correct = True;
+
+	printf("starting oplock break bench with %d connections holding "
+	       "%d level2 oplocks each\n", OPLOCK_BREAK_BENCH_CONNS,
+	       OPLOCK_BREAK_BENCH_OPENS);
+
+	ZERO_STRUCT(holders);
+
+	ev = tevent_context_init(talloc_tos());
+	if (ev == NULL) {
+		d_printf("tevent_context_init failed\n");
+		return False;
+	}
+
+	if (!torture_open_connection(&cli, 0)) {
+		TALLOC_FREE(ev);
+		return False;
+	}
+	cli_sockopt(cli, sockops);
+
+	cli_unlink(cli, fname, aSYSTEM | aHIDDEN);
+
+	/* Not oplocked, so that all the holders are granted level2 */
+	if (!NT_STATUS_IS_OK(cli_open(cli, fname, O_RDWR|O_CREAT|O_EXCL,
+				      DENY_NONE, &fnum))) {
+		printf("open of %s failed (%s)\n", fname, cli_errstr(cli));
+		torture_close_connection(cli);
+		TALLOC_FREE(ev);
+		return False;
+	}
+
+	use_level_II_oplocks = True;
+	use_oplocks = True;
+
+	for (i=0; i<OPLOCK_BREAK_BENCH_CONNS; i++) {
+		if (!torture_open_connection(&holders[i], i+1)) {
+			correct = False;
+			goto done;
+		}
+		cli_sockopt(holders[i], sockops);
+
+		for (j=0; j<OPLOCK_BREAK_BENCH_OPENS; j++) {
+			uint16_t hnum;
+
+			if (!NT_STATUS_IS_OK(cli_open(holders[i], fname,
+						      O_RDWR, DENY_NONE,
+						      &hnum))) {
+				printf("open %d/%d of %s failed (%s)\n", i, j,
+				       fname, cli_errstr(holders[i]));
+				correct = False;
+				goto done;
+			}
+		}
+	}
+
+	use_level_II_oplocks = False;
+	use_oplocks = saved_use_oplocks;
+
+	tv = timeval_current();
+
+	if (cli_write(cli, fnum, 0, buf, 0, sizeof(buf)) != sizeof(buf)) {
+		printf("write failed (%s)\n", cli_errstr(cli));
+		correct = False;
+		goto done;
+	}
+
+	write_time = timeval_elapsed(&tv);
+
+	for (i=0; i<OPLOCK_BREAK_BENCH_CONNS; i++) {
+		for (j=0; j<OPLOCK_BREAK_BENCH_OPENS; j++) {
+			struct tevent_req *req;
+			uint16_t bnum;
+			uint8_t level;
+			NTSTATUS status;
+
+			req = cli_smb_oplock_break_waiter_send(
+				talloc_tos(), ev, holders[i]);
+			if (req == NULL) {
+				d_printf("cli_smb_oplock_break_waiter_send "
+					 "failed\n");
+				correct = False;
+				goto done;
+			}
+			if (!tevent_req_poll(req, ev)) {
+				d_printf("tevent_req_poll failed\n");
+				TALLOC_FREE(req);
+				correct = False;
+				goto done;
+			}
+			status = cli_smb_oplock_break_waiter_recv(req, &bnum,
+								  &level);
+			TALLOC_FREE(req);
+			if (!NT_STATUS_IS_OK(status)) {
+				printf("oplock break %d/%d failed (%s)\n", i, j,
+				       nt_errstr(status));
+				correct = False;
+				goto done;
+			}
+			if (level != OPLOCKLEVEL_NONE) {
+				printf("holder %d/%d got a break to level %d\n",
+				       i, j, (int)level);
+				correct = False;
+			}
+		}
+	}
+
+	printf("write took %.3f secs, all %d breaks arrived after %.3f secs\n",
+	       write_time, OPLOCK_BREAK_BENCH_CONNS * OPLOCK_BREAK_BENCH_OPENS,
+	       timeval_elapsed(&tv));
+
+ done:
+	use_level_II_oplocks = False;
+	use_oplocks = saved_use_oplocks;
+
+	for (i=0; i<OPLOCK_BREAK_BENCH_CONNS; i++) {
+		if (holders[i] != NULL) {
+			cli_shutdown(holders[i]);
+		}
+	}
+
+	cli_close(cli, fnum);
+	cli_unlink(cli, fname, aSYSTEM | aHIDDEN);
+	if (!torture_close_connection(cli)) {
+		correct = False;
+	}
+
+	TALLOC_FREE(ev);
+	return correct;
+}
+
 
 
 /*
@@ -6533,6 +6684,64 @@ static bool run_local_base64(int dummy)
 	return ret;
 }
 
+static bool run_local_ms_fnmatch(int dummy)
+{
+	const char *patterns[] = {
+		"foo.txt", "FOO.TXT", "*", "**", "*.*", "*.", ".*", "*.tmp",
+		"*.TMP", "*tmp", "*.t?p", "foo*", "FOO*", "foo.*", "f*.txt",
+		"<.tmp", "*.tar.gz", "?oo.txt", "foo\"txt", "a*b*c", "\xc3\xa4*",
+		"*\xc3\xa4", "*.\xc3\xa4"
+	};
+	const char *names[] = {
+		".", "..", "foo", "foo.txt", "FOO.TXT", "foo.tmp", "FOO.TMP",
+		"x.tmp.tmp", "tmp", ".tmp", "a.b.tmp", "foo.txt.tmp", "foot",
+		"abc", "aXbYc", "a.tar.gz", "tar.gz", "\xc3\xa4.tmp",
+		"\xc3\xa4" "foo", "foo\xc3\xa4", "x.\xc3\xa4", "\xc3\xa4tmp",
+		"x\xc3\xa4.tmp", "f.txt", "fo"
+	};
+	int i, j, t, c;
+	bool ret = true;
+
+	for (i=0; i<ARRAY_SIZE(patterns); i++) {
+	for (t=0; t<2; t++) {
+	for (c=0; c<2; c++) {
+		struct ms_fnmatch_compiled *m;
+
+		m = ms_fnmatch_compile(talloc_tos(), patterns[i], t, c);
+		if (m == NULL) {
+			d_fprintf(stderr, "ms_fnmatch_compile(%s) failed\n",
+				  patterns[i]);
+			return false;
+		}
+		if (!ms_fnmatch_compiled_for(m, patterns[i], t, c)) {
+			d_fprintf(stderr, "ms_fnmatch_compiled_for(%s) "
+				  "failed\n", patterns[i]);
+			ret = false;
+		}
+
+		for (j=0; j<ARRAY_SIZE(names); j++) {
+			bool expected, result;
+
+			expected = (ms_fnmatch(patterns[i], names[j], t, c)
+				    == 0);
+			result = (ms_fnmatch_compiled(m, names[j]) == 0);
+
+			if (expected != result) {
+				d_fprintf(stderr, "pattern [%s] name [%s] "
+					  "translate %d case_sensitive %d: "
+					  "expected %d, got %d\n",
+					  patterns[i], names[j], t, c,
+					  (int)expected, (int)result);
+				ret = false;
+			}
+		}
+		TALLOC_FREE(m);
+	}
+	}
+	}
+	return ret;
+}
+
 static bool run_local_gencache(int dummy)
 {
 	char *val;
@@ -6957,7 +7166,7 @@ static bool run_local_memcache(int dummy)
 	size_t size1, size2;
 	bool ret = false;
 
-	cache = memcache_init(NULL, 100);
+	cache = memcache_init(NULL, sizeof(void *) == 8 ? 150 : 100);
 
 	if (cache == NULL) {
 		printf("memcache_init failed\n");
@@ -7037,6 +7246,286 @@ static bool run_local_memcache(int dummy)
 	return ret;
 }
 
+static void memcache_bench_print(struct memcache *cache,
+				 enum memcache_number n, const char *name)
+{
+	struct memcache_stats stats;
+
+	memcache_get_stats(cache, n, &stats);
+	d_printf("%-12s %8u elements %9u bytes %9llu lookups %9llu hits "
+		 "%9llu evictions\n", name, (unsigned)stats.num_elements,
+		 (unsigned)stats.size, (unsigned long long)stats.lookups,
+		 (unsigned long long)stats.hits,
+		 (unsigned long long)stats.evictions);
+}
+
+/*
+ * Time adds and lookups in a cache sized like smbd's, and check that a
+ * burst of directory lookups does not push out the idmap entries.
+ */
+
+static bool run_local_memcache_bench(int dummy)
+{
+	TALLOC_CTX *frame = talloc_stackframe();
+	struct memcache *cache;
+	struct timeval start;
+	double elapsed;
+	const int num_ids = 1000;
+	int num_ops = MAX(torture_numops, 100) * 1000;
+	int i, found;
+	bool result = false;
+
+	cache = memcache_init(frame, 256 * 1024);
+	if (cache == NULL) {
+		d_printf("memcache_init failed\n");
+		goto fail;
+	}
+
+	for (i=0; i<num_ids; i++) {
+		uint32_t id = i;
+		char *sid = talloc_asprintf(frame, "S-1-5-21-1-2-3-%d", i);
+
+		memcache_add(cache, SID_UID_CACHE, data_blob_string_const(sid),
+			     data_blob_const(&id, sizeof(id)));
+		TALLOC_FREE(sid);
+	}
+
+	start = timeval_current();
+
+	for (i=0; i<num_ops; i++) {
+		char path[64];
+		DATA_BLOB val;
+
+		snprintf(path, sizeof(path), "DIR/SUBDIR/FILE%08d.TXT", i);
+		if (!memcache_lookup(cache, STAT_CACHE,
+				     data_blob_string_const(path), &val)) {
+			memcache_add(cache, STAT_CACHE,
+				     data_blob_string_const(path),
+				     data_blob_string_const(path));
+		}
+	}
+
+	elapsed = timeval_elapsed(&start);
+	d_printf("%d lookups+adds in %.3f seconds: %.0f ops/sec\n",
+		 num_ops, elapsed, num_ops / elapsed);
+
+	start = timeval_current();
+
+	for (i=0; i<num_ops; i++) {
+		char path[64];
+		DATA_BLOB val;
+
+		snprintf(path, sizeof(path), "DIR/SUBDIR/FILE%08d.TXT",
+			 num_ops - 1 - (i % 1000));
+		memcache_lookup(cache, STAT_CACHE,
+				data_blob_string_const(path), &val);
+	}
+
+	elapsed = timeval_elapsed(&start);
+	d_printf("%d hot lookups in %.3f seconds: %.0f ops/sec\n",
+		 num_ops, elapsed, num_ops / elapsed);
+
+	found = 0;
+	for (i=0; i<num_ids; i++) {
+		char *sid = talloc_asprintf(frame, "S-1-5-21-1-2-3-%d", i);
+		DATA_BLOB val;
+
+		if (memcache_lookup(cache, SID_UID_CACHE,
+				    data_blob_string_const(sid), &val)) {
+			found += 1;
+		}
+		TALLOC_FREE(sid);
+	}
+
+	memcache_bench_print(cache, STAT_CACHE, "stat");
+	memcache_bench_print(cache, SID_UID_CACHE, "sid->uid");
+
+	if (found != num_ids) {
+		d_printf("only %d of %d idmap entries survived\n", found,
+			 num_ids);
+		goto fail;
+	}
+
+	result = true;
+ fail:
+	TALLOC_FREE(frame);
+	return result;
+}
+
+struct wbcache_bench_state {
+	TALLOC_CTX *mem_ctx;
+	bool user;
+	bool ok;
+	struct wbint_userinfo info;
+	enum lsa_SidType type;
+	char *domain_name;
+	char *name;
+};
+
+static void wbcache_bench_pull(TDB_DATA data,
+			       struct wbcache_bench_state *state)
+{
+	if (state->user) {
+		state->ok = wcache_rec_pull_u(data, state->mem_ctx,
+					      &state->info);
+	} else {
+		state->ok = wcache_rec_pull_sn(data, state->mem_ctx,
+					       &state->type,
+					       &state->domain_name,
+					       &state->name);
+	}
+}
+
+static int wbcache_bench_parser(TDB_DATA key, TDB_DATA data,
+				void *private_data)
+{
+	wbcache_bench_pull(data, (struct wbcache_bench_state *)private_data);
+	return 0;
+}
+
+/*
+ * Look up winbindd cache records like winbindd does for a cache hit,
+ * either copying the record out of the tdb first or parsing it in
+ * place.
+ */
+
+static bool wbcache_bench_run(struct tdb_context *tdb, TALLOC_CTX *mem_ctx,
+			      char **keys, int num_keys, int num_ops,
+			      bool user, bool in_place)
+{
+	struct wbcache_bench_state state;
+	struct timeval start;
+	double elapsed;
+	int i;
+
+	start = timeval_current();
+
+	for (i=0; i<num_ops; i++) {
+		TDB_DATA key = string_tdb_data(keys[i % num_keys]);
+
+		ZERO_STRUCT(state);
+		state.mem_ctx = talloc_new(mem_ctx);
+		state.user = user;
+
+		if (in_place) {
+			tdb_parse_record(tdb, key, wbcache_bench_parser,
+					 &state);
+		} else {
+			TDB_DATA data = tdb_fetch(tdb, key);
+
+			if (data.dptr != NULL) {
+				wbcache_bench_pull(data, &state);
+				SAFE_FREE(data.dptr);
+			}
+		}
+
+		TALLOC_FREE(state.mem_ctx);
+
+		if (!state.ok) {
+			d_printf("lookup of %s failed\n", keys[i % num_keys]);
+			return false;
+		}
+	}
+
+	elapsed = timeval_elapsed(&start);
+	d_printf("%d %s %s lookups in %.3f seconds: %.0f lookups/sec\n",
+		 num_ops, user ? "U/" : "SN/", in_place ? "in place" : "copied",
+		 elapsed, num_ops / elapsed);
+	return true;
+}
+
+static bool run_local_wbcache_bench(int dummy)
+{
+	TALLOC_CTX *frame = talloc_stackframe();
+	const char *path = "wbcache_bench.tdb";
+	struct tdb_context *tdb;
+	struct wbcache_bench_state state;
+	const int num_ids = 1000;
+	int num_ops = MAX(torture_numops, 100) * 1000;
+	char **u_keys, **sn_keys;
+	struct dom_sid dom_sid, user_sid;
+	int i;
+	bool result = false;
+
+	unlink(path);
+	tdb = tdb_open(path, 0, 0, O_RDWR|O_CREAT, 0600);
+	if (tdb == NULL) {
+		d_printf("could not open %s: %s\n", path, strerror(errno));
+		goto fail;
+	}
+
+	u_keys = TALLOC_ARRAY(frame, char *, num_ids);
+	sn_keys = TALLOC_ARRAY(frame, char *, num_ids);
+	if ((u_keys == NULL) || (sn_keys == NULL)) {
+		d_printf("talloc failed\n");
+		goto fail;
+	}
+
+	string_to_sid(&dom_sid, "S-1-5-21-1-2-3");
+
+	for (i=0; i<num_ids; i++) {
+		struct wbint_userinfo info;
+		TDB_DATA data;
+		fstring sid_str;
+
+		ZERO_STRUCT(info);
+		info.acct_name = talloc_asprintf(frame, "user%d", i);
+		info.full_name = talloc_asprintf(frame, "Bench User %d", i);
+		info.homedir = talloc_asprintf(frame, "/home/BENCH/user%d", i);
+		info.shell = "/bin/bash";
+		info.primary_gid = 513;
+		sid_compose(&info.user_sid, &dom_sid, 1000 + i);
+		sid_compose(&info.group_sid, &dom_sid, 513);
+		sid_to_fstring(sid_str, &info.user_sid);
+
+		u_keys[i] = talloc_asprintf(u_keys, "U/%s", sid_str);
+		data = wcache_rec_push_u(frame, NT_STATUS_OK, 1, &info);
+		tdb_store(tdb, string_tdb_data(u_keys[i]), data, TDB_REPLACE);
+		TALLOC_FREE(data.dptr);
+
+		sn_keys[i] = talloc_asprintf(sn_keys, "SN/%s", sid_str);
+		data = wcache_rec_push_sn(frame, NT_STATUS_OK, 1,
+					  SID_NAME_USER, "BENCH",
+					  info.acct_name);
+		tdb_store(tdb, string_tdb_data(sn_keys[i]), data, TDB_REPLACE);
+		TALLOC_FREE(data.dptr);
+	}
+
+	if (!wbcache_bench_run(tdb, frame, sn_keys, num_ids, num_ops,
+			       false, false) ||
+	    !wbcache_bench_run(tdb, frame, sn_keys, num_ids, num_ops,
+			       false, true) ||
+	    !wbcache_bench_run(tdb, frame, u_keys, num_ids, num_ops,
+			       true, false) ||
+	    !wbcache_bench_run(tdb, frame, u_keys, num_ids, num_ops,
+			       true, true)) {
+		goto fail;
+	}
+
+	ZERO_STRUCT(state);
+	state.mem_ctx = frame;
+	state.user = true;
+	tdb_parse_record(tdb, string_tdb_data(u_keys[7]),
+			 wbcache_bench_parser, &state);
+	sid_compose(&user_sid, &dom_sid, 1007);
+	if (!state.ok || (strcmp(state.info.acct_name, "user7") != 0) ||
+	    (strcmp(state.info.homedir, "/home/BENCH/user7") != 0) ||
+	    (state.info.primary_gid != 513) ||
+	    (sid_compare(&state.info.user_sid, &user_sid) != 0)) {
+		d_printf("U/ record did not survive\n");
+		goto fail;
+	}
+
+	result = true;
+ fail:
+	if (tdb != NULL) {
+		tdb_close(tdb);
+	}
+	unlink(path);
+	TALLOC_FREE(frame);
+	return result;
+}
+
 static void wbclient_done(struct tevent_req *req)
 {
 	wbcErr wbc_err;
@@ -7102,6 +7591,378 @@ static bool run_local_wbclient(int dummy)
 	return result;
 }
 
+/*
+ * Resolve the SIDs of a 1000 entry ACL one by one as smbd does today,
+ * then with one wbcSidsToUnixIds call. The ACL holds the BUILTIN
+ * aliases and rids of our own domain, talk to a running winbindd.
+ */
+
+static bool wbclient_idmap_bench_single(struct wbcDomainSid *sids,
+					int num_sids, struct wbcUnixId *ids,
+					double *elapsed)
+{
+	struct timeval start;
+	int i;
+
+	start = timeval_current();
+
+	for (i=0; i<num_sids; i++) {
+		uid_t uid;
+		gid_t gid;
+
+		if (WBC_ERROR_IS_OK(wbcSidToUid(&sids[i], &uid))) {
+			ids[i].type = WBC_ID_TYPE_UID;
+			ids[i].id.uid = uid;
+		} else if (WBC_ERROR_IS_OK(wbcSidToGid(&sids[i], &gid))) {
+			ids[i].type = WBC_ID_TYPE_GID;
+			ids[i].id.gid = gid;
+		} else {
+			ids[i].type = WBC_ID_TYPE_NOT_SPECIFIED;
+		}
+	}
+
+	*elapsed = timeval_elapsed(&start);
+	return true;
+}
+
+static bool wbclient_idmap_bench_bulk(struct wbcDomainSid *sids,
+				      int num_sids, struct wbcUnixId *ids,
+				      double *elapsed)
+{
+	struct timeval start;
+	wbcErr wbc_err;
+
+	start = timeval_current();
+
+	wbc_err = wbcSidsToUnixIds(sids, num_sids, ids);
+	if (!WBC_ERROR_IS_OK(wbc_err)) {
+		d_printf("wbcSidsToUnixIds failed: %s\n",
+			 wbcErrorString(wbc_err));
+		return false;
+	}
+
+	*elapsed = timeval_elapsed(&start);
+	return true;
+}
+
+static bool run_local_wbclient_idmap_bench(int dummy)
+{
+	TALLOC_CTX *frame = talloc_stackframe();
+	const int num_sids = 1000;
+	int num_rounds = MAX(torture_numops, 1);
+	struct wbcInterfaceDetails *details = NULL;
+	struct wbcDomainInfo *dinfo = NULL;
+	struct wbcDomainSid *sids;
+	struct wbcUnixId *single_ids, *bulk_ids;
+	double elapsed, single_time, bulk_time;
+	int i, num_mapped;
+	wbcErr wbc_err;
+	bool result = false;
+
+	wbc_err = wbcInterfaceDetails(&details);
+	if (!WBC_ERROR_IS_OK(wbc_err)) {
+		d_printf("wbcInterfaceDetails failed: %s\n",
+			 wbcErrorString(wbc_err));
+		goto fail;
+	}
+
+	/* A standalone server only has its local SAM */
+
+	wbc_err = wbcDomainInfo(details->netbios_domain, &dinfo);
+	if (!WBC_ERROR_IS_OK(wbc_err)) {
+		wbc_err = wbcDomainInfo(details->netbios_name, &dinfo);
+	}
+	if (!WBC_ERROR_IS_OK(wbc_err)) {
+		d_printf("wbcDomainInfo(%s) failed: %s\n",
+			 details->netbios_domain, wbcErrorString(wbc_err));
+		goto fail;
+	}
+
+	sids = TALLOC_ARRAY(frame, struct wbcDomainSid, num_sids);
+	single_ids = TALLOC_ARRAY(frame, struct wbcUnixId, num_sids);
+	bulk_ids = TALLOC_ARRAY(frame, struct wbcUnixId, num_sids);
+	if ((sids == NULL) || (single_ids == NULL) || (bulk_ids == NULL)) {
+		d_printf("talloc failed\n");
+		goto fail;
+	}
+
+	for (i=0; i<num_sids; i++) {
+		if (i < 8) {
+			char *sid_str = talloc_asprintf(
+				frame, "S-1-5-32-%d", 544 + i);
+			wbcStringToSid(sid_str, &sids[i]);
+			continue;
+		}
+		if (dinfo->sid.num_auths >= WBC_MAXSUBAUTHS) {
+			d_printf("domain sid too long\n");
+			goto fail;
+		}
+		sids[i] = dinfo->sid;
+		sids[i].sub_auths[sids[i].num_auths++] = 500 + i - 8;
+	}
+
+	d_printf("Resolving a %d entry ACL of %s, %d rounds\n", num_sids,
+		 dinfo->short_name, num_rounds);
+
+	/* The first round finds the idmap cache cold */
+
+	if (!wbclient_idmap_bench_bulk(sids, num_sids, bulk_ids, &elapsed)) {
+		goto fail;
+	}
+	d_printf("bulk, cold cache: %.3f seconds\n", elapsed);
+
+	single_time = bulk_time = 0.0;
+
+	for (i=0; i<num_rounds; i++) {
+		if (!wbclient_idmap_bench_single(sids, num_sids, single_ids,
+						 &elapsed)) {
+			goto fail;
+		}
+		single_time += elapsed;
+		if (!wbclient_idmap_bench_bulk(sids, num_sids, bulk_ids,
+					       &elapsed)) {
+			goto fail;
+		}
+		bulk_time += elapsed;
+	}
+
+	d_printf("per sid, warm cache: %.3f seconds per ACL, "
+		 "%.0f sids/sec\n", single_time / num_rounds,
+		 num_sids * num_rounds / single_time);
+	d_printf("bulk, warm cache: %.3f seconds per ACL, %.0f sids/sec\n",
+		 bulk_time / num_rounds, num_sids * num_rounds / bulk_time);
+
+	num_mapped = 0;
+
+	for (i=0; i<num_sids; i++) {
+		if (single_ids[i].type != bulk_ids[i].type) {
+			d_printf("sid %d: type %d per sid, %d bulk\n", i,
+				 (int)single_ids[i].type,
+				 (int)bulk_ids[i].type);
+			goto fail;
+		}
+		if (bulk_ids[i].type == WBC_ID_TYPE_NOT_SPECIFIED) {
+			continue;
+		}
+		if (single_ids[i].id.uid != bulk_ids[i].id.uid) {
+			d_printf("sid %d: id %u per sid, %u bulk\n", i,
+				 (unsigned)single_ids[i].id.uid,
+				 (unsigned)bulk_ids[i].id.uid);
+			goto fail;
+		}
+		num_mapped += 1;
+	}
+	d_printf("%d of %d sids mapped\n", num_mapped, num_sids);
+
+	result = true;
+ fail:
+	wbcFreeMemory(dinfo);
+	wbcFreeMemory(details);
+	TALLOC_FREE(frame);
+	return result;
+}
+
+struct messaging_bench_state {
+	int num_received;
+	int num_expected;
+	bool timed_out;
+	bool out_of_order;
+};
+
+static void messaging_bench_ping(struct messaging_context *msg_ctx,
+				 void *private_data,
+				 uint32_t msg_type,
+				 struct server_id src,
+				 DATA_BLOB *data)
+{
+	struct messaging_bench_state *state =
+		(struct messaging_bench_state *)private_data;
+
+	state->num_received += 1;
+	messaging_send(msg_ctx, src, MSG_PONG, data);
+}
+
+static void messaging_bench_pong(struct messaging_context *msg_ctx,
+				 void *private_data,
+				 uint32_t msg_type,
+				 struct server_id src,
+				 DATA_BLOB *data)
+{
+	struct messaging_bench_state *state =
+		(struct messaging_bench_state *)private_data;
+
+	/* The pongs carry the ping's sequence number */
+	if ((data->length < 4)
+	    || (IVAL(data->data, 0) != state->num_received)) {
+		state->out_of_order = true;
+	}
+	state->num_received += 1;
+}
+
+static void messaging_bench_timeout(struct tevent_context *ev,
+				    struct tevent_timer *te,
+				    struct timeval now,
+				    void *private_data)
+{
+	struct messaging_bench_state *state =
+		(struct messaging_bench_state *)private_data;
+
+	state->timed_out = true;
+}
+
+/*
+ * One of the nprocs clients: send torture_numops pings to the parent, with
+ * at most 20 outstanding, and wait for all pongs. Messages between two
+ * processes must arrive in the order they were sent.
+ *
+ * Like smbd children we take over the parent's messaging context with
+ * messaging_reinit(). A second context would leave the parent's
+ * messages.tdb signal handler in place, which then steals our messages.
+ */
+static int messaging_bench_child(struct tevent_context *ev,
+				 struct messaging_context *msg_ctx,
+				 struct server_id parent)
+{
+	struct messaging_bench_state state;
+	uint8_t buf[32];
+	int num_sent = 0;
+
+	if (!NT_STATUS_IS_OK(messaging_reinit(msg_ctx))) {
+		return 1;
+	}
+
+	ZERO_STRUCT(state);
+	ZERO_STRUCT(buf);
+	messaging_register(msg_ctx, &state, MSG_PONG, messaging_bench_pong);
+
+	if (tevent_add_timer(ev, ev, timeval_current_ofs(60, 0),
+			     messaging_bench_timeout, &state) == NULL) {
+		return 1;
+	}
+
+	while ((state.num_received < torture_numops) && !state.timed_out) {
+		while ((num_sent < torture_numops)
+		       && (num_sent < state.num_received + 20)) {
+			NTSTATUS status;
+			SIVAL(buf, 0, num_sent);
+			status = messaging_send_buf(msg_ctx, parent, MSG_PING,
+						    buf, sizeof(buf));
+			if (!NT_STATUS_IS_OK(status)) {
+				d_printf("messaging_send_buf failed: %s\n",
+					 nt_errstr(status));
+				return 1;
+			}
+			num_sent += 1;
+		}
+		if (tevent_loop_once(ev) != 0) {
+			return 1;
+		}
+	}
+
+	if (state.out_of_order) {
+		d_printf("pongs arrived out of order\n");
+		return 1;
+	}
+	return state.timed_out ? 1 : 0;
+}
+
+/*
+ * Messages per second between nprocs client processes and one server,
+ * each ping is answered by a pong.
+ */
+static bool run_local_messaging_bench(int dummy)
+{
+	TALLOC_CTX *frame = talloc_stackframe();
+	struct tevent_context *ev;
+	struct messaging_context *msg_ctx;
+	struct messaging_bench_state state;
+	struct server_id self = procid_self();
+	struct timeval start;
+	double elapsed;
+	pid_t *pids = NULL;
+	int num_children = 0;
+	bool result = false;
+	int i;
+
+	ev = tevent_context_init(frame);
+	if (ev == NULL) {
+		d_printf("tevent_context_init failed\n");
+		goto fail;
+	}
+	msg_ctx = messaging_init(frame, procid_self(), ev);
+	if (msg_ctx == NULL) {
+		d_printf("messaging_init failed\n");
+		goto fail;
+	}
+
+	ZERO_STRUCT(state);
+	state.num_expected = nprocs * torture_numops;
+
+	/* replace the default, chatty ping handler */
+	messaging_deregister(msg_ctx, MSG_PING, NULL);
+	messaging_register(msg_ctx, &state, MSG_PING, messaging_bench_ping);
+
+	pids = TALLOC_ARRAY(frame, pid_t, nprocs);
+	if (pids == NULL) {
+		d_printf("talloc failed\n");
+		goto fail;
+	}
+
+	start = timeval_current();
+
+	for (i=0; i<nprocs; i++) {
+		pids[i] = sys_fork();
+		if (pids[i] == -1) {
+			d_printf("fork failed: %s\n", strerror(errno));
+			goto fail;
+		}
+		if (pids[i] == 0) {
+			_exit(messaging_bench_child(ev, msg_ctx, self));
+		}
+		num_children += 1;
+	}
+
+	if (tevent_add_timer(ev, frame, timeval_current_ofs(60, 0),
+			     messaging_bench_timeout, &state) == NULL) {
+		d_printf("tevent_add_timer failed\n");
+		goto fail;
+	}
+
+	while ((state.num_received < state.num_expected) && !state.timed_out) {
+		if (tevent_loop_once(ev) != 0) {
+			d_printf("tevent_loop_once failed\n");
+			goto fail;
+		}
+	}
+
+	elapsed = timeval_elapsed(&start);
+
+	if (state.timed_out) {
+		d_printf("timed out after %d of %d pings\n",
+			 state.num_received, state.num_expected);
+		goto fail;
+	}
+
+	d_printf("%d processes, %d round trips in %.3f seconds: "
+		 "%.0f messages/sec\n", nprocs, state.num_received, elapsed,
+		 (2.0 * state.num_received) / elapsed);
+
+	result = true;
+ fail:
+	for (i=0; i<num_children; i++) {
+		int status;
+		if (waitpid(pids[i], &status, 0) == -1) {
+			continue;
+		}
+		if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+			d_printf("child %d failed\n", (int)pids[i]);
+			result = false;
+		}
+	}
+	TALLOC_FREE(frame);
+	return result;
+}
+
 static void getaddrinfo_finished(struct tevent_req *req)
 {
 	char *name = (char *)tevent_req_callback_data_void(req);
@@ -7279,6 +8140,7 @@ static struct {
 	{"OPLOCK1",  run_oplock1, 0},
 	{"OPLOCK2",  run_oplock2, 0},
 	{"OPLOCK3",  run_oplock3, 0},
+	{"OPLOCK-BREAK-BENCH", run_oplock_break_bench, 0},
 	{"DIR",  run_dirtest, 0},
 	{"DIR1",  run_dirtest1, 0},
 	{"DIR-CREATETIME",  run_dir_createtime, 0},
@@ -7328,10 +8190,15 @@ static struct {
 	{ "LOCAL-GENCACHE", run_local_gencache, 0},
 	{ "LOCAL-TALLOC-DICT", run_local_talloc_dict, 0},
 	{ "LOCAL-BASE64", run_local_base64, 0},
+	{ "LOCAL-MS-FNMATCH", run_local_ms_fnmatch, 0},
 	{ "LOCAL-RBTREE", run_local_rbtree, 0},
 	{ "LOCAL-MEMCACHE", run_local_memcache, 0},
+	{ "LOCAL-MEMCACHE-BENCH", run_local_memcache_bench, 0},
+	{ "LOCAL-WBCACHE-BENCH", run_local_wbcache_bench, 0},
+	{ "LOCAL-MESSAGING-BENCH", run_local_messaging_bench, 0},
 	{ "LOCAL-STREAM-NAME", run_local_stream_name, 0},
 	{ "LOCAL-WBCLIENT", run_local_wbclient, 0},
+	{ "LOCAL-WBCLIENT-IDMAP-BENCH", run_local_wbclient_idmap_bench, 0},
 	{ "LOCAL-dom_sid_parse", run_local_dom_sid_parse, 0},
 	{NULL, NULL, 0}};
 
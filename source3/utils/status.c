@@ -48,6 +48,7 @@ static bool numeric_only;
 const char *username = NULL;
 
 extern bool status_profile_dump(bool be_verbose);
+extern int status_latency_dump(bool be_verbose);
 extern bool status_profile_rates(bool be_verbose);
 
 /* added by OH */
@@ -299,6 +300,7 @@ static int traverse_sessionid(struct db_record *db, void *state)
 		{"brief",	'b', POPT_ARG_NONE, 	NULL, 'b', "Be brief" },
 		{"profile",     'P', POPT_ARG_NONE, NULL, 'P', "Do profiling" },
 		{"profile-rates", 'R', POPT_ARG_NONE, NULL, 'R', "Show call rates" },
+		{"latency",	0, POPT_ARG_NONE,	NULL, 'T', "Show request latency percentiles" },
 		{"byterange",	'B', POPT_ARG_NONE,	NULL, 'B', "Include byte range locks"},
 		{"numeric",	'n', POPT_ARG_NONE,	NULL, 'n', "Numeric uid/gid"},
 		POPT_COMMON_SAMBA
@@ -346,6 +348,7 @@ static int traverse_sessionid(struct db_record *db, void *state)
 			break;
 		case 'P':
 		case 'R':
+		case 'T':
 			profile_only = c;
 			break;
 		case 'B':
@@ -407,6 +410,9 @@ static int traverse_sessionid(struct db_record *db, void *state)
 		case 'R':
 			/* Continuously display rate-converted data */
 			return status_profile_rates(verbose);
+		case 'T':
+			/* Dump the latency histograms */
+			return status_latency_dump(verbose);
 		default:
 			break;
 	}
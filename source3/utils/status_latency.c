@@ -0,0 +1,134 @@
+/*
+ * Unix SMB/CIFS implementation.
+ * status reporting of the latency histograms
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "includes.h"
+
+int status_latency_dump(bool verbose);
+
+struct latency_entry {
+	char *name;
+	struct latency_hist hist;
+};
+
+struct latency_entries {
+	struct latency_entry *entries;
+	int num;
+};
+
+static int collect_latency(struct db_record *rec, void *private_data)
+{
+	struct latency_entries *state = (struct latency_entries *)private_data;
+	struct latency_entry *e;
+
+	if ((rec->key.dsize == 0) || (rec->key.dptr[rec->key.dsize-1] != 0) ||
+	    (rec->value.dsize != sizeof(struct latency_hist))) {
+		return 0;
+	}
+
+	state->entries = TALLOC_REALLOC_ARRAY(NULL, state->entries,
+					      struct latency_entry,
+					      state->num + 1);
+	if (state->entries == NULL) {
+		return -1;
+	}
+
+	e = &state->entries[state->num];
+	e->name = talloc_strdup(state->entries, (char *)rec->key.dptr);
+	if (e->name == NULL) {
+		return -1;
+	}
+	memcpy(&e->hist, rec->value.dptr, sizeof(e->hist));
+	state->num += 1;
+
+	return 0;
+}
+
+static int latency_entry_cmp(const void *a, const void *b)
+{
+	const struct latency_entry *ea = (const struct latency_entry *)a;
+	const struct latency_entry *eb = (const struct latency_entry *)b;
+
+	return strcmp(ea->name, eb->name);
+}
+
+/*******************************************************************
+ dump the percentiles of all histograms in latency.tdb
+  ******************************************************************/
+
+int status_latency_dump(bool verbose)
+{
+	struct db_context *db;
+	struct latency_entries state;
+	int i;
+
+	db = db_open(NULL, lock_path("latency.tdb"), 0,
+		     TDB_CLEAR_IF_FIRST, O_RDONLY, 0);
+	if (db == NULL) {
+		d_printf("%s not initialised\n", lock_path("latency.tdb"));
+		d_printf("This is normal if smbd does not run with "
+			 "\"perfcount module = latency\".\n");
+		return 0;
+	}
+
+	if (verbose) {
+		d_printf("Opened %s\n", lock_path("latency.tdb"));
+	}
+
+	ZERO_STRUCT(state);
+
+	if (db->traverse_read(db, collect_latency, &state) < 0) {
+		d_printf("Could not read %s\n", lock_path("latency.tdb"));
+		TALLOC_FREE(state.entries);
+		TALLOC_FREE(db);
+		return 1;
+	}
+
+	if (state.num > 0) {
+		qsort(state.entries, state.num, sizeof(struct latency_entry),
+		      latency_entry_cmp);
+	}
+
+	d_printf("\n%-28s %10s %9s %9s %9s %9s %9s %9s\n", "Latency (usec)",
+		 "count", "avg", "p50", "p90", "p99", "p99.9", "max");
+	d_printf("-----------------------------------------------------------"
+		 "---------------------------------------\n");
+
+	for (i=0; i<state.num; i++) {
+		const struct latency_hist *h = &state.entries[i].hist;
+
+		if (h->count == 0) {
+			continue;
+		}
+
+		d_printf("%-28s %10llu %9llu %9llu %9llu %9llu %9llu %9llu\n",
+			 state.entries[i].name,
+			 (unsigned long long)h->count,
+			 (unsigned long long)(h->sum / h->count),
+			 (unsigned long long)latency_hist_percentile(h, 50),
+			 (unsigned long long)latency_hist_percentile(h, 90),
+			 (unsigned long long)latency_hist_percentile(h, 99),
+			 (unsigned long long)latency_hist_percentile(h, 99.9),
+			 (unsigned long long)h->max);
+	}
+
+	d_printf("\n");
+
+	TALLOC_FREE(state.entries);
+	TALLOC_FREE(db);
+	return 0;
+}
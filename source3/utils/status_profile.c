@@ -127,6 +127,9 @@ bool status_profile_dump(bool verbose)
 	d_printf("lookups:                        %u\n", profile_p->statcache_lookups);
 	d_printf("misses:                         %u\n", profile_p->statcache_misses);
 	d_printf("hits:                           %u\n", profile_p->statcache_hits);
+	d_printf("negative_hits:                  %u\n", profile_p->statcache_negative_hits);
+	d_printf("negative_misses:                %u\n", profile_p->statcache_negative_misses);
+	d_printf("negative_stale:                 %u\n", profile_p->statcache_negative_stale);
 
 	profile_separator("Write Cache");
 	d_printf("read_hits:                      %u\n", profile_p->writecache_read_hits);
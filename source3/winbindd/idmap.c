@@ -725,17 +725,29 @@ NTSTATUS idmap_new_mapping(const struct dom_sid *psid, enum id_type type,
 	return NT_STATUS_OK;
 }
 
-NTSTATUS idmap_backends_unixid_to_sid(const char *domname, struct id_map *id)
+/**
+ * Map a NULL terminated array of unix ids to sids
+ * @param[in] domname		idmap domain the parent picked, may be NULL
+ * @param[in,out] ids		The ids to map
+ *
+ * passdb gets a chance first, what it can't map goes to the domain's
+ * backend in one call.
+ */
+
+NTSTATUS idmap_backends_unixids_to_sids(const char *domname,
+					struct id_map **ids)
 {
 	struct idmap_domain *dom;
-	struct id_map *maps[2];
+	struct id_map **unmapped;
+	NTSTATUS status;
+	int i, num_ids, num_unmapped;
 
-	 DEBUG(10, ("idmap_backend_unixid_to_sid: domain = '%s', xid = %d "
-		    "(type %d)\n",
-		    domname?domname:"NULL", id->xid.id, id->xid.type));
+	DEBUG(10, ("idmap_backends_unixids_to_sids: domain = '%s'\n",
+		   domname?domname:"NULL"));
 
-	maps[0] = id;
-	maps[1] = NULL;
+	for (num_ids = 0; ids[num_ids] != NULL; num_ids++) {
+		ids[num_ids]->status = ID_UNKNOWN;
+	}
 
 	/*
 	 * Always give passdb a chance first
@@ -743,9 +755,18 @@ NTSTATUS idmap_backends_unixid_to_sid(const char *domname, struct id_map *id)
 
 	dom = idmap_init_passdb_domain(NULL);
 	if ((dom != NULL)
-	    && NT_STATUS_IS_OK(dom->methods->unixids_to_sids(dom, maps))
-	    && id->status == ID_MAPPED) {
-		return NT_STATUS_OK;
+	    && NT_STATUS_IS_OK(dom->methods->unixids_to_sids(dom, ids))) {
+		num_unmapped = 0;
+		for (i=0; i<num_ids; i++) {
+			if (ids[i]->status != ID_MAPPED) {
+				num_unmapped += 1;
+			}
+		}
+		if (num_unmapped == 0) {
+			return NT_STATUS_OK;
+		}
+	} else {
+		num_unmapped = num_ids;
 	}
 
 	dom = idmap_find_domain(domname);
@@ -753,36 +774,124 @@ NTSTATUS idmap_backends_unixid_to_sid(const char *domname, struct id_map *id)
 		return NT_STATUS_NONE_MAPPED;
 	}
 
-	return dom->methods->unixids_to_sids(dom, maps);
+	if (num_unmapped == num_ids) {
+		return dom->methods->unixids_to_sids(dom, ids);
+	}
+
+	unmapped = TALLOC_ARRAY(talloc_tos(), struct id_map *,
+				num_unmapped + 1);
+	if (unmapped == NULL) {
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	num_unmapped = 0;
+	for (i=0; i<num_ids; i++) {
+		if (ids[i]->status != ID_MAPPED) {
+			unmapped[num_unmapped++] = ids[i];
+		}
+	}
+	unmapped[num_unmapped] = NULL;
+
+	status = dom->methods->unixids_to_sids(dom, unmapped);
+	TALLOC_FREE(unmapped);
+	return status;
 }
 
-NTSTATUS idmap_backends_sid_to_unixid(const char *domain, struct id_map *id)
+NTSTATUS idmap_backends_unixid_to_sid(const char *domname, struct id_map *id)
 {
-	struct idmap_domain *dom;
 	struct id_map *maps[2];
 
-	 DEBUG(10, ("idmap_backends_sid_to_unixid: domain = '%s', sid = [%s]\n",
-		    domain?domain:"NULL", sid_string_dbg(id->sid)));
-
 	maps[0] = id;
 	maps[1] = NULL;
 
-	if (sid_check_is_in_builtin(id->sid)
-	    || (sid_check_is_in_our_domain(id->sid))) {
+	return idmap_backends_unixids_to_sids(domname, maps);
+}
+
+/**
+ * Map a NULL terminated array of sids to unix ids
+ * @param[in] domain		idmap domain the parent picked, may be NULL
+ * @param[in,out] ids		The sids to map
+ *
+ * BUILTIN and our own sids go to passdb, all others to the domain's
+ * backend, one call to each.
+ */
+
+NTSTATUS idmap_backends_sids_to_unixids(const char *domain,
+					struct id_map **ids)
+{
+	struct idmap_domain *dom;
+	struct id_map **passdb_ids, **dom_ids;
+	NTSTATUS status;
+	int i, num_ids, num_passdb, num_dom;
+
+	DEBUG(10, ("idmap_backends_sids_to_unixids: domain = '%s'\n",
+		   domain?domain:"NULL"));
+
+	for (num_ids = 0; ids[num_ids] != NULL; num_ids++) {
+		;
+	}
+
+	passdb_ids = TALLOC_ARRAY(talloc_tos(), struct id_map *, num_ids + 1);
+	dom_ids = TALLOC_ARRAY(talloc_tos(), struct id_map *, num_ids + 1);
+	if ((passdb_ids == NULL) || (dom_ids == NULL)) {
+		TALLOC_FREE(passdb_ids);
+		TALLOC_FREE(dom_ids);
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	num_passdb = num_dom = 0;
+
+	for (i=0; i<num_ids; i++) {
+		DEBUG(10, ("idmap_backends_sids_to_unixids: sid = [%s]\n",
+			   sid_string_dbg(ids[i]->sid)));
+
+		if (sid_check_is_in_builtin(ids[i]->sid)
+		    || (sid_check_is_in_our_domain(ids[i]->sid))) {
+			passdb_ids[num_passdb++] = ids[i];
+		} else {
+			dom_ids[num_dom++] = ids[i];
+		}
+	}
+	passdb_ids[num_passdb] = NULL;
+	dom_ids[num_dom] = NULL;
+
+	status = NT_STATUS_OK;
 
+	if (num_passdb != 0) {
 		dom = idmap_init_passdb_domain(NULL);
 		if (dom == NULL) {
-			return NT_STATUS_NONE_MAPPED;
+			status = NT_STATUS_NONE_MAPPED;
+			goto done;
+		}
+		status = dom->methods->sids_to_unixids(dom, passdb_ids);
+		if (!NT_STATUS_IS_OK(status)) {
+			goto done;
 		}
-		return dom->methods->sids_to_unixids(dom, maps);
 	}
 
-	dom = idmap_find_domain(domain);
-	if (dom == NULL) {
-		return NT_STATUS_NONE_MAPPED;
+	if (num_dom != 0) {
+		dom = idmap_find_domain(domain);
+		if (dom == NULL) {
+			status = NT_STATUS_NONE_MAPPED;
+			goto done;
+		}
+		status = dom->methods->sids_to_unixids(dom, dom_ids);
 	}
 
-	return dom->methods->sids_to_unixids(dom, maps);
+ done:
+	TALLOC_FREE(dom_ids);
+	TALLOC_FREE(passdb_ids);
+	return status;
+}
+
+NTSTATUS idmap_backends_sid_to_unixid(const char *domain, struct id_map *id)
+{
+	struct id_map *maps[2];
+
+	maps[0] = id;
+	maps[1] = NULL;
+
+	return idmap_backends_sids_to_unixids(domain, maps);
 }
 
 NTSTATUS idmap_set_mapping(const struct id_map *map)
@@ -304,3 +304,251 @@ done:
 	}
 	return NT_STATUS_OK;
 }
+
+/*****************************************************************
+ Bulk versions of the above for the idmap child, one backend call
+ per array. Same rules for the cache, negative entries and new
+ mappings as for the single sid.
+*****************************************************************/
+
+static bool idmap_cache_find_sid2xid(struct id_map *map)
+{
+	uid_t uid;
+	gid_t gid;
+	bool expired;
+
+	switch (map->xid.type) {
+	case ID_TYPE_UID:
+		if (!idmap_cache_find_sid2uid(map->sid, &uid, &expired)) {
+			return false;
+		}
+		map->status = (uid == (uid_t)-1) ? ID_UNMAPPED : ID_MAPPED;
+		map->xid.id = uid;
+		break;
+	case ID_TYPE_GID:
+		if (!idmap_cache_find_sid2gid(map->sid, &gid, &expired)) {
+			return false;
+		}
+		map->status = (gid == (gid_t)-1) ? ID_UNMAPPED : ID_MAPPED;
+		map->xid.id = gid;
+		break;
+	default:
+		return false;
+	}
+
+	if (expired && idmap_is_online()) {
+		DEBUG(10, ("revalidating expired entry for %s\n",
+			   sid_string_dbg(map->sid)));
+		map->status = ID_UNKNOWN;
+		return false;
+	}
+	return true;
+}
+
+static void idmap_cache_set_sid2xid(const struct id_map *map)
+{
+	uint32_t id = (map->status == ID_MAPPED) ? map->xid.id : -1;
+
+	if (map->xid.type == ID_TYPE_UID) {
+		idmap_cache_set_sid2uid(map->sid, id);
+	} else {
+		idmap_cache_set_sid2gid(map->sid, id);
+	}
+}
+
+/*****************************************************************
+ Map an array of sids to the uid or gid given in xid.type of each
+ map. On return each map has status ID_MAPPED or ID_UNMAPPED.
+*****************************************************************/
+
+NTSTATUS idmap_sids_to_unixids(const char *dom_name, struct id_map **ids)
+{
+	struct id_map **todo;
+	enum id_type *types;
+	NTSTATUS ret;
+	int i, num_ids, num_todo;
+
+	for (num_ids = 0; ids[num_ids] != NULL; num_ids++) {
+		;
+	}
+
+	DEBUG(10, ("idmap_sids_to_unixids: %d sids, domain = '%s'\n",
+		   num_ids, dom_name));
+
+	todo = TALLOC_ARRAY(talloc_tos(), struct id_map *, num_ids + 1);
+	types = TALLOC_ARRAY(talloc_tos(), enum id_type, num_ids + 1);
+	if ((todo == NULL) || (types == NULL)) {
+		TALLOC_FREE(todo);
+		TALLOC_FREE(types);
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	num_todo = 0;
+
+	for (i=0; i<num_ids; i++) {
+		ids[i]->status = ID_UNKNOWN;
+		if (winbindd_use_idmap_cache()
+		    && idmap_cache_find_sid2xid(ids[i])) {
+			continue;
+		}
+		types[num_todo] = ids[i]->xid.type;
+		todo[num_todo++] = ids[i];
+	}
+	todo[num_todo] = NULL;
+
+	if (num_todo == 0) {
+		goto done;
+	}
+
+	ret = idmap_backends_sids_to_unixids(dom_name, todo);
+
+	for (i=0; i<num_todo; i++) {
+		struct id_map *map = todo[i];
+
+		if (NT_STATUS_IS_OK(ret) && (map->status == ID_MAPPED)) {
+			if (map->xid.type != types[i]) {
+				DEBUG(10, ("sid [%s] not mapped to a %s\n",
+					   sid_string_dbg(map->sid),
+					   (types[i] == ID_TYPE_UID)
+					   ? "uid" : "gid"));
+				map->status = ID_UNMAPPED;
+			}
+		} else if (dom_name[0] != '\0') {
+			/*
+			 * We had the task to go to a specific domain
+			 * which could not answer our request. Fail.
+			 */
+			map->status = ID_UNMAPPED;
+		} else if (NT_STATUS_IS_OK(idmap_new_mapping(
+						   map->sid, types[i],
+						   &map->xid))) {
+			map->status = ID_MAPPED;
+		} else {
+			map->status = ID_UNMAPPED;
+		}
+
+		map->xid.type = types[i];
+		if (winbindd_use_idmap_cache()) {
+			idmap_cache_set_sid2xid(map);
+		}
+	}
+
+ done:
+	TALLOC_FREE(types);
+	TALLOC_FREE(todo);
+	return NT_STATUS_OK;
+}
+
+static bool idmap_cache_find_xid2sid(struct id_map *map)
+{
+	bool expired;
+
+	switch (map->xid.type) {
+	case ID_TYPE_UID:
+		if (!idmap_cache_find_uid2sid(map->xid.id, map->sid,
+					      &expired)) {
+			return false;
+		}
+		break;
+	case ID_TYPE_GID:
+		if (!idmap_cache_find_gid2sid(map->xid.id, map->sid,
+					      &expired)) {
+			return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	if (expired && idmap_is_online()) {
+		DEBUG(10, ("revalidating expired entry for %s %u\n",
+			   (map->xid.type == ID_TYPE_UID) ? "uid" : "gid",
+			   (unsigned)map->xid.id));
+		return false;
+	}
+
+	map->status = is_null_sid(map->sid) ? ID_UNMAPPED : ID_MAPPED;
+	return true;
+}
+
+/*****************************************************************
+ Map an array of uids and gids to sids. map->sid has to point to
+ space for the result. On return each map has status ID_MAPPED or
+ ID_UNMAPPED.
+*****************************************************************/
+
+NTSTATUS idmap_unixids_to_sids(const char *dom_name, struct id_map **ids)
+{
+	struct id_map **todo;
+	enum id_type *types;
+	NTSTATUS ret;
+	int i, num_ids, num_todo;
+
+	for (num_ids = 0; ids[num_ids] != NULL; num_ids++) {
+		;
+	}
+
+	DEBUG(10, ("idmap_unixids_to_sids: %d ids, domain = '%s'\n",
+		   num_ids, dom_name?dom_name:"NULL"));
+
+	todo = TALLOC_ARRAY(talloc_tos(), struct id_map *, num_ids + 1);
+	types = TALLOC_ARRAY(talloc_tos(), enum id_type, num_ids + 1);
+	if ((todo == NULL) || (types == NULL)) {
+		TALLOC_FREE(todo);
+		TALLOC_FREE(types);
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	num_todo = 0;
+
+	for (i=0; i<num_ids; i++) {
+		ids[i]->status = ID_UNKNOWN;
+		if (winbindd_use_idmap_cache()
+		    && idmap_cache_find_xid2sid(ids[i])) {
+			continue;
+		}
+		types[num_todo] = ids[i]->xid.type;
+		todo[num_todo++] = ids[i];
+	}
+	todo[num_todo] = NULL;
+
+	if (num_todo == 0) {
+		goto done;
+	}
+
+	ret = idmap_backends_unixids_to_sids(dom_name, todo);
+	if (!NT_STATUS_IS_OK(ret)) {
+		DEBUG(10, ("idmap_backends_unixids_to_sids failed: %s\n",
+			   nt_errstr(ret)));
+	}
+
+	for (i=0; i<num_todo; i++) {
+		struct id_map *map = todo[i];
+
+		map->xid.type = types[i];
+
+		if (!NT_STATUS_IS_OK(ret)) {
+			map->status = ID_UNMAPPED;
+			continue;
+		}
+
+		if (map->status != ID_MAPPED) {
+			map->status = ID_UNMAPPED;
+			ZERO_STRUCTP(map->sid);
+		}
+
+		if (!winbindd_use_idmap_cache()) {
+			continue;
+		}
+		if (map->xid.type == ID_TYPE_UID) {
+			idmap_cache_set_sid2uid(map->sid, map->xid.id);
+		} else {
+			idmap_cache_set_sid2gid(map->sid, map->xid.id);
+		}
+	}
+
+ done:
+	TALLOC_FREE(types);
+	TALLOC_FREE(todo);
+	return NT_STATUS_OK;
+}
@@ -71,7 +71,7 @@ static struct tevent_req *wb_lookupgroupmem_send(TALLOC_CTX *mem_ctx,
 	}
 
 	subreq = rpccli_wbint_LookupGroupMembers_send(
-		state, ev, domain->child.rpccli, &state->sid, type,
+		state, ev, domain->rpccli, &state->sid, type,
 		&state->members);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
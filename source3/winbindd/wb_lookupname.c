@@ -69,7 +69,7 @@ struct tevent_req *wb_lookupname_send(TALLOC_CTX *mem_ctx,
 	}
 
 	subreq = rpccli_wbint_LookupName_send(
-		state, ev, domain->child.rpccli, state->dom_name, state->name,
+		state, ev, domain->rpccli, state->dom_name, state->name,
 		flags, &state->type, &state->sid);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
@@ -110,7 +110,7 @@ static void wb_lookupname_done(struct tevent_req *subreq)
 	}
 
 	subreq = rpccli_wbint_LookupName_send(
-		state, state->ev, root_domain->child.rpccli, state->dom_name,
+		state, state->ev, root_domain->rpccli, state->dom_name,
 		state->name, state->flags, &state->type, &state->sid);
 	if (tevent_req_nomem(subreq, req)) {
 		return;
@@ -55,7 +55,7 @@ struct tevent_req *wb_lookupsid_send(TALLOC_CTX *mem_ctx,
 	}
 
 	subreq = rpccli_wbint_LookupSid_send(
-		state, ev, state->lookup_domain->child.rpccli,
+		state, ev, state->lookup_domain->rpccli,
 		&state->sid, &state->type, &state->domname, &state->name);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
@@ -95,7 +95,7 @@ static void wb_lookupsid_done(struct tevent_req *subreq)
 	state->lookup_domain = forest_root;
 
 	subreq = rpccli_wbint_LookupSid_send(
-		state, state->ev, state->lookup_domain->child.rpccli,
+		state, state->ev, state->lookup_domain->rpccli,
 		&state->sid, &state->type, &state->domname, &state->name);
 	if (tevent_req_nomem(subreq, req)) {
 		return;
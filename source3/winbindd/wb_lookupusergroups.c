@@ -45,7 +45,7 @@ struct tevent_req *wb_lookupusergroups_send(TALLOC_CTX *mem_ctx,
 	sid_copy(&state->sid, sid);
 
 	subreq = rpccli_wbint_LookupUserGroups_send(
-		state, ev, domain->child.rpccli, &state->sid, &state->sids);
+		state, ev, domain->rpccli, &state->sid, &state->sids);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
 	}
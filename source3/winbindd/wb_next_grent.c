@@ -64,7 +64,7 @@ struct tevent_req *wb_next_grent_send(TALLOC_CTX *mem_ctx,
 			return tevent_req_post(req, ev);
 		}
 		subreq = rpccli_wbint_QueryGroupList_send(
-			state, state->ev, state->gstate->domain->child.rpccli,
+			state, state->ev, state->gstate->domain->rpccli,
 			&state->next_groups);
 		if (tevent_req_nomem(subreq, req)) {
 			return tevent_req_post(req, ev);
@@ -114,7 +114,7 @@ static void wb_next_grent_fetch_done(struct tevent_req *subreq)
 			return;
 		}
 		subreq = rpccli_wbint_QueryGroupList_send(
-			state, state->ev, state->gstate->domain->child.rpccli,
+			state, state->ev, state->gstate->domain->rpccli,
 			&state->next_groups);
 		if (tevent_req_nomem(subreq, req)) {
 			return;
@@ -41,7 +41,7 @@ struct tevent_req *wb_query_user_list_send(TALLOC_CTX *mem_ctx,
 	}
 
 	subreq = rpccli_wbint_QueryUserList_send(state, ev,
-						 domain->child.rpccli,
+						 domain->rpccli,
 						 &state->users);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
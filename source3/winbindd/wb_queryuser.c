@@ -53,7 +53,7 @@ struct tevent_req *wb_queryuser_send(TALLOC_CTX *mem_ctx,
 		return tevent_req_post(req, ev);
 	}
 
-	subreq = rpccli_wbint_QueryUser_send(state, ev, domain->child.rpccli,
+	subreq = rpccli_wbint_QueryUser_send(state, ev, domain->rpccli,
 					     &state->sid, state->info);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
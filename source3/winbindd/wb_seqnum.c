@@ -39,7 +39,7 @@ struct tevent_req *wb_seqnum_send(TALLOC_CTX *mem_ctx,
 		return NULL;
 	}
 	subreq = rpccli_wbint_QuerySequenceNumber_send(
-		state, ev, domain->child.rpccli, &state->seqnum);
+		state, ev, domain->rpccli, &state->seqnum);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
 	}
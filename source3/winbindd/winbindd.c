@@ -139,6 +139,8 @@ static void flush_caches(void)
 			exit(1);
 		}
 	}
+
+	winbindd_nsscache_flush();
 }
 
 /* Handle the signal by unlinking socket and exiting */
@@ -157,6 +159,8 @@ static void terminate(bool is_parent)
 			unlink(path);
 			SAFE_FREE(path);
 		}
+
+		winbindd_nsscache_shutdown();
 	}
 
 	idmap_close();
@@ -489,6 +493,10 @@ static struct winbindd_async_dispatch_table async_nonpriv_table[] = {
 	  winbindd_uid_to_sid_send, winbindd_uid_to_sid_recv },
 	{ WINBINDD_GID_TO_SID, "GID_TO_SID",
 	  winbindd_gid_to_sid_send, winbindd_gid_to_sid_recv },
+	{ WINBINDD_SIDS_TO_XIDS, "SIDS_TO_XIDS",
+	  winbindd_sids_to_xids_send, winbindd_sids_to_xids_recv },
+	{ WINBINDD_XIDS_TO_SIDS, "XIDS_TO_SIDS",
+	  winbindd_xids_to_sids_send, winbindd_xids_to_sids_recv },
 	{ WINBINDD_GETPWSID, "GETPWSID",
 	  winbindd_getpwsid_send, winbindd_getpwsid_recv },
 	{ WINBINDD_GETPWNAM, "GETPWNAM",
@@ -653,6 +661,7 @@ static void wb_request_done(struct tevent_req *req)
 		request_error(state);
 		return;
 	}
+	winbindd_nsscache_store(state->request, state->response);
 	request_ok(state);
 }
 
@@ -1248,6 +1257,12 @@ int main(int argc, char **argv, char **envp)
 		exit(1);
 	}
 
+	/* clients go on asking us if this fails */
+
+	if (!winbindd_nsscache_init()) {
+		DEBUG(1, ("winbindd_nsscache_init() failed\n"));
+	}
+
 	te = tevent_add_timer(winbind_event_context(), NULL, timeval_zero(),
 			      rescan_trusted_domains, NULL);
 	if (te == NULL) {
@@ -200,9 +200,15 @@ struct winbindd_domain {
 
 	struct winbindd_cm_conn conn;
 
-	/* The child pid we're talking to */
+	/*
+	 * The children we're talking to, "winbind max domain
+	 * connections" of them. rpccli load balances over them, see
+	 * choose_domain_child().
+	 */
 
-	struct winbindd_child child;
+	int num_children;
+	struct winbindd_child *children;
+	struct rpc_pipe_client *rpccli;
 
 	/* Callback we use to try put us back online. */
 
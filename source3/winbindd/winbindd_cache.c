@@ -25,6 +25,7 @@
 
 #include "includes.h"
 #include "winbindd.h"
+#include "winbindd_cache_rec.h"
 #include "tdb_validate.h"
 #include "../libcli/auth/libcli_auth.h"
 #include "../librpc/gen_ndr/ndr_wbint.h"
@@ -32,7 +33,7 @@
 #undef DBGC_CLASS
 #define DBGC_CLASS DBGC_WINBIND
 
-#define WINBINDD_CACHE_VERSION 1
+#define WINBINDD_CACHE_VERSION 2
 #define WINBINDD_CACHE_VERSION_KEYSTR "WINBINDD_CACHE_VERSION"
 
 extern struct winbindd_methods reconnect_methods;
@@ -708,6 +709,79 @@ static struct cache_entry *wcache_fetch(struct winbind_cache *cache,
 	return centry;
 }
 
+struct wcache_parse_state {
+	struct winbindd_domain *domain;
+	const char *kstr;
+	bool (*parser)(NTSTATUS status, TDB_DATA data, void *private_data);
+	void *private_data;
+	NTSTATUS status;
+};
+
+static int wcache_parse_fn(TDB_DATA key, TDB_DATA data, void *private_data)
+{
+	struct wcache_parse_state *state =
+		(struct wcache_parse_state *)private_data;
+	struct cache_entry centry;
+
+	ZERO_STRUCT(centry);
+
+	if (!wcache_rec_hdr(data, &centry.status, &centry.sequence_number)) {
+		DEBUG(10,("wcache_parse: Corrupt cache for key %s (len < 8) ?\n",
+			  state->kstr));
+		return 0;
+	}
+
+	if (centry_expired(state->domain, state->kstr, &centry)) {
+		DEBUG(10,("wcache_parse: entry %s expired for domain %s\n",
+			  state->kstr, state->domain->name));
+		return 0;
+	}
+
+	if (!state->parser(centry.status, data, state->private_data)) {
+		return 0;
+	}
+
+	DEBUG(10,("wcache_parse: returning entry %s for domain %s\n",
+		  state->kstr, state->domain->name));
+
+	state->status = centry.status;
+	return 0;
+}
+
+/*
+  like wcache_fetch, but hand the record to parser while it is still
+  in the tdb instead of copying it. parser is only called for an entry
+  that has not expired, it returns false if it can not use the
+  entry. Returns NT_STATUS_NOT_FOUND for a miss, otherwise the status
+  stored in the cache.
+*/
+static NTSTATUS wcache_parse(struct winbind_cache *cache,
+			     struct winbindd_domain *domain,
+			     const char *kstr,
+			     bool (*parser)(NTSTATUS status, TDB_DATA data,
+					    void *private_data),
+			     void *private_data)
+{
+	struct wcache_parse_state state;
+
+	if (!winbindd_use_cache()) {
+		return NT_STATUS_NOT_FOUND;
+	}
+
+	refresh_sequence_number(domain, false);
+
+	state.domain = domain;
+	state.kstr = kstr;
+	state.parser = parser;
+	state.private_data = private_data;
+	state.status = NT_STATUS_NOT_FOUND;
+
+	tdb_parse_record(cache->tdb, string_tdb_data(kstr), wcache_parse_fn,
+			 &state);
+
+	return state.status;
+}
+
 static void wcache_delete(const char *format, ...) PRINTF_ATTRIBUTE(1,2);
 static void wcache_delete(const char *format, ...)
 {
@@ -893,74 +967,79 @@ static void centry_end(struct cache_entry *centry, const char *format, ...)
 	free(kstr);
 }
 
+/*
+  write a record made by one of the wcache_rec_push functions
+*/
+static void wcache_store_rec(const char *kstr, TDB_DATA data)
+{
+	if ((wcache->tdb == NULL) || (kstr == NULL) || (data.dptr == NULL)) {
+		return;
+	}
+
+	if (!winbindd_use_cache()) {
+		return;
+	}
+
+	tdb_store(wcache->tdb, string_tdb_data(kstr), data, TDB_REPLACE);
+}
+
 static void wcache_save_name_to_sid(struct winbindd_domain *domain, 
 				    NTSTATUS status, const char *domain_name,
 				    const char *name, const DOM_SID *sid, 
 				    enum lsa_SidType type)
 {
-	struct cache_entry *centry;
+	TDB_DATA data;
 	fstring uname;
+	char *kstr;
 
-	centry = centry_start(domain, status);
-	if (!centry)
-		return;
-	centry_put_uint32(centry, type);
-	centry_put_sid(centry, sid);
 	fstrcpy(uname, name);
 	strupper_m(uname);
-	centry_end(centry, "NS/%s/%s", domain_name, uname);
+	kstr = talloc_asprintf(talloc_tos(), "NS/%s/%s", domain_name, uname);
+	data = wcache_rec_push_ns(talloc_tos(), status,
+				  domain->sequence_number, type, sid);
+	wcache_store_rec(kstr, data);
 	DEBUG(10,("wcache_save_name_to_sid: %s\\%s -> %s (%s)\n", domain_name,
 		  uname, sid_string_dbg(sid), nt_errstr(status)));
-	centry_free(centry);
+	TALLOC_FREE(data.dptr);
+	TALLOC_FREE(kstr);
 }
 
 static void wcache_save_sid_to_name(struct winbindd_domain *domain, NTSTATUS status, 
 				    const DOM_SID *sid, const char *domain_name, const char *name, enum lsa_SidType type)
 {
-	struct cache_entry *centry;
+	TDB_DATA data;
 	fstring sid_string;
+	fstring kstr;
 
-	centry = centry_start(domain, status);
-	if (!centry)
-		return;
-
-	if (NT_STATUS_IS_OK(status)) {
-		centry_put_uint32(centry, type);
-		centry_put_string(centry, domain_name);
-		centry_put_string(centry, name);
-	}
-
-	centry_end(centry, "SN/%s", sid_to_fstring(sid_string, sid));
+	fstr_sprintf(kstr, "SN/%s", sid_to_fstring(sid_string, sid));
+	data = wcache_rec_push_sn(talloc_tos(), status,
+				  domain->sequence_number, type,
+				  domain_name, name);
+	wcache_store_rec(kstr, data);
 	DEBUG(10,("wcache_save_sid_to_name: %s -> %s (%s)\n", sid_string, 
 		  name, nt_errstr(status)));
-	centry_free(centry);
+	TALLOC_FREE(data.dptr);
 }
 
 
 static void wcache_save_user(struct winbindd_domain *domain, NTSTATUS status,
 			     struct wbint_userinfo *info)
 {
-	struct cache_entry *centry;
+	TDB_DATA data;
 	fstring sid_string;
+	fstring kstr;
 
 	if (is_null_sid(&info->user_sid)) {
 		return;
 	}
 
-	centry = centry_start(domain, status);
-	if (!centry)
-		return;
-	centry_put_string(centry, info->acct_name);
-	centry_put_string(centry, info->full_name);
-	centry_put_string(centry, info->homedir);
-	centry_put_string(centry, info->shell);
-	centry_put_uint32(centry, info->primary_gid);
-	centry_put_sid(centry, &info->user_sid);
-	centry_put_sid(centry, &info->group_sid);
-	centry_end(centry, "U/%s", sid_to_fstring(sid_string,
+	fstr_sprintf(kstr, "U/%s", sid_to_fstring(sid_string,
 						  &info->user_sid));
+	data = wcache_rec_push_u(talloc_tos(), status,
+				 domain->sequence_number, info);
+	wcache_store_rec(kstr, data);
 	DEBUG(10,("wcache_save_user: %s (acct_name %s)\n", sid_string, info->acct_name));
-	centry_free(centry);
+	TALLOC_FREE(data.dptr);
 }
 
 static void wcache_save_lockout_policy(struct winbindd_domain *domain,
@@ -1721,6 +1800,23 @@ skip_save:
 	return status;
 }
 
+struct wcache_ns_state {
+	struct dom_sid *sid;
+	enum lsa_SidType *type;
+};
+
+static bool wcache_parse_ns(NTSTATUS status, TDB_DATA data,
+			    void *private_data)
+{
+	struct wcache_ns_state *state =
+		(struct wcache_ns_state *)private_data;
+
+	if (!NT_STATUS_IS_OK(status)) {
+		return true;
+	}
+	return wcache_rec_pull_ns(data, state->type, state->sid);
+}
+
 NTSTATUS wcache_name_to_sid(struct winbindd_domain *domain,
 			    const char *domain_name,
 			    const char *name,
@@ -1728,9 +1824,10 @@ NTSTATUS wcache_name_to_sid(struct winbindd_domain *domain,
 			    enum lsa_SidType *type)
 {
 	struct winbind_cache *cache = get_cache(domain);
-	struct cache_entry *centry;
+	struct wcache_ns_state state;
 	NTSTATUS status;
 	char *uname;
+	char *kstr;
 
 	if (cache->tdb == NULL) {
 		return NT_STATUS_NOT_FOUND;
@@ -1741,22 +1838,24 @@ NTSTATUS wcache_name_to_sid(struct winbindd_domain *domain,
 		return NT_STATUS_NO_MEMORY;
 	}
 
-	centry = wcache_fetch(cache, domain, "NS/%s/%s", domain_name, uname);
+	kstr = talloc_asprintf(talloc_tos(), "NS/%s/%s", domain_name, uname);
 	TALLOC_FREE(uname);
-	if (centry == NULL) {
-		return NT_STATUS_NOT_FOUND;
+	if (kstr == NULL) {
+		return NT_STATUS_NO_MEMORY;
 	}
 
-	status = centry->status;
-	if (NT_STATUS_IS_OK(status)) {
-		*type = (enum lsa_SidType)centry_uint32(centry);
-		centry_sid(centry, sid);
+	state.sid = sid;
+	state.type = type;
+
+	status = wcache_parse(cache, domain, kstr, wcache_parse_ns, &state);
+	TALLOC_FREE(kstr);
+	if (NT_STATUS_EQUAL(status, NT_STATUS_NOT_FOUND)) {
+		return status;
 	}
 
 	DEBUG(10,("name_to_sid: [Cached] - cached name for domain %s status: "
 		  "%s\n", domain->name, nt_errstr(status) ));
 
-	centry_free(centry);
 	return status;
 }
 
@@ -1829,6 +1928,52 @@ static NTSTATUS name_to_sid(struct winbindd_domain *domain,
 	return status;
 }
 
+struct wcache_sn_state {
+	TALLOC_CTX *mem_ctx;
+	char **domain_name;
+	char **name;
+	enum lsa_SidType *type;
+};
+
+static bool wcache_parse_sn(NTSTATUS status, TDB_DATA data,
+			    void *private_data)
+{
+	struct wcache_sn_state *state =
+		(struct wcache_sn_state *)private_data;
+
+	if (!NT_STATUS_IS_OK(status)) {
+		return true;
+	}
+	return wcache_rec_pull_sn(data, state->mem_ctx, state->type,
+				  state->domain_name, state->name);
+}
+
+/*
+  look up a SN/ entry. domain_name may be NULL if the caller does not
+  need it.
+*/
+static NTSTATUS wcache_fetch_sn(struct winbind_cache *cache,
+				struct winbindd_domain *domain,
+				const struct dom_sid *sid,
+				TALLOC_CTX *mem_ctx,
+				char **domain_name,
+				char **name,
+				enum lsa_SidType *type)
+{
+	struct wcache_sn_state state;
+	fstring sid_string;
+	fstring kstr;
+
+	fstr_sprintf(kstr, "SN/%s", sid_to_fstring(sid_string, sid));
+
+	state.mem_ctx = mem_ctx;
+	state.domain_name = domain_name;
+	state.name = name;
+	state.type = type;
+
+	return wcache_parse(cache, domain, kstr, wcache_parse_sn, &state);
+}
+
 NTSTATUS wcache_sid_to_name(struct winbindd_domain *domain,
 			    const struct dom_sid *sid,
 			    TALLOC_CTX *mem_ctx,
@@ -1837,34 +1982,18 @@ NTSTATUS wcache_sid_to_name(struct winbindd_domain *domain,
 			    enum lsa_SidType *type)
 {
 	struct winbind_cache *cache = get_cache(domain);
-	struct cache_entry *centry;
-	char *sid_string;
 	NTSTATUS status;
 
 	if (cache->tdb == NULL) {
 		return NT_STATUS_NOT_FOUND;
 	}
 
-	sid_string = sid_string_tos(sid);
-	if (sid_string == NULL) {
-		return NT_STATUS_NO_MEMORY;
-	}
-
-	centry = wcache_fetch(cache, domain, "SN/%s", sid_string);
-	TALLOC_FREE(sid_string);
-	if (centry == NULL) {
-		return NT_STATUS_NOT_FOUND;
-	}
-
-	if (NT_STATUS_IS_OK(centry->status)) {
-		*type = (enum lsa_SidType)centry_uint32(centry);
-		*domain_name = centry_string(centry, mem_ctx);
-		*name = centry_string(centry, mem_ctx);
+	status = wcache_fetch_sn(cache, domain, sid, mem_ctx, domain_name,
+				 name, type);
+	if (NT_STATUS_EQUAL(status, NT_STATUS_NOT_FOUND)) {
+		return status;
 	}
 
-	status = centry->status;
-	centry_free(centry);
-
 	DEBUG(10,("sid_to_name: [Cached] - cached name for domain %s status: "
 		  "%s\n", domain->name, nt_errstr(status) ));
 
@@ -1977,47 +2106,43 @@ static NTSTATUS rids_to_names(struct winbindd_domain *domain,
 
 	for (i=0; i<num_rids; i++) {
 		DOM_SID sid;
-		struct cache_entry *centry;
-		fstring tmp;
+		NTSTATUS status;
+		char *dom = NULL;
+		char *name = NULL;
+		enum lsa_SidType type;
 
 		if (!sid_compose(&sid, domain_sid, rids[i])) {
 			result = NT_STATUS_INTERNAL_ERROR;
 			goto error;
 		}
 
-		centry = wcache_fetch(cache, domain, "SN/%s",
-				      sid_to_fstring(tmp, &sid));
-		if (!centry) {
+		status = wcache_fetch_sn(cache, domain, &sid, *names,
+					 (*domain_name == NULL) ? &dom : NULL,
+					 &name, &type);
+		if (NT_STATUS_EQUAL(status, NT_STATUS_NOT_FOUND)) {
 			goto do_query;
 		}
 
 		(*types)[i] = SID_NAME_UNKNOWN;
-		(*names)[i] = talloc_strdup(*names, "");
 
-		if (NT_STATUS_IS_OK(centry->status)) {
-			char *dom;
+		if (NT_STATUS_IS_OK(status)) {
 			have_mapped = true;
-			(*types)[i] = (enum lsa_SidType)centry_uint32(centry);
+			(*types)[i] = type;
+			(*names)[i] = name;
 
-			dom = centry_string(centry, mem_ctx);
-			if (*domain_name == NULL) {
-				*domain_name = dom;
-			} else {
-				talloc_free(dom);
+			if (dom != NULL) {
+				*domain_name = talloc_move(mem_ctx, &dom);
 			}
 
-			(*names)[i] = centry_string(centry, *names);
-
-		} else if (NT_STATUS_EQUAL(centry->status, NT_STATUS_NONE_MAPPED)) {
+		} else if (NT_STATUS_EQUAL(status, NT_STATUS_NONE_MAPPED)) {
 			have_unmapped = true;
+			(*names)[i] = talloc_strdup(*names, "");
 
 		} else {
 			/* something's definitely wrong */
-			result = centry->status;
+			result = status;
 			goto error;
 		}
-
-		centry_free(centry);
 	}
 
 	if (!have_mapped) {
@@ -2050,49 +2175,47 @@ static NTSTATUS rids_to_names(struct winbindd_domain *domain,
 
 			for (i=0; i<num_rids; i++) {
 				DOM_SID sid;
-				struct cache_entry *centry;
-				fstring tmp;
+				NTSTATUS status;
+				char *dom = NULL;
+				char *name = NULL;
+				enum lsa_SidType type;
 
 				if (!sid_compose(&sid, domain_sid, rids[i])) {
 					result = NT_STATUS_INTERNAL_ERROR;
 					goto error;
 				}
 
-				centry = wcache_fetch(cache, domain, "SN/%s",
-						      sid_to_fstring(tmp, &sid));
-				if (!centry) {
-					(*types)[i] = SID_NAME_UNKNOWN;
+				status = wcache_fetch_sn(
+					cache, domain, &sid, *names,
+					(*domain_name == NULL) ? &dom : NULL,
+					&name, &type);
+
+				(*types)[i] = SID_NAME_UNKNOWN;
+
+				if (NT_STATUS_EQUAL(status, NT_STATUS_NOT_FOUND)) {
 					(*names)[i] = talloc_strdup(*names, "");
 					continue;
 				}
 
-				(*types)[i] = SID_NAME_UNKNOWN;
-				(*names)[i] = talloc_strdup(*names, "");
-
-				if (NT_STATUS_IS_OK(centry->status)) {
-					char *dom;
+				if (NT_STATUS_IS_OK(status)) {
 					have_mapped = true;
-					(*types)[i] = (enum lsa_SidType)centry_uint32(centry);
+					(*types)[i] = type;
+					(*names)[i] = name;
 
-					dom = centry_string(centry, mem_ctx);
-					if (*domain_name == NULL) {
-						*domain_name = dom;
-					} else {
-						talloc_free(dom);
+					if (dom != NULL) {
+						*domain_name = talloc_move(
+							mem_ctx, &dom);
 					}
 
-					(*names)[i] = centry_string(centry, *names);
-
-				} else if (NT_STATUS_EQUAL(centry->status, NT_STATUS_NONE_MAPPED)) {
+				} else if (NT_STATUS_EQUAL(status, NT_STATUS_NONE_MAPPED)) {
 					have_unmapped = true;
+					(*names)[i] = talloc_strdup(*names, "");
 
 				} else {
 					/* something's definitely wrong */
-					result = centry->status;
+					result = status;
 					goto error;
 				}
-
-				centry_free(centry);
 			}
 
 			if (!have_mapped) {
@@ -2159,63 +2282,91 @@ static NTSTATUS rids_to_names(struct winbindd_domain *domain,
 	return result;
 }
 
+struct wcache_u_state {
+	struct winbindd_domain *domain;
+	TALLOC_CTX *mem_ctx;
+	struct wbint_userinfo *info;
+	bool check_denied;
+	bool denied;
+};
+
+static bool wcache_parse_u(NTSTATUS status, TDB_DATA data,
+			   void *private_data)
+{
+	struct wcache_u_state *state =
+		(struct wcache_u_state *)private_data;
+
+	/*
+	 * The samlogon cache can only be looked at outside of
+	 * tdb_parse_record, see wcache_query_user.
+	 */
+
+	if (state->check_denied &&
+	    NT_STATUS_EQUAL(state->domain->last_status,
+			    NT_STATUS_ACCESS_DENIED)) {
+		state->denied = true;
+		return false;
+	}
+
+	/* if status is not ok then this is a negative hit
+	   and the rest of the data doesn't matter */
+	if (!NT_STATUS_IS_OK(status)) {
+		return true;
+	}
+	return wcache_rec_pull_u(data, state->mem_ctx, state->info);
+}
+
 NTSTATUS wcache_query_user(struct winbindd_domain *domain,
 			   TALLOC_CTX *mem_ctx,
 			   const struct dom_sid *user_sid,
 			   struct wbint_userinfo *info)
 {
 	struct winbind_cache *cache = get_cache(domain);
-	struct cache_entry *centry = NULL;
+	struct wcache_u_state state;
 	NTSTATUS status;
-	char *sid_string;
+	fstring sid_string;
+	fstring kstr;
 
 	if (cache->tdb == NULL) {
 		return NT_STATUS_NOT_FOUND;
 	}
 
-	sid_string = sid_string_tos(user_sid);
-	if (sid_string == NULL) {
-		return NT_STATUS_NO_MEMORY;
-	}
+	fstr_sprintf(kstr, "U/%s", sid_to_fstring(sid_string, user_sid));
 
-	centry = wcache_fetch(cache, domain, "U/%s", sid_string);
-	TALLOC_FREE(sid_string);
-	if (centry == NULL) {
-		return NT_STATUS_NOT_FOUND;
-	}
+	state.domain = domain;
+	state.mem_ctx = mem_ctx;
+	state.info = info;
+	state.check_denied = true;
+	state.denied = false;
 
-	/*
-	 * If we have an access denied cache entry and a cached info3
-	 * in the samlogon cache then do a query.  This will force the
-	 * rpc back end to return the info3 data.
-	 */
+	status = wcache_parse(cache, domain, kstr, wcache_parse_u, &state);
 
-	if (NT_STATUS_EQUAL(domain->last_status, NT_STATUS_ACCESS_DENIED) &&
-	    netsamlogon_cache_have(user_sid)) {
-		DEBUG(10, ("query_user: cached access denied and have cached "
-			   "info3\n"));
-		domain->last_status = NT_STATUS_OK;
-		centry_free(centry);
-		return NT_STATUS_NOT_FOUND;
+	if (state.denied) {
+		/*
+		 * If we have an access denied cache entry and a cached info3
+		 * in the samlogon cache then do a query.  This will force the
+		 * rpc back end to return the info3 data.
+		 */
+
+		if (netsamlogon_cache_have(user_sid)) {
+			DEBUG(10, ("query_user: cached access denied and have "
+				   "cached info3\n"));
+			domain->last_status = NT_STATUS_OK;
+			return NT_STATUS_NOT_FOUND;
+		}
+
+		state.check_denied = false;
+		status = wcache_parse(cache, domain, kstr, wcache_parse_u,
+				      &state);
 	}
 
-	/* if status is not ok then this is a negative hit
-	   and the rest of the data doesn't matter */
-	status = centry->status;
-	if (NT_STATUS_IS_OK(status)) {
-		info->acct_name = centry_string(centry, mem_ctx);
-		info->full_name = centry_string(centry, mem_ctx);
-		info->homedir = centry_string(centry, mem_ctx);
-		info->shell = centry_string(centry, mem_ctx);
-		info->primary_gid = centry_uint32(centry);
-		centry_sid(centry, &info->user_sid);
-		centry_sid(centry, &info->group_sid);
+	if (NT_STATUS_EQUAL(status, NT_STATUS_NOT_FOUND)) {
+		return status;
 	}
 
 	DEBUG(10,("query_user: [Cached] - cached info for domain %s status: "
 		  "%s\n", domain->name, nt_errstr(status) ));
 
-	centry_free(centry);
 	return status;
 }
 
@@ -3476,22 +3627,20 @@ static int validate_seqnum(TALLOC_CTX *mem_ctx, const char *keystr, TDB_DATA dbu
 static int validate_ns(TALLOC_CTX *mem_ctx, const char *keystr, TDB_DATA dbuf,
 		       struct tdb_validation_status *state)
 {
-	struct cache_entry *centry = create_centry_validate(keystr, dbuf, state);
-	if (!centry) {
-		return 1;
-	}
-
-	(void)centry_uint32(centry);
-	if (NT_STATUS_IS_OK(centry->status)) {
-		DOM_SID sid;
-		(void)centry_sid(centry, &sid);
-	}
-
-	centry_free(centry);
+	NTSTATUS status;
+	uint32_t seqnum;
+	enum lsa_SidType type;
+	DOM_SID sid;
 
-	if (!(state->success)) {
+	if (!wcache_rec_hdr(dbuf, &status, &seqnum) ||
+	    (NT_STATUS_IS_OK(status) &&
+	     !wcache_rec_pull_ns(dbuf, &type, &sid))) {
+		DEBUG(0,("validate_ns: Corrupt cache for key %s\n", keystr));
+		state->bad_entry = true;
+		state->success = false;
 		return 1;
 	}
+
 	DEBUG(10,("validate_ns: %s ok\n", keystr));
 	return 0;
 }
@@ -3499,22 +3648,25 @@ static int validate_ns(TALLOC_CTX *mem_ctx, const char *keystr, TDB_DATA dbuf,
 static int validate_sn(TALLOC_CTX *mem_ctx, const char *keystr, TDB_DATA dbuf,
 		       struct tdb_validation_status *state)
 {
-	struct cache_entry *centry = create_centry_validate(keystr, dbuf, state);
-	if (!centry) {
+	NTSTATUS status;
+	uint32_t seqnum;
+	enum lsa_SidType type;
+	char *domain_name = NULL;
+	char *name = NULL;
+
+	if (!wcache_rec_hdr(dbuf, &status, &seqnum) ||
+	    (NT_STATUS_IS_OK(status) &&
+	     !wcache_rec_pull_sn(dbuf, mem_ctx, &type, &domain_name,
+				 &name))) {
+		DEBUG(0,("validate_sn: Corrupt cache for key %s\n", keystr));
+		state->bad_entry = true;
+		state->success = false;
 		return 1;
 	}
 
-	if (NT_STATUS_IS_OK(centry->status)) {
-		(void)centry_uint32(centry);
-		(void)centry_string(centry, mem_ctx);
-		(void)centry_string(centry, mem_ctx);
-	}
-
-	centry_free(centry);
+	TALLOC_FREE(domain_name);
+	TALLOC_FREE(name);
 
-	if (!(state->success)) {
-		return 1;
-	}
 	DEBUG(10,("validate_sn: %s ok\n", keystr));
 	return 0;
 }
@@ -3522,26 +3674,18 @@ static int validate_sn(TALLOC_CTX *mem_ctx, const char *keystr, TDB_DATA dbuf,
 static int validate_u(TALLOC_CTX *mem_ctx, const char *keystr, TDB_DATA dbuf,
 		      struct tdb_validation_status *state)
 {
-	struct cache_entry *centry = create_centry_validate(keystr, dbuf, state);
-	DOM_SID sid;
+	NTSTATUS status;
+	uint32_t seqnum;
 
-	if (!centry) {
+	if (!wcache_rec_hdr(dbuf, &status, &seqnum) ||
+	    (NT_STATUS_IS_OK(status) &&
+	     !wcache_rec_pull_u(dbuf, NULL, NULL))) {
+		DEBUG(0,("validate_u: Corrupt cache for key %s\n", keystr));
+		state->bad_entry = true;
+		state->success = false;
 		return 1;
 	}
 
-	(void)centry_string(centry, mem_ctx);
-	(void)centry_string(centry, mem_ctx);
-	(void)centry_string(centry, mem_ctx);
-	(void)centry_string(centry, mem_ctx);
-	(void)centry_uint32(centry);
-	(void)centry_sid(centry, &sid);
-	(void)centry_sid(centry, &sid);
-
-	centry_free(centry);
-
-	if (!(state->success)) {
-		return 1;
-	}
 	DEBUG(10,("validate_u: %s ok\n", keystr));
 	return 0;
 }
@@ -0,0 +1,316 @@
+/*
+   Unix SMB/CIFS implementation.
+
+   Winbind cache: fixed layout name, sid and user records
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "includes.h"
+#include "winbindd/winbindd_cache_rec.h"
+
+#undef DBGC_CLASS
+#define DBGC_CLASS DBGC_WINBIND
+
+/****************************************************************
+ Length of a string in a record, long strings are truncated.
+****************************************************************/
+
+static uint16_t rec_strlen(const char *s)
+{
+	size_t len;
+
+	if (s == NULL) {
+		return WCACHE_REC_NULL_STRING;
+	}
+
+	len = strlen(s);
+	if (len >= WCACHE_REC_NULL_STRING) {
+		DEBUG(10, ("rec_strlen: truncating %u byte string\n",
+			   (unsigned)len));
+		len = WCACHE_REC_NULL_STRING - 1;
+	}
+	return len;
+}
+
+static size_t rec_strsize(uint16_t len)
+{
+	return (len == WCACHE_REC_NULL_STRING) ? 0 : len + 1;
+}
+
+static uint8_t *rec_put_string(uint8_t *p, const char *s, uint16_t len)
+{
+	if (len == WCACHE_REC_NULL_STRING) {
+		return p;
+	}
+	memcpy(p, s, len);
+	p[len] = '\0';
+	return p + len + 1;
+}
+
+/****************************************************************
+ Allocate a record with room for the body and strings behind the
+ header. A negative entry is just the header.
+****************************************************************/
+
+static TDB_DATA rec_start(TALLOC_CTX *mem_ctx, NTSTATUS status,
+			  uint32_t sequence_number,
+			  const void *body, size_t body_len, size_t str_size)
+{
+	TDB_DATA data = { NULL, 0 };
+
+	if (!NT_STATUS_IS_OK(status)) {
+		body_len = 0;
+		str_size = 0;
+	}
+
+	data.dsize = WCACHE_REC_HDR_SIZE + body_len + str_size;
+	data.dptr = TALLOC_ARRAY(mem_ctx, uint8_t, data.dsize);
+	if (data.dptr == NULL) {
+		data.dsize = 0;
+		return data;
+	}
+
+	SIVAL(data.dptr, 0, NT_STATUS_V(status));
+	SIVAL(data.dptr, 4, sequence_number);
+	if (body_len != 0) {
+		memcpy(data.dptr + WCACHE_REC_HDR_SIZE, body, body_len);
+	}
+	return data;
+}
+
+/****************************************************************
+ Copy the fixed body of a positive record out of the tdb.
+****************************************************************/
+
+static bool rec_get_body(TDB_DATA data, void *body, size_t body_len)
+{
+	if (data.dsize < WCACHE_REC_HDR_SIZE + body_len) {
+		return false;
+	}
+	memcpy(body, data.dptr + WCACHE_REC_HDR_SIZE, body_len);
+	return true;
+}
+
+static bool rec_sid_ok(const struct dom_sid *sid)
+{
+	return (sid->num_auths >= 0) && (sid->num_auths <= MAXSUBAUTHS);
+}
+
+/****************************************************************
+ Take the next string out of a record. With str == NULL it is
+ only checked and skipped.
+****************************************************************/
+
+static bool rec_get_string(TDB_DATA data, size_t *ofs, uint16_t len,
+			   TALLOC_CTX *mem_ctx, char **str)
+{
+	const char *p;
+
+	if (len == WCACHE_REC_NULL_STRING) {
+		if (str != NULL) {
+			*str = NULL;
+		}
+		return true;
+	}
+
+	if ((*ofs > data.dsize) || (len >= data.dsize - *ofs)) {
+		return false;
+	}
+
+	p = (const char *)data.dptr + *ofs;
+	if (p[len] != '\0') {
+		return false;
+	}
+
+	if (str != NULL) {
+		*str = talloc_strndup(mem_ctx, p, len);
+		if (*str == NULL) {
+			return false;
+		}
+	}
+
+	*ofs += len + 1;
+	return true;
+}
+
+bool wcache_rec_hdr(TDB_DATA data, NTSTATUS *status,
+		    uint32_t *sequence_number)
+{
+	if (data.dsize < WCACHE_REC_HDR_SIZE) {
+		return false;
+	}
+	*status = NT_STATUS(IVAL(data.dptr, 0));
+	*sequence_number = IVAL(data.dptr, 4);
+	return true;
+}
+
+TDB_DATA wcache_rec_push_ns(TALLOC_CTX *mem_ctx, NTSTATUS status,
+			    uint32_t sequence_number, enum lsa_SidType type,
+			    const struct dom_sid *sid)
+{
+	struct wcache_rec_ns ns;
+
+	ZERO_STRUCT(ns);
+	ns.type = type;
+	sid_copy(&ns.sid, sid);
+
+	return rec_start(mem_ctx, status, sequence_number, &ns, sizeof(ns), 0);
+}
+
+bool wcache_rec_pull_ns(TDB_DATA data, enum lsa_SidType *type,
+			struct dom_sid *sid)
+{
+	struct wcache_rec_ns ns;
+
+	if (!rec_get_body(data, &ns, sizeof(ns)) || !rec_sid_ok(&ns.sid)) {
+		return false;
+	}
+	*type = (enum lsa_SidType)ns.type;
+	sid_copy(sid, &ns.sid);
+	return true;
+}
+
+TDB_DATA wcache_rec_push_sn(TALLOC_CTX *mem_ctx, NTSTATUS status,
+			    uint32_t sequence_number, enum lsa_SidType type,
+			    const char *domain_name, const char *name)
+{
+	struct wcache_rec_sn sn;
+	TDB_DATA data;
+	uint8_t *p;
+
+	ZERO_STRUCT(sn);
+	sn.type = type;
+	sn.domain_name_len = rec_strlen(domain_name);
+	sn.name_len = rec_strlen(name);
+
+	data = rec_start(mem_ctx, status, sequence_number, &sn, sizeof(sn),
+			 rec_strsize(sn.domain_name_len)
+			 + rec_strsize(sn.name_len));
+	if ((data.dptr == NULL) || !NT_STATUS_IS_OK(status)) {
+		return data;
+	}
+
+	p = data.dptr + WCACHE_REC_HDR_SIZE + sizeof(sn);
+	p = rec_put_string(p, domain_name, sn.domain_name_len);
+	rec_put_string(p, name, sn.name_len);
+	return data;
+}
+
+/****************************************************************
+ domain_name may be NULL if the caller already has it.
+****************************************************************/
+
+bool wcache_rec_pull_sn(TDB_DATA data, TALLOC_CTX *mem_ctx,
+			enum lsa_SidType *type, char **domain_name,
+			char **name)
+{
+	struct wcache_rec_sn sn;
+	size_t ofs = WCACHE_REC_HDR_SIZE + sizeof(sn);
+
+	if (!rec_get_body(data, &sn, sizeof(sn))) {
+		return false;
+	}
+	if (!rec_get_string(data, &ofs, sn.domain_name_len, mem_ctx,
+			    domain_name)) {
+		return false;
+	}
+	if (!rec_get_string(data, &ofs, sn.name_len, mem_ctx, name)) {
+		if (domain_name != NULL) {
+			TALLOC_FREE(*domain_name);
+		}
+		return false;
+	}
+	*type = (enum lsa_SidType)sn.type;
+	return true;
+}
+
+TDB_DATA wcache_rec_push_u(TALLOC_CTX *mem_ctx, NTSTATUS status,
+			   uint32_t sequence_number,
+			   const struct wbint_userinfo *info)
+{
+	const char *strs[4];
+	struct wcache_rec_u u;
+	size_t str_size = 0;
+	TDB_DATA data;
+	uint8_t *p;
+	int i;
+
+	strs[0] = info->acct_name;
+	strs[1] = info->full_name;
+	strs[2] = info->homedir;
+	strs[3] = info->shell;
+
+	ZERO_STRUCT(u);
+	u.primary_gid = info->primary_gid;
+	sid_copy(&u.user_sid, &info->user_sid);
+	sid_copy(&u.group_sid, &info->group_sid);
+	for (i=0; i<4; i++) {
+		u.str_len[i] = rec_strlen(strs[i]);
+		str_size += rec_strsize(u.str_len[i]);
+	}
+
+	data = rec_start(mem_ctx, status, sequence_number, &u, sizeof(u),
+			 str_size);
+	if ((data.dptr == NULL) || !NT_STATUS_IS_OK(status)) {
+		return data;
+	}
+
+	p = data.dptr + WCACHE_REC_HDR_SIZE + sizeof(u);
+	for (i=0; i<4; i++) {
+		p = rec_put_string(p, strs[i], u.str_len[i]);
+	}
+	return data;
+}
+
+/****************************************************************
+ With mem_ctx == NULL only check the record.
+****************************************************************/
+
+bool wcache_rec_pull_u(TDB_DATA data, TALLOC_CTX *mem_ctx,
+		       struct wbint_userinfo *info)
+{
+	struct wcache_rec_u u;
+	size_t ofs = WCACHE_REC_HDR_SIZE + sizeof(u);
+	char *strs[4] = { NULL, NULL, NULL, NULL };
+	int i;
+
+	if (!rec_get_body(data, &u, sizeof(u)) ||
+	    !rec_sid_ok(&u.user_sid) || !rec_sid_ok(&u.group_sid)) {
+		return false;
+	}
+
+	for (i=0; i<4; i++) {
+		if (!rec_get_string(data, &ofs, u.str_len[i], mem_ctx,
+				    (mem_ctx != NULL) ? &strs[i] : NULL)) {
+			while (i > 0) {
+				TALLOC_FREE(strs[--i]);
+			}
+			return false;
+		}
+	}
+
+	if (mem_ctx == NULL) {
+		return true;
+	}
+
+	info->acct_name = strs[0];
+	info->full_name = strs[1];
+	info->homedir = strs[2];
+	info->shell = strs[3];
+	info->primary_gid = u.primary_gid;
+	sid_copy(&info->user_sid, &u.user_sid);
+	sid_copy(&info->group_sid, &u.group_sid);
+	return true;
+}
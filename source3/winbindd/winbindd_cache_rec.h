@@ -0,0 +1,85 @@
+/*
+   Unix SMB/CIFS implementation.
+
+   Winbind cache: fixed layout name, sid and user records
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _WINBINDD_CACHE_REC_H_
+#define _WINBINDD_CACHE_REC_H_
+
+#include "librpc/gen_ndr/wbint.h"
+
+/*
+ * The NS/, SN/ and U/ entries in winbindd_cache.tdb are the hottest
+ * ones. Like all other centries they start with the NTSTATUS and the
+ * domain sequence number, 4 bytes little endian each. A positive entry
+ * continues with one of the fixed size bodies below in host byte order,
+ * followed by the strings the body gives the lengths of, each with a
+ * terminating NUL. Reading an entry is one memcpy of the body straight
+ * out of the tdb mmap, no field by field decoding.
+ *
+ * The cache is local to this host and wiped when WINBINDD_CACHE_VERSION
+ * changes, so bump that whenever one of these structs changes.
+ */
+
+#define WCACHE_REC_HDR_SIZE 8
+
+/* string length for a NULL string */
+#define WCACHE_REC_NULL_STRING 0xffff
+
+/* NS/<domain>/<NAME> */
+struct wcache_rec_ns {
+	uint32_t type;
+	struct dom_sid sid;
+};
+
+/* SN/<sid>, followed by domain name and name */
+struct wcache_rec_sn {
+	uint32_t type;
+	uint16_t domain_name_len;
+	uint16_t name_len;
+};
+
+/* U/<sid>, followed by acct_name, full_name, homedir and shell */
+struct wcache_rec_u {
+	uint32_t primary_gid;
+	struct dom_sid user_sid;
+	struct dom_sid group_sid;
+	uint16_t str_len[4];
+};
+
+/* The following definitions come from winbindd/winbindd_cache_rec.c  */
+
+bool wcache_rec_hdr(TDB_DATA data, NTSTATUS *status,
+		    uint32_t *sequence_number);
+TDB_DATA wcache_rec_push_ns(TALLOC_CTX *mem_ctx, NTSTATUS status,
+			    uint32_t sequence_number, enum lsa_SidType type,
+			    const struct dom_sid *sid);
+bool wcache_rec_pull_ns(TDB_DATA data, enum lsa_SidType *type,
+			struct dom_sid *sid);
+TDB_DATA wcache_rec_push_sn(TALLOC_CTX *mem_ctx, NTSTATUS status,
+			    uint32_t sequence_number, enum lsa_SidType type,
+			    const char *domain_name, const char *name);
+bool wcache_rec_pull_sn(TDB_DATA data, TALLOC_CTX *mem_ctx,
+			enum lsa_SidType *type, char **domain_name,
+			char **name);
+TDB_DATA wcache_rec_push_u(TALLOC_CTX *mem_ctx, NTSTATUS status,
+			   uint32_t sequence_number,
+			   const struct wbint_userinfo *info);
+bool wcache_rec_pull_u(TDB_DATA data, TALLOC_CTX *mem_ctx,
+		       struct wbint_userinfo *info);
+
+#endif /* _WINBINDD_CACHE_REC_H_ */
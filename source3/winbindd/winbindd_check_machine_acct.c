@@ -62,7 +62,7 @@ struct tevent_req *winbindd_check_machine_acct_send(TALLOC_CTX *mem_ctx,
 	}
 
 	subreq = rpccli_wbint_CheckMachineAccount_send(state, ev,
-						       domain->child.rpccli);
+						       domain->rpccli);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
 	}
@@ -79,9 +79,28 @@ static const struct winbindd_child_dispatch_table domain_dispatch_table[] = {
 	}
 };
 
-void setup_domain_child(struct winbindd_domain *domain,
-			struct winbindd_child *child)
+void setup_domain_child(struct winbindd_domain *domain)
 {
-	setup_child(domain, child, domain_dispatch_table,
-		    "log.wb", domain->name);
+	int i;
+
+	if (domain->children != NULL) {
+		return;
+	}
+
+	domain->num_children = lp_winbind_max_domain_connections();
+	domain->children = SMB_MALLOC_ARRAY(struct winbindd_child,
+					    domain->num_children);
+	if (domain->children == NULL) {
+		smb_panic("setup_domain_child: malloc failed");
+	}
+	memset(domain->children, 0,
+	       sizeof(struct winbindd_child) * domain->num_children);
+
+	for (i=0; i<domain->num_children; i++) {
+		setup_child(domain, &domain->children[i],
+			    domain_dispatch_table, "log.wb", domain->name);
+	}
+
+	domain->rpccli = wbint_rpccli_create(NULL, domain, NULL);
+	SMB_ASSERT(domain->rpccli != NULL);
 }
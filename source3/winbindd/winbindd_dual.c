@@ -183,6 +183,31 @@ int wb_child_request_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
 	return 0;
 }
 
+/*
+ * Pick the child of a domain to send a request to: an idle one if there
+ * is any, the one with the shortest queue otherwise. Children that are
+ * not forked yet count as idle, they are forked on demand.
+ */
+
+struct winbindd_child *choose_domain_child(struct winbindd_domain *domain)
+{
+	struct winbindd_child *shortest = &domain->children[0];
+	size_t shortest_len = tevent_queue_length(shortest->queue);
+	int i;
+
+	for (i=0; (i<domain->num_children) && (shortest_len > 0); i++) {
+		struct winbindd_child *current = &domain->children[i];
+		size_t current_len = tevent_queue_length(current->queue);
+
+		if (current_len < shortest_len) {
+			shortest = current;
+			shortest_len = current_len;
+		}
+	}
+
+	return shortest;
+}
+
 struct wb_domain_request_state {
 	struct tevent_context *ev;
 	struct winbindd_domain *domain;
@@ -210,7 +235,8 @@ struct tevent_req *wb_domain_request_send(TALLOC_CTX *mem_ctx,
 	}
 
 	if (domain->initialized) {
-		subreq = wb_child_request_send(state, ev, &domain->child,
+		subreq = wb_child_request_send(state, ev,
+					       choose_domain_child(domain),
 					       request);
 		if (tevent_req_nomem(subreq, req)) {
 			return tevent_req_post(req, ev);
@@ -236,7 +262,8 @@ struct tevent_req *wb_domain_request_send(TALLOC_CTX *mem_ctx,
 			domain->primary ? true : false;
 		fstrcpy(state->init_req->data.init_conn.dcname, "");
 
-		subreq = wb_child_request_send(state, ev, &domain->child,
+		subreq = wb_child_request_send(state, ev,
+					       choose_domain_child(domain),
 					       state->init_req);
 		if (tevent_req_nomem(subreq, req)) {
 			return tevent_req_post(req, ev);
@@ -257,7 +284,8 @@ struct tevent_req *wb_domain_request_send(TALLOC_CTX *mem_ctx,
 	state->init_req->cmd = WINBINDD_GETDCNAME;
 	fstrcpy(state->init_req->domain_name, domain->name);
 
-	subreq = wb_child_request_send(state, ev, &domain->child, request);
+	subreq = wb_child_request_send(state, ev, choose_domain_child(domain),
+				       request);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
 	}
@@ -288,7 +316,8 @@ static void wb_domain_request_gotdc(struct tevent_req *subreq)
 
 	TALLOC_FREE(response);
 
-	subreq = wb_child_request_send(state, state->ev, &state->domain->child,
+	subreq = wb_child_request_send(state, state->ev,
+				       choose_domain_child(state->domain),
 				       state->init_req);
 	if (tevent_req_nomem(subreq, req)) {
 		return;
@@ -328,7 +357,8 @@ static void wb_domain_request_initialized(struct tevent_req *subreq)
 
 	TALLOC_FREE(response);
 
-	subreq = wb_child_request_send(state, state->ev, &state->domain->child,
+	subreq = wb_child_request_send(state, state->ev,
+				       choose_domain_child(state->domain),
 				       state->request);
 	if (tevent_req_nomem(subreq, req)) {
 		return;
@@ -1414,7 +1444,9 @@ static bool fork_domain_child(struct winbindd_child *child)
 			child);
 	}
 
+	/* Only one child of a pool changes the machine password */
 	if (child->domain && child->domain->primary &&
+	    (child == &child->domain->children[0]) &&
 	    !USE_KERBEROS_KEYTAB &&
 	    lp_server_role() == ROLE_DOMAIN_MEMBER) {
 
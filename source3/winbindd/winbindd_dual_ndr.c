@@ -59,6 +59,7 @@ static struct tevent_req *wb_ndr_dispatch_send(TALLOC_CTX *mem_ctx,
 	struct wb_ndr_dispatch_state *state;
 	struct wb_ndr_transport_priv *transport = talloc_get_type_abort(
 		cli->transport->priv, struct wb_ndr_transport_priv);
+	struct winbindd_child *child;
 	struct ndr_push *push;
 	enum ndr_err_code ndr_err;
 
@@ -99,8 +100,12 @@ static struct tevent_req *wb_ndr_dispatch_send(TALLOC_CTX *mem_ctx,
 	state->request.extra_data.data = (char *)state->req_blob.data;
 	state->request.extra_len = state->req_blob.length;
 
-	subreq = wb_child_request_send(state, ev, transport->child,
-				       &state->request);
+	child = transport->child;
+	if (child == NULL) {
+		child = choose_domain_child(transport->domain);
+	}
+
+	subreq = wb_child_request_send(state, ev, child, &state->request);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
 	}
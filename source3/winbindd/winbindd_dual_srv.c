@@ -625,3 +625,107 @@ NTSTATUS _wbint_SetHWM(pipes_struct *p, struct wbint_SetHWM *r)
 	}
 	return status;
 }
+
+/*
+ * The parent groups the ids by the idmap domain it picked, hand each
+ * group to the idmap code in one go. Unmapped ids go back with type
+ * WBINT_ID_TYPE_NOT_SPECIFIED.
+ */
+
+static NTSTATUS wbint_trans_ids(struct wbint_IdmapDomains *domains,
+				struct wbint_TransIDArray *ids,
+				bool sids_to_xids)
+{
+	struct id_map *maps, **pmaps;
+	struct dom_sid *sids;
+	uint32_t i, d, num_maps;
+	NTSTATUS status;
+
+	maps = TALLOC_ARRAY(talloc_tos(), struct id_map, ids->num_ids);
+	pmaps = TALLOC_ARRAY(talloc_tos(), struct id_map *, ids->num_ids + 1);
+	sids = TALLOC_ARRAY(talloc_tos(), struct dom_sid, ids->num_ids);
+	if ((maps == NULL) || (pmaps == NULL) || (sids == NULL)) {
+		status = NT_STATUS_NO_MEMORY;
+		goto done;
+	}
+
+	for (i=0; i<ids->num_ids; i++) {
+		if (ids->ids[i].domain_index >= domains->num_domains) {
+			ids->ids[i].type = WBINT_ID_TYPE_NOT_SPECIFIED;
+		}
+	}
+
+	for (d=0; d<domains->num_domains; d++) {
+		const char *dom_name = domains->domains[d].name;
+
+		num_maps = 0;
+
+		for (i=0; i<ids->num_ids; i++) {
+			struct wbint_TransID *id = &ids->ids[i];
+			struct id_map *map = &maps[num_maps];
+
+			if ((id->domain_index != d) ||
+			    (id->type == WBINT_ID_TYPE_NOT_SPECIFIED)) {
+				continue;
+			}
+			sid_copy(&sids[num_maps], &id->sid);
+			map->sid = &sids[num_maps];
+			map->xid.id = id->xid;
+			map->xid.type = (id->type == WBINT_ID_TYPE_UID)
+				? ID_TYPE_UID : ID_TYPE_GID;
+			map->status = ID_UNKNOWN;
+			pmaps[num_maps++] = map;
+		}
+		pmaps[num_maps] = NULL;
+
+		if (num_maps == 0) {
+			continue;
+		}
+
+		if (sids_to_xids) {
+			status = idmap_sids_to_unixids(
+				dom_name ? dom_name : "", pmaps);
+		} else {
+			status = idmap_unixids_to_sids(dom_name, pmaps);
+		}
+		if (!NT_STATUS_IS_OK(status)) {
+			goto done;
+		}
+
+		num_maps = 0;
+
+		for (i=0; i<ids->num_ids; i++) {
+			struct wbint_TransID *id = &ids->ids[i];
+			struct id_map *map;
+
+			if ((id->domain_index != d) ||
+			    (id->type == WBINT_ID_TYPE_NOT_SPECIFIED)) {
+				continue;
+			}
+			map = &maps[num_maps++];
+			if (map->status != ID_MAPPED) {
+				id->type = WBINT_ID_TYPE_NOT_SPECIFIED;
+				continue;
+			}
+			id->xid = map->xid.id;
+			sid_copy(&id->sid, map->sid);
+		}
+	}
+
+	status = NT_STATUS_OK;
+ done:
+	TALLOC_FREE(sids);
+	TALLOC_FREE(pmaps);
+	TALLOC_FREE(maps);
+	return status;
+}
+
+NTSTATUS _wbint_Sids2UnixIDs(pipes_struct *p, struct wbint_Sids2UnixIDs *r)
+{
+	return wbint_trans_ids(r->in.domains, r->out.ids, true);
+}
+
+NTSTATUS _wbint_UnixIDs2Sids(pipes_struct *p, struct wbint_UnixIDs2Sids *r)
+{
+	return wbint_trans_ids(r->in.domains, r->out.ids, false);
+}
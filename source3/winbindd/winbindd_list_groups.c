@@ -91,7 +91,7 @@ struct tevent_req *winbindd_list_groups_send(TALLOC_CTX *mem_ctx,
 		struct winbindd_list_groups_domstate *d = &state->domains[i];
 
 		d->subreq = rpccli_wbint_QueryGroupList_send(
-			state->domains, ev, d->domain->child.rpccli,
+			state->domains, ev, d->domain->rpccli,
 			&d->groups);
 		if (tevent_req_nomem(d->subreq, req)) {
 			TALLOC_FREE(state->domains);
@@ -91,7 +91,7 @@ struct tevent_req *winbindd_list_users_send(TALLOC_CTX *mem_ctx,
 		struct winbindd_list_users_domstate *d = &state->domains[i];
 
 		d->subreq = rpccli_wbint_QueryUserList_send(
-			state->domains, ev, d->domain->child.rpccli,
+			state->domains, ev, d->domain->rpccli,
 			&d->users);
 		if (tevent_req_nomem(d->subreq, req)) {
 			TALLOC_FREE(state->domains);
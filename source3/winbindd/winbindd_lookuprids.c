@@ -83,7 +83,7 @@ struct tevent_req *winbindd_lookuprids_send(TALLOC_CTX *mem_ctx,
 	}
 
 	subreq = rpccli_wbint_LookupRids_send(
-		state, ev, domain->child.rpccli, &state->rids, &state->names);
+		state, ev, domain->rpccli, &state->rids, &state->names);
 	if (tevent_req_nomem(subreq, req)) {
 		return tevent_req_post(req, ev);
 	}
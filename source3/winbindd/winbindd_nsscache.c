@@ -0,0 +1,354 @@
+/*
+   Unix SMB/CIFS implementation.
+
+   Winbind daemon - publish nss answers in a shared file
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The parent winbindd copies every successful getpw*, getgr* and
+ * sid/id mapping response into WINBINDD_SOCKET_DIR/nsscache, see
+ * nsswitch/winbind_nsscache.h for the layout. nss_winbind and
+ * libwbclient read it without a round trip to us. Only the parent
+ * writes, the children never see the requests.
+ */
+
+#include "includes.h"
+#include "winbindd.h"
+#include "nsswitch/winbind_nsscache.h"
+#include "system/shmem.h"
+
+#ifdef HAVE_MMAP
+
+static uint8_t *nsscache_map;
+static size_t nsscache_size;
+
+static char *nsscache_path(TALLOC_CTX *mem_ctx)
+{
+	return talloc_asprintf(mem_ctx, "%s/%s", get_winbind_pipe_dir(),
+			       WINBIND_NSSCACHE_NAME);
+}
+
+static struct winbind_nsscache_header *nsscache_header(void)
+{
+	return (struct winbind_nsscache_header *)nsscache_map;
+}
+
+static uint32_t *nsscache_buckets(void)
+{
+	return (uint32_t *)(nsscache_map
+			    + sizeof(struct winbind_nsscache_header));
+}
+
+/* Readers ignore the file while seqnum is odd */
+
+static void nsscache_start_write(void)
+{
+	nsscache_header()->seqnum += 1;
+	WINBIND_NSSCACHE_BARRIER();
+}
+
+static void nsscache_end_write(void)
+{
+	WINBIND_NSSCACHE_BARRIER();
+	nsscache_header()->seqnum += 1;
+}
+
+static void nsscache_clear(void)
+{
+	struct winbind_nsscache_header *hdr = nsscache_header();
+
+	memset(nsscache_buckets(), 0, hdr->num_buckets * sizeof(uint32_t));
+	hdr->used = hdr->data_ofs;
+}
+
+/****************************************************************
+ Tell clients still mapping an old nsscache file to drop it.
+****************************************************************/
+
+static void nsscache_mark_dead(const char *path)
+{
+	struct winbind_nsscache_header *hdr;
+	struct stat st;
+	void *map;
+	int fd;
+
+	fd = open(path, O_RDWR, 0);
+	if (fd == -1) {
+		return;
+	}
+
+	if ((fstat(fd, &st) == -1) ||
+	    (st.st_size < (off_t)sizeof(struct winbind_nsscache_header))) {
+		close(fd);
+		return;
+	}
+
+	map = mmap(NULL, sizeof(struct winbind_nsscache_header),
+		   PROT_READ|PROT_WRITE, MAP_FILE|MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return;
+	}
+
+	hdr = (struct winbind_nsscache_header *)map;
+	if (hdr->magic == WINBIND_NSSCACHE_MAGIC) {
+		hdr->dead = 1;
+	}
+	munmap(map, sizeof(struct winbind_nsscache_header));
+}
+
+/****************************************************************
+ Create a fresh nsscache file and replace the one a previous
+ winbindd left behind.
+****************************************************************/
+
+bool winbindd_nsscache_init(void)
+{
+	struct winbind_nsscache_header *hdr;
+	char *path, *tmp_path;
+	uint32_t num_buckets;
+	size_t size;
+	void *map;
+	int fd;
+
+	path = nsscache_path(talloc_tos());
+	if (path == NULL) {
+		return false;
+	}
+
+	nsscache_mark_dead(path);
+
+	if (!lp_winbind_nss_cache() || (lp_winbind_cache_time() == 0)) {
+		unlink(path);
+		TALLOC_FREE(path);
+		return true;
+	}
+
+	size = (size_t)lp_parm_int(-1, "winbindd", "nss cache size", 8192)
+		* 1024;
+	size = MIN(MAX(size, 64 * 1024), 1024 * 1024 * 1024);
+	num_buckets = size / 1024;
+
+	tmp_path = talloc_asprintf(talloc_tos(), "%s.tmp", path);
+	if (tmp_path == NULL) {
+		TALLOC_FREE(path);
+		return false;
+	}
+
+	fd = open(tmp_path, O_RDWR|O_CREAT|O_TRUNC, 0644);
+	if (fd == -1) {
+		DEBUG(1, ("winbindd_nsscache_init: could not create %s: %s\n",
+			  tmp_path, strerror(errno)));
+		goto fail;
+	}
+
+	if ((fchmod(fd, 0644) == -1) || (ftruncate(fd, size) == -1)) {
+		DEBUG(1, ("winbindd_nsscache_init: could not size %s: %s\n",
+			  tmp_path, strerror(errno)));
+		close(fd);
+		goto fail;
+	}
+
+	map = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_FILE|MAP_SHARED,
+		   fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		DEBUG(1, ("winbindd_nsscache_init: could not mmap %s: %s\n",
+			  tmp_path, strerror(errno)));
+		goto fail;
+	}
+
+	hdr = (struct winbind_nsscache_header *)map;
+	hdr->magic = WINBIND_NSSCACHE_MAGIC;
+	hdr->version = WINBIND_NSSCACHE_VERSION;
+	hdr->seqnum = 0;
+	hdr->dead = 0;
+	hdr->ttl = lp_winbind_cache_time();
+	hdr->num_buckets = num_buckets;
+	hdr->data_ofs = WINBIND_NSSCACHE_ALIGN(
+		sizeof(*hdr) + num_buckets * sizeof(uint32_t));
+	hdr->used = hdr->data_ofs;
+	hdr->size = size;
+
+	if (rename(tmp_path, path) == -1) {
+		DEBUG(1, ("winbindd_nsscache_init: could not rename %s: %s\n",
+			  tmp_path, strerror(errno)));
+		munmap(map, size);
+		goto fail;
+	}
+
+	nsscache_map = (uint8_t *)map;
+	nsscache_size = size;
+
+	DEBUG(3, ("winbindd_nsscache_init: publishing %u kB in %s\n",
+		  (unsigned)(size / 1024), path));
+
+	TALLOC_FREE(tmp_path);
+	TALLOC_FREE(path);
+	return true;
+
+ fail:
+	unlink(tmp_path);
+	TALLOC_FREE(tmp_path);
+	TALLOC_FREE(path);
+	return false;
+}
+
+/****************************************************************
+ Publish the response to a request that just succeeded. Called
+ before request_ok() frees the request.
+****************************************************************/
+
+void winbindd_nsscache_store(const struct winbindd_request *request,
+			     const struct winbindd_response *response)
+{
+	struct winbind_nsscache_header *hdr;
+	struct winbind_nsscache_entry *e;
+	uint8_t key[WINBIND_NSSCACHE_MAX_KEY];
+	size_t key_len, data_len, extra_len, len;
+	uint32_t *bucket;
+	uint8_t *p;
+
+	if (nsscache_map == NULL) {
+		return;
+	}
+
+	switch (request->cmd) {
+	case WINBINDD_SET_MAPPING:
+	case WINBINDD_REMOVE_MAPPING:
+	case WINBINDD_SET_HWM:
+		winbindd_nsscache_flush();
+		return;
+	default:
+		break;
+	}
+
+	key_len = winbind_nsscache_key(request->cmd, request, key, &data_len);
+	if (key_len == 0) {
+		return;
+	}
+
+	extra_len = 0;
+	if (response->length > sizeof(struct winbindd_response)) {
+		extra_len = response->length
+			- sizeof(struct winbindd_response);
+		if (response->extra_data.data == NULL) {
+			return;
+		}
+	}
+
+	hdr = nsscache_header();
+
+	len = WINBIND_NSSCACHE_ALIGN(sizeof(*e) + key_len + data_len
+				     + extra_len);
+	if (len > hdr->size - hdr->data_ofs) {
+		DEBUG(10, ("winbindd_nsscache_store: %u bytes do not fit\n",
+			   (unsigned)len));
+		return;
+	}
+
+	nsscache_start_write();
+
+	if (len > hdr->size - hdr->used) {
+		DEBUG(5, ("winbindd_nsscache_store: nsscache full, "
+			  "clearing it\n"));
+		nsscache_clear();
+	}
+
+	e = (struct winbind_nsscache_entry *)(nsscache_map + hdr->used);
+	e->cmd = request->cmd;
+	e->hash = winbind_nsscache_hash(request->cmd, key, key_len);
+	e->key_len = key_len;
+	e->data_len = data_len;
+	e->extra_len = extra_len;
+	e->stored = time(NULL);
+
+	p = (uint8_t *)(e + 1);
+	memcpy(p, key, key_len);
+	memcpy(p + key_len, &response->data, data_len);
+	if (extra_len != 0) {
+		memcpy(p + key_len + data_len, response->extra_data.data,
+		       extra_len);
+	}
+
+	bucket = &nsscache_buckets()[e->hash % hdr->num_buckets];
+	e->next = *bucket;
+	*bucket = hdr->used;
+	hdr->used += len;
+
+	nsscache_end_write();
+}
+
+/****************************************************************
+ Forget everything, for a SIGHUP or an id mapping change.
+****************************************************************/
+
+void winbindd_nsscache_flush(void)
+{
+	if (nsscache_map == NULL) {
+		return;
+	}
+
+	nsscache_start_write();
+	nsscache_clear();
+	nsscache_end_write();
+}
+
+/****************************************************************
+ The parent winbindd exits, clients have to ask winbindd again.
+****************************************************************/
+
+void winbindd_nsscache_shutdown(void)
+{
+	char *path;
+
+	if (nsscache_map == NULL) {
+		return;
+	}
+
+	nsscache_header()->dead = 1;
+	munmap(nsscache_map, nsscache_size);
+	nsscache_map = NULL;
+	nsscache_size = 0;
+
+	path = nsscache_path(talloc_tos());
+	if (path != NULL) {
+		unlink(path);
+		TALLOC_FREE(path);
+	}
+}
+
+#else
+
+bool winbindd_nsscache_init(void)
+{
+	return true;
+}
+
+void winbindd_nsscache_store(const struct winbindd_request *request,
+			     const struct winbindd_response *response)
+{
+}
+
+void winbindd_nsscache_flush(void)
+{
+}
+
+void winbindd_nsscache_shutdown(void)
+{
+}
+
+#endif
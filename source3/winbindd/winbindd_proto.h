@@ -261,8 +261,7 @@ NTSTATUS winbindd_update_creds_by_name(struct winbindd_domain *domain,
 
 /* The following definitions come from winbindd/winbindd_domain.c  */
 
-void setup_domain_child(struct winbindd_domain *domain,
-			struct winbindd_child *child);
+void setup_domain_child(struct winbindd_domain *domain);
 
 /* The following definitions come from winbindd/winbindd_dual.c  */
 
@@ -272,6 +271,7 @@ struct tevent_req *wb_child_request_send(TALLOC_CTX *mem_ctx,
 					 struct winbindd_request *request);
 int wb_child_request_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
 			  struct winbindd_response **presponse, int *err);
+struct winbindd_child *choose_domain_child(struct winbindd_domain *domain);
 struct tevent_req *wb_domain_request_send(TALLOC_CTX *mem_ctx,
 					  struct tevent_context *ev,
 					  struct winbindd_domain *domain,
@@ -386,6 +386,14 @@ void ndr_print_winbindd_domain(struct ndr_print *ndr,
 			       const char *name,
 			       const struct winbindd_domain *r);
 
+/* The following definitions come from winbindd/winbindd_nsscache.c  */
+
+bool winbindd_nsscache_init(void);
+void winbindd_nsscache_store(const struct winbindd_request *request,
+			     const struct winbindd_response *response);
+void winbindd_nsscache_flush(void);
+void winbindd_nsscache_shutdown(void);
+
 /* The following definitions come from winbindd/winbindd_pam.c  */
 
 bool check_request_flags(uint32_t flags);
@@ -575,6 +583,20 @@ struct tevent_req *winbindd_gid_to_sid_send(TALLOC_CTX *mem_ctx,
 NTSTATUS winbindd_gid_to_sid_recv(struct tevent_req *req,
 				  struct winbindd_response *response);
 
+struct tevent_req *winbindd_sids_to_xids_send(TALLOC_CTX *mem_ctx,
+					      struct tevent_context *ev,
+					      struct winbindd_cli_state *cli,
+					      struct winbindd_request *request);
+NTSTATUS winbindd_sids_to_xids_recv(struct tevent_req *req,
+				    struct winbindd_response *response);
+
+struct tevent_req *winbindd_xids_to_sids_send(TALLOC_CTX *mem_ctx,
+					      struct tevent_context *ev,
+					      struct winbindd_cli_state *cli,
+					      struct winbindd_request *request);
+NTSTATUS winbindd_xids_to_sids_recv(struct tevent_req *req,
+				    struct winbindd_response *response);
+
 struct tevent_req *winbindd_allocate_uid_send(TALLOC_CTX *mem_ctx,
 					      struct tevent_context *ev,
 					      struct winbindd_cli_state *cli,
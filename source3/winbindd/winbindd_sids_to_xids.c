@@ -0,0 +1,547 @@
+/*
+   Unix SMB/CIFS implementation.
+   async implementation of WINBINDD_SIDS_TO_XIDS
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "includes.h"
+#include "winbindd.h"
+#include "librpc/gen_ndr/cli_wbint.h"
+
+/*
+ * Map a list of sids to uids and gids in one request. The sids that are
+ * not in the idmap cache have to be looked up first to know whether we
+ * want a uid or a gid. Like wb_lookupsid we ask the domain
+ * find_lookup_domain_from_sid() gives us. Where that domain owns the
+ * sids, this is one LookupRids per domain, not one LookupSid per sid.
+ * Then all of them go to the idmap child in a single Sids2UnixIDs call.
+ */
+
+struct winbindd_sids_to_xids_state {
+	struct tevent_context *ev;
+	struct dom_sid *sids;
+	size_t num_sids;
+
+	/* One per sid, the result */
+	struct wbint_TransID *ids;
+
+	/* One per sid, what the lookups found */
+	enum lsa_SidType *types;
+	bool *found;
+	bool *cached;
+
+	int num_pending;
+
+	struct wbint_IdmapDomains idmap_doms;
+	struct wbint_TransIDArray todo;
+	uint32_t *todo_idx;
+};
+
+/* One LookupRids call, or one wb_lookupsid if domain == NULL */
+
+struct winbindd_sids_to_xids_lookup {
+	struct tevent_req *req;
+	struct winbindd_domain *domain;
+	uint32_t *idx;
+	struct wbint_RidArray rids;
+	struct wbint_Principals names;
+};
+
+static bool winbindd_sids_to_xids_cached(const struct dom_sid *sid,
+					 struct wbint_TransID *id);
+static bool winbindd_sids_to_xids_lookupsid(struct tevent_req *req,
+					    uint32_t idx);
+static void winbindd_sids_to_xids_lookuprids_done(struct tevent_req *subreq);
+static void winbindd_sids_to_xids_lookupsid_done(struct tevent_req *subreq);
+static void winbindd_sids_to_xids_lookup_finished(struct tevent_req *req);
+static void winbindd_sids_to_xids_done(struct tevent_req *subreq);
+
+struct tevent_req *winbindd_sids_to_xids_send(TALLOC_CTX *mem_ctx,
+					      struct tevent_context *ev,
+					      struct winbindd_cli_state *cli,
+					      struct winbindd_request *request)
+{
+	struct tevent_req *req, *subreq;
+	struct winbindd_sids_to_xids_state *state;
+	struct winbindd_sids_to_xids_lookup **lookups;
+	uint32_t i, j, num_lookups;
+
+	req = tevent_req_create(mem_ctx, &state,
+				struct winbindd_sids_to_xids_state);
+	if (req == NULL) {
+		return NULL;
+	}
+	state->ev = ev;
+
+	DEBUG(3, ("sids_to_xids\n"));
+
+	if ((request->extra_len == 0) ||
+	    (request->extra_data.data[request->extra_len-1] != '\0')) {
+		DEBUG(5, ("extra_data not 0-terminated\n"));
+		tevent_req_nterror(req, NT_STATUS_INVALID_PARAMETER);
+		return tevent_req_post(req, ev);
+	}
+
+	if (!parse_sidlist(state, request->extra_data.data,
+			   &state->sids, &state->num_sids)) {
+		DEBUG(5, ("parse_sidlist failed\n"));
+		tevent_req_nterror(req, NT_STATUS_INVALID_PARAMETER);
+		return tevent_req_post(req, ev);
+	}
+
+	DEBUG(10, ("num_sids: %d\n", (int)state->num_sids));
+
+	state->ids = talloc_zero_array(state, struct wbint_TransID,
+				       state->num_sids);
+	state->types = talloc_array(state, enum lsa_SidType, state->num_sids);
+	state->found = talloc_zero_array(state, bool, state->num_sids);
+	state->cached = talloc_zero_array(state, bool, state->num_sids);
+	lookups = talloc_array(talloc_tos(),
+			       struct winbindd_sids_to_xids_lookup *,
+			       state->num_sids);
+	if ((state->num_sids != 0) &&
+	    ((state->ids == NULL) || (state->types == NULL) ||
+	     (state->found == NULL) || (state->cached == NULL) ||
+	     (lookups == NULL))) {
+		tevent_req_nterror(req, NT_STATUS_NO_MEMORY);
+		return tevent_req_post(req, ev);
+	}
+
+	num_lookups = 0;
+
+	for (i=0; i<state->num_sids; i++) {
+		struct winbindd_sids_to_xids_lookup *l = NULL;
+		struct winbindd_domain *domain = NULL;
+		struct dom_sid domsid;
+		uint32_t rid = 0;
+
+		state->ids[i].type = WBINT_ID_TYPE_NOT_SPECIFIED;
+		sid_copy(&state->ids[i].sid, &state->sids[i]);
+		state->types[i] = SID_NAME_UNKNOWN;
+
+		if (winbindd_use_idmap_cache()
+		    && winbindd_sids_to_xids_cached(&state->sids[i],
+						    &state->ids[i])) {
+			state->cached[i] = true;
+			continue;
+		}
+
+		sid_copy(&domsid, &state->sids[i]);
+		if (sid_split_rid(&domsid, &rid)) {
+			domain = find_lookup_domain_from_sid(&state->sids[i]);
+		}
+
+		/*
+		 * LookupRids resolves the rids in the child's own
+		 * domain. Sids of other domains go to the lookup domain
+		 * one by one via wb_lookupsid.
+		 */
+		if ((domain != NULL) && !sid_equal(&domsid, &domain->sid)) {
+			domain = NULL;
+		}
+
+		if (domain != NULL) {
+			for (j=0; j<num_lookups; j++) {
+				if (lookups[j]->domain == domain) {
+					l = lookups[j];
+					break;
+				}
+			}
+		}
+
+		if (l == NULL) {
+			l = talloc_zero(state,
+					struct winbindd_sids_to_xids_lookup);
+			if (tevent_req_nomem(l, req)) {
+				return tevent_req_post(req, ev);
+			}
+			l->req = req;
+			l->domain = domain;
+			l->idx = talloc_array(l, uint32_t, state->num_sids);
+			l->rids.rids = talloc_array(l, uint32_t,
+						    state->num_sids);
+			if ((l->idx == NULL) || (l->rids.rids == NULL)) {
+				tevent_req_nterror(req, NT_STATUS_NO_MEMORY);
+				return tevent_req_post(req, ev);
+			}
+			lookups[num_lookups++] = l;
+		}
+
+		l->idx[l->rids.num_rids] = i;
+		l->rids.rids[l->rids.num_rids] = rid;
+		l->rids.num_rids += 1;
+	}
+
+	DEBUG(10, ("%d lookups\n", (int)num_lookups));
+
+	for (i=0; i<num_lookups; i++) {
+		struct winbindd_sids_to_xids_lookup *l = lookups[i];
+
+		if (l->domain == NULL) {
+			for (j=0; j<l->rids.num_rids; j++) {
+				if (!winbindd_sids_to_xids_lookupsid(
+					    req, l->idx[j])) {
+					return tevent_req_post(req, ev);
+				}
+			}
+			TALLOC_FREE(l);
+			continue;
+		}
+
+		subreq = rpccli_wbint_LookupRids_send(
+			l, ev, l->domain->rpccli, &l->rids, &l->names);
+		if (tevent_req_nomem(subreq, req)) {
+			return tevent_req_post(req, ev);
+		}
+		tevent_req_set_callback(
+			subreq, winbindd_sids_to_xids_lookuprids_done, l);
+		state->num_pending += 1;
+	}
+	TALLOC_FREE(lookups);
+
+	if (state->num_pending == 0) {
+		winbindd_sids_to_xids_lookup_finished(req);
+		if (tevent_req_is_in_progress(req)) {
+			return req;
+		}
+		return tevent_req_post(req, ev);
+	}
+	return req;
+}
+
+/*
+ * Answer a sid from the idmap cache. A sid with negative entries both
+ * as uid and gid is known not to map.
+ */
+
+static bool winbindd_sids_to_xids_cached(const struct dom_sid *sid,
+					 struct wbint_TransID *id)
+{
+	bool offline = is_domain_offline(find_our_domain());
+	bool expired, neg_uid, neg_gid;
+	uid_t uid;
+	gid_t gid;
+
+	neg_uid = neg_gid = false;
+
+	if (idmap_cache_find_sid2uid(sid, &uid, &expired)
+	    && (!expired || offline)) {
+		if (uid != (uid_t)-1) {
+			id->type = WBINT_ID_TYPE_UID;
+			id->xid = uid;
+			return true;
+		}
+		neg_uid = true;
+	}
+
+	if (idmap_cache_find_sid2gid(sid, &gid, &expired)
+	    && (!expired || offline)) {
+		if (gid != (gid_t)-1) {
+			id->type = WBINT_ID_TYPE_GID;
+			id->xid = gid;
+			return true;
+		}
+		neg_gid = true;
+	}
+
+	return (neg_uid && neg_gid);
+}
+
+static bool winbindd_sids_to_xids_lookupsid(struct tevent_req *req,
+					    uint32_t idx)
+{
+	struct winbindd_sids_to_xids_state *state = tevent_req_data(
+		req, struct winbindd_sids_to_xids_state);
+	struct winbindd_sids_to_xids_lookup *l;
+	struct tevent_req *subreq;
+
+	l = talloc_zero(state, struct winbindd_sids_to_xids_lookup);
+	if (tevent_req_nomem(l, req)) {
+		return false;
+	}
+	l->req = req;
+	l->idx = talloc(l, uint32_t);
+	if (tevent_req_nomem(l->idx, req)) {
+		return false;
+	}
+	l->idx[0] = idx;
+
+	subreq = wb_lookupsid_send(l, state->ev, &state->sids[idx]);
+	if (tevent_req_nomem(subreq, req)) {
+		return false;
+	}
+	tevent_req_set_callback(subreq, winbindd_sids_to_xids_lookupsid_done,
+				l);
+	state->num_pending += 1;
+	return true;
+}
+
+static void winbindd_sids_to_xids_lookuprids_done(struct tevent_req *subreq)
+{
+	struct winbindd_sids_to_xids_lookup *l = tevent_req_callback_data(
+		subreq, struct winbindd_sids_to_xids_lookup);
+	struct tevent_req *req = l->req;
+	struct winbindd_sids_to_xids_state *state = tevent_req_data(
+		req, struct winbindd_sids_to_xids_state);
+	NTSTATUS status, result;
+	uint32_t i;
+
+	status = rpccli_wbint_LookupRids_recv(subreq, l, &result);
+	TALLOC_FREE(subreq);
+	state->num_pending -= 1;
+
+	if (NT_STATUS_IS_OK(status) && NT_STATUS_IS_OK(result)
+	    && (l->names.num_principals == l->rids.num_rids)) {
+		for (i=0; i<l->rids.num_rids; i++) {
+			state->types[l->idx[i]] = l->names.principals[i].type;
+			state->found[l->idx[i]] = true;
+		}
+		TALLOC_FREE(l);
+		winbindd_sids_to_xids_lookup_finished(req);
+		return;
+	}
+
+	/*
+	 * LookupRids fails as a whole if one of the rids does not
+	 * resolve. Find out about the others one by one.
+	 */
+
+	DEBUG(10, ("LookupRids in %s failed: %s/%s, looking up %d sids "
+		   "individually\n", l->domain->name, nt_errstr(status),
+		   nt_errstr(result), (int)l->rids.num_rids));
+
+	for (i=0; i<l->rids.num_rids; i++) {
+		if (!winbindd_sids_to_xids_lookupsid(req, l->idx[i])) {
+			return;
+		}
+	}
+	TALLOC_FREE(l);
+}
+
+static void winbindd_sids_to_xids_lookupsid_done(struct tevent_req *subreq)
+{
+	struct winbindd_sids_to_xids_lookup *l = tevent_req_callback_data(
+		subreq, struct winbindd_sids_to_xids_lookup);
+	struct tevent_req *req = l->req;
+	struct winbindd_sids_to_xids_state *state = tevent_req_data(
+		req, struct winbindd_sids_to_xids_state);
+	const char *domname, *name;
+	enum lsa_SidType type;
+	NTSTATUS status;
+
+	status = wb_lookupsid_recv(subreq, talloc_tos(), &type, &domname,
+				   &name);
+	TALLOC_FREE(subreq);
+	state->num_pending -= 1;
+
+	if (NT_STATUS_IS_OK(status)) {
+		state->types[l->idx[0]] = type;
+		state->found[l->idx[0]] = true;
+	} else {
+		DEBUG(10, ("Could not look up %s: %s\n",
+			   sid_string_dbg(&state->sids[l->idx[0]]),
+			   nt_errstr(status)));
+	}
+	TALLOC_FREE(l);
+	winbindd_sids_to_xids_lookup_finished(req);
+}
+
+static uint32_t winbindd_sids_to_xids_dom_index(
+	struct winbindd_sids_to_xids_state *state, const char *name)
+{
+	struct wbint_IdmapDomains *doms = &state->idmap_doms;
+	uint32_t i;
+
+	for (i=0; i<doms->num_domains; i++) {
+		const char *dom_name = doms->domains[i].name;
+
+		if ((dom_name == NULL) ? (name == NULL)
+		    : ((name != NULL) && strequal(dom_name, name))) {
+			return i;
+		}
+	}
+
+	doms->domains[i].name = name;
+	doms->num_domains += 1;
+	return i;
+}
+
+/*
+ * All types are known, send everything that is a user or a group to
+ * the idmap child.
+ */
+
+static void winbindd_sids_to_xids_lookup_finished(struct tevent_req *req)
+{
+	struct winbindd_sids_to_xids_state *state = tevent_req_data(
+		req, struct winbindd_sids_to_xids_state);
+	struct tevent_req *subreq;
+	struct winbindd_child *child;
+	uint32_t i;
+
+	if (state->num_pending != 0) {
+		return;
+	}
+
+	state->todo.ids = talloc_array(state, struct wbint_TransID,
+				       state->num_sids);
+	state->todo_idx = talloc_array(state, uint32_t, state->num_sids);
+	state->idmap_doms.domains = talloc_array(
+		state, struct wbint_IdmapDomain, state->num_sids);
+	if ((state->num_sids != 0) &&
+	    ((state->todo.ids == NULL) || (state->todo_idx == NULL) ||
+	     (state->idmap_doms.domains == NULL))) {
+		tevent_req_nterror(req, NT_STATUS_NO_MEMORY);
+		return;
+	}
+
+	for (i=0; i<state->num_sids; i++) {
+		struct wbint_TransID *id;
+		struct winbindd_domain *domain;
+		enum wbint_IdType type;
+
+		if (state->cached[i]) {
+			continue;
+		}
+
+		switch (state->types[i]) {
+		case SID_NAME_USER:
+		case SID_NAME_COMPUTER:
+			type = WBINT_ID_TYPE_UID;
+			break;
+		case SID_NAME_DOM_GRP:
+		case SID_NAME_ALIAS:
+		case SID_NAME_WKN_GRP:
+			type = WBINT_ID_TYPE_GID;
+			break;
+		default:
+			if (!state->found[i]) {
+				continue;
+			}
+			DEBUG(5, ("Sid %s is neither a user nor a group\n",
+				  sid_string_dbg(&state->sids[i])));
+			/*
+			 * As in wb_sid2uid and wb_sid2gid, we have to set
+			 * the cache ourselves, the idmap child is not
+			 * asked for this sid.
+			 */
+			idmap_cache_set_sid2uid(&state->sids[i], -1);
+			idmap_cache_set_sid2gid(&state->sids[i], -1);
+			continue;
+		}
+
+		domain = find_domain_from_sid_noinit(&state->sids[i]);
+
+		id = &state->todo.ids[state->todo.num_ids];
+		id->type = type;
+		id->domain_index = winbindd_sids_to_xids_dom_index(
+			state, ((domain != NULL) && domain->have_idmap_config)
+			? domain->name : NULL);
+		sid_copy(&id->sid, &state->sids[i]);
+		id->xid = 0;
+
+		state->todo_idx[state->todo.num_ids] = i;
+		state->todo.num_ids += 1;
+	}
+
+	if (state->todo.num_ids == 0) {
+		tevent_req_done(req);
+		return;
+	}
+
+	child = idmap_child();
+
+	subreq = rpccli_wbint_Sids2UnixIDs_send(
+		state, state->ev, child->rpccli, &state->idmap_doms,
+		&state->todo);
+	if (tevent_req_nomem(subreq, req)) {
+		return;
+	}
+	tevent_req_set_callback(subreq, winbindd_sids_to_xids_done, req);
+}
+
+static void winbindd_sids_to_xids_done(struct tevent_req *subreq)
+{
+	struct tevent_req *req = tevent_req_callback_data(
+		subreq, struct tevent_req);
+	struct winbindd_sids_to_xids_state *state = tevent_req_data(
+		req, struct winbindd_sids_to_xids_state);
+	NTSTATUS status, result;
+	uint32_t i;
+
+	status = rpccli_wbint_Sids2UnixIDs_recv(subreq, state, &result);
+	TALLOC_FREE(subreq);
+	if (!NT_STATUS_IS_OK(status)) {
+		tevent_req_nterror(req, status);
+		return;
+	}
+	if (!NT_STATUS_IS_OK(result)) {
+		tevent_req_nterror(req, result);
+		return;
+	}
+
+	for (i=0; i<state->todo.num_ids; i++) {
+		struct wbint_TransID *id = &state->ids[state->todo_idx[i]];
+
+		id->type = state->todo.ids[i].type;
+		id->xid = state->todo.ids[i].xid;
+	}
+	tevent_req_done(req);
+}
+
+NTSTATUS winbindd_sids_to_xids_recv(struct tevent_req *req,
+				    struct winbindd_response *response)
+{
+	struct winbindd_sids_to_xids_state *state = tevent_req_data(
+		req, struct winbindd_sids_to_xids_state);
+	NTSTATUS status;
+	char *result;
+	uint32_t i;
+
+	if (tevent_req_is_nterror(req, &status)) {
+		DEBUG(5, ("Could not convert sids: %s\n", nt_errstr(status)));
+		return status;
+	}
+
+	result = talloc_strdup(response, "");
+	if (result == NULL) {
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	for (i=0; i<state->num_sids; i++) {
+		struct wbint_TransID *id = &state->ids[i];
+
+		switch (id->type) {
+		case WBINT_ID_TYPE_UID:
+			result = talloc_asprintf_append_buffer(
+				result, "U%u\n", (unsigned)id->xid);
+			break;
+		case WBINT_ID_TYPE_GID:
+			result = talloc_asprintf_append_buffer(
+				result, "G%u\n", (unsigned)id->xid);
+			break;
+		default:
+			result = talloc_asprintf_append_buffer(result, "-\n");
+			break;
+		}
+		if (result == NULL) {
+			return NT_STATUS_NO_MEMORY;
+		}
+	}
+
+	response->extra_data.data = result;
+	response->length += talloc_get_size(result);
+	return NT_STATUS_OK;
+}
@@ -66,6 +66,8 @@ static void free_domain_list(void)
 		struct winbindd_domain *next = domain->next;
 
 		DLIST_REMOVE(_domain_list, domain);
+		TALLOC_FREE(domain->rpccli);
+		SAFE_FREE(domain->children);
 		SAFE_FREE(domain);
 		domain = next;
 	}
@@ -352,8 +354,7 @@ static void trustdom_recv(void *private_data, bool success)
 						    &cache_methods,
 						    &sid);
 			if (domain) {
-				setup_domain_child(domain,
-						   &domain->child);
+				setup_domain_child(domain);
 			}
 		}
 		p=q;
@@ -609,8 +610,7 @@ bool init_domain_list(void)
 	domain = add_trusted_domain("BUILTIN", NULL, &builtin_passdb_methods,
 				    &global_sid_Builtin);
 	if (domain) {
-		setup_domain_child(domain,
-				   &domain->child);
+		setup_domain_child(domain);
 	}
 
 	/* Local SAM */
@@ -621,8 +621,7 @@ bool init_domain_list(void)
 		if ( role != ROLE_DOMAIN_MEMBER ) {
 			domain->primary = True;
 		}
-		setup_domain_child(domain,
-				   &domain->child);
+		setup_domain_child(domain);
 	}
 
 	/* Add ourselves as the first entry. */
@@ -639,8 +638,7 @@ bool init_domain_list(void)
 					     &cache_methods, &our_sid);
 		if (domain) {
 			domain->primary = True;
-			setup_domain_child(domain,
-					   &domain->child);
+			setup_domain_child(domain);
 
 			/* Even in the parent winbindd we'll need to
 			   talk to the DC, so try and see if we can
@@ -691,8 +689,7 @@ void check_domain_trusted( const char *name, const DOM_SID *user_sid )
 	domain->internal = False;
 	domain->online = True;
 
-	setup_domain_child(domain,
-			   &domain->child);
+	setup_domain_child(domain);
 
 	wcache_tdc_add_domain( domain );
 
@@ -0,0 +1,311 @@
+/*
+   Unix SMB/CIFS implementation.
+   async implementation of WINBINDD_XIDS_TO_SIDS
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "includes.h"
+#include "winbindd.h"
+#include "librpc/gen_ndr/cli_wbint.h"
+
+struct winbindd_xids_to_sids_state {
+	struct tevent_context *ev;
+
+	/* One per id, the result */
+	struct wbint_TransID *ids;
+	uint32_t num_ids;
+
+	struct wbint_IdmapDomains idmap_doms;
+	struct wbint_TransIDArray todo;
+	uint32_t *todo_idx;
+};
+
+static bool parse_xidlist(TALLOC_CTX *mem_ctx, char *xidstr,
+			  struct wbint_TransID **pids, uint32_t *pnum_ids);
+static bool winbindd_xids_to_sids_cached(struct wbint_TransID *id);
+static uint32_t winbindd_xids_to_sids_dom_index(
+	struct winbindd_xids_to_sids_state *state, uint32_t xid);
+static void winbindd_xids_to_sids_done(struct tevent_req *subreq);
+
+struct tevent_req *winbindd_xids_to_sids_send(TALLOC_CTX *mem_ctx,
+					      struct tevent_context *ev,
+					      struct winbindd_cli_state *cli,
+					      struct winbindd_request *request)
+{
+	struct tevent_req *req, *subreq;
+	struct winbindd_xids_to_sids_state *state;
+	struct winbindd_child *child;
+	uint32_t i;
+
+	req = tevent_req_create(mem_ctx, &state,
+				struct winbindd_xids_to_sids_state);
+	if (req == NULL) {
+		return NULL;
+	}
+	state->ev = ev;
+
+	DEBUG(3, ("xids_to_sids\n"));
+
+	if ((request->extra_len == 0) ||
+	    (request->extra_data.data[request->extra_len-1] != '\0')) {
+		DEBUG(5, ("extra_data not 0-terminated\n"));
+		tevent_req_nterror(req, NT_STATUS_INVALID_PARAMETER);
+		return tevent_req_post(req, ev);
+	}
+
+	if (!parse_xidlist(state, request->extra_data.data,
+			   &state->ids, &state->num_ids)) {
+		DEBUG(5, ("parse_xidlist failed\n"));
+		tevent_req_nterror(req, NT_STATUS_INVALID_PARAMETER);
+		return tevent_req_post(req, ev);
+	}
+
+	DEBUG(10, ("num_ids: %d\n", (int)state->num_ids));
+
+	state->todo.ids = talloc_array(state, struct wbint_TransID,
+				       state->num_ids);
+	state->todo_idx = talloc_array(state, uint32_t, state->num_ids);
+	state->idmap_doms.domains = talloc_array(
+		state, struct wbint_IdmapDomain, state->num_ids);
+	if ((state->num_ids != 0) &&
+	    ((state->todo.ids == NULL) || (state->todo_idx == NULL) ||
+	     (state->idmap_doms.domains == NULL))) {
+		tevent_req_nterror(req, NT_STATUS_NO_MEMORY);
+		return tevent_req_post(req, ev);
+	}
+
+	for (i=0; i<state->num_ids; i++) {
+		struct wbint_TransID *id = &state->ids[i];
+		struct wbint_TransID *todo;
+
+		if (winbindd_use_idmap_cache()
+		    && winbindd_xids_to_sids_cached(id)) {
+			continue;
+		}
+
+		todo = &state->todo.ids[state->todo.num_ids];
+		*todo = *id;
+		todo->domain_index = winbindd_xids_to_sids_dom_index(
+			state, id->xid);
+
+		state->todo_idx[state->todo.num_ids] = i;
+		state->todo.num_ids += 1;
+	}
+
+	if (state->todo.num_ids == 0) {
+		tevent_req_done(req);
+		return tevent_req_post(req, ev);
+	}
+
+	child = idmap_child();
+
+	subreq = rpccli_wbint_UnixIDs2Sids_send(
+		state, ev, child->rpccli, &state->idmap_doms, &state->todo);
+	if (tevent_req_nomem(subreq, req)) {
+		return tevent_req_post(req, ev);
+	}
+	tevent_req_set_callback(subreq, winbindd_xids_to_sids_done, req);
+	return req;
+}
+
+/*
+ * Answer an id from the idmap cache, a null sid is a negative entry.
+ */
+
+static bool winbindd_xids_to_sids_cached(struct wbint_TransID *id)
+{
+	bool expired, found;
+
+	if (id->type == WBINT_ID_TYPE_UID) {
+		found = idmap_cache_find_uid2sid(id->xid, &id->sid, &expired);
+	} else {
+		found = idmap_cache_find_gid2sid(id->xid, &id->sid, &expired);
+	}
+
+	if (!found || (expired && !idmap_is_offline())) {
+		return false;
+	}
+
+	if (is_null_sid(&id->sid)) {
+		id->type = WBINT_ID_TYPE_NOT_SPECIFIED;
+	}
+	return true;
+}
+
+/*
+ * The domain whose idmap range covers the id, like wb_uid2sid does.
+ */
+
+static uint32_t winbindd_xids_to_sids_dom_index(
+	struct winbindd_xids_to_sids_state *state, uint32_t xid)
+{
+	struct wbint_IdmapDomains *doms = &state->idmap_doms;
+	struct winbindd_domain *domain;
+	const char *name = NULL;
+	uint32_t i;
+
+	for (domain = domain_list(); domain != NULL; domain = domain->next) {
+		if (domain->have_idmap_config
+		    && (xid >= domain->id_range_low)
+		    && (xid <= domain->id_range_high)) {
+			name = domain->name;
+			break;
+		}
+	}
+
+	for (i=0; i<doms->num_domains; i++) {
+		if (doms->domains[i].name == name) {
+			return i;
+		}
+	}
+
+	doms->domains[i].name = name;
+	doms->num_domains += 1;
+	return i;
+}
+
+static void winbindd_xids_to_sids_done(struct tevent_req *subreq)
+{
+	struct tevent_req *req = tevent_req_callback_data(
+		subreq, struct tevent_req);
+	struct winbindd_xids_to_sids_state *state = tevent_req_data(
+		req, struct winbindd_xids_to_sids_state);
+	NTSTATUS status, result;
+	uint32_t i;
+
+	status = rpccli_wbint_UnixIDs2Sids_recv(subreq, state, &result);
+	TALLOC_FREE(subreq);
+	if (!NT_STATUS_IS_OK(status)) {
+		tevent_req_nterror(req, status);
+		return;
+	}
+	if (!NT_STATUS_IS_OK(result)) {
+		tevent_req_nterror(req, result);
+		return;
+	}
+
+	for (i=0; i<state->todo.num_ids; i++) {
+		struct wbint_TransID *id = &state->ids[state->todo_idx[i]];
+
+		id->type = state->todo.ids[i].type;
+		sid_copy(&id->sid, &state->todo.ids[i].sid);
+	}
+	tevent_req_done(req);
+}
+
+NTSTATUS winbindd_xids_to_sids_recv(struct tevent_req *req,
+				    struct winbindd_response *response)
+{
+	struct winbindd_xids_to_sids_state *state = tevent_req_data(
+		req, struct winbindd_xids_to_sids_state);
+	NTSTATUS status;
+	char *result;
+	uint32_t i;
+
+	if (tevent_req_is_nterror(req, &status)) {
+		DEBUG(5, ("Could not convert ids: %s\n", nt_errstr(status)));
+		return status;
+	}
+
+	result = talloc_strdup(response, "");
+	if (result == NULL) {
+		return NT_STATUS_NO_MEMORY;
+	}
+
+	for (i=0; i<state->num_ids; i++) {
+		struct wbint_TransID *id = &state->ids[i];
+
+		if (id->type == WBINT_ID_TYPE_NOT_SPECIFIED) {
+			result = talloc_asprintf_append_buffer(result, "-\n");
+		} else {
+			fstring sidstr;
+
+			result = talloc_asprintf_append_buffer(
+				result, "%s\n",
+				sid_to_fstring(sidstr, &id->sid));
+		}
+		if (result == NULL) {
+			return NT_STATUS_NO_MEMORY;
+		}
+	}
+
+	response->extra_data.data = result;
+	response->length += talloc_get_size(result);
+	return NT_STATUS_OK;
+}
+
+/*
+ * One "U<uid>" or "G<gid>" per line
+ */
+
+static bool parse_xidlist(TALLOC_CTX *mem_ctx, char *xidstr,
+			  struct wbint_TransID **pids, uint32_t *pnum_ids)
+{
+	struct wbint_TransID *ids;
+	uint32_t i, num_ids;
+	char *p;
+
+	p = xidstr;
+	num_ids = 0;
+
+	/* count ids */
+
+	while ((p = strchr(p, '\n')) != NULL) {
+		p += 1;
+		num_ids += 1;
+	}
+
+	if (num_ids == 0) {
+		*pnum_ids = 0;
+		*pids = NULL;
+		return true;
+	}
+
+	ids = talloc_zero_array(mem_ctx, struct wbint_TransID, num_ids);
+	if (ids == NULL) {
+		return false;
+	}
+
+	p = xidstr;
+
+	for (i=0; i<num_ids; i++) {
+		char *q;
+
+		switch (p[0]) {
+		case 'U':
+			ids[i].type = WBINT_ID_TYPE_UID;
+			break;
+		case 'G':
+			ids[i].type = WBINT_ID_TYPE_GID;
+			break;
+		default:
+			DEBUG(0, ("Got invalid xidstr: %s\n", p));
+			TALLOC_FREE(ids);
+			return false;
+		}
+
+		ids[i].xid = strtoul(p+1, &q, 10);
+		if ((q == p+1) || (*q != '\n')) {
+			DEBUG(0, ("Got invalid xidstr: %s\n", p));
+			TALLOC_FREE(ids);
+			return false;
+		}
+		p = q+1;
+	}
+
+	*pnum_ids = num_ids;
+	*pids = ids;
+	return true;
+}
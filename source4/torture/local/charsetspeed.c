@@ -0,0 +1,223 @@
+/*
+   Unix SMB/CIFS implementation.
+
+   local test for the speed of the ascii charset conversion fast paths
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "includes.h"
+#include "system/time.h"
+#include "../lib/util/charset/ascii.h"
+#include "torture/smbtorture.h"
+
+#define ASCII_MAXLEN 80
+
+typedef size_t (*ascii_fn)(uint8_t *dst, const uint8_t *src, size_t n);
+
+/* The byte at a time loops the kernels replace */
+
+static size_t ref_copy(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	size_t i;
+	for (i=0; i<n && src[i] != 0 && src[i] < 0x80; i++) {
+		dst[i] = src[i];
+	}
+	return i;
+}
+
+static size_t ref_widen(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	size_t i;
+	for (i=0; i<n && src[i] != 0 && src[i] < 0x80; i++) {
+		dst[2*i] = src[i];
+		dst[2*i+1] = 0;
+	}
+	return i;
+}
+
+static size_t ref_narrow(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	size_t i;
+	for (i=0; i<n && src[2*i] != 0 && src[2*i] < 0x80 &&
+		     src[2*i+1] == 0; i++) {
+		dst[i] = src[2*i];
+	}
+	return i;
+}
+
+/*
+  fill in n characters of a file name, in UTF-16LE if wide is set
+*/
+static void ascii_fill(uint8_t *buf, size_t n, bool wide)
+{
+	size_t i;
+	for (i=0; i<n; i++) {
+		uint8_t c = 'a' + (i % 26);
+		if (wide) {
+			buf[2*i] = c;
+			buf[2*i+1] = 0;
+		} else {
+			buf[i] = c;
+		}
+	}
+}
+
+/*
+  run a kernel with a non-ascii or nul character at every position of
+  every string length and compare the result with the simple loop
+*/
+static bool test_ascii_kernel(struct torture_context *tctx,
+			      ascii_fn fn, ascii_fn ref,
+			      size_t in_size, size_t out_size)
+{
+	static const uint16_t stops[] = { 0x0000, 0x0080, 0x00ff, 0x0100,
+					  0x2010, 0xd800 };
+	uint8_t src[2*ASCII_MAXLEN];
+	uint8_t dst[2*ASCII_MAXLEN+1];
+	uint8_t expected[2*ASCII_MAXLEN];
+	size_t len, pos, s;
+
+	for (len=0; len<ASCII_MAXLEN; len++) {
+	for (pos=0; pos<=len; pos++) {
+	for (s=0; s<ARRAY_SIZE(stops); s++) {
+		size_t n, n_ref;
+
+		if (in_size == 1 && stops[s] > 0xff) {
+			continue;
+		}
+
+		ascii_fill(src, len, in_size == 2);
+		if (pos < len) {
+			if (in_size == 2) {
+				SSVAL(src, 2*pos, stops[s]);
+			} else {
+				src[pos] = stops[s];
+			}
+		}
+		memset(dst, 0xaa, sizeof(dst));
+
+		n = fn(dst, src, len);
+		n_ref = ref(expected, src, len);
+
+		torture_assert(tctx, n <= n_ref,
+			       talloc_asprintf(tctx, "len %u pos %u stop 0x%x: "
+					       "converted %u, expected at most %u",
+					       (unsigned)len, (unsigned)pos,
+					       (unsigned)stops[s],
+					       (unsigned)n, (unsigned)n_ref));
+		torture_assert(tctx, memcmp(dst, expected, n*out_size) == 0,
+			       talloc_asprintf(tctx, "len %u pos %u stop 0x%x: "
+					       "wrong output",
+					       (unsigned)len, (unsigned)pos,
+					       (unsigned)stops[s]));
+		torture_assert_int_equal(tctx, dst[n*out_size], 0xaa,
+					 "wrote past the converted prefix");
+	}
+	}
+	}
+
+	return true;
+}
+
+static bool test_ascii_copy(struct torture_context *tctx)
+{
+	return test_ascii_kernel(tctx, ascii_copy, ref_copy, 1, 1);
+}
+
+static bool test_ascii_widen(struct torture_context *tctx)
+{
+	return test_ascii_kernel(tctx, ascii_widen, ref_widen, 1, 2);
+}
+
+static bool test_ascii_narrow(struct torture_context *tctx)
+{
+	return test_ascii_kernel(tctx, ascii_narrow, ref_narrow, 2, 1);
+}
+
+/*
+  convert a typical file name over and over again, with the kernel and
+  with the byte loop
+*/
+static bool test_ascii_speed(struct torture_context *tctx,
+			     const char *name, ascii_fn fn, ascii_fn ref,
+			     bool wide)
+{
+	int timelimit = torture_setting_int(tctx, "timelimit", 10);
+	int namelen = torture_setting_int(tctx, "namelen", 24);
+	uint8_t *src, *dst;
+	struct timeval tv;
+	double fn_speed, ref_speed;
+	int count;
+
+	src = talloc_array(tctx, uint8_t, 2*namelen);
+	dst = talloc_array(tctx, uint8_t, 2*namelen);
+	torture_assert(tctx, src != NULL && dst != NULL, "out of memory");
+	ascii_fill(src, namelen, wide);
+
+	torture_comment(tctx, "Testing %s speed for %d character names "
+			"for %d seconds\n", name, namelen, timelimit);
+
+	tv = timeval_current();
+	for (count=0; timeval_elapsed(&tv) < timelimit/2.0; count++) {
+		if (fn(dst, src, namelen) == 0 && namelen > 16) {
+			torture_fail(tctx, "no fast path conversion");
+		}
+	}
+	fn_speed = count/timeval_elapsed(&tv);
+
+	tv = timeval_current();
+	for (count=0; timeval_elapsed(&tv) < timelimit/2.0; count++) {
+		ref(dst, src, namelen);
+	}
+	ref_speed = count/timeval_elapsed(&tv);
+
+	torture_comment(tctx, "%s %.2f names/sec, byte loop %.2f names/sec "
+			"(%.2fx)\n", name, fn_speed, ref_speed,
+			fn_speed/ref_speed);
+
+	talloc_free(src);
+	talloc_free(dst);
+	return true;
+}
+
+static bool test_copy_speed(struct torture_context *tctx)
+{
+	return test_ascii_speed(tctx, "ascii_copy", ascii_copy, ref_copy,
+				false);
+}
+
+static bool test_widen_speed(struct torture_context *tctx)
+{
+	return test_ascii_speed(tctx, "ascii_widen", ascii_widen, ref_widen,
+				false);
+}
+
+static bool test_narrow_speed(struct torture_context *tctx)
+{
+	return test_ascii_speed(tctx, "ascii_narrow", ascii_narrow,
+				ref_narrow, true);
+}
+
+struct torture_suite *torture_local_charsetspeed(TALLOC_CTX *mem_ctx)
+{
+	struct torture_suite *s = torture_suite_create(mem_ctx, "CHARSETSPEED");
+	torture_suite_add_simple_test(s, "ascii_copy", test_ascii_copy);
+	torture_suite_add_simple_test(s, "ascii_widen", test_ascii_widen);
+	torture_suite_add_simple_test(s, "ascii_narrow", test_ascii_narrow);
+	torture_suite_add_simple_test(s, "copy_speed", test_copy_speed);
+	torture_suite_add_simple_test(s, "widen_speed", test_widen_speed);
+	torture_suite_add_simple_test(s, "narrow_speed", test_narrow_speed);
+	return s;
+}
@@ -57,6 +57,7 @@ TORTURE_LOCAL_OBJ_FILES = \
 		$(torturesrcdir)/../auth/credentials/tests/simple.o \
 		$(torturesrcdir)/local/local.o \
 		$(torturesrcdir)/local/dbspeed.o \
+		$(torturesrcdir)/local/charsetspeed.o \
 		$(torturesrcdir)/local/torture.o \
 		$(torturesrcdir)/ldb/ldb.o \
 		$(torturesrcdir)/../dsdb/common/tests/dsdb_dn.o \
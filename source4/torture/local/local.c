@@ -57,6 +57,7 @@
 	torture_local_event, 
 	torture_local_torture,
 	torture_local_dbspeed, 
+	torture_local_charsetspeed,
 	torture_local_credentials,
 	torture_ldb,
 	torture_dsdb_dn,
@@ -81,6 +82,12 @@ NTSTATUS torture_local_init(void)
 				      torture_local_crypto_md5);
 	torture_suite_add_simple_test(suite, "CRYPTO-HMACMD5", 
 				      torture_local_crypto_hmacmd5);
+	torture_suite_add_simple_test(suite, "CRYPTO-SHA256",
+				      torture_local_crypto_sha256);
+	torture_suite_add_simple_test(suite, "CRYPTO-HMACSHA256",
+				      torture_local_crypto_hmacsha256);
+	torture_suite_add_simple_test(suite, "CRYPTO-SHA256-SPEED",
+				      torture_local_crypto_sha256_speed);
 
 	for (i = 0; suite_generators[i]; i++)
 		torture_suite_add_suite(suite,
@@ -40,6 +40,7 @@ static int nprocs;
 static int open_failed;
 static int close_failed;
 static char **fnames;
+static const char *shared_fname;
 static int num_connected;
 static struct tevent_timer *report_te;
 
@@ -184,6 +185,17 @@ static void next_open(struct benchopen_state *state)
 	state->open_parms.ntcreatex.in.security_flags = 0;
 	state->open_parms.ntcreatex.in.fname = fnames[state->pending_file_num];
 
+	if (shared_fname != NULL) {
+		/* everybody opens the same file, next to the holders */
+		state->open_parms.ntcreatex.in.access_mask = SEC_FILE_READ_DATA;
+		state->open_parms.ntcreatex.in.share_access =
+			NTCREATEX_SHARE_ACCESS_READ |
+			NTCREATEX_SHARE_ACCESS_WRITE |
+			NTCREATEX_SHARE_ACCESS_DELETE;
+		state->open_parms.ntcreatex.in.open_disposition = NTCREATEX_DISP_OPEN_IF;
+		state->open_parms.ntcreatex.in.fname = shared_fname;
+	}
+
 	state->req_open = smb_raw_open_send(state->tree, &state->open_parms);
 	state->req_open->async.fn = open_completed;
 	state->req_open->async.private_data = state;
@@ -365,10 +377,35 @@ static void report_rate(struct tevent_context *ev, struct tevent_timer *te,
 	}
 }
 
-/* 
-   benchmark open calls
+/*
+  open holders handles per connection on the shared file, so that every
+  open and close in the benchmark works on a large share mode record
 */
-bool torture_bench_open(struct torture_context *torture)
+static bool open_holders(struct benchopen_state *state, int holders)
+{
+	int i, j;
+
+	printf("Holding %d handles on %s\n", nprocs*holders, shared_fname);
+	for (i=0;i<nprocs;i++) {
+		for (j=0;j<holders;j++) {
+			int fnum = smbcli_nt_create_full(
+				state[i].tree, shared_fname, 0,
+				SEC_FILE_READ_DATA, FILE_ATTRIBUTE_NORMAL,
+				NTCREATEX_SHARE_ACCESS_READ |
+				NTCREATEX_SHARE_ACCESS_WRITE |
+				NTCREATEX_SHARE_ACCESS_DELETE,
+				NTCREATEX_DISP_OPEN_IF, 0, 0);
+			if (fnum == -1) {
+				printf("Failed to open %s - %s\n", shared_fname,
+				       smbcli_errstr(state[i].tree));
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool bench_open(struct torture_context *torture, int holders)
 {
 	bool ret = true;
 	TALLOC_CTX *mem_ctx = talloc_new(torture);
@@ -422,6 +459,14 @@ bool torture_bench_open(struct torture_context *torture)
 		fnames[i] = talloc_asprintf(fnames, "%s\\file%d.dat", BASEDIR, i);
 	}
 
+	shared_fname = NULL;
+	if (holders > 0) {
+		shared_fname = fnames[0];
+		if (!open_holders(state, holders)) {
+			goto failed;
+		}
+	}
+
 	for (i=0;i<nprocs;i++) {
 		/* all connections start with the same file */
 		state[i].next_file_num = 0;
@@ -488,3 +533,21 @@ failed:
 	talloc_free(mem_ctx);
 	return false;
 }
+
+/* 
+   benchmark open calls
+*/
+bool torture_bench_open(struct torture_context *torture)
+{
+	return bench_open(torture, 0);
+}
+
+/*
+   benchmark open and close calls on a single file that many other
+   handles are open on
+*/
+bool torture_bench_open_shared(struct torture_context *torture)
+{
+	int holders = torture_setting_int(torture, "holders", 100);
+	return bench_open(torture, holders);
+}
@@ -33,6 +33,8 @@ NTSTATUS torture_raw_init(void)
 	torture_suite_add_simple_test(suite, "PING-PONG", torture_ping_pong);
 	torture_suite_add_simple_test(suite, "BENCH-LOCK", torture_bench_lock);
 	torture_suite_add_simple_test(suite, "BENCH-OPEN", torture_bench_open);
+	torture_suite_add_simple_test(suite, "BENCH-OPEN-SHARED",
+		torture_bench_open_shared);
 	torture_suite_add_simple_test(suite, "BENCH-LOOKUP",
 		torture_bench_lookup);
 	torture_suite_add_simple_test(suite, "BENCH-TCON",